@@ -0,0 +1,38 @@
+
+# Consider dependencies only in project.
+set(CMAKE_DEPENDS_IN_PROJECT_ONLY OFF)
+
+# The set of languages for which implicit dependencies are needed:
+set(CMAKE_DEPENDS_LANGUAGES
+  )
+
+# The set of dependency files which are needed:
+set(CMAKE_DEPENDS_DEPENDENCY_FILES
+  "/root/repo/client/clock_recovery.cpp" "bench/CMakeFiles/snapcast_bench.dir/__/client/clock_recovery.cpp.o" "gcc" "bench/CMakeFiles/snapcast_bench.dir/__/client/clock_recovery.cpp.o.d"
+  "/root/repo/client/decoder/pcm_decoder.cpp" "bench/CMakeFiles/snapcast_bench.dir/__/client/decoder/pcm_decoder.cpp.o" "gcc" "bench/CMakeFiles/snapcast_bench.dir/__/client/decoder/pcm_decoder.cpp.o.d"
+  "/root/repo/client/player/player.cpp" "bench/CMakeFiles/snapcast_bench.dir/__/client/player/player.cpp.o" "gcc" "bench/CMakeFiles/snapcast_bench.dir/__/client/player/player.cpp.o.d"
+  "/root/repo/client/stream.cpp" "bench/CMakeFiles/snapcast_bench.dir/__/client/stream.cpp.o" "gcc" "bench/CMakeFiles/snapcast_bench.dir/__/client/stream.cpp.o.d"
+  "/root/repo/client/time_provider.cpp" "bench/CMakeFiles/snapcast_bench.dir/__/client/time_provider.cpp.o" "gcc" "bench/CMakeFiles/snapcast_bench.dir/__/client/time_provider.cpp.o.d"
+  "/root/repo/client/variable_resampler.cpp" "bench/CMakeFiles/snapcast_bench.dir/__/client/variable_resampler.cpp.o" "gcc" "bench/CMakeFiles/snapcast_bench.dir/__/client/variable_resampler.cpp.o.d"
+  "/root/repo/server/config.cpp" "bench/CMakeFiles/snapcast_bench.dir/__/server/config.cpp.o" "gcc" "bench/CMakeFiles/snapcast_bench.dir/__/server/config.cpp.o.d"
+  "/root/repo/server/encoder/encoder_factory.cpp" "bench/CMakeFiles/snapcast_bench.dir/__/server/encoder/encoder_factory.cpp.o" "gcc" "bench/CMakeFiles/snapcast_bench.dir/__/server/encoder/encoder_factory.cpp.o.d"
+  "/root/repo/server/encoder/null_encoder.cpp" "bench/CMakeFiles/snapcast_bench.dir/__/server/encoder/null_encoder.cpp.o" "gcc" "bench/CMakeFiles/snapcast_bench.dir/__/server/encoder/null_encoder.cpp.o.d"
+  "/root/repo/server/encoder/pcm_encoder.cpp" "bench/CMakeFiles/snapcast_bench.dir/__/server/encoder/pcm_encoder.cpp.o" "gcc" "bench/CMakeFiles/snapcast_bench.dir/__/server/encoder/pcm_encoder.cpp.o.d"
+  "/root/repo/server/image_cache.cpp" "bench/CMakeFiles/snapcast_bench.dir/__/server/image_cache.cpp.o" "gcc" "bench/CMakeFiles/snapcast_bench.dir/__/server/image_cache.cpp.o.d"
+  "/root/repo/server/metrics.cpp" "bench/CMakeFiles/snapcast_bench.dir/__/server/metrics.cpp.o" "gcc" "bench/CMakeFiles/snapcast_bench.dir/__/server/metrics.cpp.o.d"
+  "/root/repo/server/streamreader/control_error.cpp" "bench/CMakeFiles/snapcast_bench.dir/__/server/streamreader/control_error.cpp.o" "gcc" "bench/CMakeFiles/snapcast_bench.dir/__/server/streamreader/control_error.cpp.o.d"
+  "/root/repo/server/streamreader/metadata.cpp" "bench/CMakeFiles/snapcast_bench.dir/__/server/streamreader/metadata.cpp.o" "gcc" "bench/CMakeFiles/snapcast_bench.dir/__/server/streamreader/metadata.cpp.o.d"
+  "/root/repo/server/streamreader/pcm_stream.cpp" "bench/CMakeFiles/snapcast_bench.dir/__/server/streamreader/pcm_stream.cpp.o" "gcc" "bench/CMakeFiles/snapcast_bench.dir/__/server/streamreader/pcm_stream.cpp.o.d"
+  "/root/repo/server/streamreader/properties.cpp" "bench/CMakeFiles/snapcast_bench.dir/__/server/streamreader/properties.cpp.o" "gcc" "bench/CMakeFiles/snapcast_bench.dir/__/server/streamreader/properties.cpp.o.d"
+  "/root/repo/server/streamreader/stream_control.cpp" "bench/CMakeFiles/snapcast_bench.dir/__/server/streamreader/stream_control.cpp.o" "gcc" "bench/CMakeFiles/snapcast_bench.dir/__/server/streamreader/stream_control.cpp.o.d"
+  "/root/repo/bench/benchmark.cpp" "bench/CMakeFiles/snapcast_bench.dir/benchmark.cpp.o" "gcc" "bench/CMakeFiles/snapcast_bench.dir/benchmark.cpp.o.d"
+  "/root/repo/bench/snapcast_bench.cpp" "bench/CMakeFiles/snapcast_bench.dir/snapcast_bench.cpp.o" "gcc" "bench/CMakeFiles/snapcast_bench.dir/snapcast_bench.cpp.o.d"
+  )
+
+# Targets to which this target links.
+set(CMAKE_TARGET_LINKED_INFO_FILES
+  "/root/repo/_bench_build/common/CMakeFiles/common.dir/DependInfo.cmake"
+  )
+
+# Fortran module output directory.
+set(CMAKE_Fortran_TARGET_MODULE_DIR "")
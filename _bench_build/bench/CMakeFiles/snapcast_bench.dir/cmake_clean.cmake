@@ -0,0 +1,47 @@
+file(REMOVE_RECURSE
+  "/root/repo/bin/snapcast_bench"
+  "/root/repo/bin/snapcast_bench.pdb"
+  "CMakeFiles/snapcast_bench.dir/__/client/clock_recovery.cpp.o"
+  "CMakeFiles/snapcast_bench.dir/__/client/clock_recovery.cpp.o.d"
+  "CMakeFiles/snapcast_bench.dir/__/client/decoder/pcm_decoder.cpp.o"
+  "CMakeFiles/snapcast_bench.dir/__/client/decoder/pcm_decoder.cpp.o.d"
+  "CMakeFiles/snapcast_bench.dir/__/client/player/player.cpp.o"
+  "CMakeFiles/snapcast_bench.dir/__/client/player/player.cpp.o.d"
+  "CMakeFiles/snapcast_bench.dir/__/client/stream.cpp.o"
+  "CMakeFiles/snapcast_bench.dir/__/client/stream.cpp.o.d"
+  "CMakeFiles/snapcast_bench.dir/__/client/time_provider.cpp.o"
+  "CMakeFiles/snapcast_bench.dir/__/client/time_provider.cpp.o.d"
+  "CMakeFiles/snapcast_bench.dir/__/client/variable_resampler.cpp.o"
+  "CMakeFiles/snapcast_bench.dir/__/client/variable_resampler.cpp.o.d"
+  "CMakeFiles/snapcast_bench.dir/__/server/config.cpp.o"
+  "CMakeFiles/snapcast_bench.dir/__/server/config.cpp.o.d"
+  "CMakeFiles/snapcast_bench.dir/__/server/encoder/encoder_factory.cpp.o"
+  "CMakeFiles/snapcast_bench.dir/__/server/encoder/encoder_factory.cpp.o.d"
+  "CMakeFiles/snapcast_bench.dir/__/server/encoder/null_encoder.cpp.o"
+  "CMakeFiles/snapcast_bench.dir/__/server/encoder/null_encoder.cpp.o.d"
+  "CMakeFiles/snapcast_bench.dir/__/server/encoder/pcm_encoder.cpp.o"
+  "CMakeFiles/snapcast_bench.dir/__/server/encoder/pcm_encoder.cpp.o.d"
+  "CMakeFiles/snapcast_bench.dir/__/server/image_cache.cpp.o"
+  "CMakeFiles/snapcast_bench.dir/__/server/image_cache.cpp.o.d"
+  "CMakeFiles/snapcast_bench.dir/__/server/metrics.cpp.o"
+  "CMakeFiles/snapcast_bench.dir/__/server/metrics.cpp.o.d"
+  "CMakeFiles/snapcast_bench.dir/__/server/streamreader/control_error.cpp.o"
+  "CMakeFiles/snapcast_bench.dir/__/server/streamreader/control_error.cpp.o.d"
+  "CMakeFiles/snapcast_bench.dir/__/server/streamreader/metadata.cpp.o"
+  "CMakeFiles/snapcast_bench.dir/__/server/streamreader/metadata.cpp.o.d"
+  "CMakeFiles/snapcast_bench.dir/__/server/streamreader/pcm_stream.cpp.o"
+  "CMakeFiles/snapcast_bench.dir/__/server/streamreader/pcm_stream.cpp.o.d"
+  "CMakeFiles/snapcast_bench.dir/__/server/streamreader/properties.cpp.o"
+  "CMakeFiles/snapcast_bench.dir/__/server/streamreader/properties.cpp.o.d"
+  "CMakeFiles/snapcast_bench.dir/__/server/streamreader/stream_control.cpp.o"
+  "CMakeFiles/snapcast_bench.dir/__/server/streamreader/stream_control.cpp.o.d"
+  "CMakeFiles/snapcast_bench.dir/benchmark.cpp.o"
+  "CMakeFiles/snapcast_bench.dir/benchmark.cpp.o.d"
+  "CMakeFiles/snapcast_bench.dir/snapcast_bench.cpp.o"
+  "CMakeFiles/snapcast_bench.dir/snapcast_bench.cpp.o.d"
+)
+
+# Per-language clean rules from dependency scanning.
+foreach(lang CXX)
+  include(CMakeFiles/snapcast_bench.dir/cmake_clean_${lang}.cmake OPTIONAL)
+endforeach()
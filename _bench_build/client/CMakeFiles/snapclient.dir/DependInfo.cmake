@@ -0,0 +1,32 @@
+
+# Consider dependencies only in project.
+set(CMAKE_DEPENDS_IN_PROJECT_ONLY OFF)
+
+# The set of languages for which implicit dependencies are needed:
+set(CMAKE_DEPENDS_LANGUAGES
+  )
+
+# The set of dependency files which are needed:
+set(CMAKE_DEPENDS_DEPENDENCY_FILES
+  "/root/repo/client/client_connection.cpp" "client/CMakeFiles/snapclient.dir/client_connection.cpp.o" "gcc" "client/CMakeFiles/snapclient.dir/client_connection.cpp.o.d"
+  "/root/repo/client/clock_recovery.cpp" "client/CMakeFiles/snapclient.dir/clock_recovery.cpp.o" "gcc" "client/CMakeFiles/snapclient.dir/clock_recovery.cpp.o.d"
+  "/root/repo/client/controller.cpp" "client/CMakeFiles/snapclient.dir/controller.cpp.o" "gcc" "client/CMakeFiles/snapclient.dir/controller.cpp.o.d"
+  "/root/repo/client/decode_worker.cpp" "client/CMakeFiles/snapclient.dir/decode_worker.cpp.o" "gcc" "client/CMakeFiles/snapclient.dir/decode_worker.cpp.o.d"
+  "/root/repo/client/decoder/null_decoder.cpp" "client/CMakeFiles/snapclient.dir/decoder/null_decoder.cpp.o" "gcc" "client/CMakeFiles/snapclient.dir/decoder/null_decoder.cpp.o.d"
+  "/root/repo/client/decoder/pcm_decoder.cpp" "client/CMakeFiles/snapclient.dir/decoder/pcm_decoder.cpp.o" "gcc" "client/CMakeFiles/snapclient.dir/decoder/pcm_decoder.cpp.o.d"
+  "/root/repo/client/player/file_player.cpp" "client/CMakeFiles/snapclient.dir/player/file_player.cpp.o" "gcc" "client/CMakeFiles/snapclient.dir/player/file_player.cpp.o.d"
+  "/root/repo/client/player/player.cpp" "client/CMakeFiles/snapclient.dir/player/player.cpp.o" "gcc" "client/CMakeFiles/snapclient.dir/player/player.cpp.o.d"
+  "/root/repo/client/snapclient.cpp" "client/CMakeFiles/snapclient.dir/snapclient.cpp.o" "gcc" "client/CMakeFiles/snapclient.dir/snapclient.cpp.o.d"
+  "/root/repo/client/stream.cpp" "client/CMakeFiles/snapclient.dir/stream.cpp.o" "gcc" "client/CMakeFiles/snapclient.dir/stream.cpp.o.d"
+  "/root/repo/client/time_provider.cpp" "client/CMakeFiles/snapclient.dir/time_provider.cpp.o" "gcc" "client/CMakeFiles/snapclient.dir/time_provider.cpp.o.d"
+  "/root/repo/client/variable_resampler.cpp" "client/CMakeFiles/snapclient.dir/variable_resampler.cpp.o" "gcc" "client/CMakeFiles/snapclient.dir/variable_resampler.cpp.o.d"
+  "/root/repo/client/zone_router.cpp" "client/CMakeFiles/snapclient.dir/zone_router.cpp.o" "gcc" "client/CMakeFiles/snapclient.dir/zone_router.cpp.o.d"
+  )
+
+# Targets to which this target links.
+set(CMAKE_TARGET_LINKED_INFO_FILES
+  "/root/repo/_bench_build/common/CMakeFiles/common.dir/DependInfo.cmake"
+  )
+
+# Fortran module output directory.
+set(CMAKE_Fortran_TARGET_MODULE_DIR "")
@@ -0,0 +1,35 @@
+file(REMOVE_RECURSE
+  "/root/repo/bin/snapclient"
+  "/root/repo/bin/snapclient.pdb"
+  "CMakeFiles/snapclient.dir/client_connection.cpp.o"
+  "CMakeFiles/snapclient.dir/client_connection.cpp.o.d"
+  "CMakeFiles/snapclient.dir/clock_recovery.cpp.o"
+  "CMakeFiles/snapclient.dir/clock_recovery.cpp.o.d"
+  "CMakeFiles/snapclient.dir/controller.cpp.o"
+  "CMakeFiles/snapclient.dir/controller.cpp.o.d"
+  "CMakeFiles/snapclient.dir/decode_worker.cpp.o"
+  "CMakeFiles/snapclient.dir/decode_worker.cpp.o.d"
+  "CMakeFiles/snapclient.dir/decoder/null_decoder.cpp.o"
+  "CMakeFiles/snapclient.dir/decoder/null_decoder.cpp.o.d"
+  "CMakeFiles/snapclient.dir/decoder/pcm_decoder.cpp.o"
+  "CMakeFiles/snapclient.dir/decoder/pcm_decoder.cpp.o.d"
+  "CMakeFiles/snapclient.dir/player/file_player.cpp.o"
+  "CMakeFiles/snapclient.dir/player/file_player.cpp.o.d"
+  "CMakeFiles/snapclient.dir/player/player.cpp.o"
+  "CMakeFiles/snapclient.dir/player/player.cpp.o.d"
+  "CMakeFiles/snapclient.dir/snapclient.cpp.o"
+  "CMakeFiles/snapclient.dir/snapclient.cpp.o.d"
+  "CMakeFiles/snapclient.dir/stream.cpp.o"
+  "CMakeFiles/snapclient.dir/stream.cpp.o.d"
+  "CMakeFiles/snapclient.dir/time_provider.cpp.o"
+  "CMakeFiles/snapclient.dir/time_provider.cpp.o.d"
+  "CMakeFiles/snapclient.dir/variable_resampler.cpp.o"
+  "CMakeFiles/snapclient.dir/variable_resampler.cpp.o.d"
+  "CMakeFiles/snapclient.dir/zone_router.cpp.o"
+  "CMakeFiles/snapclient.dir/zone_router.cpp.o.d"
+)
+
+# Per-language clean rules from dependency scanning.
+foreach(lang CXX)
+  include(CMakeFiles/snapclient.dir/cmake_clean_${lang}.cmake OPTIONAL)
+endforeach()
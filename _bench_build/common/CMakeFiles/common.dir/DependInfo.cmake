@@ -0,0 +1,26 @@
+
+# Consider dependencies only in project.
+set(CMAKE_DEPENDS_IN_PROJECT_ONLY OFF)
+
+# The set of languages for which implicit dependencies are needed:
+set(CMAKE_DEPENDS_LANGUAGES
+  )
+
+# The set of dependency files which are needed:
+set(CMAKE_DEPENDS_DEPENDENCY_FILES
+  "/root/repo/common/base64.cpp" "common/CMakeFiles/common.dir/base64.cpp.o" "gcc" "common/CMakeFiles/common.dir/base64.cpp.o.d"
+  "/root/repo/common/daemon.cpp" "common/CMakeFiles/common.dir/daemon.cpp.o" "gcc" "common/CMakeFiles/common.dir/daemon.cpp.o.d"
+  "/root/repo/common/resampler.cpp" "common/CMakeFiles/common.dir/resampler.cpp.o" "gcc" "common/CMakeFiles/common.dir/resampler.cpp.o.d"
+  "/root/repo/common/sample_format.cpp" "common/CMakeFiles/common.dir/sample_format.cpp.o" "gcc" "common/CMakeFiles/common.dir/sample_format.cpp.o.d"
+  "/root/repo/common/stream_uri.cpp" "common/CMakeFiles/common.dir/stream_uri.cpp.o" "gcc" "common/CMakeFiles/common.dir/stream_uri.cpp.o.d"
+  "/root/repo/common/utils/file_utils.cpp" "common/CMakeFiles/common.dir/utils/file_utils.cpp.o" "gcc" "common/CMakeFiles/common.dir/utils/file_utils.cpp.o.d"
+  "/root/repo/common/utils/pcm_utils.cpp" "common/CMakeFiles/common.dir/utils/pcm_utils.cpp.o" "gcc" "common/CMakeFiles/common.dir/utils/pcm_utils.cpp.o.d"
+  "/root/repo/common/utils/string_utils.cpp" "common/CMakeFiles/common.dir/utils/string_utils.cpp.o" "gcc" "common/CMakeFiles/common.dir/utils/string_utils.cpp.o.d"
+  )
+
+# Targets to which this target links.
+set(CMAKE_TARGET_LINKED_INFO_FILES
+  )
+
+# Fortran module output directory.
+set(CMAKE_Fortran_TARGET_MODULE_DIR "")
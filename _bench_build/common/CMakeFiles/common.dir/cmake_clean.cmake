@@ -0,0 +1,25 @@
+file(REMOVE_RECURSE
+  "/root/repo/bin/libcommon.a"
+  "/root/repo/bin/libcommon.pdb"
+  "CMakeFiles/common.dir/base64.cpp.o"
+  "CMakeFiles/common.dir/base64.cpp.o.d"
+  "CMakeFiles/common.dir/daemon.cpp.o"
+  "CMakeFiles/common.dir/daemon.cpp.o.d"
+  "CMakeFiles/common.dir/resampler.cpp.o"
+  "CMakeFiles/common.dir/resampler.cpp.o.d"
+  "CMakeFiles/common.dir/sample_format.cpp.o"
+  "CMakeFiles/common.dir/sample_format.cpp.o.d"
+  "CMakeFiles/common.dir/stream_uri.cpp.o"
+  "CMakeFiles/common.dir/stream_uri.cpp.o.d"
+  "CMakeFiles/common.dir/utils/file_utils.cpp.o"
+  "CMakeFiles/common.dir/utils/file_utils.cpp.o.d"
+  "CMakeFiles/common.dir/utils/pcm_utils.cpp.o"
+  "CMakeFiles/common.dir/utils/pcm_utils.cpp.o.d"
+  "CMakeFiles/common.dir/utils/string_utils.cpp.o"
+  "CMakeFiles/common.dir/utils/string_utils.cpp.o.d"
+)
+
+# Per-language clean rules from dependency scanning.
+foreach(lang CXX)
+  include(CMakeFiles/common.dir/cmake_clean_${lang}.cmake OPTIONAL)
+endforeach()
@@ -0,0 +1,57 @@
+
+# Consider dependencies only in project.
+set(CMAKE_DEPENDS_IN_PROJECT_ONLY OFF)
+
+# The set of languages for which implicit dependencies are needed:
+set(CMAKE_DEPENDS_LANGUAGES
+  )
+
+# The set of dependency files which are needed:
+set(CMAKE_DEPENDS_DEPENDENCY_FILES
+  "/root/repo/server/authinfo.cpp" "server/CMakeFiles/snapserver.dir/authinfo.cpp.o" "gcc" "server/CMakeFiles/snapserver.dir/authinfo.cpp.o.d"
+  "/root/repo/server/config.cpp" "server/CMakeFiles/snapserver.dir/config.cpp.o" "gcc" "server/CMakeFiles/snapserver.dir/config.cpp.o.d"
+  "/root/repo/server/control_dispatch.cpp" "server/CMakeFiles/snapserver.dir/control_dispatch.cpp.o" "gcc" "server/CMakeFiles/snapserver.dir/control_dispatch.cpp.o.d"
+  "/root/repo/server/control_encoding.cpp" "server/CMakeFiles/snapserver.dir/control_encoding.cpp.o" "gcc" "server/CMakeFiles/snapserver.dir/control_encoding.cpp.o.d"
+  "/root/repo/server/control_requests.cpp" "server/CMakeFiles/snapserver.dir/control_requests.cpp.o" "gcc" "server/CMakeFiles/snapserver.dir/control_requests.cpp.o.d"
+  "/root/repo/server/control_server.cpp" "server/CMakeFiles/snapserver.dir/control_server.cpp.o" "gcc" "server/CMakeFiles/snapserver.dir/control_server.cpp.o.d"
+  "/root/repo/server/control_session.cpp" "server/CMakeFiles/snapserver.dir/control_session.cpp.o" "gcc" "server/CMakeFiles/snapserver.dir/control_session.cpp.o.d"
+  "/root/repo/server/control_session_http.cpp" "server/CMakeFiles/snapserver.dir/control_session_http.cpp.o" "gcc" "server/CMakeFiles/snapserver.dir/control_session_http.cpp.o.d"
+  "/root/repo/server/control_session_tcp.cpp" "server/CMakeFiles/snapserver.dir/control_session_tcp.cpp.o" "gcc" "server/CMakeFiles/snapserver.dir/control_session_tcp.cpp.o.d"
+  "/root/repo/server/control_session_ws.cpp" "server/CMakeFiles/snapserver.dir/control_session_ws.cpp.o" "gcc" "server/CMakeFiles/snapserver.dir/control_session_ws.cpp.o.d"
+  "/root/repo/server/encoder/encoder_factory.cpp" "server/CMakeFiles/snapserver.dir/encoder/encoder_factory.cpp.o" "gcc" "server/CMakeFiles/snapserver.dir/encoder/encoder_factory.cpp.o.d"
+  "/root/repo/server/encoder/null_encoder.cpp" "server/CMakeFiles/snapserver.dir/encoder/null_encoder.cpp.o" "gcc" "server/CMakeFiles/snapserver.dir/encoder/null_encoder.cpp.o.d"
+  "/root/repo/server/encoder/pcm_encoder.cpp" "server/CMakeFiles/snapserver.dir/encoder/pcm_encoder.cpp.o" "gcc" "server/CMakeFiles/snapserver.dir/encoder/pcm_encoder.cpp.o.d"
+  "/root/repo/server/file_cache.cpp" "server/CMakeFiles/snapserver.dir/file_cache.cpp.o" "gcc" "server/CMakeFiles/snapserver.dir/file_cache.cpp.o.d"
+  "/root/repo/server/image_cache.cpp" "server/CMakeFiles/snapserver.dir/image_cache.cpp.o" "gcc" "server/CMakeFiles/snapserver.dir/image_cache.cpp.o.d"
+  "/root/repo/server/metrics.cpp" "server/CMakeFiles/snapserver.dir/metrics.cpp.o" "gcc" "server/CMakeFiles/snapserver.dir/metrics.cpp.o.d"
+  "/root/repo/server/server.cpp" "server/CMakeFiles/snapserver.dir/server.cpp.o" "gcc" "server/CMakeFiles/snapserver.dir/server.cpp.o.d"
+  "/root/repo/server/snapserver.cpp" "server/CMakeFiles/snapserver.dir/snapserver.cpp.o" "gcc" "server/CMakeFiles/snapserver.dir/snapserver.cpp.o.d"
+  "/root/repo/server/status_cache.cpp" "server/CMakeFiles/snapserver.dir/status_cache.cpp.o" "gcc" "server/CMakeFiles/snapserver.dir/status_cache.cpp.o.d"
+  "/root/repo/server/stream_server.cpp" "server/CMakeFiles/snapserver.dir/stream_server.cpp.o" "gcc" "server/CMakeFiles/snapserver.dir/stream_server.cpp.o.d"
+  "/root/repo/server/stream_session.cpp" "server/CMakeFiles/snapserver.dir/stream_session.cpp.o" "gcc" "server/CMakeFiles/snapserver.dir/stream_session.cpp.o.d"
+  "/root/repo/server/stream_session_tcp.cpp" "server/CMakeFiles/snapserver.dir/stream_session_tcp.cpp.o" "gcc" "server/CMakeFiles/snapserver.dir/stream_session_tcp.cpp.o.d"
+  "/root/repo/server/stream_session_ws.cpp" "server/CMakeFiles/snapserver.dir/stream_session_ws.cpp.o" "gcc" "server/CMakeFiles/snapserver.dir/stream_session_ws.cpp.o.d"
+  "/root/repo/server/streamreader/airplay_stream.cpp" "server/CMakeFiles/snapserver.dir/streamreader/airplay_stream.cpp.o" "gcc" "server/CMakeFiles/snapserver.dir/streamreader/airplay_stream.cpp.o.d"
+  "/root/repo/server/streamreader/control_error.cpp" "server/CMakeFiles/snapserver.dir/streamreader/control_error.cpp.o" "gcc" "server/CMakeFiles/snapserver.dir/streamreader/control_error.cpp.o.d"
+  "/root/repo/server/streamreader/file_stream.cpp" "server/CMakeFiles/snapserver.dir/streamreader/file_stream.cpp.o" "gcc" "server/CMakeFiles/snapserver.dir/streamreader/file_stream.cpp.o.d"
+  "/root/repo/server/streamreader/librespot_stream.cpp" "server/CMakeFiles/snapserver.dir/streamreader/librespot_stream.cpp.o" "gcc" "server/CMakeFiles/snapserver.dir/streamreader/librespot_stream.cpp.o.d"
+  "/root/repo/server/streamreader/meta_stream.cpp" "server/CMakeFiles/snapserver.dir/streamreader/meta_stream.cpp.o" "gcc" "server/CMakeFiles/snapserver.dir/streamreader/meta_stream.cpp.o.d"
+  "/root/repo/server/streamreader/metadata.cpp" "server/CMakeFiles/snapserver.dir/streamreader/metadata.cpp.o" "gcc" "server/CMakeFiles/snapserver.dir/streamreader/metadata.cpp.o.d"
+  "/root/repo/server/streamreader/pcm_stream.cpp" "server/CMakeFiles/snapserver.dir/streamreader/pcm_stream.cpp.o" "gcc" "server/CMakeFiles/snapserver.dir/streamreader/pcm_stream.cpp.o.d"
+  "/root/repo/server/streamreader/pipe_stream.cpp" "server/CMakeFiles/snapserver.dir/streamreader/pipe_stream.cpp.o" "gcc" "server/CMakeFiles/snapserver.dir/streamreader/pipe_stream.cpp.o.d"
+  "/root/repo/server/streamreader/process_stream.cpp" "server/CMakeFiles/snapserver.dir/streamreader/process_stream.cpp.o" "gcc" "server/CMakeFiles/snapserver.dir/streamreader/process_stream.cpp.o.d"
+  "/root/repo/server/streamreader/properties.cpp" "server/CMakeFiles/snapserver.dir/streamreader/properties.cpp.o" "gcc" "server/CMakeFiles/snapserver.dir/streamreader/properties.cpp.o.d"
+  "/root/repo/server/streamreader/stream_control.cpp" "server/CMakeFiles/snapserver.dir/streamreader/stream_control.cpp.o" "gcc" "server/CMakeFiles/snapserver.dir/streamreader/stream_control.cpp.o.d"
+  "/root/repo/server/streamreader/stream_manager.cpp" "server/CMakeFiles/snapserver.dir/streamreader/stream_manager.cpp.o" "gcc" "server/CMakeFiles/snapserver.dir/streamreader/stream_manager.cpp.o.d"
+  "/root/repo/server/streamreader/tcp_stream.cpp" "server/CMakeFiles/snapserver.dir/streamreader/tcp_stream.cpp.o" "gcc" "server/CMakeFiles/snapserver.dir/streamreader/tcp_stream.cpp.o.d"
+  "/root/repo/server/streamreader/watchdog.cpp" "server/CMakeFiles/snapserver.dir/streamreader/watchdog.cpp.o" "gcc" "server/CMakeFiles/snapserver.dir/streamreader/watchdog.cpp.o.d"
+  "/root/repo/server/subscriptions.cpp" "server/CMakeFiles/snapserver.dir/subscriptions.cpp.o" "gcc" "server/CMakeFiles/snapserver.dir/subscriptions.cpp.o.d"
+  )
+
+# Targets to which this target links.
+set(CMAKE_TARGET_LINKED_INFO_FILES
+  "/root/repo/_bench_build/common/CMakeFiles/common.dir/DependInfo.cmake"
+  )
+
+# Fortran module output directory.
+set(CMAKE_Fortran_TARGET_MODULE_DIR "")
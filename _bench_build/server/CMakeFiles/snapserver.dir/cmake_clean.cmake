@@ -0,0 +1,85 @@
+file(REMOVE_RECURSE
+  "/root/repo/bin/snapserver"
+  "/root/repo/bin/snapserver.pdb"
+  "CMakeFiles/snapserver.dir/authinfo.cpp.o"
+  "CMakeFiles/snapserver.dir/authinfo.cpp.o.d"
+  "CMakeFiles/snapserver.dir/config.cpp.o"
+  "CMakeFiles/snapserver.dir/config.cpp.o.d"
+  "CMakeFiles/snapserver.dir/control_dispatch.cpp.o"
+  "CMakeFiles/snapserver.dir/control_dispatch.cpp.o.d"
+  "CMakeFiles/snapserver.dir/control_encoding.cpp.o"
+  "CMakeFiles/snapserver.dir/control_encoding.cpp.o.d"
+  "CMakeFiles/snapserver.dir/control_requests.cpp.o"
+  "CMakeFiles/snapserver.dir/control_requests.cpp.o.d"
+  "CMakeFiles/snapserver.dir/control_server.cpp.o"
+  "CMakeFiles/snapserver.dir/control_server.cpp.o.d"
+  "CMakeFiles/snapserver.dir/control_session.cpp.o"
+  "CMakeFiles/snapserver.dir/control_session.cpp.o.d"
+  "CMakeFiles/snapserver.dir/control_session_http.cpp.o"
+  "CMakeFiles/snapserver.dir/control_session_http.cpp.o.d"
+  "CMakeFiles/snapserver.dir/control_session_tcp.cpp.o"
+  "CMakeFiles/snapserver.dir/control_session_tcp.cpp.o.d"
+  "CMakeFiles/snapserver.dir/control_session_ws.cpp.o"
+  "CMakeFiles/snapserver.dir/control_session_ws.cpp.o.d"
+  "CMakeFiles/snapserver.dir/encoder/encoder_factory.cpp.o"
+  "CMakeFiles/snapserver.dir/encoder/encoder_factory.cpp.o.d"
+  "CMakeFiles/snapserver.dir/encoder/null_encoder.cpp.o"
+  "CMakeFiles/snapserver.dir/encoder/null_encoder.cpp.o.d"
+  "CMakeFiles/snapserver.dir/encoder/pcm_encoder.cpp.o"
+  "CMakeFiles/snapserver.dir/encoder/pcm_encoder.cpp.o.d"
+  "CMakeFiles/snapserver.dir/file_cache.cpp.o"
+  "CMakeFiles/snapserver.dir/file_cache.cpp.o.d"
+  "CMakeFiles/snapserver.dir/image_cache.cpp.o"
+  "CMakeFiles/snapserver.dir/image_cache.cpp.o.d"
+  "CMakeFiles/snapserver.dir/metrics.cpp.o"
+  "CMakeFiles/snapserver.dir/metrics.cpp.o.d"
+  "CMakeFiles/snapserver.dir/server.cpp.o"
+  "CMakeFiles/snapserver.dir/server.cpp.o.d"
+  "CMakeFiles/snapserver.dir/snapserver.cpp.o"
+  "CMakeFiles/snapserver.dir/snapserver.cpp.o.d"
+  "CMakeFiles/snapserver.dir/status_cache.cpp.o"
+  "CMakeFiles/snapserver.dir/status_cache.cpp.o.d"
+  "CMakeFiles/snapserver.dir/stream_server.cpp.o"
+  "CMakeFiles/snapserver.dir/stream_server.cpp.o.d"
+  "CMakeFiles/snapserver.dir/stream_session.cpp.o"
+  "CMakeFiles/snapserver.dir/stream_session.cpp.o.d"
+  "CMakeFiles/snapserver.dir/stream_session_tcp.cpp.o"
+  "CMakeFiles/snapserver.dir/stream_session_tcp.cpp.o.d"
+  "CMakeFiles/snapserver.dir/stream_session_ws.cpp.o"
+  "CMakeFiles/snapserver.dir/stream_session_ws.cpp.o.d"
+  "CMakeFiles/snapserver.dir/streamreader/airplay_stream.cpp.o"
+  "CMakeFiles/snapserver.dir/streamreader/airplay_stream.cpp.o.d"
+  "CMakeFiles/snapserver.dir/streamreader/control_error.cpp.o"
+  "CMakeFiles/snapserver.dir/streamreader/control_error.cpp.o.d"
+  "CMakeFiles/snapserver.dir/streamreader/file_stream.cpp.o"
+  "CMakeFiles/snapserver.dir/streamreader/file_stream.cpp.o.d"
+  "CMakeFiles/snapserver.dir/streamreader/librespot_stream.cpp.o"
+  "CMakeFiles/snapserver.dir/streamreader/librespot_stream.cpp.o.d"
+  "CMakeFiles/snapserver.dir/streamreader/meta_stream.cpp.o"
+  "CMakeFiles/snapserver.dir/streamreader/meta_stream.cpp.o.d"
+  "CMakeFiles/snapserver.dir/streamreader/metadata.cpp.o"
+  "CMakeFiles/snapserver.dir/streamreader/metadata.cpp.o.d"
+  "CMakeFiles/snapserver.dir/streamreader/pcm_stream.cpp.o"
+  "CMakeFiles/snapserver.dir/streamreader/pcm_stream.cpp.o.d"
+  "CMakeFiles/snapserver.dir/streamreader/pipe_stream.cpp.o"
+  "CMakeFiles/snapserver.dir/streamreader/pipe_stream.cpp.o.d"
+  "CMakeFiles/snapserver.dir/streamreader/process_stream.cpp.o"
+  "CMakeFiles/snapserver.dir/streamreader/process_stream.cpp.o.d"
+  "CMakeFiles/snapserver.dir/streamreader/properties.cpp.o"
+  "CMakeFiles/snapserver.dir/streamreader/properties.cpp.o.d"
+  "CMakeFiles/snapserver.dir/streamreader/stream_control.cpp.o"
+  "CMakeFiles/snapserver.dir/streamreader/stream_control.cpp.o.d"
+  "CMakeFiles/snapserver.dir/streamreader/stream_manager.cpp.o"
+  "CMakeFiles/snapserver.dir/streamreader/stream_manager.cpp.o.d"
+  "CMakeFiles/snapserver.dir/streamreader/tcp_stream.cpp.o"
+  "CMakeFiles/snapserver.dir/streamreader/tcp_stream.cpp.o.d"
+  "CMakeFiles/snapserver.dir/streamreader/watchdog.cpp.o"
+  "CMakeFiles/snapserver.dir/streamreader/watchdog.cpp.o.d"
+  "CMakeFiles/snapserver.dir/subscriptions.cpp.o"
+  "CMakeFiles/snapserver.dir/subscriptions.cpp.o.d"
+)
+
+# Per-language clean rules from dependency scanning.
+foreach(lang CXX)
+  include(CMakeFiles/snapserver.dir/cmake_clean_${lang}.cmake OPTIONAL)
+endforeach()
@@ -0,0 +1,178 @@
+/***
+    This file is part of snapcast
+    Copyright (C) 2014-2025  Johannes Pohl
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+***/
+
+// prototype/interface header file
+#include "benchmark.hpp"
+
+// local headers
+#include "common/version.hpp"
+
+// standard headers
+#include <algorithm>
+#include <iomanip>
+#include <iostream>
+#include <map>
+
+
+namespace bench
+{
+
+namespace
+{
+
+using Clock = std::chrono::steady_clock;
+
+/// @return duration of @p iterations calls of @p operation
+std::chrono::nanoseconds measure(const std::function<void()>& operation, uint64_t iterations)
+{
+    auto start = Clock::now();
+    for (uint64_t n = 0; n < iterations; ++n)
+        operation();
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - start);
+}
+
+} // namespace
+
+
+double Result::realtimeFactor() const
+{
+    if ((audio_ns_per_op <= 0) || (ns_per_op <= 0))
+        return 0;
+    return audio_ns_per_op / ns_per_op;
+}
+
+
+json Result::toJson() const
+{
+    json j;
+    j["name"] = name;
+    j["iterations"] = iterations;
+    j["ns_per_op"] = ns_per_op;
+    j["ns_per_op_min"] = ns_per_op_min;
+    if (audio_ns_per_op > 0)
+        j["realtime_factor"] = realtimeFactor();
+    return j;
+}
+
+
+Runner::Runner(Settings settings) : settings_(std::move(settings)), filter_(settings_.filter.empty() ? ".*" : settings_.filter)
+{
+    settings_.repetitions = std::max<size_t>(settings_.repetitions, 1);
+}
+
+
+bool Runner::enabled(const std::string& name) const
+{
+    return std::regex_search(name, filter_);
+}
+
+
+void Runner::run(const std::string& name, const std::function<void()>& operation, std::chrono::nanoseconds audio_duration)
+{
+    if (!enabled(name))
+        return;
+
+    if (settings_.list_only)
+    {
+        std::cout << name << "\n";
+        return;
+    }
+
+    // warm up caches and lazily initialized state, then calibrate the number of iterations
+    // by doubling until a run takes at least 1/10 of min_time
+    operation();
+    uint64_t iterations = 1;
+    auto min_time = std::chrono::duration_cast<std::chrono::nanoseconds>(settings_.min_time);
+    auto duration = measure(operation, iterations);
+    while (duration < min_time / 10)
+    {
+        iterations *= 2;
+        duration = measure(operation, iterations);
+    }
+    if (duration < min_time)
+        iterations = static_cast<uint64_t>(static_cast<double>(iterations) * static_cast<double>(min_time.count()) / static_cast<double>(duration.count())) + 1;
+
+    std::vector<double> ns_per_op;
+    for (size_t n = 0; n < settings_.repetitions; ++n)
+        ns_per_op.push_back(static_cast<double>(measure(operation, iterations).count()) / static_cast<double>(iterations));
+    std::sort(ns_per_op.begin(), ns_per_op.end());
+
+    Result result;
+    result.name = name;
+    result.iterations = iterations;
+    result.ns_per_op = ns_per_op[ns_per_op.size() / 2];
+    result.ns_per_op_min = ns_per_op.front();
+    result.audio_ns_per_op = static_cast<double>(audio_duration.count());
+
+    std::cout << std::left << std::setw(56) << name << std::right << std::setw(14) << std::fixed << std::setprecision(1) << result.ns_per_op << " ns/op";
+    if (result.audio_ns_per_op > 0)
+        std::cout << std::setw(12) << std::setprecision(1) << result.realtimeFactor() << "x realtime";
+    std::cout << "\n" << std::flush;
+
+    results_.push_back(std::move(result));
+}
+
+
+const std::vector<Result>& Runner::results() const
+{
+    return results_;
+}
+
+
+json Runner::toJson() const
+{
+    json j;
+    j["version"] = version::code;
+    j["revision"] = version::rev(8);
+    j["settings"]["min_time_ms"] = settings_.min_time.count();
+    j["settings"]["repetitions"] = settings_.repetitions;
+    j["results"] = json::array();
+    for (const auto& result : results_)
+        j["results"].push_back(result.toJson());
+    return j;
+}
+
+
+std::vector<Comparison> compare(const json& baseline, const std::vector<Result>& results, double tolerance_percent)
+{
+    std::map<std::string, double> baseline_ns;
+    if (baseline.contains("results"))
+    {
+        for (const auto& result : baseline["results"])
+            baseline_ns[result.at("name").get<std::string>()] = result.at("ns_per_op").get<double>();
+    }
+
+    std::vector<Comparison> comparisons;
+    for (const auto& result : results)
+    {
+        auto iter = baseline_ns.find(result.name);
+        if ((iter == baseline_ns.end()) || (iter->second <= 0))
+            continue;
+
+        Comparison comparison;
+        comparison.name = result.name;
+        comparison.baseline_ns = iter->second;
+        comparison.current_ns = result.ns_per_op;
+        comparison.change_percent = 100. * (result.ns_per_op - iter->second) / iter->second;
+        comparison.regression = (comparison.change_percent > tolerance_percent);
+        comparisons.push_back(comparison);
+    }
+    return comparisons;
+}
+
+} // namespace bench
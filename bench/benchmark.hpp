@@ -0,0 +1,142 @@
+/***
+    This file is part of snapcast
+    Copyright (C) 2014-2025  Johannes Pohl
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+***/
+
+#pragma once
+
+
+// local headers
+#include "common/json.hpp"
+
+// standard headers
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <regex>
+#include <string>
+#include <vector>
+
+
+using json = nlohmann::json;
+
+
+namespace bench
+{
+
+/// Prevent the compiler from optimizing away the computation of @p value
+template <typename T>
+inline void doNotOptimize(const T& value)
+{
+#if defined(__GNUC__) || defined(__clang__)
+    asm volatile("" : : "r,m"(value) : "memory");
+#else
+    static volatile const void* sink;
+    sink = &value;
+#endif
+}
+
+
+/// Timing of a single benchmark
+struct Result
+{
+    /// name of the benchmark, e.g. "encode/flac/48000:16:2/20ms"
+    std::string name;
+    /// number of operations per repetition
+    uint64_t iterations{0};
+    /// median duration of one operation over all repetitions [ns]
+    double ns_per_op{0};
+    /// fastest duration of one operation over all repetitions [ns]
+    double ns_per_op_min{0};
+    /// duration of audio processed by one operation [ns], 0 if not applicable
+    double audio_ns_per_op{0};
+
+    /// @return audio duration processed per wall clock duration, 0 if not applicable
+    double realtimeFactor() const;
+    /// @return the result as json
+    json toJson() const;
+};
+
+
+/// Comparison of a Result against its baseline
+struct Comparison
+{
+    /// name of the benchmark
+    std::string name;
+    /// ns per op of the baseline
+    double baseline_ns{0};
+    /// ns per op of the current run
+    double current_ns{0};
+    /// change in percent, positive means slower
+    double change_percent{0};
+    /// the change exceeds the tolerance
+    bool regression{false};
+};
+
+
+/// Runs benchmarks and collects their results
+/**
+ * Every benchmark is run for at least "min_time" per repetition. The number of operations
+ * per repetition is calibrated upfront, the reported time per operation is the median over
+ * all repetitions, which is robust against single outliers caused by the scheduler.
+ */
+class Runner
+{
+public:
+    /// Runner settings
+    struct Settings
+    {
+        /// minimum duration of one repetition
+        std::chrono::milliseconds min_time{100};
+        /// number of repetitions
+        size_t repetitions{5};
+        /// only run benchmarks whose name matches this regex
+        std::string filter;
+        /// only list the benchmarks, don't run them
+        bool list_only{false};
+    };
+
+    /// c'tor
+    explicit Runner(Settings settings);
+
+    /// @return true if the benchmark @p name will be run (i.e. is not filtered)
+    bool enabled(const std::string& name) const;
+
+    /// Run the benchmark @p name, calling @p operation repeatedly
+    /// @param name name of the benchmark
+    /// @param operation the operation to measure
+    /// @param audio_duration duration of audio processed by one operation, used to calculate the realtime factor
+    void run(const std::string& name, const std::function<void()>& operation, std::chrono::nanoseconds audio_duration = std::chrono::nanoseconds(0));
+
+    /// @return the collected results
+    const std::vector<Result>& results() const;
+
+    /// @return all results as json document
+    json toJson() const;
+
+private:
+    Settings settings_;
+    std::regex filter_;
+    std::vector<Result> results_;
+};
+
+
+/// Compare @p results against the json document @p baseline, as written by Runner::toJson
+/// Benchmarks that are not contained in the baseline are ignored.
+/// @param tolerance_percent a benchmark is considered as regression, if it is slower than the baseline by more than this
+std::vector<Comparison> compare(const json& baseline, const std::vector<Result>& results, double tolerance_percent);
+
+} // namespace bench
@@ -0,0 +1,591 @@
+/***
+    This file is part of snapcast
+    Copyright (C) 2014-2025  Johannes Pohl
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+***/
+
+
+// local headers
+#include "benchmark.hpp"
+#include "common/aixlog.hpp"
+#include "common/message/factory.hpp"
+#include "common/message/pcm_chunk.hpp"
+#include "common/popl.hpp"
+#include "common/resampler.hpp"
+#include "common/sample_format.hpp"
+#include "common/snap_exception.hpp"
+#include "common/stream_uri.hpp"
+#include "config.hpp"
+#include "decoder/pcm_decoder.hpp"
+#if defined(HAS_OGG) && (defined(HAS_TREMOR) || defined(HAS_VORBIS))
+#include "decoder/ogg_decoder.hpp"
+#endif
+#if defined(HAS_FLAC)
+#include "decoder/flac_decoder.hpp"
+#endif
+#if defined(HAS_OPUS)
+#include "decoder/opus_decoder.hpp"
+#endif
+#include "double_buffer.hpp"
+#include "encoder/encoder_factory.hpp"
+#include "median_buffer.hpp"
+#include "player/player.hpp"
+#include "stream.hpp"
+#include "streamreader/pcm_stream.hpp"
+#include "variable_resampler.hpp"
+
+// 3rd party headers
+#include <boost/asio/io_context.hpp>
+#include <boost/asio/streambuf.hpp>
+
+// standard headers
+#include <cmath>
+#include <filesystem>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
+
+
+using namespace std;
+using namespace std::chrono_literals;
+using namespace popl;
+
+namespace
+{
+
+/// Duration of the synthetic test signal. Audio benchmarks process the complete signal per operation.
+constexpr auto kSignalDuration = 1000ms;
+
+using Chunks = std::vector<std::shared_ptr<msg::PcmChunk>>;
+
+
+/// @return @p format as string, packed 24 bit formats are marked with "24_3"
+std::string formatName(const SampleFormat& format)
+{
+    if (!format.isPacked24())
+        return format.toString();
+    return std::to_string(format.rate()) + ":24_3:" + std::to_string(format.channels());
+}
+
+
+/// @return deterministic interleaved PCM data in @p format with @p duration
+/// Two sine tones at about -6 dBFS, slightly detuned per channel, plus low level noise.
+/// The noise is generated from the raw std::mt19937 output, which is fully specified by the standard,
+/// so that lossless codecs see the same input on every platform.
+std::vector<char> makeSignal(const SampleFormat& format, std::chrono::milliseconds duration, bool silent = false)
+{
+    std::mt19937 rng(1704);
+    size_t frames = static_cast<size_t>(format.rate()) * duration.count() / 1000;
+    std::vector<char> pcm(frames * format.frameSize(), 0);
+    if (silent)
+        return pcm;
+
+    const double max_amplitude = std::pow(2, format.bits() - 1) - 1;
+    const double two_pi = 2. * std::acos(-1.);
+    char* out = pcm.data();
+    for (size_t frame = 0; frame < frames; ++frame)
+    {
+        double t = static_cast<double>(frame) / format.rate();
+        for (size_t channel = 0; channel < format.channels(); ++channel)
+        {
+            double noise = static_cast<double>(rng()) / static_cast<double>(std::mt19937::max()) * 2. - 1.;
+            double value = 0.35 * std::sin(two_pi * 440. * t + static_cast<double>(channel)) +
+                           0.15 * std::sin(two_pi * (1000. + 10. * static_cast<double>(channel)) * t) + 0.01 * noise;
+            auto sample = static_cast<int32_t>(std::lround(value * max_amplitude));
+            // little endian, sign extended into the container
+            for (size_t byte = 0; byte < format.sampleSize(); ++byte)
+                *out++ = static_cast<char>((sample >> (8 * std::min<size_t>(byte, 3))) & 0xff);
+        }
+    }
+    return pcm;
+}
+
+
+/// @return @p pcm in @p format split into chunks of @p chunk_duration
+Chunks makeChunks(const SampleFormat& format, const std::vector<char>& pcm, std::chrono::milliseconds chunk_duration)
+{
+    Chunks chunks;
+    const size_t chunk_bytes = static_cast<size_t>(format.rate()) * chunk_duration.count() / 1000 * format.frameSize();
+    for (size_t offset = 0; offset + chunk_bytes <= pcm.size(); offset += chunk_bytes)
+    {
+        auto chunk = std::make_shared<msg::PcmChunk>(format, static_cast<uint32_t>(chunk_duration.count()));
+        std::copy_n(pcm.data() + offset, chunk_bytes, chunk->payload);
+        auto us = static_cast<int64_t>(offset / format.frameSize()) * 1000000 / format.rate();
+        chunk->timestamp.sec = static_cast<int32_t>(us / 1000000);
+        chunk->timestamp.usec = static_cast<int32_t>(us % 1000000);
+        chunks.push_back(std::move(chunk));
+    }
+    return chunks;
+}
+
+
+/// @return decoder for @p codec, or nullptr if the codec is not supported by the client
+std::unique_ptr<decoder::Decoder> createDecoder(const std::string& codec)
+{
+    if (codec == "pcm")
+        return std::make_unique<decoder::PcmDecoder>();
+#if defined(HAS_OGG) && (defined(HAS_TREMOR) || defined(HAS_VORBIS))
+    else if (codec == "ogg")
+        return std::make_unique<decoder::OggDecoder>();
+#endif
+#if defined(HAS_FLAC)
+    else if (codec == "flac")
+        return std::make_unique<decoder::FlacDecoder>();
+#endif
+#if defined(HAS_OPUS)
+    else if (codec == "opus")
+        return std::make_unique<decoder::OpusDecoder>();
+#endif
+    return nullptr;
+}
+
+
+/// Exposes PcmStream::isSilent
+class SilenceProbe : public streamreader::PcmStream
+{
+public:
+    /// c'tor
+    SilenceProbe(boost::asio::io_context& ioc, const StreamUri& uri) : PcmStream(nullptr, ioc, ServerSettings{}, uri, PcmStream::Source::config)
+    {
+    }
+
+    /// @return if @p chunk is silent
+    bool silent(const msg::PcmChunk& chunk) const
+    {
+        return isSilent(chunk);
+    }
+};
+
+
+/// Player without a device, exposes Player::adjustVolume
+class BenchPlayer : public player::Player
+{
+public:
+    /// c'tor
+    BenchPlayer(boost::asio::io_context& io_context, const ClientSettings::Player& settings, std::shared_ptr<Stream> stream)
+        : Player(io_context, settings, std::move(stream))
+    {
+    }
+
+    /// Apply the current volume to @p frames frames in @p buffer
+    void process(char* buffer, size_t frames)
+    {
+        adjustVolume(buffer, frames);
+    }
+
+protected:
+    bool needsThread() const override
+    {
+        return false;
+    }
+};
+
+
+/// Encode the test signal with @p codec (incl. codec options) and decode the result
+void benchmarkCodec(bench::Runner& runner, const std::string& codec, const SampleFormat& format, std::chrono::milliseconds chunk_duration)
+{
+    const std::string suffix = "/" + codec + "/" + formatName(format) + "/" + std::to_string(chunk_duration.count()) + "ms";
+    if (!runner.enabled("encode" + suffix) && !runner.enabled("decode" + suffix))
+        return;
+
+    std::unique_ptr<encoder::Encoder> encoder;
+    Chunks encoded;
+    double encoded_ms = 0;
+    bool capture = true;
+    try
+    {
+        encoder = encoder::EncoderFactory().createEncoder(codec);
+        auto on_encoded = [&](const encoder::Encoder& /*encoder*/, const std::shared_ptr<msg::PcmChunk>& chunk, double duration)
+        {
+            bench::doNotOptimize(chunk->payloadSize);
+            if (!capture)
+                return;
+            encoded.push_back(chunk);
+            encoded_ms += duration;
+        };
+        encoder->init(on_encoded, format);
+    }
+    catch (const std::exception& e)
+    {
+        std::cout << "Skipping " << codec << " with " << formatName(format) << ": " << e.what() << "\n";
+        return;
+    }
+
+    auto chunks = makeChunks(format, makeSignal(format, kSignalDuration), chunk_duration);
+    for (const auto& chunk : chunks)
+        encoder->encode(*chunk);
+    capture = false;
+    auto header = encoder->getHeader();
+
+    auto encode = [&]()
+    {
+        for (const auto& chunk : chunks)
+            encoder->encode(*chunk);
+    };
+    runner.run("encode" + suffix, encode, kSignalDuration);
+
+    if (!header || !createDecoder(header->codec))
+        return;
+
+    // Decoders are stateful, so every operation decodes the complete signal with a fresh decoder.
+    // Decoding works in place, the copy of the encoded chunk is part of the measurement.
+    auto decode = [&]()
+    {
+        auto decoder = createDecoder(header->codec);
+        decoder->setHeader(header.get());
+        for (const auto& chunk : encoded)
+        {
+            msg::PcmChunk pcm_chunk(*chunk);
+            bench::doNotOptimize(decoder->decode(&pcm_chunk));
+        }
+    };
+    runner.run("decode" + suffix, decode, std::chrono::microseconds(static_cast<int64_t>(encoded_ms * 1000.)));
+}
+
+
+/// Resample the test signal from @p in_format to @p out_format
+void benchmarkResampler(bench::Runner& runner, const SampleFormat& in_format, const SampleFormat& out_format)
+{
+    const std::string name = "resample/" + formatName(in_format) + "/" + formatName(out_format);
+    if (!runner.enabled(name))
+        return;
+
+    std::unique_ptr<Resampler> resampler;
+    try
+    {
+        resampler = std::make_unique<Resampler>(in_format, out_format);
+    }
+    catch (const std::exception& e)
+    {
+        std::cout << "Skipping " << name << ": " << e.what() << "\n";
+        return;
+    }
+
+    auto chunks = makeChunks(in_format, makeSignal(in_format, kSignalDuration), 20ms);
+    // the output chunk is reused, like the client does
+    msg::PcmChunk resampled;
+    auto resample = [&]()
+    {
+        for (const auto& chunk : chunks)
+        {
+            if (resampler->resample(*chunk, resampled))
+                bench::doNotOptimize(resampled.payload);
+        }
+    };
+    runner.run(name, resample, kSignalDuration);
+}
+
+
+/// Drift correction of the test signal in @p format with @p quality, in 10ms player callbacks at a rate ratio of 0.9995
+void benchmarkDriftCorrection(bench::Runner& runner, const SampleFormat& format, VariableResampler::Quality quality, const std::string& quality_name)
+{
+    const std::string name = "drift_correction/" + quality_name + "/" + formatName(format);
+    if (!runner.enabled(name))
+        return;
+
+    const uint32_t frames = format.rate() / 100;
+    VariableResampler resampler(format, quality, frames);
+    auto pcm = makeSignal(format, kSignalDuration);
+    std::vector<char> output(frames * format.frameSize());
+    const double ratio = 0.9995;
+    auto correct = [&]()
+    {
+        // wrap around the signal, the content doesn't change the amount of work
+        size_t pos = 0;
+        for (uint32_t n = 0; n < format.rate() / frames; ++n)
+        {
+            uint32_t in_frames = resampler.inputFrames(frames, ratio);
+            if ((pos + in_frames) * format.frameSize() > pcm.size())
+                pos = 0;
+            resampler.process(pcm.data() + pos * format.frameSize(), in_frames, output.data(), frames, ratio);
+            pos += in_frames;
+        }
+        bench::doNotOptimize(output.data());
+    };
+    runner.run(name, correct, kSignalDuration);
+}
+
+
+/// Check a silent signal in @p format for silence, the worst case for PcmStream::isSilent
+void benchmarkSilence(bench::Runner& runner, boost::asio::io_context& ioc, const SampleFormat& format, const std::string& threshold_percent)
+{
+    const std::string name = "is_silent/" + formatName(format) + "/" + threshold_percent + "%";
+    if (!runner.enabled(name))
+        return;
+
+    // chunk_ms must match the default of 20ms, which is used to size the silent reference chunk
+    SilenceProbe probe(ioc, StreamUri("pipe:///dev/null?name=bench&codec=null&sampleformat=" + format.toString() +
+                                      "&silence_threshold_percent=" + threshold_percent));
+    auto chunks = makeChunks(format, makeSignal(format, kSignalDuration, true), 20ms);
+    auto is_silent = [&]()
+    {
+        for (const auto& chunk : chunks)
+            bench::doNotOptimize(probe.silent(*chunk));
+    };
+    runner.run(name, is_silent, kSignalDuration);
+}
+
+
+/// Apply a software volume of 50% to the test signal in @p format
+void benchmarkVolume(bench::Runner& runner, boost::asio::io_context& ioc, const SampleFormat& format)
+{
+    const std::string name = "adjust_volume/" + formatName(format);
+    if (!runner.enabled(name))
+        return;
+
+    ClientSettings::Player settings;
+    settings.mixer.mode = ClientSettings::Mixer::Mode::software;
+    BenchPlayer player(ioc, settings, std::make_shared<Stream>(format, SampleFormat()));
+    player.setVolume({0.5, false});
+
+    // The volume is applied in place and the signal fades out over the iterations,
+    // which doesn't change the amount of work per sample
+    auto pcm = makeSignal(format, kSignalDuration);
+    const size_t frames = pcm.size() / format.frameSize();
+    runner.run(name, [&]() { player.process(pcm.data(), frames); }, kSignalDuration);
+}
+
+
+/// Add a value to a @p Buffer (DoubleBuffer or MedianBuffer) of @p size and get the median,
+/// as done by the client Stream for every played chunk
+template <class Buffer>
+void benchmarkMedian(bench::Runner& runner, const std::string& buffer_name, size_t size)
+{
+    const std::string name = buffer_name + "/median/" + std::to_string(size);
+    if (!runner.enabled(name))
+        return;
+
+    std::mt19937 rng(1704);
+    Buffer buffer(size);
+    while (!buffer.full())
+        buffer.add(static_cast<int64_t>(rng() % 10000));
+    auto median = [&]()
+    {
+        buffer.add(static_cast<int64_t>(rng() % 10000));
+        bench::doNotOptimize(buffer.median());
+    };
+    runner.run(name, median);
+}
+
+
+/// Serialize @p message into a stream buffer, and deserialize it using the message factory
+void benchmarkMessage(bench::Runner& runner, const std::string& message_name, const msg::BaseMessage& message)
+{
+    const std::string serialize_name = "message/serialize/" + message_name;
+    const std::string deserialize_name = "message/deserialize/" + message_name;
+
+    boost::asio::streambuf streambuf;
+    auto serialize = [&]()
+    {
+        std::ostream stream(&streambuf);
+        message.serialize(stream);
+        streambuf.consume(streambuf.size());
+    };
+    runner.run(serialize_name, serialize);
+
+    std::ostream stream(&streambuf);
+    message.serialize(stream);
+    std::vector<char> buffer(streambuf.size());
+    std::copy_n(boost::asio::buffers_begin(streambuf.data()), buffer.size(), buffer.begin());
+    auto deserialize = [&]()
+    {
+        msg::BaseMessage base_message;
+        base_message.deserialize(buffer.data());
+        bench::doNotOptimize(msg::factory::createMessage(base_message, buffer.data() + base_message.getSize()));
+    };
+    runner.run(deserialize_name, deserialize);
+}
+
+
+/// Config lookups and group changes with @p clients clients in @p groups groups, spread over 4 streams
+void benchmarkConfig(bench::Runner& runner, size_t clients, size_t groups)
+{
+    const std::string suffix = "/" + std::to_string(clients) + "_clients_" + std::to_string(groups) + "_groups";
+    const std::string get_client_name = "config/get_client" + suffix;
+    const std::string get_group_name = "config/get_group_from_client" + suffix;
+    const std::string get_stream_name = "config/get_groups_from_stream" + suffix;
+    const std::string move_name = "config/move_client" + suffix;
+    if (!runner.enabled(get_client_name) && !runner.enabled(get_group_name) && !runner.enabled(get_stream_name) && !runner.enabled(move_name))
+        return;
+
+    // Config is persisted on destruction, keep it away from the user's server.json
+    auto& config = Config::instance();
+    auto dir = std::filesystem::temp_directory_path() / "snapcast_bench_config";
+    std::filesystem::create_directories(dir);
+    config.init(dir.string());
+    for (const auto& group : config.getGroupList())
+        config.remove(group, true);
+
+    std::vector<ClientInfoPtr> client_infos;
+    std::vector<GroupPtr> group_ptrs;
+    for (size_t n = 0; n < clients; ++n)
+    {
+        client_infos.push_back(std::make_shared<ClientInfo>("client " + std::to_string(n)));
+        GroupPtr group = (n < groups) ? nullptr : group_ptrs[n % groups];
+        group = config.moveClient(client_infos.back(), group);
+        if (n < groups)
+        {
+            config.setStream(group, "stream " + std::to_string(n % 4));
+            group_ptrs.push_back(group);
+        }
+    }
+
+    std::mt19937 rng(1704);
+    auto client_id = [&]() -> const std::string& { return client_infos[rng() % clients]->id; };
+    runner.run(get_client_name, [&]() { bench::doNotOptimize(config.getClientInfo(client_id())); });
+    runner.run(get_group_name, [&]() { bench::doNotOptimize(config.getGroupFromClient(client_id())); });
+    runner.run(get_stream_name, [&]() { bench::doNotOptimize(config.getGroupsFromStream("stream " + std::to_string(rng() % 4))); });
+    // every move rebuilds the lookup tables
+    runner.run(move_name, [&]() { bench::doNotOptimize(config.moveClient(client_infos[rng() % clients], group_ptrs[rng() % groups])); });
+
+    for (const auto& group : config.getGroupList())
+        config.remove(group, true);
+}
+
+} // namespace
+
+
+int main(int argc, char** argv)
+{
+    try
+    {
+        bench::Runner::Settings settings;
+        size_t min_time_ms = 100;
+        std::string output;
+        std::string baseline;
+        double tolerance = 10.;
+
+        OptionParser op("Allowed options");
+        auto help_switch = op.add<Switch>("", "help", "Produce help message");
+        auto list_switch = op.add<Switch>("l", "list", "List the benchmarks without running them");
+        op.add<Value<string>>("f", "filter", "Only run benchmarks matching this regex", "", &settings.filter);
+        op.add<Value<size_t>>("", "min-time", "Minimum duration of a repetition [ms]", min_time_ms, &min_time_ms);
+        op.add<Value<size_t>>("r", "repetitions", "Number of repetitions, the median is reported", settings.repetitions, &settings.repetitions);
+        op.add<Value<string>>("o", "output", "Write results as json to this file (\"-\" for stdout)", "", &output);
+        op.add<Value<string>>("b", "baseline", "Compare against the json results in this file", "", &baseline);
+        op.add<Value<double>>("t", "tolerance", "Slowdown against the baseline that counts as regression [%]", tolerance, &tolerance);
+        op.parse(argc, argv);
+
+        if (help_switch->is_set())
+        {
+            std::cout << op << "\n";
+            return EXIT_SUCCESS;
+        }
+        if (!op.unknown_options().empty())
+            throw SnapException("Unknown command line argument: '" + op.unknown_options().front() + "'");
+
+        AixLog::Log::init<AixLog::SinkNull>();
+        settings.min_time = std::chrono::milliseconds(min_time_ms);
+        settings.list_only = list_switch->is_set();
+        bench::Runner runner(settings);
+        boost::asio::io_context ioc;
+
+        const std::vector<SampleFormat> formats{SampleFormat("44100:16:2"), SampleFormat("48000:16:2"), SampleFormat("48000:24:2")};
+        for (const std::string codec : {"pcm", "flac", "ogg", "opus"})
+        {
+            for (const auto& format : formats)
+            {
+                for (auto chunk_duration : {10ms, 20ms, 50ms})
+                    benchmarkCodec(runner, codec, format, chunk_duration);
+            }
+        }
+        benchmarkCodec(runner, "pcm:PACKED", SampleFormat("48000:24:2"), 20ms);
+
+        benchmarkResampler(runner, SampleFormat("44100:16:2"), SampleFormat("48000:16:2"));
+        benchmarkResampler(runner, SampleFormat("48000:16:2"), SampleFormat("44100:16:2"));
+        benchmarkResampler(runner, SampleFormat("48000:24:2"), SampleFormat("48000:16:2"));
+        benchmarkResampler(runner, SampleFormat(48000, 24, 2, 3), SampleFormat("48000:24:2"));
+        benchmarkResampler(runner, SampleFormat("48000:24:2"), SampleFormat(48000, 24, 2, 3));
+
+        for (const auto& format : {SampleFormat("48000:16:2"), SampleFormat(48000, 24, 2, 3)})
+        {
+            benchmarkDriftCorrection(runner, format, VariableResampler::Quality::low, "low");
+            benchmarkDriftCorrection(runner, format, VariableResampler::Quality::medium, "medium");
+            benchmarkDriftCorrection(runner, format, VariableResampler::Quality::high, "high");
+        }
+
+        for (const auto& format : {SampleFormat("48000:16:2"), SampleFormat("48000:24:2"), SampleFormat("48000:32:2")})
+        {
+            for (const std::string threshold : {"0", "0.1"})
+                benchmarkSilence(runner, ioc, format, threshold);
+        }
+
+        for (const auto& format : {SampleFormat("48000:16:2"), SampleFormat("48000:24:2"), SampleFormat(48000, 24, 2, 3), SampleFormat("48000:32:2")})
+            benchmarkVolume(runner, ioc, format);
+
+        for (size_t size : {20, 100, 500})
+        {
+            benchmarkMedian<DoubleBuffer<int64_t>>(runner, "double_buffer", size);
+            benchmarkMedian<MedianBuffer<int64_t>>(runner, "median_buffer", size);
+        }
+
+        SampleFormat format("48000:16:2");
+        auto chunk = makeChunks(format, makeSignal(format, 20ms), 20ms).front();
+        benchmarkMessage(runner, "pcm_chunk/" + format.toString() + "/20ms", *chunk);
+        benchmarkMessage(runner, "time", msg::Time());
+
+        benchmarkConfig(runner, 1000, 200);
+
+        if (settings.list_only)
+            return EXIT_SUCCESS;
+
+        json result = runner.toJson();
+        if (output == "-")
+        {
+            std::cout << result.dump(4) << "\n";
+        }
+        else if (!output.empty())
+        {
+            std::ofstream ofs(output);
+            if (!ofs)
+                throw SnapException("Failed to open output file: " + output);
+            ofs << result.dump(4) << "\n";
+        }
+
+        if (!baseline.empty())
+        {
+            std::ifstream ifs(baseline);
+            if (!ifs)
+                throw SnapException("Failed to open baseline file: " + baseline);
+            auto comparisons = bench::compare(json::parse(ifs), runner.results(), tolerance);
+            size_t regressions = 0;
+            std::cout << "\nComparison against " << baseline << " (tolerance: " << tolerance << "%)\n";
+            for (const auto& comparison : comparisons)
+            {
+                std::cout << (comparison.regression ? "REGRESSION " : "           ") << std::left << std::setw(56) << comparison.name << std::right
+                          << std::setw(14) << std::fixed << std::setprecision(1) << comparison.baseline_ns << " -> " << std::setw(14) << comparison.current_ns
+                          << " ns/op" << std::showpos << std::setw(10) << comparison.change_percent << "%" << std::noshowpos << "\n";
+                if (comparison.regression)
+                    ++regressions;
+            }
+            if (regressions > 0)
+            {
+                std::cout << "\n" << regressions << " of " << comparisons.size() << " benchmarks regressed\n";
+                return EXIT_FAILURE;
+            }
+        }
+    }
+    catch (const std::exception& e)
+    {
+        std::cerr << "Exception: " << e.what() << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
@@ -19,6 +19,7 @@
 #pragma once
 
 // local headers
+#include "common/resampler.hpp"
 #include "common/sample_format.hpp"
 #include "common/stream_uri.hpp"
 #include "player/pcm_device.hpp"
@@ -27,6 +28,7 @@
 #include <filesystem>
 #include <optional>
 #include <string>
+#include <vector>
 
 
 /// Snapclient settings
@@ -40,6 +42,15 @@ struct ClientSettings
         shared       ///< shared access
     };
 
+    /// Drift correction mode
+    enum class DriftCorrection : char
+    {
+        frames, ///< drop or duplicate single frames
+        low,    ///< variable rate resampling, linear interpolation
+        medium, ///< variable rate resampling, 8 tap windowed sinc
+        high    ///< variable rate resampling, 32 tap windowed sinc
+    };
+
     /// Mixer settings
     struct Mixer
     {
@@ -102,10 +113,25 @@ struct ClientSettings
         player::PcmDevice pcm_device;
         /// Sampleformat to be uses, i.e. 48000:16:2
         SampleFormat sample_format;
+        /// Quality and threads of the resampler to sample_format
+        Resampler::Settings resampler;
         /// The sharing mode
         SharingMode sharing_mode{SharingMode::unspecified};
+        /// Drift correction (soft sync)
+        DriftCorrection drift_correction{DriftCorrection::medium};
         /// Mixer settings
         Mixer mixer;
+        /// The channels of the stream to play, in this order, all channels if empty
+        std::vector<uint16_t> channels;
+    };
+
+    /// A zone of a multi-zone client: a logical client with its own instance id, DAC and channels
+    struct Zone
+    {
+        /// the DAC
+        player::PcmDevice pcm_device;
+        /// The channels of the stream to play, in this order, all channels if empty
+        std::vector<uint16_t> channels;
     };
 
     /// Log settings
@@ -126,6 +152,8 @@ struct ClientSettings
     Server server;
     /// Player settings
     Player player;
+    /// The zones of a multi-zone client, with instance ids counting up from instance. A single client if empty.
+    std::vector<Zone> zones;
     /// Logging settings
     Logging logging;
 };
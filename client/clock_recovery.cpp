@@ -0,0 +1,195 @@
+/***
+    This file is part of snapcast
+    Copyright (C) 2014-2025  Johannes Pohl
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+***/
+
+// prototype/interface header file
+#include "clock_recovery.hpp"
+
+// local headers
+#include "common/aixlog.hpp"
+
+// standard headers
+#include <algorithm>
+#include <cmath>
+
+
+static constexpr auto LOG_TAG = "ClockRecovery";
+
+/// base deviation of an offset measurement, i.e. timestamping jitter [us]
+static constexpr double kMeasurementDeviation = 100.;
+/// variance of the offset random walk [us^2/s]
+static constexpr double kOffsetNoise = 1.;
+/// variance of the skew random walk [ppm^2/s]
+static constexpr double kSkewNoise = 0.01;
+/// deviation of the initial skew [ppm]
+static constexpr double kInitialSkewDeviation = 200.;
+/// number of round trip times for the min RTT filter
+static constexpr size_t kRttWindow = 32;
+/// measurements with an RTT exceeding the minimum by more than this are rejected [us]
+static constexpr chronos::usec::rep kMaxRttExcess = 5000;
+/// an offset jump by more than this is considered as clock step and restarts the estimation [us]
+static constexpr double kMaxInnovation = 50000.;
+/// the estimation is converged if the offset deviation is below [us] ...
+static constexpr double kConvergedOffsetDeviation = 500.;
+/// ... and the skew deviation is below [ppm]
+static constexpr double kConvergedSkewDeviation = 5.;
+
+
+ClockEstimator::ClockEstimator() : rtts_(kRttWindow)
+{
+    reset();
+}
+
+
+void ClockEstimator::reset()
+{
+    initialized_ = false;
+    time_ = chronos::time_point_clk();
+    offset_ = 0;
+    skew_ = 0;
+    p_ = {{{0, 0}, {0, 0}}};
+    rtts_.clear();
+    updates_ = 0;
+}
+
+
+void ClockEstimator::predict(const chronos::time_point_clk& local_time)
+{
+    double dt = std::chrono::duration<double>(local_time - time_).count();
+    if (dt <= 0)
+        return;
+    time_ = local_time;
+
+    // x = F * x, with F = [1 dt; 0 1]
+    offset_ += skew_ * dt;
+    // P = F * P * F' + Q
+    double p00 = p_[0][0] + dt * (p_[0][1] + p_[1][0]) + dt * dt * p_[1][1];
+    double p01 = p_[0][1] + dt * p_[1][1];
+    double p10 = p_[1][0] + dt * p_[1][1];
+    double p11 = p_[1][1];
+    p_[0][0] = p00 + kSkewNoise * dt * dt * dt / 3. + kOffsetNoise * dt;
+    p_[0][1] = p01 + kSkewNoise * dt * dt / 2.;
+    p_[1][0] = p10 + kSkewNoise * dt * dt / 2.;
+    p_[1][1] = p11 + kSkewNoise * dt;
+}
+
+
+bool ClockEstimator::update(const chronos::time_point_clk& local_time, const chronos::usec& offset, const chronos::usec& rtt)
+{
+    rtts_.add(rtt.count());
+    // the path asymmetry is bound by half of the excess over the min RTT
+    double excess = static_cast<double>(rtt.count() - rtts_.percentile(0));
+    double measurement_variance = kMeasurementDeviation * kMeasurementDeviation + excess * excess / 4.;
+    double z = static_cast<double>(offset.count());
+
+    if (!initialized_)
+    {
+        initialized_ = true;
+        time_ = local_time;
+        offset_ = z;
+        skew_ = 0;
+        p_ = {{{measurement_variance, 0}, {0, kInitialSkewDeviation * kInitialSkewDeviation}}};
+        updates_ = 1;
+        return true;
+    }
+
+    if (excess > kMaxRttExcess)
+        return false;
+
+    predict(local_time);
+    double innovation = z - offset_;
+    if (std::abs(innovation) > kMaxInnovation)
+    {
+        LOG(INFO, LOG_TAG) << "Clock step of " << innovation / 1000. << " ms, restarting the estimation\n";
+        reset();
+        return update(local_time, offset, rtt);
+    }
+
+    // K = P * H' / (H * P * H' + R), with H = [1 0]
+    double s = p_[0][0] + measurement_variance;
+    double k0 = p_[0][0] / s;
+    double k1 = p_[1][0] / s;
+    offset_ += k0 * innovation;
+    skew_ += k1 * innovation;
+    // P = (I - K * H) * P
+    double p00 = p_[0][0];
+    double p01 = p_[0][1];
+    p_[0][0] -= k0 * p00;
+    p_[0][1] -= k0 * p01;
+    p_[1][0] -= k1 * p00;
+    p_[1][1] -= k1 * p01;
+    ++updates_;
+    return true;
+}
+
+
+chronos::usec ClockEstimator::offset(const chronos::time_point_clk& local_time) const
+{
+    double dt = std::chrono::duration<double>(local_time - time_).count();
+    return chronos::usec(static_cast<chronos::usec::rep>(std::llround(offset_ + skew_ * dt)));
+}
+
+
+double ClockEstimator::skew() const
+{
+    return skew_;
+}
+
+
+chronos::usec ClockEstimator::deviation() const
+{
+    return chronos::usec(static_cast<chronos::usec::rep>(std::sqrt(std::max(p_[0][0], 0.))));
+}
+
+
+bool ClockEstimator::converged() const
+{
+    return initialized_ && (p_[0][0] < kConvergedOffsetDeviation * kConvergedOffsetDeviation) &&
+           (p_[1][1] < kConvergedSkewDeviation * kConvergedSkewDeviation);
+}
+
+
+
+RateController::RateController(double kp, double ki, double max_ppm) : kp_(kp), ki_(ki), max_ppm_(max_ppm)
+{
+    reset();
+}
+
+
+double RateController::update(double error, double dt)
+{
+    double integral = integral_ + ki_ * error * dt;
+    double ppm = kp_ * error + integral;
+    // anti windup: don't integrate further into saturation
+    if (std::abs(ppm) <= max_ppm_)
+        integral_ = integral;
+    ppm_ = std::clamp(kp_ * error + integral_, -max_ppm_, max_ppm_);
+    return ratio();
+}
+
+
+double RateController::ratio() const
+{
+    return 1. - ppm_ / 1000000.;
+}
+
+
+void RateController::reset()
+{
+    integral_ = 0;
+    ppm_ = 0;
+}
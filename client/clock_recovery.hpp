@@ -0,0 +1,116 @@
+/***
+    This file is part of snapcast
+    Copyright (C) 2014-2025  Johannes Pohl
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+***/
+
+#pragma once
+
+
+// local headers
+#include "common/time_defs.hpp"
+#include "median_buffer.hpp"
+
+// standard headers
+#include <array>
+
+
+/// Estimates offset and frequency skew of a remote clock
+/**
+ * Two state Kalman filter, tracking the offset of the remote (server) clock to the
+ * local clock and the skew, i.e. the drift of the offset in us per second (ppm).
+ * Measurements are round trips: the offset is the mean of the one way latencies and
+ * is biased by the asymmetry of the path, which is at most half of the excess round trip
+ * time over the minimum RTT of the last measurements. Measurements are weighted
+ * accordingly, measurements with a high excess RTT are rejected.
+ */
+class ClockEstimator
+{
+public:
+    /// c'tor
+    ClockEstimator();
+
+    /// Add a measurement, taken at @p local_time
+    /// @param local_time local time of the measurement
+    /// @param offset remote time - local time
+    /// @param rtt round trip time
+    /// @return true if the measurement was used, false if it was rejected
+    bool update(const chronos::time_point_clk& local_time, const chronos::usec& offset, const chronos::usec& rtt);
+
+    /// @return the estimated offset at @p local_time
+    chronos::usec offset(const chronos::time_point_clk& local_time) const;
+
+    /// @return the estimated skew of the remote clock in ppm (us per second)
+    double skew() const;
+
+    /// @return standard deviation of the offset estimation
+    chronos::usec deviation() const;
+
+    /// @return true if the estimation has settled
+    bool converged() const;
+
+    /// Forget all measurements
+    void reset();
+
+private:
+    /// Advance the state to @p local_time
+    void predict(const chronos::time_point_clk& local_time);
+
+    bool initialized_;
+    chronos::time_point_clk time_;
+    /// offset [us]
+    double offset_;
+    /// skew [us/s]
+    double skew_;
+    /// state covariance
+    std::array<std::array<double, 2>, 2> p_;
+    /// recent round trip times, for min RTT filtering
+    MedianBuffer<chronos::usec::rep> rtts_;
+    size_t updates_;
+};
+
+
+/// PI controller, turning a playback error into a playback rate ratio
+/**
+ * The integral part tracks the steady drift between the local playback (DAC) clock and
+ * the server clock, the proportional part pulls the error to zero.
+ * The output is clamped with anti windup.
+ */
+class RateController
+{
+public:
+    /// c'tor
+    /// @param kp proportional gain [ppm/us]
+    /// @param ki integral gain [ppm/(us*s)]
+    /// @param max_ppm max deviation of the ratio from 1 [ppm]
+    RateController(double kp, double ki, double max_ppm);
+
+    /// Update with the current @p error [us], > 0 if playing late, @p dt seconds after the last update
+    /// @return the new rate ratio, < 1 means play faster
+    double update(double error, double dt);
+
+    /// @return the current rate ratio
+    double ratio() const;
+
+    /// Reset the proportional and integral part
+    void reset();
+
+private:
+    double kp_;
+    double ki_;
+    double max_ppm_;
+    double integral_;
+    double ppm_;
+};
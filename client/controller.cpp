@@ -62,6 +62,7 @@
 #include "browseZeroConf/browse_zeroconf.hpp"
 #include "common/aixlog.hpp"
 #include "common/message/client_info.hpp"
+#include "common/message/client_stats.hpp"
 #include "common/message/error.hpp"
 #include "common/message/factory.hpp"
 #include "common/message/hello.hpp"
@@ -73,22 +74,34 @@
 
 // standard headers
 #include <algorithm>
+#include <cstring>
 #include <iostream>
+#include <limits>
 #include <memory>
 #include <string>
+#include <tuple>
 
 using namespace std;
 using namespace player;
 
 static constexpr auto LOG_TAG = "Controller";
 static constexpr auto TIME_SYNC_INTERVAL = 1s;
-
-Controller::Controller(boost::asio::io_context& io_context, const ClientSettings& settings)
+/// Time sync interval, once offset and skew of the server clock are known
+static constexpr auto TIME_SYNC_INTERVAL_CONVERGED = 5s;
+/// Reconnect interval during the first second of an outage ...
+static constexpr auto FAST_RECONNECT_INTERVAL = 100ms;
+/// ... and afterwards
+static constexpr auto RECONNECT_INTERVAL = 1s;
+/// Max number of chunks queued for decoding. Covers the burst of a full buffer that is sent after (re)connecting.
+static constexpr size_t MAX_PENDING_CHUNKS = 256;
+
+Controller::Controller(boost::asio::io_context& io_context, const ClientSettings& settings, std::shared_ptr<ZoneRouter> zone_router)
     : io_context_(io_context),
 #ifdef HAS_OPENSSL
       ssl_context_(boost::asio::ssl::context::tlsv12_client),
 #endif
-      timer_(io_context), settings_(settings), stream_(nullptr), decoder_(nullptr), player_(nullptr), serverSettings_(nullptr)
+      timer_(io_context), statsTimer_(io_context), settings_(settings), zoneRouter_(std::move(zone_router)), stream_(nullptr),
+      decodeWorker_(nullptr), player_(nullptr), serverSettings_(nullptr)
 {
 #ifdef HAS_OPENSSL
     if (settings.server.isSsl())
@@ -173,6 +186,27 @@ std::vector<std::string> Controller::getSupportedPlayerNames()
 }
 
 
+bool Controller::supportsPacked24(const std::string& player_name)
+{
+    // the player that will be created by default is the first supported one
+    std::string name = player_name.empty() ? getSupportedPlayerNames().front() : player_name;
+#ifdef HAS_OPENSL
+    if (name == player::OPENSL)
+        return false;
+#endif
+#ifdef HAS_COREAUDIO
+    if (name == player::COREAUDIO)
+        return false;
+#endif
+#ifdef HAS_WASAPI
+    if (name == player::WASAPI)
+        return false;
+#endif
+    std::ignore = name;
+    return true;
+}
+
+
 void Controller::getNextMessage()
 {
     clientConnection_->getNextMessage([this](const boost::system::error_code& ec, std::unique_ptr<msg::BaseMessage> response)
@@ -191,20 +225,27 @@ void Controller::getNextMessage()
 
         if (response->type == message_type::kWireChunk)
         {
-            if (stream_ && decoder_)
+            if (decodeWorker_)
             {
-                // execute on the io_context to do the (costly) decoding on another thread (if more than one thread is used)
-                // boost::asio::post(io_context_, [this, response = std::move(response)]() mutable {
+                // the (costly) decoding is done on the decode worker's thread, to keep reading messages (e.g. time sync responses).
+                // If the worker can't keep up, pause reading until it has drained its queue.
                 auto pcmChunk = msg::message_cast<msg::PcmChunk>(std::move(response));
                 pcmChunk->format = sampleFormat_;
+                lastChunkTimestamp_ = pcmChunk->timestamp;
                 // LOG(TRACE, LOG_TAG) << "chunk: " << pcmChunk->payloadSize << ", sampleFormat: " << sampleFormat_.toString() << "\n";
-                if (decoder_->decode(pcmChunk.get()))
+                auto resume = [this]()
+                {
+                    if (readPaused_)
+                    {
+                        readPaused_ = false;
+                        getNextMessage();
+                    }
+                };
+                if (!decodeWorker_->push(std::move(pcmChunk), resume))
                 {
-                    // LOG(TRACE, LOG_TAG) << ", decoded: " << pcmChunk->payloadSize << ", Duration: " << pcmChunk->durationMs() << ", sec: " <<
-                    // pcmChunk->timestamp.sec << ", usec: " << pcmChunk->timestamp.usec / 1000 << ", type: " << pcmChunk->type << "\n";
-                    stream_->addChunk(std::move(pcmChunk));
+                    readPaused_ = true;
+                    return;
                 }
-                // });
             }
         }
         else if (response->type == message_type::kServerSettings)
@@ -220,35 +261,95 @@ void Controller::getNextMessage()
         }
         else if (response->type == message_type::kCodecHeader)
         {
-            headerChunk_ = msg::message_cast<msg::CodecHeader>(std::move(response));
-            decoder_.reset(nullptr);
-            stream_ = nullptr;
-            player_.reset(nullptr);
+            auto header = msg::message_cast<msg::CodecHeader>(std::move(response));
+            // after a reconnect the server resumes the stream: continue with the same decoder, queued audio and player
+            bool resumed = resuming_ && stream_ && player_ && headerChunk_ && (header->codec == headerChunk_->codec) &&
+                           (header->payloadSize == headerChunk_->payloadSize) && (memcmp(header->payload, headerChunk_->payload, header->payloadSize) == 0);
+            resuming_ = false;
+            headerChunk_ = std::move(header);
+            if (resumed)
+            {
+                LOG(INFO, LOG_TAG) << "Resuming playback, codec: " << headerChunk_->codec << "\n";
+                stream_->setBufferLen(std::max(0, serverSettings_->getBufferMs() - serverSettings_->getLatency() - settings_.player.latency));
+                player_->setVolume({serverSettings_->getVolume() / 100., serverSettings_->isMuted()});
+                return getNextMessage();
+            }
+
+            decodeWorker_.reset(nullptr);
 
+            std::unique_ptr<decoder::Decoder> decoder;
             if (headerChunk_->codec == "pcm")
-                decoder_ = make_unique<decoder::PcmDecoder>();
+                decoder = make_unique<decoder::PcmDecoder>();
 #if defined(HAS_OGG) && (defined(HAS_TREMOR) || defined(HAS_VORBIS))
             else if (headerChunk_->codec == "ogg")
-                decoder_ = make_unique<decoder::OggDecoder>();
+                decoder = make_unique<decoder::OggDecoder>();
 #endif
 #if defined(HAS_FLAC)
             else if (headerChunk_->codec == "flac")
-                decoder_ = make_unique<decoder::FlacDecoder>();
+                decoder = make_unique<decoder::FlacDecoder>();
 #endif
 #if defined(HAS_OPUS)
             else if (headerChunk_->codec == "opus")
-                decoder_ = make_unique<decoder::OpusDecoder>();
+                decoder = make_unique<decoder::OpusDecoder>();
 #endif
             else if (headerChunk_->codec == "null")
-                decoder_ = make_unique<decoder::NullDecoder>();
+                decoder = make_unique<decoder::NullDecoder>();
             else
                 throw SnapException("codec not supported: \"" + headerChunk_->codec + "\"");
 
-            sampleFormat_ = decoder_->setHeader(headerChunk_.get());
+            sampleFormat_ = decoder->setHeader(headerChunk_.get());
             LOG(INFO, LOG_TAG) << "Codec: " << headerChunk_->codec << ", sampleformat: " << sampleFormat_.toString() << "\n";
 
-            stream_ = make_shared<Stream>(sampleFormat_, settings_.player.sample_format);
+            // a zone of a multi-zone client plays a selection of the channels
+            const auto& channels = settings_.player.channels;
+            SampleFormat stream_format = sampleFormat_;
+            if (!channels.empty())
+            {
+                for (auto channel : channels)
+                {
+                    if (channel >= sampleFormat_.channels())
+                        throw SnapException("Channel " + cpt::to_string(channel) + " not available, the stream has " +
+                                            cpt::to_string(sampleFormat_.channels()) + " channels");
+                }
+                stream_format.setFormat(sampleFormat_.rate(), sampleFormat_.bits(), static_cast<uint16_t>(channels.size()), sampleFormat_.sampleSize());
+            }
+            auto create_decode_worker = [&]()
+            {
+                std::unique_ptr<ZoneRouter::Member> member;
+                if (zoneRouter_)
+                    member = zoneRouter_->join(*headerChunk_);
+                decodeWorker_ = make_unique<DecodeWorker>(io_context_, std::move(decoder), stream_, MAX_PENDING_CHUNKS, std::move(member), channels);
+            };
+
+            // Packed 24 bit samples are passed to the player, if it can handle them. Otherwise unpack them in the stream.
+            SampleFormat out_format = settings_.player.sample_format;
+            if (stream_format.isPacked24() && !out_format.isInitialized() && !supportsPacked24(settings_.player.player_name))
+                out_format.setFormat(stream_format.rate(), stream_format.bits(), stream_format.channels());
+
+            // the group changed its stream: keep the player and the queued audio, if the output format doesn't change
+            if (stream_ && player_ && stream_->switchInput(stream_format, out_format))
+            {
+                LOG(INFO, LOG_TAG) << "Switching stream, keeping the player with sampleformat: " << stream_->getFormat().toString() << "\n";
+                stream_->setBufferLen(std::max(0, serverSettings_->getBufferMs() - serverSettings_->getLatency() - settings_.player.latency));
+                create_decode_worker();
+                player_->setVolume({serverSettings_->getVolume() / 100., serverSettings_->isMuted()});
+                return getNextMessage();
+            }
+
+            stream_ = nullptr;
+            player_.reset(nullptr);
+            stream_ = make_shared<Stream>(stream_format, out_format, settings_.player.resampler);
+            lastStatistics_ = {};
             stream_->setBufferLen(std::max(0, serverSettings_->getBufferMs() - serverSettings_->getLatency() - settings_.player.latency));
+            std::optional<VariableResampler::Quality> drift_quality;
+            if (settings_.player.drift_correction == ClientSettings::DriftCorrection::low)
+                drift_quality = VariableResampler::Quality::low;
+            else if (settings_.player.drift_correction == ClientSettings::DriftCorrection::medium)
+                drift_quality = VariableResampler::Quality::medium;
+            else if (settings_.player.drift_correction == ClientSettings::DriftCorrection::high)
+                drift_quality = VariableResampler::Quality::high;
+            stream_->setDriftCorrection(drift_quality);
+            create_decode_worker();
 
 #ifdef HAS_ALSA
             if (!player_)
@@ -287,10 +388,9 @@ void Controller::getNextMessage()
             player_->setVolumeCallback([this](const Player::Volume& volume)
             {
                 // Cache the last volume and check if it really changed in the player's volume callback
-                static Player::Volume last_volume{-1, true};
-                if (volume != last_volume)
+                if (volume != lastVolume_)
                 {
-                    last_volume = volume;
+                    lastVolume_ = volume;
                     auto info = std::make_shared<msg::ClientInfo>();
                     info->setVolume(static_cast<uint16_t>(volume.volume * 100.));
                     info->setMuted(volume.mute);
@@ -329,6 +429,20 @@ void Controller::getNextMessage()
 
 void Controller::sendTimeSyncMessage(int quick_syncs)
 {
+    if (zoneRouter_ && !zoneRouter_->claimTimeSync(this))
+    {
+        // another zone syncs the shared TimeProvider: check again later, to take over when it disconnects
+        timer_.expires_after(TIME_SYNC_INTERVAL);
+        timer_.async_wait([this, quick_syncs](const boost::system::error_code& ec)
+        {
+            if (!ec)
+            {
+                sendTimeSyncMessage(quick_syncs);
+            }
+        });
+        return;
+    }
+
     auto timeReq = std::make_shared<msg::Time>();
     clientConnection_->sendRequest<msg::Time>(timeReq, 2s,
                                               [this, quick_syncs](const boost::system::error_code& ec, const std::unique_ptr<msg::Time>& response) mutable
@@ -344,7 +458,8 @@ void Controller::sendTimeSyncMessage(int quick_syncs)
             TimeProvider::getInstance().setDiff(response->latency, response->received - response->sent);
         }
 
-        std::chrono::microseconds next = TIME_SYNC_INTERVAL;
+        // the skew is tracked between the syncs, so that they can be sent less frequently once the estimation settled
+        std::chrono::microseconds next = TimeProvider::getInstance().converged() ? TIME_SYNC_INTERVAL_CONVERGED : TIME_SYNC_INTERVAL;
         if (quick_syncs > 0)
         {
             if (--quick_syncs == 0)
@@ -363,6 +478,65 @@ void Controller::sendTimeSyncMessage(int quick_syncs)
     });
 }
 
+void Controller::scheduleStats()
+{
+    // servers that don't support the stats don't request them
+    std::chrono::milliseconds interval(serverSettings_ ? serverSettings_->getStatsIntervalMs() : 0);
+    if (interval.count() == 0)
+        return;
+    statsTimer_.expires_after(interval);
+    statsTimer_.async_wait([this, interval](const boost::system::error_code& ec)
+    {
+        if (!ec)
+        {
+            sendStats(interval);
+            scheduleStats();
+        }
+    });
+}
+
+
+void Controller::sendStats(const std::chrono::milliseconds& interval)
+{
+    if (!stream_)
+        return;
+
+    auto to_uint32 = [](int64_t value) { return static_cast<uint32_t>(std::clamp<int64_t>(value, 0, std::numeric_limits<uint32_t>::max())); };
+    // the counters restart with a new stream
+    auto increase = [](uint32_t value, uint32_t last) { return (value >= last) ? value - last : value; };
+
+    auto statistics = stream_->getStatistics();
+    auto stats = std::make_shared<msg::ClientStats>();
+    stats->interval_ms = to_uint32(interval.count());
+    stats->sync_error_p50_us = to_uint32(statistics.sync_error[0].count());
+    stats->sync_error_p95_us = to_uint32(statistics.sync_error[1].count());
+    stats->sync_error_p99_us = to_uint32(statistics.sync_error[2].count());
+    stats->sync_error_max_us = to_uint32(statistics.sync_error[3].count());
+    stats->hard_syncs = increase(statistics.hard_syncs, lastStatistics_.hard_syncs);
+    stats->underruns = increase(statistics.underruns, lastStatistics_.underruns);
+    stats->buffer_ms = to_uint32(std::chrono::duration_cast<std::chrono::milliseconds>(statistics.buffer).count());
+    stats->device_latency_us = to_uint32(statistics.dac_time.count());
+    stats->rtt_us = to_uint32(TimeProvider::getInstance().getRtt().count());
+    if (decodeWorker_)
+    {
+        auto decode_statistics = decodeWorker_->takeStatistics();
+        if (decode_statistics.chunks > 0)
+            stats->decode_avg_us = to_uint32(decode_statistics.total.count() / decode_statistics.chunks);
+        stats->decode_max_us = to_uint32(decode_statistics.max.count());
+    }
+    lastStatistics_ = statistics;
+
+    clientConnection_->send(stats, [this](const boost::system::error_code& ec)
+    {
+        if (ec)
+        {
+            LOG(ERROR, LOG_TAG) << "Failed to send client stats, error: " << ec.message() << "\n";
+            reconnect();
+        }
+    });
+}
+
+
 void Controller::browseMdns(const MdnsHandler& handler)
 {
 #ifdef HAS_MDNS
@@ -452,11 +626,26 @@ void Controller::reconnect()
 {
     LOG(INFO, LOG_TAG) << "Reconnecting\n";
     timer_.cancel();
+    statsTimer_.cancel();
     clientConnection_->disconnect();
-    player_.reset();
-    stream_.reset();
-    decoder_.reset();
-    timer_.expires_after(1s);
+    if (zoneRouter_)
+        zoneRouter_->releaseTimeSync(this);
+    readPaused_ = false;
+    resuming_ = false;
+
+    // Keep decoder, stream and player during short outages, to play the queued audio and to resume the stream
+    // after reconnecting. The server keeps the chunks of one buffer duration, after longer outages start from scratch.
+    auto now = chronos::clk::now();
+    if (!disconnected_.has_value())
+        disconnected_ = now;
+    if (!serverSettings_ || (now - *disconnected_ > std::chrono::milliseconds(serverSettings_->getBufferMs())))
+    {
+        decodeWorker_.reset();
+        player_.reset();
+        stream_.reset();
+        lastChunkTimestamp_.reset();
+    }
+    timer_.expires_after((now - *disconnected_ < 1s) ? FAST_RECONNECT_INTERVAL : RECONNECT_INTERVAL);
     timer_.async_wait([this](const boost::system::error_code& ec)
     {
         if (!ec)
@@ -485,6 +674,9 @@ void Controller::worker()
             if (settings_.server.auth.has_value())
                 auth = msg::Hello::Auth{settings_.server.auth->scheme, settings_.server.auth->param};
             auto hello = std::make_shared<msg::Hello>(macAddress, settings_.host_id, settings_.instance, auth);
+            resuming_ = stream_ && lastChunkTimestamp_.has_value();
+            if (resuming_)
+                hello->setResume(*lastChunkTimestamp_);
             clientConnection_->sendRequest(hello, 2s, [this](const boost::system::error_code& ec, std::unique_ptr<msg::BaseMessage> response) mutable
             {
                 if (ec)
@@ -514,8 +706,10 @@ void Controller::worker()
                     LOG(INFO, LOG_TAG) << "ServerSettings - buffer: " << serverSettings_->getBufferMs() << ", latency: " << serverSettings_->getLatency()
                                        << ", volume: " << serverSettings_->getVolume() << ", muted: " << serverSettings_->isMuted() << "\n";
 
-                    // Do initial time sync with the server
-                    sendTimeSyncMessage(50);
+                    // Do initial time sync with the server, the estimation is kept over a reconnect
+                    disconnected_.reset();
+                    sendTimeSyncMessage(TimeProvider::getInstance().converged() ? 0 : 50);
+                    scheduleStats();
                 }
             });
         }
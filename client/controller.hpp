@@ -22,13 +22,15 @@
 #include "client_connection.hpp"
 #include "client_settings.hpp"
 #include "common/message/server_settings.hpp"
-#include "decoder/decoder.hpp"
+#include "decode_worker.hpp"
 #include "player/player.hpp"
 #include "stream.hpp"
+#include "zone_router.hpp"
 
 // 3rd party headers
 
 // standard headers
+#include <optional>
 
 
 using namespace std::chrono_literals;
@@ -37,14 +39,20 @@ using namespace std::chrono_literals;
 /**
  * Sets up a connection to the server (using ClientConnection)
  * Sets up the audio decoder and player.
- * Decodes audio (message_type::kWireChunk) and feeds PCM to the audio stream buffer
+ * Decodes audio (message_type::kWireChunk) on a DecodeWorker thread and feeds PCM to the audio stream buffer
  * Does timesync with the server
+ * Reports sync stats to the server, if requested in the server settings
+ * Keeps decoder, stream and player over short connection losses and asks the server to resume the stream
+ * Can be one of several zones of a multi-zone client, sharing the TimeProvider and the decoded chunks (using ZoneRouter)
  */
 class Controller
 {
 public:
     /// c'tor
-    Controller(boost::asio::io_context& io_context, const ClientSettings& settings);
+    /// @param io_context the io_context, shared by all zones of a multi-zone client
+    /// @param settings the client settings
+    /// @param zone_router shares the decoded chunks and the time sync with the other zones, nullptr for a single client
+    Controller(boost::asio::io_context& io_context, const ClientSettings& settings, std::shared_ptr<ZoneRouter> zone_router = nullptr);
     /// Start thw work
     void start();
     // void stop();
@@ -56,24 +64,44 @@ private:
     void worker();
     void reconnect();
     void browseMdns(const MdnsHandler& handler);
+    /// @return true if the player @p player_name (or the default player, if empty) can play packed 24 bit samples (S24_3LE)
+    static bool supportsPacked24(const std::string& player_name);
 
     template <typename PlayerType>
     std::unique_ptr<player::Player> createPlayer(ClientSettings::Player& settings, const std::string& player_name);
 
     void getNextMessage();
     void sendTimeSyncMessage(int quick_syncs);
+    /// Send the sync stats in the interval requested by the server
+    void scheduleStats();
+    /// Send the sync stats of the last @p interval
+    void sendStats(const std::chrono::milliseconds& interval);
 
     boost::asio::io_context& io_context_;
 #ifdef HAS_OPENSSL
     boost::asio::ssl::context ssl_context_;
 #endif
     boost::asio::steady_timer timer_;
+    boost::asio::steady_timer statsTimer_;
     ClientSettings settings_;
+    std::shared_ptr<ZoneRouter> zoneRouter_;
     SampleFormat sampleFormat_;
     std::unique_ptr<ClientConnection> clientConnection_;
     std::shared_ptr<Stream> stream_;
-    std::unique_ptr<decoder::Decoder> decoder_;
+    std::unique_ptr<DecodeWorker> decodeWorker_;
+    /// reading is paused, until the decode worker accepts new chunks
+    bool readPaused_{false};
     std::unique_ptr<player::Player> player_;
+    /// the last volume of the player, sent to the server
+    player::Player::Volume lastVolume_{-1, true};
     std::unique_ptr<msg::ServerSettings> serverSettings_;
     std::unique_ptr<msg::CodecHeader> headerChunk_;
+    /// timestamp of the last received chunk, to resume the stream after a reconnect
+    std::optional<tv> lastChunkTimestamp_;
+    /// the hello message asked the server to resume the stream
+    bool resuming_{false};
+    /// start of the current outage
+    std::optional<chronos::time_point_clk> disconnected_;
+    /// stream statistics of the last sent sync stats, to send the counters' increase
+    Stream::Statistics lastStatistics_;
 };
@@ -0,0 +1,145 @@
+/***
+    This file is part of snapcast
+    Copyright (C) 2014-2025  Johannes Pohl
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+***/
+
+// prototype/interface header file
+#include "decode_worker.hpp"
+
+// local headers
+#include "common/aixlog.hpp"
+#include "common/utils/pcm_utils.hpp"
+
+// 3rd party headers
+#include <boost/asio/post.hpp>
+
+// standard headers
+#include <algorithm>
+
+
+static constexpr auto LOG_TAG = "DecodeWorker";
+
+
+DecodeWorker::DecodeWorker(boost::asio::io_context& io_context, std::unique_ptr<decoder::Decoder> decoder, std::shared_ptr<Stream> stream,
+                           size_t max_pending, std::unique_ptr<ZoneRouter::Member> member, std::vector<uint16_t> channels)
+    : io_context_(io_context), decoder_(std::move(decoder)), stream_(std::move(stream)), max_pending_(std::max<size_t>(max_pending, 1)),
+      member_(std::move(member)), channels_(std::move(channels)), active_(true)
+{
+    thread_ = std::thread(&DecodeWorker::worker, this);
+}
+
+
+DecodeWorker::~DecodeWorker()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        active_ = false;
+    }
+    cond_.notify_one();
+    if (thread_.joinable())
+        thread_.join();
+}
+
+
+bool DecodeWorker::push(std::unique_ptr<msg::PcmChunk> chunk, ReadyHandler on_ready)
+{
+    bool accepts_more;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        pending_.push_back(std::move(chunk));
+        accepts_more = (pending_.size() < max_pending_);
+        if (!accepts_more)
+        {
+            LOG(DEBUG, LOG_TAG) << "Decode queue full (" << pending_.size() << " chunks), pausing\n";
+            on_ready_ = std::move(on_ready);
+        }
+    }
+    cond_.notify_one();
+    return accepts_more;
+}
+
+
+void DecodeWorker::worker()
+{
+    std::unique_lock<std::mutex> lock(mutex_);
+    while (true)
+    {
+        cond_.wait(lock, [this]() { return !active_ || !pending_.empty(); });
+        if (!active_)
+            return;
+
+        auto chunk = std::move(pending_.front());
+        pending_.pop_front();
+        // resume with some hysteresis, to not toggle for every chunk
+        if (on_ready_ && (pending_.size() <= max_pending_ / 2))
+        {
+            LOG(DEBUG, LOG_TAG) << "Decode queue drained (" << pending_.size() << " chunks), resuming\n";
+            boost::asio::post(io_context_, std::move(on_ready_));
+            on_ready_ = nullptr;
+        }
+        lock.unlock();
+
+        try
+        {
+            auto start = std::chrono::steady_clock::now();
+            chunk = decode(std::move(chunk));
+            auto duration = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start).count();
+            decoded_chunks_.fetch_add(1, std::memory_order_relaxed);
+            decode_total_us_.fetch_add(duration, std::memory_order_relaxed);
+            auto max = decode_max_us_.load(std::memory_order_relaxed);
+            while ((duration > max) && !decode_max_us_.compare_exchange_weak(max, duration, std::memory_order_relaxed))
+                ;
+            if (chunk)
+                stream_->addChunk(std::move(chunk));
+        }
+        catch (const std::exception& e)
+        {
+            LOG(ERROR, LOG_TAG) << "Exception while decoding: " << e.what() << "\n";
+        }
+
+        lock.lock();
+    }
+}
+
+
+DecodeWorker::Statistics DecodeWorker::takeStatistics()
+{
+    Statistics statistics;
+    statistics.chunks = decoded_chunks_.exchange(0, std::memory_order_relaxed);
+    statistics.total = std::chrono::microseconds(decode_total_us_.exchange(0, std::memory_order_relaxed));
+    statistics.max = std::chrono::microseconds(decode_max_us_.exchange(0, std::memory_order_relaxed));
+    return statistics;
+}
+
+
+std::unique_ptr<msg::PcmChunk> DecodeWorker::decode(std::unique_ptr<msg::PcmChunk> chunk)
+{
+    if (member_)
+        chunk = member_->decode(std::move(chunk), [this](msg::PcmChunk& encoded) { return decoder_->decode(&encoded); });
+    else if (!decoder_->decode(chunk.get()))
+        chunk = nullptr;
+
+    if (!chunk || channels_.empty())
+        return chunk;
+
+    const auto& format = chunk->format;
+    SampleFormat mapped_format(format.rate(), format.bits(), static_cast<uint16_t>(channels_.size()), format.sampleSize());
+    auto mapped = std::make_unique<msg::PcmChunk>(mapped_format, 0);
+    mapped->timestamp = chunk->timestamp;
+    mapped->setFrameCount(static_cast<int>(chunk->getFrameCount()));
+    utils::pcm::mapChannels(chunk->payload, mapped->payload, chunk->getFrameCount(), format.channels(), format.sampleSize(), channels_);
+    return mapped;
+}
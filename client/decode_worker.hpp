@@ -0,0 +1,114 @@
+/***
+    This file is part of snapcast
+    Copyright (C) 2014-2025  Johannes Pohl
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+***/
+
+#pragma once
+
+
+// local headers
+#include "common/message/pcm_chunk.hpp"
+#include "decoder/decoder.hpp"
+#include "stream.hpp"
+#include "zone_router.hpp"
+
+// 3rd party headers
+#include <boost/asio/io_context.hpp>
+
+// standard headers
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+
+/// Decodes audio chunks on a dedicated thread
+/**
+ * Encoded chunks are queued by the network thread and decoded in the order of arrival
+ * by a worker thread, which passes them on to the Stream.
+ * The queue is bounded: if it's full, the producer is asked to pause reading and is
+ * notified via the io_context as soon as the queue has drained to the half.
+ * In a multi-zone client the decoding is shared with the other zones on the same stream
+ * and the decoded chunks can be reduced to a selection of channels.
+ */
+class DecodeWorker
+{
+public:
+    /// Handler that is called when the queue accepts new chunks again
+    using ReadyHandler = std::function<void()>;
+
+    /// c'tor
+    /// @param io_context the context to post the ready handler to
+    /// @param decoder the decoder, initialized with the codec header
+    /// @param stream the stream to add the decoded chunks to
+    /// @param max_pending max number of queued chunks
+    /// @param member membership in a ZoneRouter source, to share the decoded chunks, or nullptr
+    /// @param channels the channels of the decoded chunks to add to the stream, in this order, or empty for all channels
+    DecodeWorker(boost::asio::io_context& io_context, std::unique_ptr<decoder::Decoder> decoder, std::shared_ptr<Stream> stream, size_t max_pending,
+                 std::unique_ptr<ZoneRouter::Member> member = nullptr, std::vector<uint16_t> channels = {});
+    /// d'tor, discards pending chunks and stops the worker thread
+    virtual ~DecodeWorker();
+
+    /// Queue the encoded @p chunk for decoding
+    /// @return true if more chunks can be queued. If false is returned, @p on_ready will be posted
+    /// to the io_context as soon as the queue can take new chunks
+    bool push(std::unique_ptr<msg::PcmChunk> chunk, ReadyHandler on_ready);
+
+    /// Decode statistics
+    struct Statistics
+    {
+        /// number of decoded chunks
+        uint32_t chunks{0};
+        /// sum of the decode durations
+        std::chrono::microseconds total{0};
+        /// max decode duration
+        std::chrono::microseconds max{0};
+    };
+
+    /// @return the decode statistics since the last call, can be called from any thread
+    Statistics takeStatistics();
+
+private:
+    /// The worker thread
+    void worker();
+    /// Decode the encoded @p chunk, on its own or together with the other members of the source
+    /// @return the decoded chunk with the selected channels, or nullptr
+    std::unique_ptr<msg::PcmChunk> decode(std::unique_ptr<msg::PcmChunk> chunk);
+
+    boost::asio::io_context& io_context_;
+    std::unique_ptr<decoder::Decoder> decoder_;
+    std::shared_ptr<Stream> stream_;
+    size_t max_pending_;
+    std::unique_ptr<ZoneRouter::Member> member_;
+    std::vector<uint16_t> channels_;
+
+    std::mutex mutex_;
+    std::condition_variable cond_;
+    std::deque<std::unique_ptr<msg::PcmChunk>> pending_;
+    ReadyHandler on_ready_;
+    bool active_;
+    std::thread thread_;
+
+    /// decode statistics, written by the worker thread and reset by takeStatistics
+    std::atomic<uint32_t> decoded_chunks_{0};
+    std::atomic<std::chrono::microseconds::rep> decode_total_us_{0};
+    std::atomic<std::chrono::microseconds::rep> decode_max_us_{0};
+};
@@ -25,6 +25,8 @@
 #include "common/snap_exception.hpp"
 
 // standard headers
+#include <algorithm>
+#include <cstdlib>
 #include <cstring>
 #include <iostream>
 
@@ -36,38 +38,31 @@ static constexpr auto LOG_TAG = "FlacDecoder";
 namespace decoder
 {
 
-namespace callback
-{
-// NOLINTBEGIN
-FLAC__StreamDecoderReadStatus read_callback(const FLAC__StreamDecoder* decoder, FLAC__byte buffer[], size_t* bytes, void* client_data);
-FLAC__StreamDecoderWriteStatus write_callback(const FLAC__StreamDecoder* decoder, const FLAC__Frame* frame, const FLAC__int32* const buffer[],
-                                              void* client_data);
-void metadata_callback(const FLAC__StreamDecoder* decoder, const FLAC__StreamMetadata* metadata, void* client_data);
-void error_callback(const FLAC__StreamDecoder* decoder, FLAC__StreamDecoderErrorStatus status, void* client_data);
-// NOLINTEND
-} // namespace callback
-
-namespace
-{
-msg::CodecHeader* flacHeader = nullptr;
-msg::PcmChunk* flacChunk = nullptr;
-msg::PcmChunk* pcmChunk = nullptr;
-SampleFormat sampleFormat;
-FLAC__StreamDecoder* decoder = nullptr;
-} // namespace
-
-
 FlacDecoder::FlacDecoder() : Decoder(), lastError_(nullptr)
 {
-    flacChunk = new msg::PcmChunk();
 }
 
 
 FlacDecoder::~FlacDecoder()
 {
     std::lock_guard<std::mutex> lock(mutex_);
-    FLAC__stream_decoder_delete(decoder);
-    delete flacChunk;
+    if (decoder_ != nullptr)
+        FLAC__stream_decoder_delete(decoder_);
+    free(output_);
+}
+
+
+bool FlacDecoder::reserveOutput(size_t bytes)
+{
+    if ((bytes == 0) || (output_size_ + bytes <= output_capacity_))
+        return true;
+    size_t capacity = std::max(output_size_ + bytes, 2 * output_capacity_);
+    auto* output = static_cast<char*>(realloc(output_, capacity)); // NOLINT
+    if (output == nullptr)
+        return false;
+    output_ = output;
+    output_capacity_ = capacity;
+    return true;
 }
 
 
@@ -75,27 +70,35 @@ bool FlacDecoder::decode(msg::PcmChunk* chunk)
 {
     std::lock_guard<std::mutex> lock(mutex_);
     cacheInfo_.reset();
-    pcmChunk = chunk;
-    flacChunk->payload = static_cast<char*>(realloc(flacChunk->payload, chunk->payloadSize));
-    memcpy(flacChunk->payload, chunk->payload, chunk->payloadSize);
-    flacChunk->payloadSize = chunk->payloadSize;
-
-    pcmChunk->payload = static_cast<char*>(realloc(pcmChunk->payload, 0)); // NOLINT
-    pcmChunk->payloadSize = 0;
-    while (flacChunk->payloadSize > 0)
-    {
-        if (FLAC__stream_decoder_process_single(decoder) == 0)
-        {
-            return false;
-        }
+    input_ = chunk->payload;
+    input_size_ = chunk->payloadSize;
+
+    // presize the output buffer to the decoded size of the last chunk
+    output_size_ = 0;
+    if (!reserveOutput(last_output_size_))
+        throw SnapException("Failed to allocate output buffer");
 
-        if (lastError_)
+    while (input_size_ > 0)
+    {
+        if ((FLAC__stream_decoder_process_single(decoder_) == 0) || lastError_)
         {
-            LOG(ERROR, LOG_TAG) << "FLAC decode error: " << FLAC__StreamDecoderErrorStatusString[*lastError_] << "\n";
+            if (lastError_)
+                LOG(ERROR, LOG_TAG) << "FLAC decode error: " << FLAC__StreamDecoderErrorStatusString[*lastError_] << "\n";
             lastError_ = nullptr;
+            input_ = nullptr;
+            input_size_ = 0;
             return false;
         }
     }
+    input_ = nullptr;
+
+    // hand the decoded samples over to the chunk, the encoded payload is not needed anymore
+    free(chunk->payload);
+    chunk->payload = output_;
+    chunk->payloadSize = static_cast<uint32_t>(output_size_);
+    last_output_size_ = output_size_;
+    output_ = nullptr;
+    output_capacity_ = 0;
 
     if ((cacheInfo_.cachedBlocks_ > 0) && (cacheInfo_.sampleRate_ != 0))
     {
@@ -111,23 +114,30 @@ bool FlacDecoder::decode(msg::PcmChunk* chunk)
 
 SampleFormat FlacDecoder::setHeader(msg::CodecHeader* chunk)
 {
-    flacHeader = chunk;
-    FLAC__StreamDecoderInitStatus init_status;
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (decoder_ != nullptr)
+        FLAC__stream_decoder_delete(decoder_);
 
-    if ((decoder = FLAC__stream_decoder_new()) == nullptr)
+    if ((decoder_ = FLAC__stream_decoder_new()) == nullptr)
         throw SnapException("ERROR: allocating decoder");
 
-    //	(void)FLAC__stream_decoder_set_md5_checking(decoder, true);
-    init_status = FLAC__stream_decoder_init_stream(decoder, callback::read_callback, nullptr, nullptr, nullptr, nullptr, callback::write_callback,
-                                                   callback::metadata_callback, callback::error_callback, this);
+    //	(void)FLAC__stream_decoder_set_md5_checking(decoder_, true);
+    FLAC__StreamDecoderInitStatus init_status = FLAC__stream_decoder_init_stream(decoder_, callback::read_callback, nullptr, nullptr, nullptr, nullptr,
+                                                                                 callback::write_callback, callback::metadata_callback,
+                                                                                 callback::error_callback, this);
     if (init_status != FLAC__STREAM_DECODER_INIT_STATUS_OK)
         throw SnapException("ERROR: initializing decoder: " + string(FLAC__StreamDecoderInitStatusString[init_status]));
 
-    FLAC__stream_decoder_process_until_end_of_metadata(decoder);
-    if (sampleFormat.rate() == 0)
+    sample_format_ = SampleFormat();
+    input_ = chunk->payload;
+    input_size_ = chunk->payloadSize;
+    FLAC__stream_decoder_process_until_end_of_metadata(decoder_);
+    input_ = nullptr;
+    input_size_ = 0;
+    if (sample_format_.rate() == 0)
         throw SnapException("Sample format not found");
 
-    return sampleFormat;
+    return sample_format_;
 }
 
 namespace callback
@@ -135,26 +145,20 @@ namespace callback
 // NOLINTNEXTLINE
 FLAC__StreamDecoderReadStatus read_callback(const FLAC__StreamDecoder* /*decoder*/, FLAC__byte buffer[], size_t* bytes, void* client_data)
 {
-    if (flacHeader != nullptr)
-    {
-        *bytes = flacHeader->payloadSize;
-        memcpy(buffer, flacHeader->payload, *bytes);
-        flacHeader = nullptr;
-    }
-    else if (flacChunk != nullptr)
+    auto* flacDecoder = static_cast<FlacDecoder*>(client_data);
+    // header data is read during setHeader, where no chunk is decoded, so this has no effect
+    flacDecoder->cacheInfo_.isCachedChunk_ = false;
+    if (*bytes > flacDecoder->input_size_)
+        *bytes = flacDecoder->input_size_;
+
+    //		if (*bytes == 0)
+    //			return FLAC__STREAM_DECODER_READ_STATUS_END_OF_STREAM;
+
+    if (*bytes > 0)
     {
-        //		cerr << "read_callback: " << *bytes << ", avail: " << flacChunk->payloadSize << "\n";
-        static_cast<FlacDecoder*>(client_data)->cacheInfo_.isCachedChunk_ = false;
-        if (*bytes > flacChunk->payloadSize)
-            *bytes = flacChunk->payloadSize;
-
-        //		if (*bytes == 0)
-        //			return FLAC__STREAM_DECODER_READ_STATUS_END_OF_STREAM;
-
-        memcpy(buffer, flacChunk->payload, *bytes);
-        memmove(flacChunk->payload, flacChunk->payload + *bytes, flacChunk->payloadSize - *bytes);
-        flacChunk->payloadSize = flacChunk->payloadSize - static_cast<uint32_t>(*bytes);
-        flacChunk->payload = static_cast<char*>(realloc(flacChunk->payload, flacChunk->payloadSize)); // NOLINT
+        memcpy(buffer, flacDecoder->input_, *bytes);
+        flacDecoder->input_ += *bytes;
+        flacDecoder->input_size_ -= *bytes;
     }
     return FLAC__STREAM_DECODER_READ_STATUS_CONTINUE;
 }
@@ -163,45 +167,48 @@ FLAC__StreamDecoderReadStatus read_callback(const FLAC__StreamDecoder* /*decoder
 FLAC__StreamDecoderWriteStatus write_callback(const FLAC__StreamDecoder* /*decoder*/, const FLAC__Frame* frame, const FLAC__int32* const buffer[],
                                               void* client_data)
 {
-    if (pcmChunk != nullptr)
-    {
-        size_t bytes = frame->header.blocksize * sampleFormat.frameSize();
+    auto* flacDecoder = static_cast<FlacDecoder*>(client_data);
+    const SampleFormat& sampleFormat = flacDecoder->sample_format_;
+    size_t bytes = frame->header.blocksize * sampleFormat.frameSize();
 
-        auto* flacDecoder = static_cast<FlacDecoder*>(client_data);
-        if (flacDecoder->cacheInfo_.isCachedChunk_)
-            flacDecoder->cacheInfo_.cachedBlocks_ += frame->header.blocksize;
+    if (flacDecoder->cacheInfo_.isCachedChunk_)
+        flacDecoder->cacheInfo_.cachedBlocks_ += frame->header.blocksize;
+
+    if (!flacDecoder->reserveOutput(bytes))
+    {
+        LOG(ERROR, LOG_TAG) << "Failed to allocate output buffer\n";
+        return FLAC__STREAM_DECODER_WRITE_STATUS_ABORT;
+    }
+    char* output = flacDecoder->output_ + flacDecoder->output_size_;
 
-        pcmChunk->payload = static_cast<char*>(realloc(pcmChunk->payload, pcmChunk->payloadSize + bytes));
+    for (size_t channel = 0; channel < sampleFormat.channels(); ++channel)
+    {
+        if (buffer[channel] == nullptr)
+        {
+            LOG(ERROR, LOG_TAG) << "ERROR: buffer[" << channel << "] is NULL\n";
+            return FLAC__STREAM_DECODER_WRITE_STATUS_ABORT;
+        }
 
-        for (size_t channel = 0; channel < sampleFormat.channels(); ++channel)
+        if (sampleFormat.sampleSize() == 1)
         {
-            if (buffer[channel] == nullptr)
-            {
-                LOG(ERROR, LOG_TAG) << "ERROR: buffer[" << channel << "] is NULL\n";
-                return FLAC__STREAM_DECODER_WRITE_STATUS_ABORT;
-            }
-
-            if (sampleFormat.sampleSize() == 1)
-            {
-                auto* chunkBuffer = reinterpret_cast<int8_t*>(pcmChunk->payload + pcmChunk->payloadSize);
-                for (size_t i = 0; i < frame->header.blocksize; i++)
-                    chunkBuffer[sampleFormat.channels() * i + channel] = static_cast<int8_t>(buffer[channel][i]);
-            }
-            else if (sampleFormat.sampleSize() == 2)
-            {
-                auto* chunkBuffer = reinterpret_cast<int16_t*>(pcmChunk->payload + pcmChunk->payloadSize);
-                for (size_t i = 0; i < frame->header.blocksize; i++)
-                    chunkBuffer[sampleFormat.channels() * i + channel] = SWAP_16((int16_t)(buffer[channel][i]));
-            }
-            else if (sampleFormat.sampleSize() == 4)
-            {
-                auto* chunkBuffer = reinterpret_cast<int32_t*>(pcmChunk->payload + pcmChunk->payloadSize);
-                for (size_t i = 0; i < frame->header.blocksize; i++)
-                    chunkBuffer[sampleFormat.channels() * i + channel] = SWAP_32((int32_t)(buffer[channel][i]));
-            }
+            auto* chunkBuffer = reinterpret_cast<int8_t*>(output);
+            for (size_t i = 0; i < frame->header.blocksize; i++)
+                chunkBuffer[sampleFormat.channels() * i + channel] = static_cast<int8_t>(buffer[channel][i]);
+        }
+        else if (sampleFormat.sampleSize() == 2)
+        {
+            auto* chunkBuffer = reinterpret_cast<int16_t*>(output);
+            for (size_t i = 0; i < frame->header.blocksize; i++)
+                chunkBuffer[sampleFormat.channels() * i + channel] = SWAP_16((int16_t)(buffer[channel][i]));
+        }
+        else if (sampleFormat.sampleSize() == 4)
+        {
+            auto* chunkBuffer = reinterpret_cast<int32_t*>(output);
+            for (size_t i = 0; i < frame->header.blocksize; i++)
+                chunkBuffer[sampleFormat.channels() * i + channel] = SWAP_32((int32_t)(buffer[channel][i]));
         }
-        pcmChunk->payloadSize += static_cast<uint32_t>(bytes);
     }
+    flacDecoder->output_size_ += bytes;
 
     return FLAC__STREAM_DECODER_WRITE_STATUS_CONTINUE;
 }
@@ -212,9 +219,10 @@ void metadata_callback(const FLAC__StreamDecoder* /*decoder*/, const FLAC__Strea
     /* print some stats */
     if (metadata->type == FLAC__METADATA_TYPE_STREAMINFO)
     {
-        static_cast<FlacDecoder*>(client_data)->cacheInfo_.sampleRate_ = metadata->data.stream_info.sample_rate;
-        sampleFormat.setFormat(metadata->data.stream_info.sample_rate, static_cast<uint16_t>(metadata->data.stream_info.bits_per_sample),
-                               static_cast<uint16_t>(metadata->data.stream_info.channels));
+        auto* flacDecoder = static_cast<FlacDecoder*>(client_data);
+        flacDecoder->cacheInfo_.sampleRate_ = metadata->data.stream_info.sample_rate;
+        flacDecoder->sample_format_.setFormat(metadata->data.stream_info.sample_rate, static_cast<uint16_t>(metadata->data.stream_info.bits_per_sample),
+                                              static_cast<uint16_t>(metadata->data.stream_info.channels));
     }
 }
 
@@ -32,6 +32,19 @@
 namespace decoder
 {
 
+class FlacDecoder;
+
+namespace callback
+{
+// NOLINTBEGIN
+FLAC__StreamDecoderReadStatus read_callback(const FLAC__StreamDecoder* decoder, FLAC__byte buffer[], size_t* bytes, void* client_data);
+FLAC__StreamDecoderWriteStatus write_callback(const FLAC__StreamDecoder* decoder, const FLAC__Frame* frame, const FLAC__int32* const buffer[],
+                                              void* client_data);
+void metadata_callback(const FLAC__StreamDecoder* decoder, const FLAC__StreamMetadata* metadata, void* client_data);
+void error_callback(const FLAC__StreamDecoder* decoder, FLAC__StreamDecoderErrorStatus status, void* client_data);
+// NOLINTEND
+} // namespace callback
+
 
 /// Cache internal decoder status
 struct CacheInfo
@@ -50,6 +63,11 @@ struct CacheInfo
 
 
 /// Flac decoder
+/**
+ * All decoder state is held per instance, so that multiple streams can be decoded in parallel.
+ * The encoded data is read by libFLAC directly from the received chunk, the decoded samples
+ * are written into an output buffer that is presized to the decoded size of the previous chunk.
+ */
 class FlacDecoder : public Decoder
 {
 public:
@@ -61,12 +79,40 @@ public:
     bool decode(msg::PcmChunk* chunk) override;
     SampleFormat setHeader(msg::CodecHeader* chunk) override;
 
+private:
+    friend FLAC__StreamDecoderReadStatus callback::read_callback(const FLAC__StreamDecoder* decoder, FLAC__byte buffer[], size_t* bytes, void* client_data);
+    friend FLAC__StreamDecoderWriteStatus callback::write_callback(const FLAC__StreamDecoder* decoder, const FLAC__Frame* frame,
+                                                                   const FLAC__int32* const buffer[], void* client_data);
+    friend void callback::metadata_callback(const FLAC__StreamDecoder* decoder, const FLAC__StreamMetadata* metadata, void* client_data);
+    friend void callback::error_callback(const FLAC__StreamDecoder* decoder, FLAC__StreamDecoderErrorStatus status, void* client_data);
+
+    /// Make sure that the output buffer can take @p bytes more bytes
+    /// @return false if the buffer could not be allocated
+    bool reserveOutput(size_t bytes);
+
+    /// the libFLAC decoder
+    FLAC__StreamDecoder* decoder_{nullptr};
+    /// sample format, as read from the stream info
+    SampleFormat sample_format_;
     /// Flac internal cache info
     CacheInfo cacheInfo_;
     /// Last decoder error
     std::unique_ptr<FLAC__StreamDecoderErrorStatus> lastError_;
 
-private:
+    /// encoded data that is not yet consumed by libFLAC (points into the header or chunk that is currently decoded)
+    const char* input_{nullptr};
+    /// size of the unconsumed encoded data
+    size_t input_size_{0};
+
+    /// decoded samples, allocated with malloc, because the buffer is handed over to the decoded chunk
+    char* output_{nullptr};
+    /// size of the decoded samples in output_
+    size_t output_size_{0};
+    /// allocated size of output_
+    size_t output_capacity_{0};
+    /// decoded size of the last chunk, used to presize the next output buffer
+    size_t last_output_size_{0};
+
     std::mutex mutex_;
 };
 
@@ -32,6 +32,8 @@ static constexpr auto ID_WAVE = 0x45564157;
 static constexpr auto ID_FMT = 0x20746d66;
 static constexpr auto ID_DATA = 0x61746164;
 
+static constexpr auto WAVE_FORMAT_EXTENSIBLE = 0xFFFE;
+
 /// RIFF wave header
 /// See https://en.wikipedia.org/wiki/WAV
 struct riff_wave_header
@@ -64,6 +66,15 @@ struct chunk_fmt
 };
 
 
+/// Extension of the format chunk for WAVE_FORMAT_EXTENSIBLE
+/// See https://learn.microsoft.com/en-us/windows/win32/api/mmreg/ns-mmreg-waveformatextensible
+struct chunk_fmt_extensible
+{
+    uint16_t cb_size;               ///< size of the extension
+    uint16_t valid_bits_per_sample; ///< valid bits in a sample container
+};
+
+
 PcmDecoder::PcmDecoder() : Decoder()
 {
 }
@@ -86,6 +97,7 @@ SampleFormat PcmDecoder::setHeader(msg::CodecHeader* chunk)
     chunk_fmt.sample_rate = SWAP_32(0);
     chunk_fmt.bits_per_sample = SWAP_16(0);
     chunk_fmt.num_channels = SWAP_16(0);
+    bool packed(false);
 
     size_t pos(0);
     memcpy(&riff_wave_header, chunk->payload + pos, sizeof(riff_wave_header));
@@ -107,6 +119,16 @@ SampleFormat PcmDecoder::setHeader(msg::CodecHeader* chunk)
                     throw SnapException("riff/wave header incomplete");
                 memcpy(&chunk_fmt, chunk->payload + pos, sizeof(chunk_fmt));
                 pos += sizeof(chunk_fmt);
+                /// Snapcast sends 24 bit samples in 4 byte containers, packed samples are signaled
+                /// as WAVE_FORMAT_EXTENSIBLE with 24 valid bits in a 24 bit container
+                if ((SWAP_16(chunk_fmt.audio_format) == WAVE_FORMAT_EXTENSIBLE) &&
+                    (SWAP_32(chunk_header.sz) >= sizeof(chunk_fmt) + sizeof(chunk_fmt_extensible)) &&
+                    (pos + sizeof(chunk_fmt_extensible) <= chunk->payloadSize))
+                {
+                    struct chunk_fmt_extensible chunk_fmt_extensible;
+                    memcpy(&chunk_fmt_extensible, chunk->payload + pos, sizeof(chunk_fmt_extensible));
+                    packed = (SWAP_16(chunk_fmt.bits_per_sample) == 24) && (SWAP_16(chunk_fmt_extensible.valid_bits_per_sample) == 24);
+                }
                 /// If the format header is larger, skip the rest
                 if (SWAP_32(chunk_header.sz) > sizeof(chunk_fmt))
                     pos += (SWAP_32(chunk_header.sz) - sizeof(chunk_fmt));
@@ -125,7 +147,7 @@ SampleFormat PcmDecoder::setHeader(msg::CodecHeader* chunk)
     if (SWAP_32(chunk_fmt.sample_rate) == 0)
         throw SnapException("Sample format not found");
 
-    SampleFormat sampleFormat(SWAP_32(chunk_fmt.sample_rate), SWAP_16(chunk_fmt.bits_per_sample), SWAP_16(chunk_fmt.num_channels));
+    SampleFormat sampleFormat(SWAP_32(chunk_fmt.sample_rate), SWAP_16(chunk_fmt.bits_per_sample), SWAP_16(chunk_fmt.num_channels), packed ? 3 : 0);
 
     return sampleFormat;
 }
@@ -0,0 +1,322 @@
+/***
+    This file is part of snapcast
+    Copyright (C) 2014-2025  Johannes Pohl
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+***/
+
+#pragma once
+
+
+// standard headers
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+
+/// Size limited sliding window with order statistics
+/**
+ * Drop-in replacement for DoubleBuffer, with the same statistic functions:
+ * median, mean, percentile.
+ * Instead of sorting a copy of the buffer for every query, the values are additionally kept
+ * in an order statistic tree (a treap with subtree sizes), so that adding a value (and evicting
+ * the oldest one) is O(log n) and any percentile is O(log n). The median is cached, i.e. O(1)
+ * for repeated queries. All nodes are allocated in setSize, add doesn't allocate.
+ */
+template <class T>
+class MedianBuffer
+{
+public:
+    /// c'tor
+    explicit MedianBuffer(size_t size = 10)
+    {
+        setSize(size);
+    }
+
+    /// Add @p element, pop last, if buffer is full
+    void add(const T& element)
+    {
+        if (nodes_.empty())
+            return;
+
+        size_t index;
+        if (count_ == nodes_.size())
+        {
+            // evict the oldest element and reuse its node
+            index = head_;
+            root_ = erase(root_, static_cast<int32_t>(index));
+            sum_ -= nodes_[index].value;
+            head_ = (head_ + 1) % nodes_.size();
+        }
+        else
+        {
+            index = (head_ + count_) % nodes_.size();
+            ++count_;
+        }
+
+        Node& node = nodes_[index];
+        node.value = element;
+        node.sequence = sequence_++;
+        node.priority = random();
+        node.left = kNil;
+        node.right = kNil;
+        node.size = 1;
+        root_ = insert(root_, static_cast<int32_t>(index));
+        sum_ += element;
+        median_valid_ = false;
+    }
+
+    /// @return median as mean over N values around the median
+    T median(uint16_t mean = 1) const
+    {
+        if (count_ == 0)
+            return 0;
+        if ((mean <= 1) || (count_ < mean))
+        {
+            if (!median_valid_)
+            {
+                median_ = select(count_ / 2);
+                median_valid_ = true;
+            }
+            return median_;
+        }
+
+        uint16_t low = static_cast<uint16_t>(count_) / 2;
+        uint16_t high = low;
+        low -= mean / 2;
+        high += mean / 2;
+        T result((T)0);
+        for (uint16_t i = low; i <= high; ++i)
+            result += select(i);
+        return result / mean;
+    }
+
+    /// @return mean value
+    double mean() const
+    {
+        if (count_ == 0)
+            return 0;
+        return static_cast<double>(sum_) / static_cast<double>(count_);
+    }
+
+    /// @return @p percentile percentile
+    T percentile(unsigned int percentile) const
+    {
+        if (count_ == 0)
+            return 0;
+        return select((size_t)((count_ - 1) * ((float)percentile / (float)100)));
+    }
+
+    /// @return array of different percentiles
+    template <std::size_t Size>
+    std::array<T, Size> percentiles(std::array<uint8_t, Size> percentiles) const
+    {
+        std::array<T, Size> result;
+        result.fill(0);
+        if (count_ == 0)
+            return result;
+        for (std::size_t i = 0; i < Size; ++i)
+            result[i] = percentile(percentiles[i]);
+        return result;
+    }
+
+    /// @return if the buffer is full
+    inline bool full() const
+    {
+        return (count_ == nodes_.size());
+    }
+
+    /// Clear the buffer
+    inline void clear()
+    {
+        root_ = kNil;
+        head_ = 0;
+        count_ = 0;
+        sum_ = 0;
+        median_valid_ = false;
+    }
+
+    /// @return current size of the buffer
+    inline size_t size() const
+    {
+        return count_;
+    }
+
+    /// @return if the buffer is empty
+    inline bool empty() const
+    {
+        return (count_ == 0);
+    }
+
+    /// Set size of the buffer, clears the buffer
+    void setSize(size_t size)
+    {
+        nodes_.resize(size);
+        clear();
+    }
+
+private:
+    static constexpr int32_t kNil = -1;
+
+    /// Tree node, the index of a node is its slot in the sliding window
+    struct Node
+    {
+        T value{};
+        /// insertion counter, to order equal values
+        uint64_t sequence{0};
+        uint32_t priority{0};
+        int32_t left{kNil};
+        int32_t right{kNil};
+        /// number of nodes in this subtree
+        uint32_t size{0};
+    };
+
+    /// @return true if node @p a is ordered before node @p b
+    bool less(int32_t a, int32_t b) const
+    {
+        const Node& na = nodes_[a];
+        const Node& nb = nodes_[b];
+        return (na.value < nb.value) || (!(nb.value < na.value) && (na.sequence < nb.sequence));
+    }
+
+    uint32_t sizeOf(int32_t node) const
+    {
+        return (node == kNil) ? 0 : nodes_[node].size;
+    }
+
+    void update(int32_t node)
+    {
+        nodes_[node].size = 1 + sizeOf(nodes_[node].left) + sizeOf(nodes_[node].right);
+    }
+
+    int32_t rotateRight(int32_t node)
+    {
+        int32_t left = nodes_[node].left;
+        nodes_[node].left = nodes_[left].right;
+        nodes_[left].right = node;
+        update(node);
+        update(left);
+        return left;
+    }
+
+    int32_t rotateLeft(int32_t node)
+    {
+        int32_t right = nodes_[node].right;
+        nodes_[node].right = nodes_[right].left;
+        nodes_[right].left = node;
+        update(node);
+        update(right);
+        return right;
+    }
+
+    /// insert @p node into the subtree @p root
+    /// @return the new root of the subtree
+    int32_t insert(int32_t root, int32_t node)
+    {
+        if (root == kNil)
+            return node;
+        if (less(node, root))
+        {
+            nodes_[root].left = insert(nodes_[root].left, node);
+            update(root);
+            if (nodes_[nodes_[root].left].priority > nodes_[root].priority)
+                root = rotateRight(root);
+        }
+        else
+        {
+            nodes_[root].right = insert(nodes_[root].right, node);
+            update(root);
+            if (nodes_[nodes_[root].right].priority > nodes_[root].priority)
+                root = rotateLeft(root);
+        }
+        return root;
+    }
+
+    /// merge the subtrees @p left and @p right, all nodes in left are ordered before right
+    int32_t merge(int32_t left, int32_t right)
+    {
+        if (left == kNil)
+            return right;
+        if (right == kNil)
+            return left;
+        if (nodes_[left].priority > nodes_[right].priority)
+        {
+            nodes_[left].right = merge(nodes_[left].right, right);
+            update(left);
+            return left;
+        }
+        nodes_[right].left = merge(left, nodes_[right].left);
+        update(right);
+        return right;
+    }
+
+    /// remove @p node from the subtree @p root
+    /// @return the new root of the subtree
+    int32_t erase(int32_t root, int32_t node)
+    {
+        if (root == node)
+            return merge(nodes_[root].left, nodes_[root].right);
+        if (less(node, root))
+            nodes_[root].left = erase(nodes_[root].left, node);
+        else
+            nodes_[root].right = erase(nodes_[root].right, node);
+        update(root);
+        return root;
+    }
+
+    /// @return the value with rank @p rank, i.e. the rank-th smallest value, starting at 0
+    T select(size_t rank) const
+    {
+        int32_t node = root_;
+        while (node != kNil)
+        {
+            size_t left_size = sizeOf(nodes_[node].left);
+            if (rank < left_size)
+            {
+                node = nodes_[node].left;
+            }
+            else if (rank == left_size)
+            {
+                return nodes_[node].value;
+            }
+            else
+            {
+                rank -= left_size + 1;
+                node = nodes_[node].right;
+            }
+        }
+        return 0;
+    }
+
+    /// xorshift32 for the treap priorities
+    uint32_t random()
+    {
+        random_ ^= random_ << 13;
+        random_ ^= random_ >> 17;
+        random_ ^= random_ << 5;
+        return random_;
+    }
+
+    std::vector<Node> nodes_;
+    int32_t root_{kNil};
+    /// slot of the oldest element
+    size_t head_{0};
+    size_t count_{0};
+    uint64_t sequence_{0};
+    uint32_t random_{2463534242};
+    T sum_{0};
+    mutable T median_{0};
+    mutable bool median_valid_{false};
+};
@@ -24,13 +24,20 @@
 #include "common/snap_exception.hpp"
 #include "common/str_compat.hpp"
 #include "common/utils/logging.hpp"
+#include "common/utils/pcm_utils.hpp"
 #include "common/utils/string_utils.hpp"
 
 // 3rd party headers
+#include <pthread.h>
+#include <sys/mman.h>
 
 // standard headers
+#include <algorithm>
+#include <cerrno>
 #include <chrono>
 #include <cmath>
+#include <cstring>
+#include <ctime>
 
 
 using namespace std::chrono_literals;
@@ -85,10 +92,17 @@ AlsaPlayer::AlsaPlayer(boost::asio::io_context& io_context, const ClientSettings
         buffer_time_ = std::chrono::milliseconds(std::max(cpt::stoi(params["buffer_time"]), 10));
     if (params.find("fragments") != params.end())
         periods_ = std::max(cpt::stoi(params["fragments"]), 2);
+    if (params.find("mmap") != params.end())
+        mmap_ = (params["mmap"] == "true");
+    if (params.find("rt_priority") != params.end())
+        rt_priority_ = std::clamp(cpt::stoi(params["rt_priority"]), 1, 99);
+    if (params.find("mlock") != params.end())
+        mlock_ = (params["mlock"] == "true");
 
     LOG(INFO, LOG_TAG) << "Using " << (buffer_time_.has_value() ? "configured" : "default")
                        << " buffer_time: " << buffer_time_.value_or(BUFFER_TIME).count() / 1000 << " ms, " << (periods_.has_value() ? "configured" : "default")
-                       << " fragments: " << periods_.value_or(PERIODS) << "\n";
+                       << " fragments: " << periods_.value_or(PERIODS) << ", mmap: " << mmap_ << ", rt_priority: " << rt_priority_.value_or(0)
+                       << ", mlock: " << mlock_ << "\n";
 }
 
 
@@ -325,8 +339,19 @@ void AlsaPlayer::initAlsa()
     }
 
     // Set parameters
-    if (err = snd_pcm_hw_params_set_access(handle_, params, SND_PCM_ACCESS_RW_INTERLEAVED); err < 0)
-        throw SnapException("Can't set interleaved mode: " + string(snd_strerror(err)));
+    mmap_active_ = false;
+    if (mmap_)
+    {
+        if (err = snd_pcm_hw_params_set_access(handle_, params, SND_PCM_ACCESS_MMAP_INTERLEAVED); err == 0)
+            mmap_active_ = true;
+        else
+            LOG(WARNING, LOG_TAG) << "Can't set mmap interleaved mode: " << snd_strerror(err) << ", using read/write access\n";
+    }
+    if (!mmap_active_)
+    {
+        if (err = snd_pcm_hw_params_set_access(handle_, params, SND_PCM_ACCESS_RW_INTERLEAVED); err < 0)
+            throw SnapException("Can't set interleaved mode: " + string(snd_strerror(err)));
+    }
 
     snd_pcm_format_t snd_pcm_format;
     if (format.bits() == 8)
@@ -335,15 +360,28 @@ void AlsaPlayer::initAlsa()
         snd_pcm_format = SND_PCM_FORMAT_S16_LE;
     else if ((format.bits() == 24) && (format.sampleSize() == 4))
         snd_pcm_format = SND_PCM_FORMAT_S24_LE;
+    else if (format.isPacked24())
+        snd_pcm_format = SND_PCM_FORMAT_S24_3LE;
     else if (format.bits() == 32)
         snd_pcm_format = SND_PCM_FORMAT_S32_LE;
     else
         throw SnapException("Unsupported sample format: " + cpt::to_string(format.bits()));
 
+    unpack_format_ = SND_PCM_FORMAT_UNKNOWN;
     err = snd_pcm_hw_params_set_format(handle_, params, snd_pcm_format);
     if (err == -EINVAL)
     {
-        if (snd_pcm_format == SND_PCM_FORMAT_S24_LE)
+        if (snd_pcm_format == SND_PCM_FORMAT_S24_3LE)
+        {
+            // The device doesn't support packed 24 bit samples, unpack them before writing
+            if (snd_pcm_hw_params_test_format(handle_, params, SND_PCM_FORMAT_S24_LE) == 0)
+                snd_pcm_format = SND_PCM_FORMAT_S24_LE;
+            else
+                snd_pcm_format = SND_PCM_FORMAT_S32_LE;
+            unpack_format_ = snd_pcm_format;
+            LOG(INFO, LOG_TAG) << "S24_3LE not supported, unpacking to " << snd_pcm_format_name(snd_pcm_format) << "\n";
+        }
+        else if (snd_pcm_format == SND_PCM_FORMAT_S24_LE)
         {
             snd_pcm_format = SND_PCM_FORMAT_S32_LE;
             volCorrection_ = 256;
@@ -444,9 +482,26 @@ void AlsaPlayer::initAlsa()
     snd_pcm_sw_params_set_avail_min(handle_, swparams, frames_);
     snd_pcm_sw_params_set_start_threshold(handle_, swparams, frames_);
     //	snd_pcm_sw_params_set_stop_threshold(pcm_handle, swparams, frames_);
+    if (mmap_active_)
+    {
+        // timestamp the status in the time base of CLOCK_MONOTONIC, see getStatus
+        snd_pcm_sw_params_set_tstamp_mode(handle_, swparams, SND_PCM_TSTAMP_ENABLE);
+        snd_pcm_sw_params_set_tstamp_type(handle_, swparams, SND_PCM_TSTAMP_TYPE_MONOTONIC);
+    }
     snd_pcm_sw_params(handle_, swparams);
 
-    if (snd_pcm_state(handle_) == SND_PCM_STATE_PREPARED)
+    if (mmap_active_)
+    {
+        int count = snd_pcm_poll_descriptors_count(handle_);
+        if (count <= 0)
+            throw SnapException("Invalid poll descriptor count: " + cpt::to_string(count));
+        pcm_fds_.resize(count);
+        if (err = snd_pcm_poll_descriptors(handle_, pcm_fds_.data(), count); err < 0)
+            throw SnapException("Can't get poll descriptors: " + string(snd_strerror(err)));
+    }
+
+    // in mmap mode the PCM is started after the first period has been committed
+    if (!mmap_active_ && (snd_pcm_state(handle_) == SND_PCM_STATE_PREPARED))
     {
         if (err = snd_pcm_start(handle_); err < 0)
             LOG(DEBUG, LOG_TAG) << "Failed to start PCM: " << snd_strerror(err) << "\n";
@@ -565,13 +620,84 @@ bool AlsaPlayer::getAvailDelay(snd_pcm_sframes_t& avail, snd_pcm_sframes_t& dela
 }
 
 
+bool AlsaPlayer::getStatus(snd_pcm_sframes_t& avail, chronos::usec& delay)
+{
+    snd_pcm_status_t* status;
+    snd_pcm_status_alloca(&status);
+    if (int err = snd_pcm_status(handle_, status); err < 0)
+    {
+        LOG(WARNING, LOG_TAG) << "snd_pcm_status failed: " << snd_strerror(err) << " (" << err << ")\n";
+        return false;
+    }
+
+    avail = static_cast<snd_pcm_sframes_t>(snd_pcm_status_get_avail(status));
+    delay = chronos::usec(static_cast<chronos::usec::rep>(1000 * static_cast<double>(snd_pcm_status_get_delay(status)) / stream_->getFormat().msRate()));
+
+    // the delay has been measured at the time of the last hardware pointer update, the DAC played on since then
+    snd_htimestamp_t tstamp;
+    snd_pcm_status_get_htstamp(status, &tstamp);
+    if ((tstamp.tv_sec != 0) || (tstamp.tv_nsec != 0))
+    {
+        timespec now;
+        clock_gettime(CLOCK_MONOTONIC, &now);
+        auto age = std::chrono::duration_cast<chronos::usec>(chronos::sec(now.tv_sec - tstamp.tv_sec) + chronos::nsec(now.tv_nsec - tstamp.tv_nsec));
+        if ((age.count() > 0) && (age < delay))
+            delay -= age;
+    }
+    return true;
+}
+
+
+int AlsaPlayer::waitForPcm(std::chrono::milliseconds timeout)
+{
+    int result = poll(pcm_fds_.data(), pcm_fds_.size(), static_cast<int>(timeout.count()));
+    if (result <= 0)
+        return ((result < 0) && (errno != EINTR)) ? -errno : 0;
+
+    unsigned short revents;
+    if (int err = snd_pcm_poll_descriptors_revents(handle_, pcm_fds_.data(), pcm_fds_.size(), &revents); err < 0)
+        return err;
+    if ((revents & POLLERR) != 0)
+    {
+        snd_pcm_state_t state = snd_pcm_state(handle_);
+        if (state == SND_PCM_STATE_XRUN)
+            return -EPIPE;
+        if (state == SND_PCM_STATE_SUSPENDED)
+            return -ESTRPIPE;
+        // a prepared, not yet started PCM also signals POLLERR on some devices
+        if (state != SND_PCM_STATE_PREPARED)
+            return -EIO;
+    }
+    return ((revents & POLLOUT) != 0) ? 1 : 0;
+}
+
+
+void AlsaPlayer::setRealtime()
+{
+    if (mlock_)
+    {
+        if (mlockall(MCL_CURRENT | MCL_FUTURE) != 0)
+            LOG(WARNING, LOG_TAG) << "Failed to lock memory: " << strerror(errno) << "\n";
+        else
+            LOG(INFO, LOG_TAG) << "Locked memory\n";
+    }
+
+    if (rt_priority_.has_value())
+    {
+        sched_param param{};
+        param.sched_priority = *rt_priority_;
+        if (int err = pthread_setschedparam(pthread_self(), SCHED_FIFO, &param); err != 0)
+            LOG(WARNING, LOG_TAG) << "Failed to set SCHED_FIFO priority " << param.sched_priority << ": " << strerror(err) << "\n";
+        else
+            LOG(INFO, LOG_TAG) << "Playback thread running with SCHED_FIFO priority " << param.sched_priority << "\n";
+    }
+}
+
+
 void AlsaPlayer::worker()
 {
-    snd_pcm_sframes_t pcm;
-    snd_pcm_sframes_t framesDelay;
-    snd_pcm_sframes_t framesAvail;
-    long lastChunkTick = chronos::getTickCount();
-    const SampleFormat& format = stream_->getFormat();
+    setRealtime();
+    last_chunk_tick_ = chronos::getTickCount();
     while (active_)
     {
         if (handle_ == nullptr)
@@ -592,83 +718,207 @@ void AlsaPlayer::worker()
                 continue;
         }
 
-        int wait_result = snd_pcm_wait(handle_, 100);
-        if (wait_result == -EPIPE)
+        if (!(mmap_active_ ? playMmap() : playInterleaved()))
+            waitForChunks();
+    }
+}
+
+
+bool AlsaPlayer::playMmap()
+{
+    int wait_result = waitForPcm(100ms);
+    if ((wait_result == -EPIPE) || (wait_result == -ESTRPIPE))
+    {
+        LOG(ERROR, LOG_TAG) << "XRUN while waiting for PCM: " << snd_strerror(wait_result) << "\n";
+        snd_pcm_recover(handle_, wait_result, 1);
+        return true;
+    }
+    else if (wait_result < 0)
+    {
+        LOG(ERROR, LOG_TAG) << "ERROR. Can't wait for PCM to become ready: " << snd_strerror(wait_result) << "\n";
+        uninitAlsa(true);
+        return true;
+    }
+
+    snd_pcm_sframes_t framesAvail;
+    chronos::usec delay;
+    if (!getStatus(framesAvail, delay))
+    {
+        this_thread::sleep_for(10ms);
+        snd_pcm_prepare(handle_);
+        return true;
+    }
+    // woken up by the timeout or before a period is free
+    if (framesAvail < static_cast<snd_pcm_sframes_t>(frames_))
+        return true;
+
+    const SampleFormat& format = stream_->getFormat();
+    auto frames = static_cast<snd_pcm_uframes_t>(framesAvail);
+    snd_pcm_uframes_t written = 0;
+    // the free space might wrap around the end of the ring buffer, i.e. consist of two contiguous areas
+    while (written < frames)
+    {
+        const snd_pcm_channel_area_t* areas;
+        snd_pcm_uframes_t offset;
+        snd_pcm_uframes_t contiguous = frames - written;
+        if (int err = snd_pcm_mmap_begin(handle_, &areas, &offset, &contiguous); err < 0)
         {
-            LOG(ERROR, LOG_TAG) << "XRUN while waiting for PCM: " << snd_strerror(wait_result) << "\n";
-            snd_pcm_prepare(handle_);
+            LOG(ERROR, LOG_TAG) << "Can't access the PCM ring buffer: " << snd_strerror(err) << "\n";
+            snd_pcm_recover(handle_, err, 1);
+            return true;
         }
-        else if (wait_result < 0)
+        char* data = static_cast<char*>(areas[0].addr) + (areas[0].first + offset * areas[0].step) / 8;
+        // the frames of the previous area are played out before this one
+        chronos::usec dac_time = delay + chronos::usec(static_cast<chronos::usec::rep>(1000 * static_cast<double>(written) / format.msRate()));
+
+        bool played;
+        if (unpack_format_ == SND_PCM_FORMAT_UNKNOWN)
         {
-            LOG(ERROR, LOG_TAG) << "ERROR. Can't wait for PCM to become ready: " << snd_strerror(wait_result) << "\n";
-            uninitAlsa(true);
-            continue;
+            played = stream_->getPlayerChunk(data, dac_time, contiguous);
+            if (played)
+                adjustVolume(data, contiguous);
         }
-        else if (wait_result == 0)
+        else
         {
-            continue;
+            // the device can't take packed 24 bit samples, render into buffer_ and unpack into the ring buffer
+            if (buffer_.size() < contiguous * format.frameSize())
+                buffer_.resize(contiguous * format.frameSize());
+            played = stream_->getPlayerChunk(buffer_.data(), dac_time, contiguous);
+            if (played)
+            {
+                adjustVolume(buffer_.data(), contiguous);
+                if (unpack_format_ == SND_PCM_FORMAT_S24_LE)
+                    utils::pcm::unpack24(buffer_.data(), data, contiguous * format.channels());
+                else
+                    utils::pcm::unpack24To32(buffer_.data(), data, contiguous * format.channels());
+            }
         }
 
-        if (!getAvailDelay(framesAvail, framesDelay))
+        if (!played)
         {
-            this_thread::sleep_for(10ms);
-            snd_pcm_prepare(handle_);
-            continue;
+            snd_pcm_mmap_commit(handle_, offset, 0);
+            return (written > 0);
         }
+        last_chunk_tick_ = chronos::getTickCount();
 
-        // if (framesAvail < static_cast<snd_pcm_sframes_t>(frames_))
-        // {
-        //     this_thread::sleep_for(5ms);
-        //     continue;
-        // }
-        if (framesAvail == 0)
+        snd_pcm_sframes_t committed = snd_pcm_mmap_commit(handle_, offset, contiguous);
+        if ((committed < 0) || (static_cast<snd_pcm_uframes_t>(committed) != contiguous))
         {
-            auto frame_time = std::chrono::microseconds(static_cast<int>(frames_ / format.usRate()));
-            std::chrono::microseconds wait = std::min(frame_time / 2, std::chrono::microseconds(10ms));
-            LOG(DEBUG, LOG_TAG) << "No frames available, waiting for " << wait.count() << " us\n";
-            this_thread::sleep_for(wait);
-            continue;
+            int err = (committed < 0) ? static_cast<int>(committed) : -EPIPE;
+            LOG(ERROR, LOG_TAG) << "XRUN while committing to PCM: " << snd_strerror(err) << "\n";
+            snd_pcm_recover(handle_, err, 1);
+            return true;
         }
+        written += contiguous;
+    }
 
-        // LOG(TRACE, LOG_TAG) << "res: " << result << ", framesAvail: " << framesAvail << ", delay: " << framesDelay << ", frames: " << frames_ << "\n";
-        chronos::usec delay(static_cast<chronos::usec::rep>(1000 * static_cast<double>(framesDelay) / format.msRate()));
-        // LOG(TRACE, LOG_TAG) << "delay: " << framesDelay << ", delay[ms]: " << delay.count() / 1000 << ", avail: " << framesAvail << "\n";
+    if (snd_pcm_state(handle_) == SND_PCM_STATE_PREPARED)
+    {
+        if (int err = snd_pcm_start(handle_); err < 0)
+            LOG(DEBUG, LOG_TAG) << "Failed to start PCM: " << snd_strerror(err) << "\n";
+    }
+    return true;
+}
 
-        if (buffer_.size() < static_cast<size_t>(framesAvail * format.frameSize()))
-        {
-            LOG(DEBUG, LOG_TAG) << "Resizing buffer from " << buffer_.size() << " to " << framesAvail * format.frameSize() << "\n";
-            buffer_.resize(framesAvail * format.frameSize());
-        }
-        if (stream_->getPlayerChunk(buffer_.data(), delay, framesAvail))
-        {
-            lastChunkTick = chronos::getTickCount();
-            adjustVolume(buffer_.data(), framesAvail);
-            if ((pcm = snd_pcm_writei(handle_, buffer_.data(), framesAvail)) == -EPIPE)
-            {
-                LOG(ERROR, LOG_TAG) << "XRUN while writing to PCM: " << snd_strerror(pcm) << "\n";
-                snd_pcm_prepare(handle_);
-            }
-            else if (pcm < 0)
-            {
-                LOG(ERROR, LOG_TAG) << "ERROR. Can't write to PCM device: " << snd_strerror(pcm) << "\n";
-                uninitAlsa(true);
-            }
-        }
+
+bool AlsaPlayer::playInterleaved()
+{
+    snd_pcm_sframes_t pcm;
+    snd_pcm_sframes_t framesDelay;
+    snd_pcm_sframes_t framesAvail;
+    const SampleFormat& format = stream_->getFormat();
+
+    int wait_result = snd_pcm_wait(handle_, 100);
+    if (wait_result == -EPIPE)
+    {
+        LOG(ERROR, LOG_TAG) << "XRUN while waiting for PCM: " << snd_strerror(wait_result) << "\n";
+        snd_pcm_prepare(handle_);
+    }
+    else if (wait_result < 0)
+    {
+        LOG(ERROR, LOG_TAG) << "ERROR. Can't wait for PCM to become ready: " << snd_strerror(wait_result) << "\n";
+        uninitAlsa(true);
+        return true;
+    }
+    else if (wait_result == 0)
+    {
+        return true;
+    }
+
+    if (!getAvailDelay(framesAvail, framesDelay))
+    {
+        this_thread::sleep_for(10ms);
+        snd_pcm_prepare(handle_);
+        return true;
+    }
+
+    // if (framesAvail < static_cast<snd_pcm_sframes_t>(frames_))
+    // {
+    //     this_thread::sleep_for(5ms);
+    //     continue;
+    // }
+    if (framesAvail == 0)
+    {
+        auto frame_time = std::chrono::microseconds(static_cast<int>(frames_ / format.usRate()));
+        std::chrono::microseconds wait = std::min(frame_time / 2, std::chrono::microseconds(10ms));
+        LOG(DEBUG, LOG_TAG) << "No frames available, waiting for " << wait.count() << " us\n";
+        this_thread::sleep_for(wait);
+        return true;
+    }
+
+    // LOG(TRACE, LOG_TAG) << "res: " << result << ", framesAvail: " << framesAvail << ", delay: " << framesDelay << ", frames: " << frames_ << "\n";
+    chronos::usec delay(static_cast<chronos::usec::rep>(1000 * static_cast<double>(framesDelay) / format.msRate()));
+    // LOG(TRACE, LOG_TAG) << "delay: " << framesDelay << ", delay[ms]: " << delay.count() / 1000 << ", avail: " << framesAvail << "\n";
+
+    if (buffer_.size() < static_cast<size_t>(framesAvail * format.frameSize()))
+    {
+        LOG(DEBUG, LOG_TAG) << "Resizing buffer from " << buffer_.size() << " to " << framesAvail * format.frameSize() << "\n";
+        buffer_.resize(framesAvail * format.frameSize());
+    }
+    if (!stream_->getPlayerChunk(buffer_.data(), delay, framesAvail))
+        return false;
+
+    last_chunk_tick_ = chronos::getTickCount();
+    adjustVolume(buffer_.data(), framesAvail);
+    char* data = buffer_.data();
+    if (unpack_format_ != SND_PCM_FORMAT_UNKNOWN)
+    {
+        size_t samples = framesAvail * format.channels();
+        if (unpack_buffer_.size() < samples * 4)
+            unpack_buffer_.resize(samples * 4);
+        if (unpack_format_ == SND_PCM_FORMAT_S24_LE)
+            utils::pcm::unpack24(buffer_.data(), unpack_buffer_.data(), samples);
         else
+            utils::pcm::unpack24To32(buffer_.data(), unpack_buffer_.data(), samples);
+        data = unpack_buffer_.data();
+    }
+    if ((pcm = snd_pcm_writei(handle_, data, framesAvail)) == -EPIPE)
+    {
+        LOG(ERROR, LOG_TAG) << "XRUN while writing to PCM: " << snd_strerror(pcm) << "\n";
+        snd_pcm_prepare(handle_);
+    }
+    else if (pcm < 0)
+    {
+        LOG(ERROR, LOG_TAG) << "ERROR. Can't write to PCM device: " << snd_strerror(pcm) << "\n";
+        uninitAlsa(true);
+    }
+    return true;
+}
+
+
+void AlsaPlayer::waitForChunks()
+{
+    LOG(INFO, LOG_TAG) << "Failed to get chunk\n";
+    while (active_ && !stream_->waitForChunk(100ms))
+    {
+        // Log "Waiting for chunk" only every second second
+        static utils::logging::TimeConditional cond(2s);
+        LOG(DEBUG, LOG_TAG) << cond << "Waiting for chunk\n";
+        if ((handle_ != nullptr) && (chronos::getTickCount() - last_chunk_tick_ > 5000))
         {
-            LOG(INFO, LOG_TAG) << "Failed to get chunk\n";
-            while (active_ && !stream_->waitForChunk(100ms))
-            {
-                // Log "Waiting for chunk" only every second second
-                static utils::logging::TimeConditional cond(2s);
-                LOG(DEBUG, LOG_TAG) << cond << "Waiting for chunk\n";
-                if ((handle_ != nullptr) && (chronos::getTickCount() - lastChunkTick > 5000))
-                {
-                    LOG(NOTICE, LOG_TAG) << "No chunk received for 5000ms. Closing ALSA.\n";
-                    uninitAlsa(false);
-                    stream_->clearChunks();
-                }
-            }
+            LOG(NOTICE, LOG_TAG) << "No chunk received for 5000ms. Closing ALSA.\n";
+            uninitAlsa(false);
+            stream_->clearChunks();
         }
     }
 }
@@ -40,6 +40,10 @@ static constexpr auto ALSA = "alsa";
 /// Audio Player
 /**
  * Audio player implementation using Alsa
+ *
+ * By default the audio is written with snd_pcm_writei. In mmap mode the player waits on the
+ * PCM's poll descriptors and the stream renders straight into the DMA ring buffer. The
+ * playback thread can optionally run with SCHED_FIFO priority and lock the process memory.
  */
 class AlsaPlayer : public Player
 {
@@ -66,6 +70,22 @@ private:
     /// @param uninit_mixer free the mixer
     void uninitAlsa(bool uninit_mixer);
     bool getAvailDelay(snd_pcm_sframes_t& avail, snd_pcm_sframes_t& delay);
+    /// get avail frames and the DAC delay from snd_pcm_status, corrected by the age of its timestamp
+    bool getStatus(snd_pcm_sframes_t& avail, chronos::usec& delay);
+
+    /// wait for the PCM to accept a period, using its poll descriptors
+    /// @return 1 if ready, 0 on timeout or a negative error code, -EPIPE on XRUN
+    int waitForPcm(std::chrono::milliseconds timeout);
+    /// render available frames straight into the mmap'ed DMA ring buffer
+    /// @return false if the stream returned no chunk
+    bool playMmap();
+    /// render available frames into buffer_ and write them with snd_pcm_writei
+    /// @return false if the stream returned no chunk
+    bool playInterleaved();
+    /// wait for new chunks after the stream returned none, close the device if there are none for 5s
+    void waitForChunks();
+    /// apply the configured realtime priority and memory locking to the calling thread
+    void setRealtime();
 
     void initMixer();
     void uninitMixer();
@@ -85,6 +105,9 @@ private:
 
     std::unique_ptr<pollfd, std::function<void(pollfd*)>> fd_;
     std::vector<char> buffer_;
+    /// if packed 24 bit samples are not supported by the device: the format to unpack to
+    snd_pcm_format_t unpack_format_{SND_PCM_FORMAT_UNKNOWN};
+    std::vector<char> unpack_buffer_;
     snd_pcm_uframes_t frames_;
     boost::asio::posix::stream_descriptor sd_;
     std::chrono::time_point<std::chrono::steady_clock> last_change_;
@@ -93,6 +116,18 @@ private:
 
     std::optional<std::chrono::microseconds> buffer_time_;
     std::optional<uint32_t> periods_;
+    /// use mmap access, if the device supports it
+    bool mmap_{false};
+    /// the device is opened with mmap access
+    bool mmap_active_{false};
+    /// PCM poll descriptors for the mmap mode
+    std::vector<pollfd> pcm_fds_;
+    /// SCHED_FIFO priority of the playback thread
+    std::optional<int> rt_priority_;
+    /// lock the process memory with mlockall
+    bool mlock_{false};
+    /// tick of the last chunk received from the stream
+    long last_chunk_tick_{0};
 };
 
 } // namespace player
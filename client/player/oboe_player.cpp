@@ -22,6 +22,7 @@
 // local headers
 #include "common/aixlog.hpp"
 #include "common/str_compat.hpp"
+#include "common/utils/pcm_utils.hpp"
 
 // 3rd party headers
 
@@ -175,7 +176,8 @@ oboe::DataCallbackResult OboePlayer::onAudioReady(oboe::AudioStream* /*oboeStrea
     chronos::usec delay(static_cast<int>(output_latency * 1000.));
 
     void* buffer = audioData;
-    if (stream_->getFormat().bits() == 24)
+    bool pack = (stream_->getFormat().bits() == 24) && !stream_->getFormat().isPacked24();
+    if (pack)
     {
         // Oboe expects 24 bit audio in 3 bytes, while Snapcast stores 24 bit in 4 bytes.
         // Data must be converted before passing it to Oboe, but first we need to adabt the buffer size
@@ -195,11 +197,10 @@ oboe::DataCallbackResult OboePlayer::onAudioReady(oboe::AudioStream* /*oboeStrea
     else
     {
         adjustVolume(static_cast<char*>(buffer), numFrames);
-        if (stream_->getFormat().bits() == 24)
+        if (pack)
         {
             // Copy the 24 bit, 4 bytes data into Oboes 24 bit, 3 bytes buffer
-            for (size_t n = 0; n < static_cast<size_t>(numFrames) * stream_->getFormat().channels(); ++n)
-                memcpy(static_cast<char*>(audioData) + 3 * n, audio_data_.data() + 4 * n, 3);
+            utils::pcm::pack24(audio_data_.data(), static_cast<char*>(audioData), static_cast<size_t>(numFrames) * stream_->getFormat().channels());
         }
     }
 
@@ -58,8 +58,10 @@ spa_audio_format sampleFormatToPipeWire(const SampleFormat& format)
         return SPA_AUDIO_FORMAT_S8;
     else if (format.bits() == 16)
         return SPA_AUDIO_FORMAT_S16_LE;
-    else if ((format.bits() == 24) && (format.sampleSize() == 4))
+    else if ((format.bits() == 24) && (format.sampleSize() == 3))
         return SPA_AUDIO_FORMAT_S24_LE;
+    else if ((format.bits() == 24) && (format.sampleSize() == 4))
+        return SPA_AUDIO_FORMAT_S24_32_LE;
     else if (format.bits() == 32)
         return SPA_AUDIO_FORMAT_S32_LE;
     else
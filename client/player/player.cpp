@@ -23,6 +23,7 @@
 #include "common/aixlog.hpp"
 #include "common/snap_exception.hpp"
 #include "common/str_compat.hpp"
+#include "common/utils/pcm_utils.hpp"
 #include "common/utils/string_utils.hpp"
 
 // 3rd party headers
@@ -159,26 +160,24 @@ bool Player::getHardwareVolume(Volume& volume)
 
 void Player::adjustVolume(char* buffer, size_t frames)
 {
-    std::lock_guard<std::mutex> lock(mutex_);
-    double volume = volCorrection_;
-    // apply volume changes only for software mixer
-    // for any other mixer, we might still have to apply the volCorrection_
-    if (settings_.mixer.mode == ClientSettings::Mixer::Mode::software)
+    double volume;
     {
-        volume = volume_.mute ? 0. : volume_.volume;
-        volume *= volCorrection_;
+        std::lock_guard<std::mutex> lock(mutex_);
+        volume = volCorrection_;
+        // apply volume changes only for software mixer
+        // for any other mixer, we might still have to apply the volCorrection_
+        if (settings_.mixer.mode == ClientSettings::Mixer::Mode::software)
+        {
+            volume = volume_.mute ? 0. : volume_.volume;
+            volume *= volCorrection_;
+        }
     }
 
-    if (volume != 1.0)
-    {
-        const SampleFormat& sampleFormat = stream_->getFormat();
-        if (sampleFormat.sampleSize() == 1)
-            adjustVolume<int8_t>(buffer, frames * sampleFormat.channels(), volume);
-        else if (sampleFormat.sampleSize() == 2)
-            adjustVolume<int16_t>(buffer, frames * sampleFormat.channels(), volume);
-        else if (sampleFormat.sampleSize() == 4)
-            adjustVolume<int32_t>(buffer, frames * sampleFormat.channels(), volume);
-    }
+    // ramp from the gain of the previous buffer, a step would click
+    double from = gain_.value_or(volume);
+    gain_ = volume;
+    const SampleFormat& sampleFormat = stream_->getFormat();
+    utils::pcm::applyGain(buffer, frames, sampleFormat.channels(), sampleFormat.sampleSize(), from, volume);
 }
 
 
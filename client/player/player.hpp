@@ -20,7 +20,6 @@
 
 // local headers
 #include "client_settings.hpp"
-#include "common/endian.hpp"
 #include "stream.hpp"
 
 // 3rd party headers
@@ -30,6 +29,7 @@
 #include <atomic>
 #include <functional>
 #include <mutex>
+#include <optional>
 #include <thread>
 
 
@@ -98,6 +98,7 @@ protected:
     void setVolume_exp(double volume, double base);
 
     /// adjust volume of buffer by the current volume setting
+    /// Volume changes are ramped over the buffer, so a change is applied click-free within one period
     void adjustVolume(char* buffer, size_t frames);
 
     /// Notify the server about hardware volume changes
@@ -128,13 +129,8 @@ protected:
     mutable std::mutex mutex_;
 
 private:
-    template <typename T>
-    void adjustVolume(char* buffer, size_t count, double volume)
-    {
-        auto* bufferT = reinterpret_cast<T*>(buffer);
-        for (size_t n = 0; n < count; ++n)
-            bufferT[n] = endian::swap<T>(static_cast<T>(endian::swap<T>(bufferT[n]) * volume));
-    }
+    /// gain applied to the end of the previous buffer, the next buffer is ramped from here. Player thread only.
+    std::optional<double> gain_;
 };
 
 inline bool operator==(const Player::Volume& lhs, const Player::Volume& rhs)
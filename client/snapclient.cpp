@@ -44,6 +44,7 @@
 #include "common/str_compat.hpp"
 #include "common/stream_uri.hpp"
 #include "common/version.hpp"
+#include "zone_router.hpp"
 
 // 3rd party headers
 #include <boost/asio/ip/host_name.hpp>
@@ -116,6 +117,27 @@ PcmDevice getPcmDevice(const std::string& player, const std::string& parameter,
     pcm_device.name = soundcard;
     return pcm_device;
 }
+
+
+/// Parse a zone, given as "<soundcard>[@<channel>[,<channel>]*]"
+ClientSettings::Zone getZone(const std::string& player, const std::string& parameter, const std::string& zone)
+{
+    ClientSettings::Zone result;
+    std::string soundcard = zone;
+    auto pos = zone.rfind('@');
+    if ((pos != std::string::npos) && (pos + 1 < zone.size()) && (zone.find_first_not_of("0123456789,", pos + 1) == std::string::npos))
+    {
+        soundcard = zone.substr(0, pos);
+        for (const auto& channel : utils::string::split(zone.substr(pos + 1), ','))
+        {
+            if (channel.empty())
+                throw SnapException("Invalid channel list in zone: " + zone);
+            result.channels.push_back(static_cast<uint16_t>(cpt::stoul(channel)));
+        }
+    }
+    result.pcm_device = getPcmDevice(player, parameter, soundcard);
+    return result;
+}
 } // namespace
 
 #ifdef WINDOWS
@@ -191,8 +213,12 @@ int main(int argc, char** argv)
         op.add<Value<string>>("s", "soundcard", "Index or name of the PCM device", pcm_device, &pcm_device);
 #endif
         op.add<Value<int>>("", "latency", "Latency of the PCM device", 0, &settings.player.latency);
+        auto zone_opt = op.add<Value<string>>("", "zone",
+                                              "Add a zone with instance id counting up from --instance, all zones share one process: "
+                                              "<soundcard>[@<channel>[,<channel>]*], can be given multiple times");
 #ifdef HAS_SOXR
         auto sample_format = op.add<Value<string>>("", "sampleformat", "Resample audio stream to <rate>:<bits>:<channels>", "");
+        auto resampler_opt = op.add<Value<string>>("", "resampler", "Resampler quality and number of threads <qq|lq|mq|hq|vhq>[:<threads>]", "hq");
 #endif
 
         auto supported_players = Controller::getSupportedPlayerNames();
@@ -201,6 +227,8 @@ int main(int argc, char** argv)
             supported_players_str += (!supported_players_str.empty() ? "|" : "") + supported_player;
         op.add<Value<string>>("", "player", supported_players_str + "[:<options>|?]", supported_players.front(), &settings.player.player_name);
 
+        auto drift_correction = op.add<Value<string>>("", "driftcorrection", "Drift correction [frames|low|medium|high]", "medium");
+
 // sharing mode
 #if defined(HAS_OBOE) || defined(HAS_WASAPI)
         auto sharing_mode = op.add<Value<string>>("", "sharingmode", "Audio mode to use [shared|exclusive]", "shared");
@@ -480,8 +508,20 @@ int main(int argc, char** argv)
             if ((bits != 0) && (bits != 16) && (bits != 24) && (bits != 32))
                 throw SnapException("sampleformat bits must be 16, 24, 32, * (= same as the source)");
         }
+        settings.player.resampler = Resampler::parseSettings(resampler_opt->value());
 #endif
 
+        if (drift_correction->value() == "frames")
+            settings.player.drift_correction = ClientSettings::DriftCorrection::frames;
+        else if (drift_correction->value() == "low")
+            settings.player.drift_correction = ClientSettings::DriftCorrection::low;
+        else if (drift_correction->value() == "medium")
+            settings.player.drift_correction = ClientSettings::DriftCorrection::medium;
+        else if (drift_correction->value() == "high")
+            settings.player.drift_correction = ClientSettings::DriftCorrection::high;
+        else
+            throw SnapException("drift correction must be one of frames, low, medium, high");
+
 #if defined(HAS_OBOE) || defined(HAS_WASAPI)
         settings.player.sharing_mode = (sharing_mode->value() == "exclusive") ? ClientSettings::SharingMode::exclusive : ClientSettings::SharingMode::shared;
 #endif
@@ -508,7 +548,10 @@ int main(int argc, char** argv)
             {
                 cout << "Options are a comma separated list of:\n"
                      << " \"buffer_time=<total buffer size [ms]>\" - default 80, min 10\n"
-                     << " \"fragments=<number of buffers>\" - default 4, min 2\n";
+                     << " \"fragments=<number of buffers>\" - default 4, min 2\n"
+                     << " \"mmap=<true|false>\" - render straight into the DMA buffer, default false\n"
+                     << " \"rt_priority=<1..99>\" - SCHED_FIFO priority of the playback thread, default not set\n"
+                     << " \"mlock=<true|false>\" - lock the memory with mlockall, default false\n";
             }
 #endif
 #ifdef HAS_PIPEWIRE
@@ -537,6 +580,9 @@ int main(int argc, char** argv)
         }
 #endif
 
+        for (size_t n = 0; n < zone_opt->count(); ++n)
+            settings.zones.push_back(getZone(settings.player.player_name, settings.player.parameter, zone_opt->value(n)));
+
         string mode = utils::string::split_left(mixer_mode->value(), ':', settings.player.mixer.parameter);
         if (mode == "software")
             settings.player.mixer.mode = ClientSettings::Mixer::Mode::software;
@@ -581,8 +627,28 @@ int main(int argc, char** argv)
 
         LOG(INFO, LOG_TAG) << "Version " << version::code << (!version::rev().empty() ? (", revision " + version::rev(8)) : ("")) << "\n";
 
-        auto controller = make_shared<Controller>(io_context, settings);
-        controller->start();
+        std::vector<std::shared_ptr<Controller>> controllers;
+        if (settings.zones.empty())
+        {
+            controllers.push_back(make_shared<Controller>(io_context, settings));
+        }
+        else
+        {
+            // Every zone is a client with its own connection. The zones share the TimeProvider, which is synced by the
+            // first connected zone, and the decoded chunks of the streams they play.
+            auto zone_router = make_shared<ZoneRouter>();
+            for (size_t n = 0; n < settings.zones.size(); ++n)
+            {
+                ClientSettings zone_settings = settings;
+                zone_settings.instance = settings.instance + n;
+                zone_settings.player.pcm_device = settings.zones[n].pcm_device;
+                zone_settings.player.channels = settings.zones[n].channels;
+                LOG(INFO, LOG_TAG) << "Zone " << zone_settings.instance << ", PCM device: " << zone_settings.player.pcm_device.name << "\n";
+                controllers.push_back(make_shared<Controller>(io_context, zone_settings, zone_router));
+            }
+        }
+        for (const auto& controller : controllers)
+            controller->start();
 
         int num_threads = 0;
         std::vector<std::thread> threads;
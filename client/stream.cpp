@@ -25,13 +25,14 @@
 
 // local headers
 #include "common/aixlog.hpp"
+#include "common/endian.hpp"
 #include "common/snap_exception.hpp"
-#include "common/str_compat.hpp"
 #include "time_provider.hpp"
 
 // 3rd party headers
 
 // standard headers
+#include <algorithm>
 #include <cmath>
 #include <cstring>
 #include <iostream>
@@ -41,25 +42,75 @@ using namespace std;
 namespace cs = chronos;
 
 static constexpr auto LOG_TAG = "Stream";
-static constexpr auto kCorrectionBegin = 100us;
+/// PI loop for the soft sync: proportional gain [ppm/us], i.e. 1ms error => 200ppm faster
+static constexpr double kRateKp = 0.2;
+/// integral gain [ppm/(us*s)]
+static constexpr double kRateKi = 0.01;
+/// max playback rate deviation [ppm]
+static constexpr double kRateMaxPpm = 500.;
+/// max number of chunks in the queue, e.g. 20s of 10ms chunks
+static constexpr size_t kMaxChunks = 2000;
+/// max number of queued diagnostic events
+static constexpr size_t kMaxDiagnostics = 64;
+/// duration of the preallocated buffer for reads with tempo adaption
+static constexpr auto kReadBufferDuration = 1s;
+/// duration of the fade out of the previous and the fade in of the new input stream on a stream switch
+static constexpr auto kSwitchFadeDuration = 10ms;
+
+namespace
+{
+/// Apply a linear gain ramp from @p from to @p to on @p frames frames with @p channels samples of type T
+template <typename T>
+void ramp(char* buffer, uint32_t frames, uint16_t channels, double from, double to)
+{
+    auto* bufferT = reinterpret_cast<T*>(buffer);
+    for (uint32_t n = 0; n < frames; ++n)
+    {
+        double gain = from + (to - from) * (n + 1) / (frames + 1);
+        for (uint16_t channel = 0; channel < channels; ++channel, ++bufferT)
+            *bufferT = endian::swap<T>(static_cast<T>(endian::swap<T>(*bufferT) * gain));
+    }
+}
+
+/// Apply a linear gain ramp on S24_3LE samples
+void rampPacked24(char* buffer, uint32_t frames, uint16_t channels, double from, double to)
+{
+    auto* bufferT = reinterpret_cast<uint8_t*>(buffer);
+    for (uint32_t n = 0; n < frames; ++n)
+    {
+        double gain = from + (to - from) * (n + 1) / (frames + 1);
+        for (uint16_t channel = 0; channel < channels; ++channel, bufferT += 3)
+        {
+            int32_t sample = static_cast<int32_t>(static_cast<uint32_t>(bufferT[0]) << 8 | static_cast<uint32_t>(bufferT[1]) << 16 |
+                                                  static_cast<uint32_t>(bufferT[2]) << 24) >>
+                             8;
+            sample = static_cast<int32_t>(sample * gain);
+            bufferT[0] = static_cast<uint8_t>(sample);
+            bufferT[1] = static_cast<uint8_t>(sample >> 8);
+            bufferT[2] = static_cast<uint8_t>(sample >> 16);
+        }
+    }
+}
+} // namespace
 
 // #define LOG_LATENCIES
 
-Stream::Stream(const SampleFormat& in_format, const SampleFormat& out_format)
-    : in_format_(in_format), median_(0), shortMedian_(0), lastUpdate_(0), playedFrames_(0), correctAfterXFrames_(0), bufferMs_(cs::msec(500)), frame_delta_(0),
-      hard_sync_(true), time_cond_(1s)
+Stream::Stream(const SampleFormat& in_format, const SampleFormat& out_format, const Resampler::Settings& resampler_settings)
+    : in_format_(in_format), chunks_(kMaxChunks), played_(kMaxChunks + 1), diagnostics_(kMaxDiagnostics), diagnostics_lost_(0),
+      recent_end_(cs::time_point_clk()), median_(0), shortMedian_(0), lastUpdate_(0), playedFrames_(0), correctAfterXFrames_(0), bufferMs_(cs::msec(500)),
+      rate_controller_(kRateKp, kRateKi, kRateMaxPpm), ratio_(1.), resampler_settings_(resampler_settings), frame_delta_(0), hard_syncs_(0),
+      frames_inserted_(0), frames_dropped_(0), underruns_(0), dac_time_(0), hard_sync_(true), switch_chunk_(nullptr), switch_pending_(false), switched_(false),
+      switch_resync_(false), fade_in_(false), time_cond_(1s)
 {
     buffer_.setSize(500);
     shortBuffer_.setSize(100);
     miniBuffer_.setSize(20);
+    sync_errors_.setSize(500);
     latencies_.setSize(100);
+    for (auto& sync_error : sync_error_)
+        sync_error.store(0);
 
-    format_ = in_format_;
-    if (out_format.isInitialized())
-    {
-        format_.setFormat(out_format.rate() != 0 ? out_format.rate() : format_.rate(), out_format.bits() != 0 ? out_format.bits() : format_.bits(),
-                          out_format.channels() != 0 ? out_format.channels() : format_.channels());
-    }
+    format_ = outputFormat(in_format_, out_format);
 
     /*
     48000     x
@@ -69,13 +120,57 @@ Stream::Stream(const SampleFormat& in_format, const SampleFormat& out_format)
     x = 1,000016667 / (1,000016667 - 1)
     */
     // setRealSampleRate(format_.rate());
-    resampler_ = std::make_unique<Resampler>(in_format_, format_);
+    resampler_ = std::make_unique<Resampler>(in_format_, format_, resampler_settings_);
+    read_buffer_.resize(format_.rate() * cs::duration<cs::sec>(kReadBufferDuration) * format_.frameSize());
+}
+
+
+SampleFormat Stream::outputFormat(const SampleFormat& in_format, const SampleFormat& out_format)
+{
+    SampleFormat format = in_format;
+    if (out_format.isInitialized())
+    {
+        format.setFormat(out_format.rate() != 0 ? out_format.rate() : format.rate(), out_format.bits() != 0 ? out_format.bits() : format.bits(),
+                         out_format.channels() != 0 ? out_format.channels() : format.channels());
+    }
+    return format;
+}
+
+
+bool Stream::switchInput(const SampleFormat& in_format, const SampleFormat& out_format)
+{
+    SampleFormat format = outputFormat(in_format, out_format);
+    if ((format.rate() != format_.rate()) || (format.bits() != format_.bits()) || (format.channels() != format_.channels()) ||
+        (format.sampleSize() != format_.sampleSize()) || (in_format.channels() != format_.channels()))
+    {
+        LOG(DEBUG, LOG_TAG) << "Can't switch from " << in_format_.toString() << " to " << in_format.toString() << ", output format: " << format_.toString()
+                            << "\n";
+        return false;
+    }
+
+    std::unique_ptr<Resampler> resampler;
+    try
+    {
+        resampler = std::make_unique<Resampler>(in_format, format_, resampler_settings_);
+    }
+    catch (const SnapException& e)
+    {
+        LOG(INFO, LOG_TAG) << "Can't switch to " << in_format.toString() << ": " << e.what() << "\n";
+        return false;
+    }
+
+    LOG(DEBUG, LOG_TAG) << "Switching input from " << in_format_.toString() << " to " << in_format.toString() << "\n";
+    in_format_ = in_format;
+    resampler_ = std::move(resampler);
+    switch_pending_ = true;
+    return true;
 }
 
 
 void Stream::setRealSampleRate(double sampleRate)
 {
-    if (sampleRate == format_.rate())
+    // the correction interval would overflow for tiny deviations
+    if (std::abs(format_.rate() / sampleRate - 1.) < 1e-8)
     {
         correctAfterXFrames_ = 0;
     }
@@ -93,50 +188,208 @@ void Stream::setBufferLen(size_t bufferLenMs)
 }
 
 
+Stream::Statistics Stream::getStatistics() const
+{
+    Statistics statistics;
+    statistics.hard_syncs = hard_syncs_.load(std::memory_order_relaxed);
+    statistics.frames_inserted = frames_inserted_.load(std::memory_order_relaxed);
+    statistics.frames_dropped = frames_dropped_.load(std::memory_order_relaxed);
+    statistics.underruns = underruns_.load(std::memory_order_relaxed);
+    for (size_t n = 0; n < sync_error_.size(); ++n)
+        statistics.sync_error[n] = cs::usec(sync_error_[n].load(std::memory_order_relaxed));
+    statistics.dac_time = cs::usec(dac_time_.load(std::memory_order_relaxed));
+    auto recent_end = recent_end_.load();
+    if (recent_end != cs::time_point_clk())
+    {
+        // the player plays the audio that is "bufferMs" old (server time)
+        auto buffer = std::chrono::duration_cast<cs::usec>(recent_end - (TimeProvider::serverNow() - bufferMs_.load()));
+        statistics.buffer = std::max(buffer, cs::usec(0));
+    }
+    return statistics;
+}
+
+
+void Stream::setDriftCorrection(std::optional<VariableResampler::Quality> quality)
+{
+    drift_resampler_ = nullptr;
+    if (!quality.has_value())
+        return;
+
+    if (!VariableResampler::supports(format_))
+    {
+        LOG(WARNING, LOG_TAG) << "Variable rate resampling not supported for " << format_.toString() << ", dropping or duplicating frames instead\n";
+        return;
+    }
+    drift_resampler_ = std::make_unique<VariableResampler>(format_, *quality, static_cast<uint32_t>(read_buffer_.size() / format_.frameSize()));
+}
+
+
 void Stream::clearChunks()
 {
-    std::lock_guard<std::mutex> lock(mutex_);
-    // Use the safer try_pop pattern to drain the queue
-    std::shared_ptr<msg::PcmChunk> chunk;
-    while (chunks_.try_pop(chunk))
+    releaseChunk();
+    while (nextChunk())
     {
         // Keep popping until the queue is empty
     }
+    switched_ = false;
     resetBuffers();
 }
 
 
 void Stream::addChunk(unique_ptr<msg::PcmChunk> chunk)
 {
+    // free the chunks that have been played out, keep one for the resampler, and log what happened on the realtime path
+    std::shared_ptr<msg::PcmChunk> played;
+    while (played_.try_pop(played))
+    {
+        if (!spare_chunk_ && (played.use_count() == 1))
+            spare_chunk_ = std::move(played);
+        played = nullptr;
+    }
+    flushDiagnostics();
+
     // drop chunk if it's too old. Just in case, this shouldn't happen.
     auto age = std::chrono::duration_cast<cs::msec>(TimeProvider::serverNow() - chunk->start());
     if (age > 5s + bufferMs_.load())
         return;
 
-    auto resampled = resampler_->resample(std::move(chunk));
+    std::shared_ptr<msg::PcmChunk> resampled;
+    if (!resampler_->resamplingNeeded())
+    {
+        resampled = std::move(chunk);
+    }
+    else
+    {
+        resampled = spare_chunk_ ? std::move(spare_chunk_) : std::make_shared<msg::PcmChunk>();
+        if (!resampler_->resample(*chunk, *resampled))
+            spare_chunk_ = std::move(resampled);
+    }
     if (resampled)
     {
+        auto end = resampled->end();
+        // mark the first chunk of a new input stream before the player can pop it
+        if (switch_pending_)
+            switch_chunk_.store(resampled.get(), std::memory_order_release);
+        if (!chunks_.try_push(std::move(resampled)))
+        {
+            // the player doesn't consume, the chunks in the queue will be dropped as too old when it continues
+            LOG(TRACE, LOG_TAG) << "Chunk queue full: " << chunks_.size() << " chunks, dropping chunk\n";
+            if (switch_pending_)
+                switch_chunk_.store(nullptr, std::memory_order_release);
+            return;
+        }
+        switch_pending_ = false;
+        recent_end_.store(end);
         std::lock_guard<std::mutex> lock(mutex_);
-        recent_ = resampled;
-        chunks_.push(resampled);
+        cond_.notify_all();
+    }
+    // LOG(TRACE, LOG_TAG) << "new chunk: " << chunk->durationMs() << " ms, age: " << age.count() << " ms, Chunks: " << chunks_.size() << "\n";
+}
+
+
+bool Stream::waitForChunk(const std::chrono::milliseconds& timeout) const
+{
+    flushDiagnostics();
+    std::unique_lock<std::mutex> lock(mutex_);
+    return cond_.wait_for(lock, timeout, [this]() { return !chunks_.empty(); });
+}
+
+
+void Stream::raise(Diagnostic::Type type, std::array<int64_t, 7> values) noexcept
+{
+    if (!diagnostics_.try_push(Diagnostic{type, values}))
+        diagnostics_lost_.fetch_add(1, std::memory_order_relaxed);
+}
+
 
-        std::shared_ptr<msg::PcmChunk> front_;
-        while (chunks_.front_copy(front_))
+void Stream::flushDiagnostics() const
+{
+    std::unique_lock<std::mutex> lock(diagnostics_mutex_, std::try_to_lock);
+    if (!lock.owns_lock())
+        return;
+
+    Diagnostic diagnostic;
+    while (diagnostics_.try_pop(diagnostic))
+    {
+        const auto& v = diagnostic.values;
+        switch (diagnostic.type)
         {
-            age = std::chrono::duration_cast<cs::msec>(TimeProvider::serverNow() - front_->start());
-            if ((age > 5s + bufferMs_.load()) && chunks_.try_pop(front_))
-                LOG(TRACE, LOG_TAG) << "Oldest chunk too old: " << age.count() << " ms, removing. Chunks in queue left: " << chunks_.size() << "\n";
-            else
+            case Diagnostic::Type::dac_time_too_large:
+                LOG(INFO, LOG_TAG) << "outputBufferDacTime > bufferMs: " << v[0] << " > " << v[1] << "\n";
+                break;
+            case Diagnostic::Type::no_chunks:
+                LOG(INFO, LOG_TAG) << "No chunks available\n";
+                break;
+            case Diagnostic::Type::underrun:
+                LOG(INFO, LOG_TAG) << "Not enough frames available, requested frames: " << v[0] << ", available: " << v[1] << "\n";
+                break;
+            case Diagnostic::Type::dropping_old:
+                LOG(DEBUG, LOG_TAG) << "age > 0: " << v[0] << "ms, dropping old chunks\n";
+                break;
+            case Diagnostic::Type::silent_frames:
+                LOG(DEBUG, LOG_TAG) << "Silent frames: " << v[0] << ", frames: " << v[1] << ", age: " << v[2] / 1000. << "\n";
+                break;
+            case Diagnostic::Type::hard_sync:
+                if (v[0] == 0)
+                    LOG(INFO, LOG_TAG) << "pBuffer->full() && (abs(median_) > 2): " << v[1] << "\n";
+                else if (v[0] == 1)
+                    LOG(INFO, LOG_TAG) << "pShortBuffer->full() && (abs(shortMedian_) > 5): " << v[1] << "\n";
+                else if (v[0] == 2)
+                    LOG(INFO, LOG_TAG) << "pMiniBuffer->full() && (abs(pMiniBuffer->mean()) > 50): " << v[1] << "\n";
+                else
+                    LOG(INFO, LOG_TAG) << "abs(age > 500): " << v[1] << "\n";
+                break;
+            case Diagnostic::Type::stats:
+                LOG(DEBUG, "Stats") << "Chunk: " << v[0] / 100 << "\t" << v[1] / 100 << "\t" << v[2] / 100 << "\t" << v[3] / 100 << "\t" << v[4] << "\t" << v[5]
+                                    << "\t" << v[6] << "\n";
+                break;
+            case Diagnostic::Type::latency:
+                LOG(DEBUG, "Latency") << "100%: " << v[0] << ", 99%: " << v[1] << ", 95%: " << v[2] << ", 50%: " << v[3] << ", 5%: " << v[4] << "\n";
+                break;
+            case Diagnostic::Type::silence:
+                LOG(DEBUG, LOG_TAG) << "Failed to get chunk, returning silence\n";
                 break;
         }
     }
-    // LOG(TRACE, LOG_TAG) << "new chunk: " << chunk->durationMs() << " ms, age: " << age.count() << " ms, Chunks: " << chunks_.size() << "\n";
+
+    auto lost = diagnostics_lost_.exchange(0, std::memory_order_relaxed);
+    if (lost > 0)
+        LOG(DEBUG, LOG_TAG) << "Diagnostics lost: " << lost << "\n";
 }
 
 
-bool Stream::waitForChunk(const std::chrono::milliseconds& timeout) const
+void Stream::releaseChunk()
+{
+    // moving the chunk back to the producer doesn't touch the reference count, so it's not freed here
+    if (chunk_ && !played_.try_push(std::move(chunk_)))
+        chunk_ = nullptr;
+}
+
+
+bool Stream::nextChunk()
 {
-    return chunks_.wait_for(timeout);
+    releaseChunk();
+    if (!chunks_.try_pop(chunk_))
+        return false;
+
+    const msg::PcmChunk* switch_chunk = switch_chunk_.load(std::memory_order_acquire);
+    if (switch_chunk == nullptr)
+        return true;
+
+    if (chunk_.get() == switch_chunk)
+    {
+        // don't clear a switch that has been marked in the meantime
+        switch_chunk_.compare_exchange_strong(switch_chunk, nullptr, std::memory_order_acq_rel);
+        switched_ = true;
+    }
+    else
+    {
+        // the current chunk is the last one of the previous input stream: fade out its end
+        auto* next = chunks_.front();
+        if ((next != nullptr) && (next->get() == switch_chunk))
+            fade(chunk_->payload, chunk_->getFrameCount(), false);
+    }
+    return true;
 }
 
 
@@ -146,24 +399,60 @@ void Stream::getSilentPlayerChunk(void* outputBuffer, uint32_t frames) const
 }
 
 
-cs::time_point_clk Stream::getNextPlayerChunk(void* outputBuffer, uint32_t frames)
+void Stream::fade(void* buffer, uint32_t frames, bool fade_in) const
 {
-    if (!chunk_ && !chunks_.try_pop(chunk_))
-        throw SnapException("No chunks available, requested frames: " + cpt::to_string(frames));
+    auto fade_frames = std::min(frames, static_cast<uint32_t>(format_.msRate() * cs::duration<cs::msec>(kSwitchFadeDuration)));
+    if (fade_frames == 0)
+        return;
+
+    char* begin = static_cast<char*>(buffer) + (fade_in ? 0 : (frames - fade_frames) * format_.frameSize());
+    double from = fade_in ? 0. : 1.;
+    if (format_.sampleSize() == 1)
+        ramp<int8_t>(begin, fade_frames, format_.channels(), from, 1. - from);
+    else if (format_.sampleSize() == 2)
+        ramp<int16_t>(begin, fade_frames, format_.channels(), from, 1. - from);
+    else if (format_.sampleSize() == 3)
+        rampPacked24(begin, fade_frames, format_.channels(), from, 1. - from);
+    else if (format_.sampleSize() == 4)
+        ramp<int32_t>(begin, fade_frames, format_.channels(), from, 1. - from);
+}
+
 
-    cs::time_point_clk tp = chunk_->start();
+bool Stream::getNextPlayerChunk(void* outputBuffer, uint32_t frames, cs::time_point_clk& start)
+{
+    if (!chunk_ && !nextChunk())
+    {
+        underruns_.fetch_add(1, std::memory_order_relaxed);
+        raise(Diagnostic::Type::underrun, {frames, 0});
+        return false;
+    }
+
+    start = chunk_->start();
     uint32_t read = 0;
     while (read < frames)
     {
+        if (switched_)
+        {
+            // the previous input stream ends here, it has been faded out already.
+            // Resync to the timestamps of the new one with the next request.
+            switched_ = false;
+            switch_resync_ = true;
+            getSilentPlayerChunk(static_cast<char*>(outputBuffer) + read * format_.frameSize(), frames - read);
+            return true;
+        }
         read += chunk_->readFrames(static_cast<char*>(outputBuffer) + read * format_.frameSize(), frames - read);
-        if ((read < frames) && chunk_->isEndOfChunk() && !chunks_.try_pop(chunk_))
-            throw SnapException("Not enough frames available, requested frames: " + cpt::to_string(frames) + ", available: " + cpt::to_string(read));
+        if ((read < frames) && chunk_->isEndOfChunk() && !nextChunk())
+        {
+            underruns_.fetch_add(1, std::memory_order_relaxed);
+            raise(Diagnostic::Type::underrun, {frames, read});
+            return false;
+        }
     }
-    return tp;
+    return true;
 }
 
 
-cs::time_point_clk Stream::getNextPlayerChunk(void* outputBuffer, uint32_t frames, int32_t framesCorrection)
+bool Stream::getNextPlayerChunk(void* outputBuffer, uint32_t frames, int32_t framesCorrection, cs::time_point_clk& start)
 {
     if (framesCorrection < 0 && (static_cast<int32_t>(frames) + framesCorrection <= 0))
     {
@@ -171,15 +460,18 @@ cs::time_point_clk Stream::getNextPlayerChunk(void* outputBuffer, uint32_t frame
         framesCorrection = -static_cast<int32_t>(frames) + 1;
     }
 
-    if (framesCorrection == 0)
-        return getNextPlayerChunk(outputBuffer, frames);
+    uint32_t toRead = frames + framesCorrection;
+    // read_buffer_ is preallocated, don't correct if the request doesn't fit
+    if ((framesCorrection == 0) || (toRead * format_.frameSize() > read_buffer_.size()))
+        return getNextPlayerChunk(outputBuffer, frames, start);
 
+    if (!getNextPlayerChunk(read_buffer_.data(), toRead, start))
+        return false;
     frame_delta_ -= framesCorrection;
-
-    uint32_t toRead = frames + framesCorrection;
-    if (toRead * format_.frameSize() > read_buffer_.size())
-        read_buffer_.resize(toRead * format_.frameSize());
-    cs::time_point_clk tp = getNextPlayerChunk(read_buffer_.data(), toRead);
+    if (framesCorrection > 0)
+        frames_dropped_.fetch_add(framesCorrection, std::memory_order_relaxed);
+    else
+        frames_inserted_.fetch_add(-framesCorrection, std::memory_order_relaxed);
 
     const auto max = framesCorrection < 0 ? frames : toRead;
     // Divide the buffer into one more slice than frames that need to be dropped.
@@ -239,7 +531,46 @@ cs::time_point_clk Stream::getNextPlayerChunk(void* outputBuffer, uint32_t frame
         pos += size;
     }
 
-    return tp;
+    return true;
+}
+
+
+bool Stream::getResampledPlayerChunk(void* outputBuffer, uint32_t frames, double ratio, cs::time_point_clk& start)
+{
+    // the first output frame lags behind the next input frame by the resampler's latency
+    double latency = drift_resampler_->latency();
+    // read_buffer_ is preallocated: process long requests in slices that fit into it, with room for the ratio and the lookahead
+    const uint32_t max_slice = static_cast<uint32_t>(read_buffer_.size() / format_.frameSize()) / 2;
+    uint32_t done = 0;
+    do
+    {
+        uint32_t slice = std::min(frames - done, max_slice);
+        uint32_t toRead = drift_resampler_->inputFrames(slice, ratio);
+        // toRead is 0 if the resampler holds enough frames, the read still yields the time of the next input frame
+        cs::time_point_clk slice_start;
+        if (!getNextPlayerChunk(read_buffer_.data(), toRead, slice_start))
+            return false;
+        if (done == 0)
+            start = slice_start;
+        frame_delta_ -= static_cast<int>(toRead) - static_cast<int>(slice);
+        if (toRead > slice)
+            frames_dropped_.fetch_add(toRead - slice, std::memory_order_relaxed);
+        else
+            frames_inserted_.fetch_add(slice - toRead, std::memory_order_relaxed);
+
+        drift_resampler_->process(read_buffer_.data(), toRead, static_cast<char*>(outputBuffer) + done * format_.frameSize(), slice, ratio);
+        done += slice;
+    } while (done < frames);
+    start -= cs::nsec(static_cast<cs::nsec::rep>(latency / format_.nsRate()));
+    return true;
+}
+
+
+void Stream::setHardSync()
+{
+    if (!hard_sync_)
+        hard_syncs_.fetch_add(1, std::memory_order_relaxed);
+    hard_sync_ = true;
 }
 
 
@@ -248,6 +579,7 @@ void Stream::updateBuffers(chronos::usec::rep age)
     buffer_.add(age);
     miniBuffer_.add(age);
     shortBuffer_.add(age);
+    sync_errors_.add(std::abs(age));
 }
 
 
@@ -263,29 +595,35 @@ bool Stream::getPlayerChunk(void* outputBuffer, const cs::usec& outputBufferDacT
 {
     if (outputBufferDacTime > bufferMs_.load())
     {
-        LOG(INFO, LOG_TAG) << "outputBufferDacTime > bufferMs: " << cs::duration<cs::msec>(outputBufferDacTime) << " > "
-                           << cs::duration<cs::msec>(bufferMs_.load()) << "\n";
+        raise(Diagnostic::Type::dac_time_too_large, {cs::duration<cs::msec>(outputBufferDacTime), cs::duration<cs::msec>(bufferMs_.load())});
         return false;
     }
 
-    std::lock_guard<std::mutex> lock(mutex_);
-    time_t now = time(nullptr);
-    if (!chunk_ && !chunks_.try_pop(chunk_))
+    // a new input stream starts: jump to its expected position, without counting it as sync error
+    if (switch_resync_)
+    {
+        switch_resync_ = false;
+        hard_sync_ = true;
+        fade_in_ = true;
+    }
+
+    auto now = std::chrono::duration_cast<cs::sec>(TimeProvider::now().time_since_epoch()).count();
+    if (!chunk_ && !nextChunk())
     {
         if (now != lastUpdate_)
         {
             lastUpdate_ = now;
-            LOG(INFO, LOG_TAG) << "No chunks available\n";
+            raise(Diagnostic::Type::no_chunks);
         }
         return false;
     }
 
 #ifdef LOG_LATENCIES
     // calculate the estimated end to end latency
-    if (recent_)
+    if (recent_end_.load() != cs::time_point_clk())
     {
         cs::nsec req_chunk_duration = cs::nsec(static_cast<cs::nsec::rep>(frames / format_.nsRate()));
-        auto youngest = recent_->end() - req_chunk_duration;
+        auto youngest = recent_end_.load() - req_chunk_duration;
         cs::msec age = std::chrono::duration_cast<cs::msec>(TimeProvider::serverNow() - youngest + outputBufferDacTime);
         latencies_.add(age.count());
     }
@@ -297,170 +635,163 @@ bool Stream::getPlayerChunk(void* outputBuffer, const cs::usec& outputBufferDacT
     /// age < 0 => play in -age => wait for a while, play silence in the meantime
     /// age > 0 => too old      => throw them away
 
-    try
+    if (hard_sync_)
     {
-        if (hard_sync_)
+        // the resampler's lookahead is discarded, hard sync reads directly from the chunks
+        if (drift_resampler_)
+            drift_resampler_->reset();
+        cs::nsec req_chunk_duration = cs::nsec(static_cast<cs::nsec::rep>(frames / format_.nsRate()));
+        cs::usec age = std::chrono::duration_cast<cs::usec>(TimeProvider::serverNow() - chunk_->start()) - bufferMs_.load() + outputBufferDacTime;
+        if (age < -req_chunk_duration)
         {
-            cs::nsec req_chunk_duration = cs::nsec(static_cast<cs::nsec::rep>(frames / format_.nsRate()));
-            cs::usec age = std::chrono::duration_cast<cs::usec>(TimeProvider::serverNow() - chunk_->start()) - bufferMs_.load() + outputBufferDacTime;
-            // LOG(INFO, LOG_TAG) << "age: " << age.count() / 1000 << ", buffer: " <<
-            // std::chrono::duration_cast<chrono::milliseconds>(req_chunk_duration).count() << "\n";
-            if (age < -req_chunk_duration)
-            {
-                // the oldest chunk (top of the stream) is too young for the buffer
-                // e.g. age = -100ms (=> should be played in 100ms)
-                // but the requested chunk duration is 50ms, so there is not data in this iteration available
-                getSilentPlayerChunk(outputBuffer, frames);
-                return true;
-            }
-            else
+            // the oldest chunk (top of the stream) is too young for the buffer
+            // e.g. age = -100ms (=> should be played in 100ms)
+            // but the requested chunk duration is 50ms, so there is not data in this iteration available
+            getSilentPlayerChunk(outputBuffer, frames);
+            return true;
+        }
+        else
+        {
+            if (age.count() > 0)
             {
-                if (age.count() > 0)
+                raise(Diagnostic::Type::dropping_old, {age.count() / 1000});
+                // age > 0: the top of the stream is too old. We must fast foward.
+                // delete the current chunk, it's too old. This will avoid an endless loop if there is no chunk in the queue.
+                while (nextChunk())
                 {
-                    LOG(DEBUG, LOG_TAG) << "age > 0: " << age.count() / 1000 << "ms, dropping old chunks\n";
-                    // age > 0: the top of the stream is too old. We must fast foward.
-                    // delete the current chunk, it's too old. This will avoid an endless loop if there is no chunk in the queue.
-                    chunk_ = nullptr;
-                    while (chunks_.try_pop(chunk_))
+                    age = std::chrono::duration_cast<cs::usec>(TimeProvider::serverNow() - chunk_->start()) - bufferMs_.load() + outputBufferDacTime;
+                    // check if the current chunk's end is older than age => can be player
+                    if ((age.count() > 0) && (age < chunk_->duration<cs::usec>()))
                     {
-                        age = std::chrono::duration_cast<cs::usec>(TimeProvider::serverNow() - chunk_->start()) - bufferMs_.load() + outputBufferDacTime;
-                        LOG(DEBUG, LOG_TAG) << "age: " << age.count() / 1000 << ", requested chunk_duration: "
-                                            << std::chrono::duration_cast<std::chrono::milliseconds>(req_chunk_duration).count()
-                                            << ", duration: " << chunk_->duration<std::chrono::milliseconds>().count() << "\n";
-                        // check if the current chunk's end is older than age => can be player
-                        if ((age.count() > 0) && (age < chunk_->duration<cs::usec>()))
-                        {
-                            // fast forward by "age" to get in sync, i.e. age = 0
-                            chunk_->seek(static_cast<uint32_t>(chunk_->format.nsRate() * std::chrono::duration_cast<cs::nsec>(age).count()));
-                            age = 0s;
-                        }
-                        if (age.count() <= 0)
-                            break;
+                        // fast forward by "age" to get in sync, i.e. age = 0
+                        chunk_->seek(static_cast<uint32_t>(chunk_->format.nsRate() * std::chrono::duration_cast<cs::nsec>(age).count()));
+                        age = 0s;
                     }
+                    if (age.count() <= 0)
+                        break;
                 }
+            }
 
-                if (age.count() <= 0)
+            if (age.count() <= 0)
+            {
+                // the oldest chunk (top of the stream) can be played in this iteration
+                // e.g. age = -20ms (=> should be played in 20ms)
+                // and the current chunk duration is 50ms, so we need to play 20ms silence (as we don't have data)
+                // and can play 30ms of the stream
+                uint32_t silent_frames = static_cast<uint32_t>(-chunk_->format.nsRate() * std::chrono::duration_cast<cs::nsec>(age).count());
+                bool result = (silent_frames <= frames);
+                silent_frames = std::min(silent_frames, frames);
+                if (silent_frames > 0)
                 {
-                    // the oldest chunk (top of the stream) can be played in this iteration
-                    // e.g. age = -20ms (=> should be played in 20ms)
-                    // and the current chunk duration is 50ms, so we need to play 20ms silence (as we don't have data)
-                    // and can play 30ms of the stream
-                    uint32_t silent_frames = static_cast<uint32_t>(-chunk_->format.nsRate() * std::chrono::duration_cast<cs::nsec>(age).count());
-                    bool result = (silent_frames <= frames);
-                    silent_frames = std::min(silent_frames, frames);
-                    if (silent_frames > 0)
-                    {
-                        LOG(DEBUG, LOG_TAG) << "Silent frames: " << silent_frames << ", frames: " << frames
-                                            << ", age: " << std::chrono::duration_cast<cs::usec>(age).count() / 1000. << "\n";
-                        getSilentPlayerChunk(outputBuffer, silent_frames);
-                    }
-                    getNextPlayerChunk(static_cast<char*>(outputBuffer) + (chunk_->format.frameSize() * silent_frames), frames - silent_frames);
+                    raise(Diagnostic::Type::silent_frames, {silent_frames, frames, age.count()});
+                    getSilentPlayerChunk(outputBuffer, silent_frames);
+                }
+                // the hard sync jumped into a new input stream
+                if (switched_)
+                {
+                    switched_ = false;
+                    fade_in_ = true;
+                }
+                cs::time_point_clk start;
+                char* buffer = static_cast<char*>(outputBuffer) + (chunk_->format.frameSize() * silent_frames);
+                if (!getNextPlayerChunk(buffer, frames - silent_frames, start))
+                    return false;
+                if (fade_in_)
+                {
+                    fade_in_ = false;
+                    fade(buffer, frames - silent_frames, true);
+                }
 
-                    if (result)
-                    {
-                        hard_sync_ = false;
-                        resetBuffers();
-                    }
-                    return true;
+                if (result)
+                {
+                    hard_sync_ = false;
+                    resetBuffers();
                 }
-                return false;
+                return true;
             }
+            return false;
         }
+    }
 
-        // sample rate correction
-        // framesCorrection = number of frames to be read more or less to get in-sync
-        int32_t framesCorrection = 0;
-        if (correctAfterXFrames_ != 0)
+    // sample rate correction
+    // framesCorrection = number of frames to be read more or less to get in-sync
+    int32_t framesCorrection = 0;
+    if (correctAfterXFrames_ != 0)
+    {
+        playedFrames_ += frames;
+        if (playedFrames_ >= static_cast<uint32_t>(abs(correctAfterXFrames_)))
         {
-            playedFrames_ += frames;
-            if (playedFrames_ >= static_cast<uint32_t>(abs(correctAfterXFrames_)))
-            {
-                framesCorrection = static_cast<int32_t>(playedFrames_) / correctAfterXFrames_;
-                playedFrames_ %= abs(correctAfterXFrames_);
-            }
+            framesCorrection = static_cast<int32_t>(playedFrames_) / correctAfterXFrames_;
+            playedFrames_ %= abs(correctAfterXFrames_);
         }
+    }
 
-        cs::usec age = std::chrono::duration_cast<cs::usec>(TimeProvider::serverNow() - getNextPlayerChunk(outputBuffer, frames, framesCorrection) -
-                                                            bufferMs_.load() + outputBufferDacTime);
+    cs::time_point_clk start;
+    bool read = drift_resampler_ ? getResampledPlayerChunk(outputBuffer, frames, ratio_, start)
+                                 : getNextPlayerChunk(outputBuffer, frames, framesCorrection, start);
+    if (!read)
+    {
+        setHardSync();
+        return false;
+    }
+    cs::usec age = std::chrono::duration_cast<cs::usec>(TimeProvider::serverNow() - start - bufferMs_.load() + outputBufferDacTime);
 
-        setRealSampleRate(format_.rate());
-        // check if we need a hard sync
-        if (buffer_.full() && (cs::usec(abs(median_)) > cs::msec(2)) && (cs::abs(age) > cs::usec(500)))
-        {
-            LOG(INFO, LOG_TAG) << "pBuffer->full() && (abs(median_) > 2): " << median_ << "\n";
-            hard_sync_ = true;
-        }
-        else if (shortBuffer_.full() && (cs::usec(abs(shortMedian_)) > cs::msec(5)) && (cs::abs(age) > cs::usec(500)))
-        {
-            LOG(INFO, LOG_TAG) << "pShortBuffer->full() && (abs(shortMedian_) > 5): " << shortMedian_ << "\n";
-            hard_sync_ = true;
-        }
-        else if (miniBuffer_.full() && (cs::usec(abs(miniBuffer_.median())) > cs::msec(50)) && (cs::abs(age) > cs::usec(500)))
-        {
-            LOG(INFO, LOG_TAG) << "pMiniBuffer->full() && (abs(pMiniBuffer->mean()) > 50): " << miniBuffer_.median() << "\n";
-            hard_sync_ = true;
-        }
-        else if (cs::abs(age) > 500ms)
-        {
-            LOG(INFO, LOG_TAG) << "abs(age > 500): " << cs::abs(age).count() << "\n";
-            hard_sync_ = true;
-        }
-        else if (shortBuffer_.full())
-        {
-            // No hard sync needed
-            // Check if we need a samplerate correction (change playback speed (soft sync))
-            auto miniMedian = miniBuffer_.median();
-            if ((cs::usec(shortMedian_) > kCorrectionBegin) && (cs::usec(miniMedian) > cs::usec(50)) && (cs::usec(age) > cs::usec(50)))
-            {
-                double rate = (shortMedian_ / 100.) * 0.00005;
-                rate = 1.0 - std::min(rate, 0.0005);
-                // LOG(INFO, LOG_TAG) << "Rate: " << rate << "\n";
-                // we are late (age > 0), this means we are not playing fast enough
-                // => the real sample rate seems to be lower, we have to drop some frames
-                setRealSampleRate(format_.rate() * rate); // 0.9999);
-            }
-            else if ((cs::usec(shortMedian_) < -kCorrectionBegin) && (cs::usec(miniMedian) < -cs::usec(50)) && (cs::usec(age) < -cs::usec(50)))
-            {
-                double rate = (-shortMedian_ / 100.) * 0.00005;
-                rate = 1.0 + std::min(rate, 0.0005);
-                // LOG(INFO, LOG_TAG) << "Rate: " << rate << "\n";
-                // we are early (age > 0), this means we are playing too fast
-                // => the real sample rate seems to be higher, we have to insert some frames
-                setRealSampleRate(format_.rate() * rate); // 1.0001);
-            }
-        }
+    // check if we need a hard sync
+    if (buffer_.full() && (cs::usec(abs(median_)) > cs::msec(2)) && (cs::abs(age) > cs::usec(500)))
+    {
+        raise(Diagnostic::Type::hard_sync, {0, median_});
+        setHardSync();
+    }
+    else if (shortBuffer_.full() && (cs::usec(abs(shortMedian_)) > cs::msec(5)) && (cs::abs(age) > cs::usec(500)))
+    {
+        raise(Diagnostic::Type::hard_sync, {1, shortMedian_});
+        setHardSync();
+    }
+    else if (miniBuffer_.full() && (cs::usec(abs(miniBuffer_.median())) > cs::msec(50)) && (cs::abs(age) > cs::usec(500)))
+    {
+        raise(Diagnostic::Type::hard_sync, {2, miniBuffer_.median()});
+        setHardSync();
+    }
+    else if (cs::abs(age) > 500ms)
+    {
+        raise(Diagnostic::Type::hard_sync, {3, cs::abs(age).count()});
+        setHardSync();
+    }
+    else
+    {
+        // No hard sync needed
+        // Soft sync: the PI loop turns the playback error into a continuous rate ratio, that is applied by the
+        // drift resampler, or by dropping (ratio < 1, we are late) or inserting (ratio > 1, we are early) single frames
+        double ratio = rate_controller_.ratio();
+        if (miniBuffer_.full())
+            ratio = rate_controller_.update(static_cast<double>(miniBuffer_.median()), static_cast<double>(frames) / format_.rate());
+        ratio_ = ratio;
+        setRealSampleRate(format_.rate() * ratio);
+    }
 
-        updateBuffers(age.count());
+    updateBuffers(age.count());
 
-        // update median_ and shortMedian_ and print sync stats
-        if (now != lastUpdate_)
-        {
-            // log buffer stats
-            lastUpdate_ = now;
-            median_ = buffer_.median();
-            shortMedian_ = shortBuffer_.median();
-            LOG(DEBUG, "Stats") << "Chunk: " << age.count() / 100 << "\t" << miniBuffer_.median() / 100 << "\t" << shortMedian_ / 100 << "\t" << median_ / 100
-                                << "\t" << buffer_.size() << "\t" << cs::duration<cs::msec>(outputBufferDacTime) << "\t" << frame_delta_ << "\n";
-            frame_delta_ = 0;
+    // update median_ and shortMedian_ and queue sync stats
+    if (now != lastUpdate_)
+    {
+        lastUpdate_ = now;
+        median_ = buffer_.median();
+        shortMedian_ = shortBuffer_.median();
+        raise(Diagnostic::Type::stats, {age.count(), miniBuffer_.median(), shortMedian_, median_, static_cast<int64_t>(buffer_.size()),
+                                        cs::duration<cs::msec>(outputBufferDacTime), frame_delta_});
+        frame_delta_ = 0;
+        auto sync_errors = sync_errors_.percentiles(std::array<uint8_t, 4>{50, 95, 99, 100});
+        for (size_t n = 0; n < sync_errors.size(); ++n)
+            sync_error_[n].store(sync_errors[n], std::memory_order_relaxed);
+        dac_time_.store(outputBufferDacTime.count(), std::memory_order_relaxed);
 
 #ifdef LOG_LATENCIES
-            // log latencies
-            std::array<uint8_t, 5> percents = {100, 99, 95, 50, 5};
-            auto percentiles = latencies_.percentiles(percents);
-            std::stringstream ss;
-            for (std::size_t n = 0; n < percents.size(); ++n)
-                ss << ((n > 0) ? ", " : "") << (int)percents[n] << "%: " << percentiles[n];
-            LOG(DEBUG, "Latency") << ss.str() << "\n";
+        // log latencies
+        auto percentiles = latencies_.percentiles(std::array<uint8_t, 5>{100, 99, 95, 50, 5});
+        raise(Diagnostic::Type::latency, {percentiles[0], percentiles[1], percentiles[2], percentiles[3], percentiles[4]});
 #endif
-        }
-        return (abs(cs::duration<cs::msec>(age)) < 500);
-    }
-    catch (const std::exception& e)
-    {
-        LOG(INFO, LOG_TAG) << "Exception: " << e.what() << "\n";
-        hard_sync_ = true;
-        return false;
     }
+    return (abs(cs::duration<cs::msec>(age)) < 500);
 }
 
 
@@ -469,7 +800,9 @@ bool Stream::getPlayerChunkOrSilence(void* outputBuffer, const chronos::usec& ou
     bool result = getPlayerChunk(outputBuffer, outputBufferDacTime, frames);
     if (!result)
     {
-        LOG(DEBUG, LOG_TAG) << time_cond_ << "Failed to get chunk, returning silence\n";
+        // Log "failed to get chunk" only once per second
+        if (time_cond_.is_true())
+            raise(Diagnostic::Type::silence);
         getSilentPlayerChunk(outputBuffer, frames);
     }
     return result;
@@ -19,12 +19,14 @@
 #pragma once
 
 // local headers
+#include "clock_recovery.hpp"
 #include "common/message/pcm_chunk.hpp"
-#include "common/queue.hpp"
 #include "common/resampler.hpp"
 #include "common/sample_format.hpp"
+#include "common/spsc_ring.hpp"
 #include "common/utils/logging.hpp"
-#include "double_buffer.hpp"
+#include "median_buffer.hpp"
+#include "variable_resampler.hpp"
 
 // 3rd party headers
 #ifdef HAS_SOXR
@@ -32,8 +34,12 @@
 #endif
 
 // standard headers
+#include <array>
 #include <atomic>
+#include <condition_variable>
 #include <memory>
+#include <mutex>
+#include <optional>
 
 
 
@@ -41,18 +47,30 @@
 /**
  * Queue with PCM data.
  * Returns "online" server-time-synchronized PCM data
+ *
+ * The chunks are passed from the producer (addChunk) to the player (getPlayerChunk) in a lock-free
+ * SPSC ring. The player side is realtime safe: it doesn't lock, allocate, free, throw or log.
+ * Played chunks are handed back to the producer to be freed there, diagnostics are queued and
+ * logged by the next non-realtime caller of addChunk or waitForChunk.
  */
 class Stream
 {
 public:
     /// c'tor
-    Stream(const SampleFormat& in_format, const SampleFormat& out_format);
+    Stream(const SampleFormat& in_format, const SampleFormat& out_format, const Resampler::Settings& resampler_settings = Resampler::Settings());
     /// d'tor
     virtual ~Stream() = default;
 
-    /// Adds PCM data to the queue
+    /// Adds PCM data to the queue, must be called from one (producer) thread at a time
     void addChunk(std::unique_ptr<msg::PcmChunk> chunk);
-    /// Remove all chunks from the queue
+    /// Switch to a new input stream with @p in_format, without changing the output format
+    /// The queued chunks of the current input stream are played out and faded out, the new stream is faded in
+    /// after a resync to its timestamps. Must be called from the producer thread, while no chunks are added.
+    /// @param in_format sample format of the new input stream
+    /// @param out_format requested output format, as passed to the c'tor
+    /// @return false if the output format would change or the conversion is not supported, the stream is unchanged then
+    bool switchInput(const SampleFormat& in_format, const SampleFormat& out_format);
+    /// Remove all chunks from the queue, must be called from the player thread
     void clearChunks();
 
     /// Get PCM data, which will be played out in "outputBufferDacTime" time
@@ -71,6 +89,32 @@ public:
     /// "Server buffer": playout latency, e.g. 1000ms
     void setBufferLen(size_t bufferLenMs);
 
+    /// Correct the drift by variable rate resampling with @p quality, or by dropping or duplicating single frames if not set
+    /// Must be called before the playback starts
+    void setDriftCorrection(std::optional<VariableResampler::Quality> quality);
+
+    /// Sync statistics, the counters are counted since the stream has been created
+    struct Statistics
+    {
+        /// number of hard syncs, i.e. jumps to the expected position in the stream
+        uint32_t hard_syncs{0};
+        /// frames inserted by the soft sync, to play slower
+        uint64_t frames_inserted{0};
+        /// frames dropped by the soft sync, to play faster
+        uint64_t frames_dropped{0};
+        /// number of requests that couldn't be served completely
+        uint32_t underruns{0};
+        /// percentiles 50, 95, 99 and 100 of the absolute sync error over the last played chunks, updated once per second
+        std::array<chronos::usec, 4> sync_error{};
+        /// queued audio, not yet played
+        chronos::usec buffer{0};
+        /// latency of the audio device, as passed to getPlayerChunk
+        chronos::usec dac_time{0};
+    };
+
+    /// @return the sync statistics, can be called from any thread
+    Statistics getStatistics() const;
+
     /// @return sampleformat
     const SampleFormat& getFormat() const
     {
@@ -81,11 +125,15 @@ public:
     bool waitForChunk(const std::chrono::milliseconds& timeout) const;
 
 private:
+    /// @return the output format for @p in_format and the requested @p out_format
+    static SampleFormat outputFormat(const SampleFormat& in_format, const SampleFormat& out_format);
+
     /// Request an audio chunk from the front of the stream.
     /// @param outputBuffer will be filled with the chunk
     /// @param frames the number of requested frames
-    /// @return the timepoint when this chunk should be audible
-    chronos::time_point_clk getNextPlayerChunk(void* outputBuffer, uint32_t frames);
+    /// @param[out] start the timepoint when this chunk should be audible
+    /// @return false if not enough frames are available
+    bool getNextPlayerChunk(void* outputBuffer, uint32_t frames, chronos::time_point_clk& start);
 
     /// Request an audio chunk from the front of the stream with a tempo adaption
     /// @param outputBuffer will be filled with the chunk
@@ -95,49 +143,138 @@ private:
     ///        so if frames is 100 and framesCorrection is 2, 102 frames will be read from the stream and 2 frames will be removed.
     ///        This makes us "fast-forward" by 2 frames, or if framesCorrection is -3, 97 frames will be read from the stream and
     ///        filled with 3 frames (simply by dublication), this makes us effectively slower
-    /// @return the timepoint when this chunk should be audible
-    chronos::time_point_clk getNextPlayerChunk(void* outputBuffer, uint32_t frames, int32_t framesCorrection);
+    /// @param[out] start the timepoint when this chunk should be audible
+    /// @return false if not enough frames are available
+    bool getNextPlayerChunk(void* outputBuffer, uint32_t frames, int32_t framesCorrection, chronos::time_point_clk& start);
+
+    /// Request an audio chunk from the front of the stream, resampled by the rate @p ratio
+    /// @param outputBuffer will be filled with the chunk
+    /// @param frames the number of requested frames
+    /// @param ratio playback rate ratio, < 1 plays faster
+    /// @param[out] start the timepoint when this chunk should be audible
+    /// @return false if not enough frames are available
+    bool getResampledPlayerChunk(void* outputBuffer, uint32_t frames, double ratio, chronos::time_point_clk& start);
+
+    /// Hand the current chunk back to the producer and pop the next one
+    /// @return false if there is no next chunk
+    bool nextChunk();
+    /// Hand the current chunk back to the producer, to be freed outside of the realtime thread
+    void releaseChunk();
 
     /// Request a silent audio chunk
     /// @param outputBuffer will be filled with the chunk
     /// @param frames the number of requested frames
     void getSilentPlayerChunk(void* outputBuffer, uint32_t frames) const;
 
+    /// Fade in the first or fade out the last (up to) kSwitchFadeDuration of @p frames frames in @p buffer
+    void fade(void* buffer, uint32_t frames, bool fade_in) const;
+
+    /// Resync on the next request by jumping to the expected position in the stream
+    void setHardSync();
+
     void updateBuffers(chronos::usec::rep age);
     void resetBuffers();
     void setRealSampleRate(double sampleRate);
 
+    /// Diagnostic event, raised on the realtime path and logged by flushDiagnostics
+    struct Diagnostic
+    {
+        /// event type
+        enum class Type : char
+        {
+            dac_time_too_large, ///< outputBufferDacTime > bufferMs: [dac ms, buffer ms]
+            no_chunks,          ///< no chunks available
+            underrun,           ///< not enough frames: [requested, available]
+            dropping_old,       ///< age > 0: [age ms]
+            silent_frames,      ///< silence inserted: [silent frames, frames, age us]
+            hard_sync,          ///< hard sync triggered: [reason, value]
+            stats,              ///< sync stats: [age, mini, short, median, size, dac ms, frame delta]
+            latency,            ///< latency percentiles [100%, 99%, 95%, 50%, 5%]
+            silence             ///< failed to get a chunk, playing silence
+        };
+
+        Type type;
+        std::array<int64_t, 7> values;
+    };
+
+    /// Queue a diagnostic event of @p type, called from the realtime path
+    void raise(Diagnostic::Type type, std::array<int64_t, 7> values = {}) noexcept;
+    /// Log the queued diagnostic events, called from non-realtime threads
+    void flushDiagnostics() const;
+
     SampleFormat format_;
     SampleFormat in_format_;
 
-    Queue<std::shared_ptr<msg::PcmChunk>> chunks_;
-    DoubleBuffer<chronos::usec::rep> miniBuffer_;
-    DoubleBuffer<chronos::usec::rep> shortBuffer_;
-    DoubleBuffer<chronos::usec::rep> buffer_;
+    /// decoded chunks, from the producer to the player
+    SpscRing<std::shared_ptr<msg::PcmChunk>> chunks_;
+    /// played chunks, from the player back to the producer
+    SpscRing<std::shared_ptr<msg::PcmChunk>> played_;
+    /// diagnostics, from the player to the next non-realtime thread
+    mutable SpscRing<Diagnostic> diagnostics_;
+    /// serializes flushDiagnostics
+    mutable std::mutex diagnostics_mutex_;
+    /// number of diagnostics that were lost because the ring was full
+    mutable std::atomic<uint32_t> diagnostics_lost_;
+    MedianBuffer<chronos::usec::rep> miniBuffer_;
+    MedianBuffer<chronos::usec::rep> shortBuffer_;
+    MedianBuffer<chronos::usec::rep> buffer_;
+    /// absolute sync errors, for the percentiles of the statistics
+    MedianBuffer<chronos::usec::rep> sync_errors_;
     /// current chunk (oldest, to be played)
     std::shared_ptr<msg::PcmChunk> chunk_;
-    /// most recent chunk (newly queued)
-    std::shared_ptr<msg::PcmChunk> recent_;
-    DoubleBuffer<chronos::msec::rep> latencies_;
+    /// end of the most recent chunk (newly queued)
+    std::atomic<chronos::time_point_clk> recent_end_;
+    MedianBuffer<chronos::msec::rep> latencies_;
 
     chronos::usec::rep median_;
     chronos::usec::rep shortMedian_;
-    time_t lastUpdate_;
+    /// local time of the last stats update [s]
+    chronos::sec::rep lastUpdate_;
     uint32_t playedFrames_;
     int32_t correctAfterXFrames_;
     std::atomic<chronos::msec> bufferMs_;
+    /// soft sync, turns the playback error into a rate ratio
+    RateController rate_controller_;
+    /// current playback rate ratio of the soft sync
+    double ratio_;
+    /// variable rate resampler for the drift correction, frames are dropped or duplicated if not set
+    std::unique_ptr<VariableResampler> drift_resampler_;
 
     std::unique_ptr<Resampler> resampler_;
+    Resampler::Settings resampler_settings_;
+    /// a played chunk, recycled as output of the resampler
+    std::shared_ptr<msg::PcmChunk> spare_chunk_;
 
-    std::vector<char> resample_buffer_;
+    /// preallocated buffer for reads with tempo adaption
     std::vector<char> read_buffer_;
     int frame_delta_;
+    std::atomic<uint32_t> hard_syncs_;
+    std::atomic<uint64_t> frames_inserted_;
+    std::atomic<uint64_t> frames_dropped_;
+    std::atomic<uint32_t> underruns_;
+    /// sync error percentiles [us], published by the player once per second
+    std::array<std::atomic<chronos::usec::rep>, 4> sync_error_;
+    /// last outputBufferDacTime [us]
+    std::atomic<chronos::usec::rep> dac_time_;
     // int64_t next_us_;
 
+    /// used by waitForChunk to wait for new chunks
     mutable std::mutex mutex_;
+    mutable std::condition_variable cond_;
 
     bool hard_sync_;
 
+    /// first chunk of a new input stream, set by the producer and cleared by the player when it's reached
+    std::atomic<const msg::PcmChunk*> switch_chunk_;
+    /// the next added chunk is the first one of a new input stream (producer)
+    bool switch_pending_;
+    /// the current chunk is the first one of a new input stream (player)
+    bool switched_;
+    /// resync to the timestamps of the new input stream with the next request (player)
+    bool switch_resync_;
+    /// fade in the frames read by the next hard sync (player)
+    bool fade_in_;
+
     /// Log "failed to get chunk" only once per second
     utils::logging::TimeConditional time_cond_;
 };
@@ -27,47 +27,63 @@
 
 static constexpr auto LOG_TAG = "TimeProvider";
 
-TimeProvider::TimeProvider() : diffToServer_(0)
+TimeProvider::TimeProvider() : diffSequence_(0), diffToServer_(0), diffTime_(0), skew_(0), converged_(false), rtt_(0)
 {
-    diffBuffer_.setSize(200);
 }
 
 
 void TimeProvider::setDiff(const tv& c2s, const tv& s2c)
-{
-    //	tv latency = c2s - s2c;
-    //	double diff = (latency.sec * 1000. + latency.usec / 1000.) / 2.;
-    double diff = (static_cast<double>(c2s.sec) / 2. - static_cast<double>(s2c.sec) / 2.) * 1000. +
-                  (static_cast<double>(c2s.usec) / 2. - static_cast<double>(s2c.usec) / 2.) / 1000.;
-    setDiffToServer(diff);
-}
-
-
-void TimeProvider::setDiffToServer(double ms)
 {
     using namespace std::chrono_literals;
-    auto now = std::chrono::system_clock::now();
-    static auto lastTimeSync = now;
-    auto diff = chronos::abs(now - lastTimeSync);
+    // offset = ((server received - client sent) - (client received - server sent)) / 2
+    double offset = (static_cast<double>(c2s.sec) / 2. - static_cast<double>(s2c.sec) / 2.) * 1000000. +
+                    (static_cast<double>(c2s.usec) / 2. - static_cast<double>(s2c.usec) / 2.);
+    double rtt = (static_cast<double>(c2s.sec) + static_cast<double>(s2c.sec)) * 1000000. + static_cast<double>(c2s.usec) + static_cast<double>(s2c.usec);
+    auto now = TimeProvider::now();
+    // the offset is measured in the middle of the round trip
+    auto measured = now - chronos::usec(static_cast<chronos::usec::rep>(rtt / 2.));
+    rtt_ = static_cast<chronos::usec::rep>(rtt);
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    /// restart the estimation if last update is older than a minute
+    if ((lastTimeSync_ != chronos::time_point_clk()) && (chronos::abs(now - lastTimeSync_) > 60s))
+    {
+        LOG(INFO, LOG_TAG) << "Last time sync older than a minute. Restarting the estimation\n";
+        estimator_.reset();
+    }
+    lastTimeSync_ = now;
 
-    /// clear diffBuffer if last update is older than a minute
-    if (!diffBuffer_.empty() && (diff > 60s))
+    if (!estimator_.update(measured, chronos::usec(static_cast<chronos::usec::rep>(offset)), chronos::usec(static_cast<chronos::usec::rep>(rtt))))
     {
-        LOG(INFO, LOG_TAG) << "Last time sync older than a minute. Clearing time buffer\n";
-        diffToServer_ = static_cast<chronos::usec::rep>(ms * 1000);
-        diffBuffer_.clear();
+        LOG(DEBUG, LOG_TAG) << "Rejecting time sync with RTT: " << rtt / 1000. << " ms\n";
+        return;
     }
-    lastTimeSync = now;
 
-    diffBuffer_.add(static_cast<chronos::usec::rep>(ms * 1000));
-    diffToServer_ = diffBuffer_.median();
-    // LOG(INFO, LOG_TAG) << "setDiffToServer: " << ms << ", diff: " << diffToServer_ / 1000000 << " s, " << (diffToServer_ / 1000) % 1000 << "." <<
-    // diffToServer_ % 1000 << " ms\n";
+    storeDiff({now.time_since_epoch().count(), estimator_.offset(now).count(), estimator_.skew()});
+    converged_ = estimator_.converged();
+    // LOG(INFO, LOG_TAG) << "setDiff: " << offset << ", diff: " << diffToServer_ << " us, skew: " << skew_ << " ppm, deviation: " <<
+    // estimator_.deviation().count() << " us\n";
+}
+
+
+void TimeProvider::storeDiff(const Diff& diff)
+{
+    uint32_t sequence = diffSequence_.load(std::memory_order_relaxed);
+    diffSequence_.store(sequence + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    diffTime_.store(diff.time, std::memory_order_relaxed);
+    diffToServer_.store(diff.offset, std::memory_order_relaxed);
+    skew_.store(diff.skew, std::memory_order_relaxed);
+    diffSequence_.store(sequence + 2, std::memory_order_release);
 }
 
-/*
-long TimeProvider::getPercentileDiffToServer(size_t percentile)
+
+void TimeProvider::reset()
 {
-        return diffBuffer.percentile(percentile);
+    std::lock_guard<std::mutex> lock(mutex_);
+    estimator_.reset();
+    lastTimeSync_ = chronos::time_point_clk();
+    storeDiff({0, 0, 0.});
+    converged_ = false;
+    rtt_ = 0;
 }
-*/
@@ -21,14 +21,16 @@
 
 // local headers
 #include "common/message/message.hpp"
+#include "clock_recovery.hpp"
 #include "common/time_defs.hpp"
-#include "double_buffer.hpp"
 
 // 3rd party headers
 
 // standard headers
 #include <atomic>
 #include <chrono>
+#include <cstdint>
+#include <mutex>
 
 
 /// Provides local and server time
@@ -36,6 +38,8 @@
  * Stores time difference to the server
  * Returns server's local system time.
  * Clients are using the server time to play audio in sync, independent of the client's system time
+ * The difference is estimated by a ClockEstimator, which also tracks the skew of the server clock,
+ * so that the difference is continuously extrapolated between the time syncs.
  */
 class TimeProvider
 {
@@ -47,8 +51,6 @@ public:
         return instance;
     }
 
-    /// Set diff to server
-    void setDiffToServer(double ms);
     /// Set diff from round-trip-times client-to-server and server-to-client
     void setDiff(const tv& c2s, const tv& s2c);
 
@@ -56,7 +58,33 @@ public:
     template <typename T>
     inline T getDiffToServer() const
     {
-        return std::chrono::duration_cast<T>(chronos::usec(diffToServer_));
+        return std::chrono::duration_cast<T>(getDiffToServer(now()));
+    }
+
+    /// @return time diff to server at local time @p local_time
+    inline chronos::usec getDiffToServer(const chronos::time_point_clk& local_time) const
+    {
+        Diff diff = loadDiff();
+        double dt = std::chrono::duration<double>(local_time - chronos::time_point_clk(chronos::clk::duration(diff.time))).count();
+        return chronos::usec(diff.offset + static_cast<chronos::usec::rep>(diff.skew * dt));
+    }
+
+    /// @return the estimated skew of the server clock in ppm
+    double getSkew() const
+    {
+        return loadDiff().skew;
+    }
+
+    /// @return true if the estimation of the time diff has settled
+    bool converged() const
+    {
+        return converged_.load();
+    }
+
+    /// @return the round trip time of the last time sync
+    chronos::usec getRtt() const
+    {
+        return chronos::usec(rtt_.load());
     }
 
     /*	chronos::usec::rep getDiffToServer();
@@ -77,23 +105,78 @@ public:
         return chronos::time_point_clk(chronos::usec(timeval.usec) + chronos::sec(timeval.sec));
     }
 
+    /// Local clock function
+    using Clock = chronos::time_point_clk (*)();
+
+    /// Replace the local clock by @p clock, e.g. by a simulated clock. nullptr restores chronos::clk::now
+    static void setClock(Clock clock)
+    {
+        clock_.store((clock != nullptr) ? clock : &chronos::clk::now);
+    }
+
     /// @return local time
     inline static chronos::time_point_clk now()
     {
-        return chronos::clk::now();
+        return clock_.load(std::memory_order_relaxed)();
     }
 
     /// @return server time
     inline static chronos::time_point_clk serverNow()
     {
-        return chronos::clk::now() + TimeProvider::getInstance().getDiffToServer<chronos::usec>();
+        auto local = now();
+        return local + TimeProvider::getInstance().getDiffToServer(local);
     }
 
+    /// Forget all time syncs and restart the estimation
+    void reset();
+
 private:
+    /// Diff to the server, extrapolated with the skew
+    struct Diff
+    {
+        /// local time of the estimation
+        chronos::clk::duration::rep time;
+        /// diff to server at local time "time" [us]
+        chronos::usec::rep offset;
+        /// drift of the diff in us per second
+        double skew;
+    };
+
+    /// @return consistent snapshot of the diff, lock free for the realtime thread
+    inline Diff loadDiff() const
+    {
+        // seqlock: the writer makes the sequence odd while updating the values
+        while (true)
+        {
+            uint32_t sequence = diffSequence_.load(std::memory_order_acquire);
+            Diff diff{diffTime_.load(std::memory_order_relaxed), diffToServer_.load(std::memory_order_relaxed), skew_.load(std::memory_order_relaxed)};
+            std::atomic_thread_fence(std::memory_order_acquire);
+            if (((sequence & 1) == 0) && (sequence == diffSequence_.load(std::memory_order_relaxed)))
+                return diff;
+        }
+    }
+
+    /// Publish @p diff, must be called with mutex_ locked
+    void storeDiff(const Diff& diff);
+
     TimeProvider();
     TimeProvider(TimeProvider const&);   // Don't Implement
     void operator=(TimeProvider const&); // Don't implement
 
-    DoubleBuffer<chronos::usec::rep> diffBuffer_;
+    /// local clock, chronos::clk::now or an injected (simulated) clock
+    inline static std::atomic<Clock> clock_{&chronos::clk::now};
+
+    std::mutex mutex_;
+    ClockEstimator estimator_;
+    chronos::time_point_clk lastTimeSync_;
+    /// odd while the diff is written, see loadDiff
+    std::atomic<uint32_t> diffSequence_;
+    /// diff to server at local time diffTime_
     std::atomic<chronos::usec::rep> diffToServer_;
+    std::atomic<chronos::clk::duration::rep> diffTime_;
+    /// drift of the diff in us per second
+    std::atomic<double> skew_;
+    std::atomic<bool> converged_;
+    /// round trip time of the last time sync [us]
+    std::atomic<chronos::usec::rep> rtt_;
 };
@@ -0,0 +1,216 @@
+/***
+    This file is part of snapcast
+    Copyright (C) 2014-2025  Johannes Pohl
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+***/
+
+// prototype/interface header file
+#include "variable_resampler.hpp"
+
+// local headers
+#include "common/snap_exception.hpp"
+
+// standard headers
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+
+namespace
+{
+constexpr double kPi = 3.14159265358979323846;
+
+/// @return sample @p index from @p input with @p sample_size bytes per sample
+inline float load(const char* input, size_t index, uint16_t sample_size)
+{
+    switch (sample_size)
+    {
+        case 1:
+            return static_cast<float>(reinterpret_cast<const int8_t*>(input)[index]);
+        case 2:
+            return static_cast<float>(reinterpret_cast<const int16_t*>(input)[index]);
+        case 3:
+        {
+            const auto* sample = reinterpret_cast<const uint8_t*>(input) + 3 * index;
+            return static_cast<float>(static_cast<int32_t>(static_cast<uint32_t>(sample[0]) << 8 | static_cast<uint32_t>(sample[1]) << 16 |
+                                                           static_cast<uint32_t>(sample[2]) << 24) >>
+                                      8);
+        }
+        default:
+            return static_cast<float>(reinterpret_cast<const int32_t*>(input)[index]);
+    }
+}
+} // namespace
+
+
+VariableResampler::VariableResampler(const SampleFormat& format, Quality quality, uint32_t max_frames) : format_(format), phases_(0), available_(0), phase_(0)
+{
+    if (!supports(format_))
+        throw SnapException("Sample format not supported for variable rate resampling: " + format_.toString());
+
+    taps_ = (quality == Quality::low) ? 2 : ((quality == Quality::medium) ? 8 : 32);
+    half_ = taps_ / 2;
+    if (quality != Quality::low)
+    {
+        // Blackman windowed sinc, one row per phase, plus one to interpolate the last phase
+        phases_ = 256;
+        table_.resize((phases_ + 1) * taps_);
+        for (uint32_t phase = 0; phase <= phases_; ++phase)
+        {
+            double frac = static_cast<double>(phase) / phases_;
+            float* row = &table_[phase * taps_];
+            double sum = 0;
+            for (uint32_t tap = 0; tap < taps_; ++tap)
+            {
+                double x = static_cast<double>(tap) - half_ + 1 - frac;
+                double sinc = (x == 0) ? 1. : std::sin(kPi * x) / (kPi * x);
+                double window = 0.42 + 0.5 * std::cos(kPi * x / half_) + 0.08 * std::cos(2. * kPi * x / half_);
+                row[tap] = static_cast<float>(sinc * window);
+                sum += row[tap];
+            }
+            // unity gain for DC
+            for (uint32_t tap = 0; tap < taps_; ++tap)
+                row[tap] = static_cast<float>(row[tap] / sum);
+        }
+    }
+    coefficients_.resize(taps_);
+    // input frames for max_frames output frames at the max ratio, plus history and lookahead
+    buffer_.resize((max_frames + max_frames / 500 + 2 * taps_ + 4) * format_.channels());
+
+    max_ = static_cast<float>((1u << (format_.bits() - 1)) - 1);
+    if (format_.bits() == 32)
+        max_ = 2147483520.f; // largest float below 2^31
+    min_ = -max_ - 1;
+    reset();
+}
+
+
+bool VariableResampler::supports(const SampleFormat& format)
+{
+    return format.isInitialized() && (format.channels() > 0) && (format.sampleSize() >= 1) && (format.sampleSize() <= 4) && (format.bits() <= 32);
+}
+
+
+void VariableResampler::reset()
+{
+    // start with silence as history, the first input frame becomes the current frame
+    available_ = half_ - 1;
+    std::fill_n(buffer_.begin(), available_ * format_.channels(), 0.f);
+    phase_ = 0;
+}
+
+
+double VariableResampler::latency() const
+{
+    return static_cast<double>(available_) - (half_ - 1) - phase_;
+}
+
+
+uint32_t VariableResampler::inputFrames(uint32_t frames, double ratio) const
+{
+    if (frames == 0)
+        return 0;
+    double last = phase_ + (frames - 1) / ratio;
+    // frames up to the last interpolation point plus the lookahead
+    auto needed = static_cast<int64_t>(half_ - 1) + static_cast<int64_t>(std::floor(last)) + half_ + 1;
+    return static_cast<uint32_t>(std::max<int64_t>(needed - available_, 0));
+}
+
+
+void VariableResampler::append(const void* input, uint32_t frames)
+{
+    const auto* in = static_cast<const char*>(input);
+    float* out = &buffer_[available_ * format_.channels()];
+    size_t samples = static_cast<size_t>(frames) * format_.channels();
+    for (size_t n = 0; n < samples; ++n)
+        out[n] = load(in, n, format_.sampleSize());
+    available_ += frames;
+}
+
+
+void VariableResampler::store(char* output, float value) const
+{
+    value = std::clamp(std::nearbyint(value), min_, max_);
+    switch (format_.sampleSize())
+    {
+        case 1:
+            *reinterpret_cast<int8_t*>(output) = static_cast<int8_t>(value);
+            break;
+        case 2:
+            *reinterpret_cast<int16_t*>(output) = static_cast<int16_t>(value);
+            break;
+        case 3:
+        {
+            auto sample = static_cast<uint32_t>(static_cast<int32_t>(value));
+            output[0] = static_cast<char>(sample & 0xff);
+            output[1] = static_cast<char>((sample >> 8) & 0xff);
+            output[2] = static_cast<char>((sample >> 16) & 0xff);
+            break;
+        }
+        default:
+            *reinterpret_cast<int32_t*>(output) = static_cast<int32_t>(value);
+    }
+}
+
+
+void VariableResampler::process(const void* input, uint32_t in_frames, void* output, uint32_t frames, double ratio)
+{
+    append(input, in_frames);
+
+    const uint16_t channels = format_.channels();
+    const uint16_t sample_size = format_.sampleSize();
+    const double step = 1. / ratio;
+    auto* out = static_cast<char*>(output);
+    for (uint32_t n = 0; n < frames; ++n)
+    {
+        double position = phase_ + n * step;
+        auto index = static_cast<uint32_t>(position);
+        auto frac = static_cast<float>(position - index);
+        // first frame of the kernel
+        const float* in = &buffer_[index * channels];
+
+        if (taps_ == 2)
+        {
+            // linear interpolation between the current and the next frame
+            for (uint16_t channel = 0; channel < channels; ++channel)
+                store(out + (n * channels + channel) * sample_size, in[channel] + frac * (in[channels + channel] - in[channel]));
+            continue;
+        }
+
+        // interpolate the coefficients between the two nearest phases
+        float phase = frac * phases_;
+        auto row = static_cast<uint32_t>(phase);
+        float weight = phase - row;
+        const float* lower = &table_[row * taps_];
+        const float* upper = lower + taps_;
+        for (uint32_t tap = 0; tap < taps_; ++tap)
+            coefficients_[tap] = lower[tap] + weight * (upper[tap] - lower[tap]);
+
+        for (uint16_t channel = 0; channel < channels; ++channel)
+        {
+            float sum = 0;
+            for (uint32_t tap = 0; tap < taps_; ++tap)
+                sum += in[tap * channels + channel] * coefficients_[tap];
+            store(out + (n * channels + channel) * sample_size, sum);
+        }
+    }
+
+    // drop the consumed frames, keep the history and the lookahead
+    double end = phase_ + frames * step;
+    auto consumed = std::min(static_cast<uint32_t>(end), available_ - (half_ - 1));
+    phase_ = end - consumed;
+    available_ -= consumed;
+    std::memmove(buffer_.data(), buffer_.data() + consumed * channels, available_ * channels * sizeof(float));
+}
@@ -0,0 +1,97 @@
+/***
+    This file is part of snapcast
+    Copyright (C) 2014-2025  Johannes Pohl
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+***/
+
+#pragma once
+
+
+// local headers
+#include "common/sample_format.hpp"
+
+// standard headers
+#include <cstdint>
+#include <vector>
+
+
+/// Variable rate resampler for the drift correction
+/**
+ * Changes the playback speed by a continuous rate ratio close to 1, by interpolating
+ * between the input frames with a windowed sinc (or linear) kernel from a polyphase table.
+ * Frame accounting is exact: inputFrames tells how many input frames are needed to produce
+ * the requested output frames and latency tells the distance of the next output frame to
+ * the next input frame, so that the caller can map the output to the stream timestamps.
+ * All buffers are allocated in the constructor, process doesn't allocate.
+ */
+class VariableResampler
+{
+public:
+    /// Interpolation quality
+    enum class Quality : char
+    {
+        low,    ///< linear interpolation, 2 taps
+        medium, ///< windowed sinc, 8 taps
+        high    ///< windowed sinc, 32 taps
+    };
+
+    /// c'tor
+    /// @param format sample format of input and output
+    /// @param quality interpolation quality
+    /// @param max_frames max number of frames per process call
+    VariableResampler(const SampleFormat& format, Quality quality, uint32_t max_frames);
+
+    /// @return true if @p format is supported
+    static bool supports(const SampleFormat& format);
+
+    /// @return number of input frames needed to produce @p frames output frames at @p ratio
+    /// @param ratio playback rate ratio: < 1 plays faster, i.e. consumes more input frames
+    uint32_t inputFrames(uint32_t frames, double ratio) const;
+
+    /// Resample @p in_frames frames from @p input into @p frames frames in @p output
+    /// @param in_frames must be the number returned by inputFrames for the same @p frames and @p ratio
+    void process(const void* input, uint32_t in_frames, void* output, uint32_t frames, double ratio);
+
+    /// @return latency in frames: the distance of the next output frame to the next input frame
+    double latency() const;
+
+    /// Discard all buffered frames
+    void reset();
+
+private:
+    /// convert @p frames frames from @p input to float and append them to the buffer
+    void append(const void* input, uint32_t frames);
+    /// convert @p value to the sample format and store it at @p output
+    void store(char* output, float value) const;
+
+    SampleFormat format_;
+    uint32_t taps_;
+    /// number of frames before the interpolation point, the current frame included
+    uint32_t half_;
+    /// number of phases in the polyphase table
+    uint32_t phases_;
+    /// coefficients, (phases_ + 1) * taps_
+    std::vector<float> table_;
+    /// interpolated coefficients of the current phase
+    std::vector<float> coefficients_;
+    /// input frames, interleaved. The frame at index half_ - 1 is the current frame (position 0)
+    std::vector<float> buffer_;
+    /// number of frames in the buffer
+    uint32_t available_;
+    /// fractional position of the next output frame, relative to the current frame
+    double phase_;
+    float min_;
+    float max_;
+};
@@ -0,0 +1,218 @@
+/***
+    This file is part of snapcast
+    Copyright (C) 2014-2025  Johannes Pohl
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+***/
+
+
+// prototype/interface header file
+#include "zone_router.hpp"
+
+// local headers
+#include "common/aixlog.hpp"
+
+// standard headers
+#include <algorithm>
+#include <cstring>
+
+
+static constexpr auto LOG_TAG = "ZoneRouter";
+
+
+namespace
+{
+/// @return FNV-1a hash of the @p size bytes in @p data
+uint64_t hash(const char* data, size_t size)
+{
+    uint64_t result = 14695981039346656037ULL;
+    for (size_t n = 0; n < size; ++n)
+    {
+        result ^= static_cast<uint8_t>(data[n]);
+        result *= 1099511628211ULL;
+    }
+    return result;
+}
+} // namespace
+
+
+ZoneRouter::Member::Member(ZoneRouter& router, std::shared_ptr<Source> source) : router_(router), source_(std::move(source))
+{
+}
+
+
+ZoneRouter::Member::~Member()
+{
+    std::lock_guard<std::mutex> lock(router_.mutex_);
+    router_.leave(*this);
+}
+
+
+bool ZoneRouter::Member::isLeader() const
+{
+    std::lock_guard<std::mutex> lock(router_.mutex_);
+    return source_->leader == this;
+}
+
+
+std::unique_ptr<msg::PcmChunk> ZoneRouter::Member::decode(std::unique_ptr<msg::PcmChunk> chunk, const DecodeFunc& decode)
+{
+    const int64_t timestamp = static_cast<int64_t>(chunk->timestamp.sec) * 1000000 + chunk->timestamp.usec;
+    const uint32_t size = chunk->payloadSize;
+    const uint64_t chunk_hash = hash(chunk->payload, chunk->payloadSize);
+
+    std::unique_lock<std::mutex> lock(router_.mutex_);
+    auto deadline = std::chrono::steady_clock::now() + router_.max_wait_;
+    while (source_->leader != this)
+    {
+        const auto& published = source_->published;
+        auto iter = std::find_if(published.rbegin(), published.rend(), [timestamp](const Published& entry) { return entry.timestamp == timestamp; });
+        if (iter != published.rend())
+        {
+            if ((iter->size == size) && (iter->hash == chunk_hash))
+                return iter->chunk ? std::make_unique<msg::PcmChunk>(*iter->chunk) : nullptr;
+            LOG(INFO, LOG_TAG) << "Chunk doesn't match the decoded one, decoding the stream on its own\n";
+            router_.lead(*this);
+        }
+        else if (!published.empty() && (timestamp < published.front().timestamp))
+        {
+            // older than all decoded chunks, e.g. the burst after connecting: decode it, without taking over
+            lock.unlock();
+            return decode(*chunk) ? std::move(chunk) : nullptr;
+        }
+        else if (!published.empty() && (timestamp <= published.back().timestamp))
+        {
+            LOG(INFO, LOG_TAG) << "Chunk wasn't decoded by the leader, decoding the stream on its own\n";
+            router_.lead(*this);
+        }
+        else if (router_.cond_.wait_until(lock, deadline) == std::cv_status::timeout)
+        {
+            LOG(INFO, LOG_TAG) << "Timeout waiting for the leader, taking over\n";
+            source_->leader = this;
+        }
+    }
+
+    lock.unlock();
+    bool decoded = false;
+    try
+    {
+        decoded = decode(*chunk);
+    }
+    catch (...)
+    {
+        // don't let the members wait for this chunk
+        lock.lock();
+        router_.publish(*source_, {timestamp, size, chunk_hash, nullptr});
+        throw;
+    }
+    std::shared_ptr<const msg::PcmChunk> pcm_chunk;
+    if (decoded)
+        pcm_chunk = std::make_shared<const msg::PcmChunk>(*chunk);
+    lock.lock();
+    router_.publish(*source_, {timestamp, size, chunk_hash, std::move(pcm_chunk)});
+    return decoded ? std::move(chunk) : nullptr;
+}
+
+
+ZoneRouter::ZoneRouter(size_t max_published, std::chrono::milliseconds max_wait) : max_published_(std::max<size_t>(max_published, 1)), max_wait_(max_wait)
+{
+}
+
+
+std::unique_ptr<ZoneRouter::Member> ZoneRouter::join(const msg::CodecHeader& header)
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto source = std::find_if(sources_.begin(), sources_.end(), [&header](const std::shared_ptr<Source>& source)
+    {
+        return (source->codec == header.codec) && (source->header.size() == header.payloadSize) &&
+               std::equal(source->header.begin(), source->header.end(), header.payload);
+    });
+
+    if (source != sources_.end())
+    {
+        std::unique_ptr<Member> member(new Member(*this, *source));
+        (*source)->members.push_back(member.get());
+        LOG(INFO, LOG_TAG) << "Joining source with codec " << header.codec << ", members: " << (*source)->members.size() << "\n";
+        return member;
+    }
+
+    auto new_source = std::make_shared<Source>();
+    new_source->codec = header.codec;
+    new_source->header.assign(header.payload, header.payload + header.payloadSize);
+    std::unique_ptr<Member> member(new Member(*this, new_source));
+    new_source->members.push_back(member.get());
+    new_source->leader = member.get();
+    sources_.push_back(std::move(new_source));
+    LOG(INFO, LOG_TAG) << "New source with codec " << header.codec << ", sources: " << sources_.size() << "\n";
+    return member;
+}
+
+
+size_t ZoneRouter::sources() const
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    return sources_.size();
+}
+
+
+bool ZoneRouter::claimTimeSync(const void* zone)
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (time_sync_zone_ == nullptr)
+        time_sync_zone_ = zone;
+    return time_sync_zone_ == zone;
+}
+
+
+void ZoneRouter::releaseTimeSync(const void* zone)
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (time_sync_zone_ == zone)
+        time_sync_zone_ = nullptr;
+}
+
+
+void ZoneRouter::publish(Source& source, Published published)
+{
+    source.published.push_back(std::move(published));
+    while (source.published.size() > max_published_)
+        source.published.pop_front();
+    cond_.notify_all();
+}
+
+
+void ZoneRouter::leave(Member& member)
+{
+    auto& source = *member.source_;
+    source.members.erase(std::remove(source.members.begin(), source.members.end(), &member), source.members.end());
+    if (source.leader == &member)
+        source.leader = source.members.empty() ? nullptr : source.members.front();
+    if (source.members.empty())
+        sources_.erase(std::remove(sources_.begin(), sources_.end(), member.source_), sources_.end());
+    // waiting members have to check if they are the new leader
+    cond_.notify_all();
+}
+
+
+void ZoneRouter::lead(Member& member)
+{
+    auto new_source = std::make_shared<Source>();
+    new_source->codec = member.source_->codec;
+    new_source->header = member.source_->header;
+    leave(member);
+    new_source->members.push_back(&member);
+    new_source->leader = &member;
+    member.source_ = new_source;
+    sources_.push_back(std::move(new_source));
+}
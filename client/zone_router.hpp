@@ -0,0 +1,147 @@
+/***
+    This file is part of snapcast
+    Copyright (C) 2014-2025  Johannes Pohl
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+***/
+
+
+#pragma once
+
+
+// local headers
+#include "common/message/codec_header.hpp"
+#include "common/message/pcm_chunk.hpp"
+
+// standard headers
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+
+/// Shares decoded chunks between the zones of a multi-zone client
+/**
+ * Every zone has its own connection to the server and receives the same encoded chunks as all
+ * other zones that play the same stream. Zones with an identical codec header join the same
+ * source. Only the leader of a source decodes its chunks and publishes them, the other members
+ * take a copy of the decoded chunk that matches their own encoded chunk (timestamp, size and hash
+ * of the payload). Each zone adds the decoded chunks to its Stream on its own DecodeWorker thread.
+ *
+ * A member that waits too long for the leader takes over the source, a member whose chunks don't
+ * match the published ones (e.g. another stream with the same codec header) leaves it and leads
+ * a source on its own. A member's decoder is only used once it becomes a leader: until then it
+ * has seen nothing but the codec header, just like after connecting to a running stream.
+ *
+ * The zones share the TimeProvider, only one of them syncs it with the server: the first connected
+ * zone claims the time sync and releases it when it disconnects, so that another zone can take over.
+ */
+class ZoneRouter
+{
+    struct Source;
+
+public:
+    /// A zone's membership in a source
+    class Member
+    {
+    public:
+        /// Decodes the chunk in place, @return true if the chunk holds PCM data
+        using DecodeFunc = std::function<bool(msg::PcmChunk& chunk)>;
+
+        /// d'tor, leaves the source. The next member takes over, if this member was the leader.
+        ~Member();
+
+        /// Decode the encoded @p chunk with @p decode or take the chunk decoded by the leader
+        /// @return the decoded chunk, or nullptr if there is no PCM data for @p chunk
+        std::unique_ptr<msg::PcmChunk> decode(std::unique_ptr<msg::PcmChunk> chunk, const DecodeFunc& decode);
+
+        /// @return true if this member decodes the chunks of its source
+        bool isLeader() const;
+
+    private:
+        friend class ZoneRouter;
+        Member(ZoneRouter& router, std::shared_ptr<Source> source);
+
+        ZoneRouter& router_;
+        std::shared_ptr<Source> source_;
+    };
+
+    /// c'tor
+    /// @param max_published number of decoded chunks that are kept for the members of a source
+    /// @param max_wait max time a member waits for the leader's chunk, before it takes over the source
+    explicit ZoneRouter(size_t max_published = 128, std::chrono::milliseconds max_wait = std::chrono::milliseconds(250));
+
+    /// Join the source of the stream with the codec @p header, or lead a new one
+    std::unique_ptr<Member> join(const msg::CodecHeader& header);
+
+    /// @return number of sources, i.e. streams that are decoded
+    size_t sources() const;
+
+    /// Claim the time sync of the shared TimeProvider for @p zone
+    /// @return true if @p zone owns the time sync, i.e. if no other zone claimed it before
+    bool claimTimeSync(const void* zone);
+    /// Release the time sync of @p zone, e.g. when it's disconnected. Does nothing if another zone owns it.
+    void releaseTimeSync(const void* zone);
+
+private:
+    /// A decoded chunk, with the identity of its encoded chunk
+    struct Published
+    {
+        /// timestamp [us] of the encoded chunk
+        int64_t timestamp;
+        /// size of the encoded payload
+        uint32_t size;
+        /// hash of the encoded payload
+        uint64_t hash;
+        /// the decoded chunk, nullptr if the chunk didn't yield PCM data
+        std::shared_ptr<const msg::PcmChunk> chunk;
+    };
+
+    /// The chunks of a stream, decoded by the leader
+    struct Source
+    {
+        /// codec name
+        std::string codec;
+        /// codec header payload
+        std::vector<char> header;
+        /// the members, in the order of joining
+        std::vector<Member*> members;
+        /// the member that decodes the chunks
+        Member* leader{nullptr};
+        /// the last decoded chunks, in order
+        std::deque<Published> published;
+    };
+
+    /// Append @p published to the decoded chunks of @p source and wake up the waiting members
+    void publish(Source& source, Published published);
+    /// Remove @p member from its source, hand over the lead, drop the source if it's empty
+    void leave(Member& member);
+    /// Make @p member the leader of a new source with the same codec header
+    void lead(Member& member);
+
+    // all sources and their members are guarded by mutex_
+
+    size_t max_published_;
+    std::chrono::milliseconds max_wait_;
+    mutable std::mutex mutex_;
+    std::condition_variable cond_;
+    std::vector<std::shared_ptr<Source>> sources_;
+    /// the zone that syncs the shared TimeProvider, nullptr if none
+    const void* time_sync_zone_{nullptr};
+};
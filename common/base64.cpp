@@ -31,6 +31,7 @@
 // standard headers
 #include <algorithm>
 #include <array>
+#include <cstdint>
 
 
 static std::string base64_chars = "ABCDEFGHIJKLMNOPQRSTUVWXYZ"
@@ -38,11 +39,6 @@ static std::string base64_chars = "ABCDEFGHIJKLMNOPQRSTUVWXYZ"
                                   "0123456789+/";
 
 
-static inline bool is_base64(unsigned char c)
-{
-    return ((isalnum(c) != 0) || (c == '+') || (c == '/'));
-}
-
 std::string base64_encode(const unsigned char* bytes_to_encode, size_t in_len)
 {
     std::string ret;
@@ -92,49 +88,59 @@ std::string base64_encode(const std::string& text)
     return base64_encode(reinterpret_cast<const unsigned char*>(text.c_str()), text.size());
 }
 
-std::string base64_decode(const std::string& encoded_string)
+namespace
 {
-    size_t in_len = encoded_string.size();
-    int i = 0;
-    int in_ = 0;
-    std::array<unsigned char, 4> char_array_4;
-    std::array<unsigned char, 3> char_array_3;
-    std::string ret;
+/// Marks characters that are not part of the base64 alphabet
+constexpr uint8_t kInvalid = 0xff;
 
-    while (((in_len--) != 0) && (encoded_string[in_] != '=') && is_base64(encoded_string[in_]))
-    {
-        char_array_4[i++] = encoded_string[in_];
-        in_++;
-        if (i == 4)
-        {
-            for (i = 0; i < 4; i++)
-                char_array_4[i] = static_cast<unsigned char>(base64_chars.find(char_array_4[i]));
+/// @return lookup table: character => 6 bit value, or kInvalid
+constexpr std::array<uint8_t, 256> makeDecodeTable()
+{
+    std::array<uint8_t, 256> table{};
+    for (auto& value : table)
+        value = kInvalid;
+    constexpr char chars[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+    for (uint8_t n = 0; n < 64; ++n)
+        table[static_cast<uint8_t>(chars[n])] = n;
+    return table;
+}
 
-            char_array_3[0] = (char_array_4[0] << 2) + ((char_array_4[1] & 0x30) >> 4);
-            char_array_3[1] = ((char_array_4[1] & 0xf) << 4) + ((char_array_4[2] & 0x3c) >> 2);
-            char_array_3[2] = ((char_array_4[2] & 0x3) << 6) + char_array_4[3];
+constexpr std::array<uint8_t, 256> decode_table = makeDecodeTable();
+} // namespace
 
-            for (i = 0; (i < 3); i++)
-                ret += char_array_3[i];
-            i = 0;
-        }
-    }
 
-    if (i != 0)
-    {
-        int j = 0;
-        for (j = i; j < 4; j++)
-            char_array_4[j] = 0;
+std::string base64_decode(const std::string& encoded_string)
+{
+    const auto* in = reinterpret_cast<const uint8_t*>(encoded_string.data());
+    // Decoding stops at the first padding or non base64 character
+    size_t in_len = 0;
+    while ((in_len < encoded_string.size()) && (decode_table[in[in_len]] != kInvalid))
+        ++in_len;
 
-        for (j = 0; j < 4; j++)
-            char_array_4[j] = static_cast<unsigned char>(base64_chars.find(char_array_4[j]));
+    std::string ret;
+    ret.resize(in_len / 4 * 3 + (in_len % 4) * 3 / 4);
+    auto* out = reinterpret_cast<uint8_t*>(ret.data());
 
-        char_array_3[0] = (char_array_4[0] << 2) + ((char_array_4[1] & 0x30) >> 4);
-        char_array_3[1] = ((char_array_4[1] & 0xf) << 4) + ((char_array_4[2] & 0x3c) >> 2);
-        char_array_3[2] = ((char_array_4[2] & 0x3) << 6) + char_array_4[3];
+    // Decode blocks of 4 characters into 3 bytes, without branches inside the loop
+    size_t blocks = in_len / 4;
+    for (size_t n = 0; n < blocks; ++n, in += 4, out += 3)
+    {
+        uint32_t value = (decode_table[in[0]] << 18) | (decode_table[in[1]] << 12) | (decode_table[in[2]] << 6) | decode_table[in[3]];
+        out[0] = static_cast<uint8_t>(value >> 16);
+        out[1] = static_cast<uint8_t>(value >> 8);
+        out[2] = static_cast<uint8_t>(value);
+    }
 
-        for (j = 0; (j < i - 1); j++)
-            ret += char_array_3[j];
+    // 2 or 3 remaining characters decode to 1 or 2 bytes, a single remaining character is ignored
+    size_t rest = in_len % 4;
+    if (rest >= 2)
+    {
+        uint32_t value = (decode_table[in[0]] << 18) | (decode_table[in[1]] << 12);
+        if (rest == 3)
+            value |= (decode_table[in[2]] << 6);
+        out[0] = static_cast<uint8_t>(value >> 16);
+        if (rest == 3)
+            out[1] = static_cast<uint8_t>(value >> 8);
     }
 
     return ret;
@@ -0,0 +1,111 @@
+/***
+    This file is part of snapcast
+    Copyright (C) 2014-2025  Johannes Pohl
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+***/
+
+#pragma once
+
+// local headers
+#include "message.hpp"
+
+// standard headers
+#include <cstdint>
+
+
+namespace msg
+{
+
+/// Sync statistics, sent periodically from client to server
+/**
+ * Fixed size binary message. Fields might be appended in future versions,
+ * receivers must ignore trailing bytes and treat missing fields as 0.
+ */
+class ClientStats : public BaseMessage
+{
+public:
+    /// c'tor
+    ClientStats() : BaseMessage(message_type::kClientStats)
+    {
+    }
+
+    /// d'tor
+    ~ClientStats() override = default;
+
+    void read(std::istream& stream) override
+    {
+        readVal(stream, interval_ms);
+        readVal(stream, sync_error_p50_us);
+        readVal(stream, sync_error_p95_us);
+        readVal(stream, sync_error_p99_us);
+        readVal(stream, sync_error_max_us);
+        readVal(stream, hard_syncs);
+        readVal(stream, underruns);
+        readVal(stream, buffer_ms);
+        readVal(stream, decode_avg_us);
+        readVal(stream, decode_max_us);
+        readVal(stream, device_latency_us);
+        readVal(stream, rtt_us);
+    }
+
+    uint32_t getSize() const override
+    {
+        return 12 * sizeof(uint32_t);
+    }
+
+    /// reporting interval, the counters are the events within this interval [ms]
+    uint32_t interval_ms{0};
+    /// median of the absolute sync error [us]
+    uint32_t sync_error_p50_us{0};
+    /// 95th percentile of the absolute sync error [us]
+    uint32_t sync_error_p95_us{0};
+    /// 99th percentile of the absolute sync error [us]
+    uint32_t sync_error_p99_us{0};
+    /// max absolute sync error [us]
+    uint32_t sync_error_max_us{0};
+    /// number of hard syncs, i.e. jumps to the expected position in the stream
+    uint32_t hard_syncs{0};
+    /// number of buffer underruns
+    uint32_t underruns{0};
+    /// queued audio, not yet played [ms]
+    uint32_t buffer_ms{0};
+    /// mean time to decode a chunk [us]
+    uint32_t decode_avg_us{0};
+    /// max time to decode a chunk [us]
+    uint32_t decode_max_us{0};
+    /// latency of the audio device, i.e. the time until the played audio is audible [us]
+    uint32_t device_latency_us{0};
+    /// round trip time of the last time sync [us]
+    uint32_t rtt_us{0};
+
+protected:
+    void doserialize(std::ostream& stream) const override
+    {
+        writeVal(stream, interval_ms);
+        writeVal(stream, sync_error_p50_us);
+        writeVal(stream, sync_error_p95_us);
+        writeVal(stream, sync_error_p99_us);
+        writeVal(stream, sync_error_max_us);
+        writeVal(stream, hard_syncs);
+        writeVal(stream, underruns);
+        writeVal(stream, buffer_ms);
+        writeVal(stream, decode_avg_us);
+        writeVal(stream, decode_max_us);
+        writeVal(stream, device_latency_us);
+        writeVal(stream, rtt_us);
+    }
+};
+
+} // namespace msg
@@ -20,6 +20,7 @@
 
 // local headers
 #include "client_info.hpp"
+#include "client_stats.hpp"
 #include "codec_header.hpp"
 #include "common/message/error.hpp"
 #include "error.hpp"
@@ -83,6 +84,8 @@ static std::unique_ptr<BaseMessage> createMessage(const BaseMessage& base_messag
             return createMessage<ClientInfo>(base_message, buffer);
         case message_type::kError:
             return createMessage<msg::Error>(base_message, buffer);
+        case message_type::kClientStats:
+            return createMessage<ClientStats>(base_message, buffer);
         default:
             return nullptr;
     }
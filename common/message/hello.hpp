@@ -168,6 +168,21 @@ public:
             return std::nullopt;
         return Auth{msg["Auth"]};
     }
+
+    /// Resume the stream after a reconnect: @p timestamp is the timestamp of the last chunk the client holds
+    void setResume(const tv& timestamp)
+    {
+        msg["Resume"]["Timestamp"] = {{"sec", timestamp.sec}, {"usec", timestamp.usec}};
+    }
+
+    /// @return the timestamp of the last chunk the client holds, if the client wants to resume the stream
+    std::optional<tv> getResume() const
+    {
+        if (!msg.contains("Resume") || !msg["Resume"].contains("Timestamp"))
+            return std::nullopt;
+        const auto& timestamp = msg["Resume"]["Timestamp"];
+        return tv{timestamp.value("sec", 0), timestamp.value("usec", 0)};
+    }
 };
 
 } // namespace msg
@@ -67,9 +67,10 @@ enum class message_type : uint16_t
     // kStreamTags = 6,
     kClientInfo = 7,
     kError = 8,
+    kClientStats = 9,
 
     kFirst = kBase,
-    kLast = kError
+    kLast = kClientStats
 };
 
 /// Message type to string
@@ -101,6 +102,9 @@ static std::ostream& operator<<(std::ostream& os, const message_type& msg_type)
         case message_type::kError:
             os << "Error";
             break;
+        case message_type::kClientStats:
+            os << "ClientStats";
+            break;
         default:
             os << "Unknown";
     }
@@ -65,6 +65,12 @@ public:
         return get("muted", false);
     }
 
+    /// @return interval of the client's sync stats in [ms], 0 = don't send stats
+    uint32_t getStatsIntervalMs()
+    {
+        return get("statsIntervalMs", static_cast<uint32_t>(0));
+    }
+
 
     /// Set the end to end delay to @p buffer_ms [ms]
     void setBufferMs(int32_t buffer_ms)
@@ -89,6 +95,12 @@ public:
     {
         msg["muted"] = muted;
     }
+
+    /// Set the interval of the client's sync stats to @p stats_interval_ms [ms], 0 = don't send stats
+    void setStatsIntervalMs(uint32_t stats_interval_ms)
+    {
+        msg["statsIntervalMs"] = stats_interval_ms;
+    }
 };
 
 } // namespace msg
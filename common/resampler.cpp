@@ -16,24 +16,98 @@
     along with this program.  If not, see <http://www.gnu.org/licenses/>.
 ***/
 
+
 // prototype/interface header file
 #include "resampler.hpp"
 
 // local headers
 #include "common/aixlog.hpp"
-#ifndef HAS_SOXR
 #include "common/snap_exception.hpp"
-#endif
+#include "common/str_compat.hpp"
+#include "common/utils/pcm_utils.hpp"
+#include "common/utils/string_utils.hpp"
 
 // standard headers
+#include <chrono>
 #include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <tuple>
 
 
 using namespace std;
 
 static constexpr auto LOG_TAG = "Resampler";
 
-Resampler::Resampler(const SampleFormat& in_format, const SampleFormat& out_format) : in_format_(in_format), out_format_(out_format)
+namespace
+{
+/// the timestamps of continuous input are not re-derived from soxr's delay as long as they deviate less [ns]
+constexpr int64_t kMaxTimestampDeviation = 1000000;
+
+#ifdef HAS_SOXR
+/// @return size of a frame as processed by soxr: 16 bit samples or 32 bit samples for anything larger
+uint16_t soxrFrameSize(const SampleFormat& format)
+{
+    return format.channels() * ((format.sampleSize() > 2) ? 4 : 2);
+}
+
+/// @return the soxr recipe for @p quality
+unsigned long soxrRecipe(Resampler::Quality quality)
+{
+    switch (quality)
+    {
+        case Resampler::Quality::quick:
+            return SOXR_QQ;
+        case Resampler::Quality::low:
+            return SOXR_LQ;
+        case Resampler::Quality::medium:
+            return SOXR_MQ;
+        case Resampler::Quality::very_high:
+            return SOXR_VHQ;
+        case Resampler::Quality::high:
+        default:
+            return SOXR_HQ;
+    }
+}
+#endif
+} // namespace
+
+
+Resampler::Settings Resampler::parseSettings(const std::string& settings)
+{
+    Settings result;
+    std::string threads;
+    std::string quality = utils::string::split_left(settings, ':', threads);
+    if (quality == "qq")
+        result.quality = Quality::quick;
+    else if (quality == "lq")
+        result.quality = Quality::low;
+    else if (quality == "mq")
+        result.quality = Quality::medium;
+    else if (quality == "hq")
+        result.quality = Quality::high;
+    else if (quality == "vhq")
+        result.quality = Quality::very_high;
+    else
+        throw SnapException("Resampler quality must be one of qq, lq, mq, hq, vhq");
+
+    if (!threads.empty())
+    {
+        if (threads.find_first_not_of("0123456789") != std::string::npos)
+            throw SnapException("Invalid number of resampler threads: " + threads);
+        result.threads = static_cast<uint16_t>(cpt::stoul(threads));
+    }
+    return result;
+}
+
+
+Resampler::Resampler(const SampleFormat& in_format, const SampleFormat& out_format) : Resampler(in_format, out_format, Settings())
+{
+}
+
+
+Resampler::Resampler(const SampleFormat& in_format, const SampleFormat& out_format, const Settings& settings)
+    : in_format_(in_format), out_format_(out_format)
 {
 #ifdef HAS_SOXR
     if ((out_format_.rate() != in_format_.rate()) || (out_format_.bits() != in_format_.bits()))
@@ -48,169 +122,190 @@ Resampler::Resampler(const SampleFormat& in_format, const SampleFormat& out_form
         if (out_format_.sampleSize() > 2)
             out_type = SOXR_INT32_I;
         soxr_io_spec_t iospec = soxr_io_spec(in_type, out_type);
-        // HQ should be fine: http://sox.sourceforge.net/Docs/FAQ
-        soxr_quality_spec_t q_spec = soxr_quality_spec(SOXR_HQ, 0);
+        // HQ (the default) should be fine: http://sox.sourceforge.net/Docs/FAQ
+        soxr_quality_spec_t q_spec = soxr_quality_spec(soxrRecipe(settings.quality), 0);
+        soxr_runtime_spec_t runtime_spec = soxr_runtime_spec(settings.threads);
         soxr_ = soxr_create(static_cast<double>(in_format_.rate()), static_cast<double>(out_format_.rate()), in_format_.channels(), &error, &iospec, &q_spec,
-                            nullptr);
+                            &runtime_spec);
         if (error != nullptr)
         {
             LOG(ERROR, LOG_TAG) << "Error soxr_create: " << error << "\n";
             soxr_ = nullptr;
         }
-        // initialize the buffer with 20ms (~latency of the reampler)
-        resample_buffer_.resize(out_format_.frameSize() * static_cast<uint16_t>(ceil(out_format_.msRate() * 20)));
     }
 #else
-    LOG(WARNING, LOG_TAG) << "Soxr not available, resampling not supported\n";
+    std::ignore = settings;
     if ((out_format_.rate() != in_format_.rate()) || (out_format_.bits() != in_format_.bits()))
     {
+        LOG(WARNING, LOG_TAG) << "Soxr not available, resampling not supported\n";
         throw SnapException("Resampling requested, but not supported");
     }
 #endif
-    // resampled_chunk_ = std::make_unique<msg::PcmChunk>(out_format_, 0);
+    if ((out_format_.rate() == in_format_.rate()) && (out_format_.bits() == in_format_.bits()) && (out_format_.sampleSize() != in_format_.sampleSize()))
+        LOG(INFO, LOG_TAG) << "Converting from " << (in_format_.isPacked24() ? "packed" : "padded") << " to "
+                           << (out_format_.isPacked24() ? "packed" : "padded") << " 24 bit samples\n";
 }
 
 
 bool Resampler::resamplingNeeded() const
 {
 #ifdef HAS_SOXR
-    return soxr_ != nullptr;
+    return (soxr_ != nullptr) || (out_format_.sampleSize() != in_format_.sampleSize());
 #else
-    return false;
+    return (out_format_.sampleSize() != in_format_.sampleSize());
 #endif
 }
 
 
-// std::shared_ptr<msg::PcmChunk> Resampler::resample(std::shared_ptr<msg::PcmChunk> chunk, chronos::usec duration)
-// {
-//     auto resampled_chunk = resample(chunk);
-//     if (!resampled_chunk)
-//         return nullptr;
-// std::cerr << "1\n";
-//     resampled_chunk_->append(*resampled_chunk);
-// std::cerr << "2\n";
-//     while (resampled_chunk_->duration<chronos::usec>() >= duration)
-//     {
-//         LOG(DEBUG, LOG_TAG) << "resampled duration: " << resampled_chunk_->durationMs() << ", consuming: " << out_format_.usRate() * duration.count() <<
-//         "\n";
-//         auto chunk = resampled_chunk_->consume(out_format_.usRate() * duration.count());
-//         LOG(DEBUG, LOG_TAG) << "consumed: " << chunk->durationMs() << ", resampled duration: " << resampled_chunk_->durationMs() << "\n";
-//         return chunk;
-//     }
-//     // resampled_chunks_.push_back(resampled_chunk);
-//     // chronos::usec avail;
-//     // for (const auto& chunk: resampled_chunks_)
-//     // {
-//     //     avail += chunk->durationLeft<chronos::usec>();
-//     //     if (avail >= duration)
-//     //     {
-
-//     //     }
-//     // }
-// }
-
-
-std::shared_ptr<msg::PcmChunk> Resampler::resample(const msg::PcmChunk& chunk)
+void Resampler::convert(const msg::PcmChunk& in, msg::PcmChunk& out) const
 {
-#ifndef HAS_SOXR
-    return std::make_shared<msg::PcmChunk>(chunk);
-#else
-    if (!resamplingNeeded())
+    out.setFrameCount(static_cast<int>(in.getFrameCount()));
+    if (in_format_.isPacked24())
+        utils::pcm::unpack24(in.payload, out.payload, in.getSampleCount());
+    else
+        utils::pcm::pack24(in.payload, out.payload, in.getSampleCount());
+}
+
+
+tv Resampler::timestamp(const msg::PcmChunk& in, size_t frames, double delay)
+{
+    // the resampled frames end delay frames before the end of the input
+    const int64_t rate = out_format_.rate();
+    const int64_t in_end = chrono::duration_cast<chrono::nanoseconds>(in.start().time_since_epoch()).count() + in.durationLeft<chrono::nanoseconds>().count();
+    const int64_t start = in_end - static_cast<int64_t>((static_cast<double>(frames) + delay) * 1000000000. / static_cast<double>(rate));
+
+    // soxr's delay is fractional and jitters: as long as the input is continuous, count the frames instead
+    int64_t result = origin_.has_value() ? *origin_ + frames_since_origin_ * 1000000000 / rate : start;
+    if (!origin_.has_value() || (std::abs(result - start) > kMaxTimestampDeviation))
+    {
+        origin_ = start;
+        frames_since_origin_ = 0;
+        result = start;
+    }
+    frames_since_origin_ += static_cast<int64_t>(frames);
+    // move the origin in steps of whole seconds, to keep the frame count small
+    *origin_ += (frames_since_origin_ / rate) * 1000000000;
+    frames_since_origin_ %= rate;
+
+    int64_t us = result / 1000;
+    if (result % 1000 < 0)
+        --us;
+    int64_t usec = us % 1000000;
+    if (usec < 0)
+        usec += 1000000;
+    return {static_cast<int32_t>((us - usec) / 1000000), static_cast<int32_t>(usec)};
+}
+
+
+bool Resampler::resample(const msg::PcmChunk& in, msg::PcmChunk& out)
+{
+    // rewind, in case out is a recycled chunk. The format goes first: seek divides by the frame size,
+    // which is 0 for a default constructed chunk
+    out.format = out_format_;
+    out.seek(-out.seek(0));
+#ifdef HAS_SOXR
+    if (soxr_ != nullptr)
+        return resampleSoxr(in, out);
+#endif
+    out.timestamp = in.timestamp;
+    if (out_format_.sampleSize() != in_format_.sampleSize())
     {
-        return std::make_shared<msg::PcmChunk>(chunk);
+        convert(in, out);
     }
     else
     {
-        if (in_format_.bits() == 24)
+        out.setFrameCount(static_cast<int>(in.getFrameCount()));
+        memcpy(out.payload, in.payload, out.payloadSize);
+    }
+    return true;
+}
+
+
+#ifdef HAS_SOXR
+bool Resampler::resampleSoxr(const msg::PcmChunk& in, msg::PcmChunk& out)
+{
+    // soxr expects 32 bit input for anything larger than 16 bit, with the sample in the upper bytes
+    const char* input = in.payload;
+    const size_t in_samples = in.getSampleCount();
+    if (in_format_.isPacked24())
+    {
+        in_buffer_.resize(in_samples * 4);
+        utils::pcm::unpack24To32(in.payload, in_buffer_.data(), in_samples);
+        input = in_buffer_.data();
+    }
+    else if (in_format_.bits() == 24)
+    {
+        in_buffer_.resize(in_samples * 4);
+        utils::pcm::pad24To32(in.payload, in_buffer_.data(), in_samples);
+        input = in_buffer_.data();
+    }
+
+    // soxr writes straight into the payload of out, except for packed 24 bit samples, that are packed afterwards
+    const size_t in_frame_size = soxrFrameSize(in_format_);
+    const size_t out_frame_size = soxrFrameSize(out_format_);
+    const size_t margin = static_cast<size_t>(ceil(out_format_.msRate() * 5));
+    size_t capacity = static_cast<size_t>(ceil(static_cast<double>(in.getFrameCount()) * out_format_.rate() / in_format_.rate())) + margin;
+    size_t in_left = in.getFrameCount();
+    size_t frames = 0;
+    char* output = nullptr;
+    while (true)
+    {
+        if (out_format_.isPacked24())
         {
-            // sox expects 32 bit input, shift 8 bits left
-            auto* frames = reinterpret_cast<int32_t*>(chunk.payload);
-            for (size_t n = 0; n < chunk.getSampleCount(); ++n)
-                frames[n] = frames[n] << 8;
+            out_buffer_.resize(capacity * out_frame_size);
+            output = out_buffer_.data();
+        }
+        else
+        {
+            out.setFrameCount(static_cast<int>(capacity));
+            output = out.payload;
         }
 
-        size_t idone;
-        size_t odone;
-        auto resample_buffer_framesize = resample_buffer_.size() / out_format_.frameSize();
-        const auto* error = soxr_process(soxr_, chunk.payload, chunk.getFrameCount(), &idone, resample_buffer_.data(), resample_buffer_framesize, &odone);
+        size_t idone = 0;
+        size_t odone = 0;
+        const auto* error = soxr_process(soxr_, input, in_left, &idone, output + frames * out_frame_size, capacity - frames, &odone);
         if (error != nullptr)
         {
             LOG(ERROR, LOG_TAG) << "Error soxr_process: " << error << "\n";
+            out.setFrameCount(0);
+            return false;
         }
-        else
-        {
-            LOG(TRACE, LOG_TAG) << "Resample idone: " << idone << "/" << chunk.getFrameCount() << ", odone: " << odone << "/"
-                                << resample_buffer_.size() / out_format_.frameSize() << ", delay: " << soxr_delay(soxr_) << "\n";
-
-            // some data has been resampled (odone frames) and some is still in the pipe (soxr_delay frames)
-            if (odone > 0)
-            {
-                // get the resampled ts from the input ts
-                auto input_end_ts = chunk.start() + chunk.duration<std::chrono::microseconds>();
-                double resampled_ms = (odone + soxr_delay(soxr_)) / out_format_.msRate();
-                auto resampled_start = input_end_ts - std::chrono::microseconds(static_cast<int>(resampled_ms * 1000.));
-
-                auto resampled_chunk = std::make_shared<msg::PcmChunk>(out_format_, 0);
-                auto us = chrono::duration_cast<chrono::microseconds>(resampled_start.time_since_epoch()).count();
-                resampled_chunk->timestamp.sec = static_cast<int32_t>(us / 1000000);
-                resampled_chunk->timestamp.usec = static_cast<int32_t>(us % 1000000);
-
-                // copy from the resample_buffer to the resampled chunk
-                resampled_chunk->payloadSize = static_cast<uint32_t>(odone * out_format_.frameSize());
-                resampled_chunk->payload = static_cast<char*>(realloc(resampled_chunk->payload, resampled_chunk->payloadSize));
-                memcpy(resampled_chunk->payload, resample_buffer_.data(), resampled_chunk->payloadSize);
-
-                if (out_format_.bits() == 24)
-                {
-                    // sox has quantized to 32 bit, shift 8 bits right
-                    auto* frames = reinterpret_cast<int32_t*>(resampled_chunk->payload);
-                    for (size_t n = 0; n < resampled_chunk->getSampleCount(); ++n)
-                    {
-                        // +128 to round to the nearest so that quantisation steps are distributed evenly
-                        frames[n] = (frames[n] + 128) >> 8;
-                        if (frames[n] > 0x7fffffff)
-                            frames[n] = 0x7fffffff;
-                    }
-                }
-
-                // check if the resample_buffer is large enough, or if soxr was using all available space
-                if (odone == resample_buffer_framesize)
-                {
-                    // buffer for resampled data too small, add space for 5ms
-                    resample_buffer_.resize(resample_buffer_.size() + out_format_.frameSize() * static_cast<uint16_t>(ceil(out_format_.msRate() * 5)));
-                    LOG(DEBUG, LOG_TAG) << "Resample buffer completely filled, adding space for 5ms; new buffer size: " << resample_buffer_.size()
-                                        << " bytes\n";
-                }
-
-                // //LOG(TRACE, LOG_TAG) << "ts: " << out->timestamp.sec << "s, " << out->timestamp.usec/1000.f << " ms, duration: " << odone / format_.msRate()
-                // << "\n";
-                // int64_t next_us = us + static_cast<int64_t>(odone / format_.msRate() * 1000);
-                // LOG(TRACE, LOG_TAG) << "ts: " << us << ", next: " << next_us << ", diff: " << next_us_ - us << "\n";
-                // next_us_ = next_us;
-
-                return resampled_chunk;
-            }
-        }
+        input += idone * in_frame_size;
+        in_left -= idone;
+        frames += odone;
+        LOG(TRACE, LOG_TAG) << "Resample idone: " << idone << "/" << in.getFrameCount() << ", odone: " << odone << ", delay: " << soxr_delay(soxr_) << "\n";
+
+        // done, unless soxr has filled the output or hasn't taken all input
+        if (((frames < capacity) && (in_left == 0)) || ((idone == 0) && (odone == 0)))
+            break;
+        capacity += margin;
+        LOG(DEBUG, LOG_TAG) << "Resample buffer completely filled, adding space for 5ms; new capacity: " << capacity << " frames\n";
     }
-    return nullptr;
-#endif
+
+    // sox has quantized to 32 bit
+    if (out_format_.bits() == 24)
+        utils::pcm::round32To24(output, frames * out_format_.channels());
+    out.setFrameCount(static_cast<int>(frames));
+    if (out_format_.isPacked24())
+        utils::pcm::pack24(out_buffer_.data(), out.payload, frames * out_format_.channels());
+    if (frames == 0)
+        return false;
+
+    out.timestamp = timestamp(in, frames, soxr_delay(soxr_));
+    return true;
 }
+#endif
 
 
 std::shared_ptr<msg::PcmChunk> Resampler::resample(std::shared_ptr<msg::PcmChunk> chunk)
 {
-#ifndef HAS_SOXR
-    return chunk;
-#else
     if (!resamplingNeeded())
-    {
         return chunk;
-    }
-    else
-    {
-        return resample(*chunk);
-    }
-#endif
+
+    auto resampled = std::make_shared<msg::PcmChunk>();
+    if (!resample(*chunk, *resampled))
+        return nullptr;
+    return resampled;
 }
 
 
@@ -16,6 +16,7 @@
     along with this program.  If not, see <http://www.gnu.org/licenses/>.
 ***/
 
+
 #pragma once
 
 
@@ -29,29 +30,82 @@
 #endif
 
 // standard headers
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <string>
 #include <vector>
 
 
 /// Resampler
+/**
+ * Converts PCM chunks between sample rates (using soxr) and sample layouts (16, 24, packed 24 and 32 bit).
+ * The input chunks are never modified. The output is written into a chunk of the caller, whose payload
+ * memory is reused, so that a caller who keeps its output chunk (or recycles its chunks) doesn't allocate
+ * per chunk.
+ * soxr has a latency, i.e. the first calls might not yield any frames. As long as the input is continuous,
+ * the output timestamps are derived from the number of resampled frames and are continuous as well.
+ */
 class Resampler
 {
 public:
-    /// c'tor to resample from @p in_format to @p out_format
+    /// Resampling quality, i.e. the soxr recipe
+    enum class Quality : char
+    {
+        quick,    ///< cubic interpolation (SOXR_QQ)
+        low,      ///< 16 bit with a larger roll-off (SOXR_LQ)
+        medium,   ///< 16 bit with a medium roll-off (SOXR_MQ)
+        high,     ///< 20 bit (SOXR_HQ)
+        very_high ///< 28 bit (SOXR_VHQ)
+    };
+
+    /// Resampler settings
+    struct Settings
+    {
+        /// the resampling quality
+        Quality quality{Quality::high};
+        /// number of threads used by soxr, 0 = one per CPU core
+        uint16_t threads{1};
+    };
+
+    /// @return settings parsed from "<qq|lq|mq|hq|vhq>[:<threads>]"
+    static Settings parseSettings(const std::string& settings);
+
+    /// c'tor to resample from @p in_format to @p out_format with the default settings
     Resampler(const SampleFormat& in_format, const SampleFormat& out_format);
+    /// c'tor to resample from @p in_format to @p out_format with @p settings
+    Resampler(const SampleFormat& in_format, const SampleFormat& out_format, const Settings& settings);
     /// d'tor
     virtual ~Resampler();
 
-    /// @return resampled @p chunk
+    /// Resample @p in into @p out, @p in is not modified. The payload of @p out is reallocated to the resampled size.
+    /// @return true if @p out holds resampled frames
+    bool resample(const msg::PcmChunk& in, msg::PcmChunk& out);
+    /// @return resampled @p chunk, @p chunk itself if no resampling is needed, or nullptr if there are no resampled frames yet
     std::shared_ptr<msg::PcmChunk> resample(std::shared_ptr<msg::PcmChunk> chunk);
-    /// @return resampled @p chunk
-    std::shared_ptr<msg::PcmChunk> resample(const msg::PcmChunk& chunk);
     /// @return if resampling is needed (in_format != out_format)
     bool resamplingNeeded() const;
 
 private:
-    std::vector<char> resample_buffer_;
+    /// Convert @p in between packed and padded 24 bit samples into @p out
+    void convert(const msg::PcmChunk& in, msg::PcmChunk& out) const;
+#ifdef HAS_SOXR
+    /// Resample @p in into @p out with soxr
+    bool resampleSoxr(const msg::PcmChunk& in, msg::PcmChunk& out);
+#endif
+    /// @return the timestamp of @p frames resampled frames that end @p delay frames before the end of @p in
+    tv timestamp(const msg::PcmChunk& in, size_t frames, double delay);
+
+    /// 32 bit input samples for soxr
+    std::vector<char> in_buffer_;
+    /// 32 bit output samples of soxr, to be packed
+    std::vector<char> out_buffer_;
     SampleFormat in_format_;
     SampleFormat out_format_;
+    /// timestamp [ns] of the first resampled frame after the last discontinuity of the input
+    std::optional<int64_t> origin_;
+    /// frames resampled since origin_
+    int64_t frames_since_origin_{0};
 #ifdef HAS_SOXR
     soxr_t soxr_{nullptr};
 #endif
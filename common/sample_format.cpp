@@ -44,9 +44,9 @@ SampleFormat::SampleFormat(const std::string& format)
 }
 
 
-SampleFormat::SampleFormat(uint32_t sampleRate, uint16_t bitsPerSample, uint16_t channels)
+SampleFormat::SampleFormat(uint32_t sampleRate, uint16_t bitsPerSample, uint16_t channels, uint16_t sample_size)
 {
-    setFormat(sampleRate, bitsPerSample, channels);
+    setFormat(sampleRate, bitsPerSample, channels, sample_size);
 }
 
 
@@ -70,17 +70,16 @@ void SampleFormat::setFormat(const std::string& format)
 }
 
 
-void SampleFormat::setFormat(uint32_t rate, uint16_t bits, uint16_t channels)
+void SampleFormat::setFormat(uint32_t rate, uint16_t bits, uint16_t channels, uint16_t sample_size)
 {
-    // needs something like:
-    // 24_4 = 3 bytes, padded to 4
-    // 32 = 4 bytes
+    // 24 bit samples are padded to 4 bytes (S24_LE), unless explicitly
+    // requested to be packed into 3 bytes (S24_3LE)
     rate_ = rate;
     bits_ = bits;
     channels_ = channels;
     sample_size_ = bits / 8;
     if (bits_ == 24)
-        sample_size_ = 4;
+        sample_size_ = (sample_size == 3) ? 3 : 4;
     frame_size_ = channels_ * sample_size_;
     //	LOG(DEBUG) << "SampleFormat: " << rate << ":" << bits << ":" << channels << "\n";
 }
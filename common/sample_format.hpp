@@ -43,7 +43,8 @@ public:
     /// c'tor
     SampleFormat(const std::string& format);
     /// c'tor
-    SampleFormat(uint32_t rate, uint16_t bits, uint16_t channels);
+    /// @param sample_size size of a sample in [bytes], 0 to derive it from @p bits (24 bit samples are padded to 4 bytes)
+    SampleFormat(uint32_t rate, uint16_t bits, uint16_t channels, uint16_t sample_size = 0);
 
     /// @return sampleformat as string rate:bits::channels
     std::string toString() const;
@@ -51,7 +52,8 @@ public:
     /// Set @p format (rate:bits::channels)
     void setFormat(const std::string& format);
     /// Set format
-    void setFormat(uint32_t rate, uint16_t bits, uint16_t channels);
+    /// @param sample_size size of a sample in [bytes], 0 to derive it from @p bits (24 bit samples are padded to 4 bytes)
+    void setFormat(uint32_t rate, uint16_t bits, uint16_t channels, uint16_t sample_size = 0);
 
     /// @return if has format
     bool isInitialized() const
@@ -83,6 +85,12 @@ public:
         return sample_size_;
     }
 
+    /// @return true if 24 bit samples are packed into 3 bytes (S24_3LE) instead of 4 bytes (S24_LE)
+    bool isPacked24() const
+    {
+        return (bits_ == 24) && (sample_size_ == 3);
+    }
+
     /// @return size in [bytes] of a frame (sum of sample sizes = num-channel*sampleSize), e.g. 4 bytes (= 2 channel * 16 bit)
     uint16_t frameSize() const
     {
@@ -0,0 +1,115 @@
+/***
+    This file is part of snapcast
+    Copyright (C) 2014-2025  Johannes Pohl
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+***/
+
+#pragma once
+
+// standard headers
+#include <atomic>
+#include <cstddef>
+#include <utility>
+#include <vector>
+
+
+/// Lock-free single producer, single consumer ring buffer
+/**
+ * All slots are allocated in the constructor, pushing and popping never allocates,
+ * never blocks and never throws, as long as moving a T doesn't.
+ * This makes it suitable to pass data to and from a realtime (audio) thread.
+ * try_push must only be called from one (producer) thread, try_pop and front only
+ * from one (consumer) thread.
+ */
+template <typename T>
+class SpscRing
+{
+public:
+    /// c'tor
+    /// @param capacity max number of elements in the ring
+    explicit SpscRing(size_t capacity) : slots_(capacity + 1)
+    {
+    }
+
+    SpscRing(const SpscRing&) = delete;            ///< disable copying
+    SpscRing& operator=(const SpscRing&) = delete; ///< disable assignment
+
+    /// Add @p item at the end of the ring, called by the producer
+    /// @return false if the ring is full, @p item is left untouched in this case
+    bool try_push(T&& item) noexcept
+    {
+        const size_t tail = tail_.load(std::memory_order_relaxed);
+        const size_t next = increment(tail);
+        if (next == head_.load(std::memory_order_acquire))
+            return false;
+        slots_[tail] = std::move(item);
+        tail_.store(next, std::memory_order_release);
+        return true;
+    }
+
+    /// Move the oldest element into @p item, called by the consumer
+    /// @return false if the ring is empty
+    bool try_pop(T& item) noexcept
+    {
+        const size_t head = head_.load(std::memory_order_relaxed);
+        if (head == tail_.load(std::memory_order_acquire))
+            return false;
+        item = std::move(slots_[head]);
+        head_.store(increment(head), std::memory_order_release);
+        return true;
+    }
+
+    /// @return the oldest element or nullptr if the ring is empty, called by the consumer
+    T* front() noexcept
+    {
+        const size_t head = head_.load(std::memory_order_relaxed);
+        if (head == tail_.load(std::memory_order_acquire))
+            return nullptr;
+        return &slots_[head];
+    }
+
+    /// @return number of elements in the ring, just a snapshot if called concurrently
+    size_t size() const noexcept
+    {
+        const size_t head = head_.load(std::memory_order_acquire);
+        const size_t tail = tail_.load(std::memory_order_acquire);
+        return (tail >= head) ? (tail - head) : (slots_.size() - head + tail);
+    }
+
+    /// @return if the ring is empty
+    bool empty() const noexcept
+    {
+        return (head_.load(std::memory_order_acquire) == tail_.load(std::memory_order_acquire));
+    }
+
+    /// @return max number of elements in the ring
+    size_t capacity() const noexcept
+    {
+        return slots_.size() - 1;
+    }
+
+private:
+    /// @return the slot following @p index
+    size_t increment(size_t index) const noexcept
+    {
+        return (index + 1 == slots_.size()) ? 0 : index + 1;
+    }
+
+    std::vector<T> slots_;
+    /// read position, written by the consumer
+    alignas(64) std::atomic<size_t> head_{0};
+    /// write position, written by the producer
+    alignas(64) std::atomic<size_t> tail_{0};
+};
@@ -0,0 +1,371 @@
+/***
+    This file is part of snapcast
+    Copyright (C) 2014-2025  Johannes Pohl
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+***/
+
+
+// prototype/interface header file
+#include "pcm_utils.hpp"
+
+// 3rd party headers
+#if defined(__SSSE3__)
+#include <tmmintrin.h>
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#elif defined(__ARM_NEON)
+#include <arm_neon.h>
+#endif
+
+// standard headers
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+
+
+namespace utils::pcm
+{
+
+namespace
+{
+/// fractional bits of the fixed point gain
+constexpr int kGainBits = 16;
+/// unity gain in fixed point
+constexpr int64_t kUnityGain = int64_t{1} << kGainBits;
+
+/// @return @p gain in fixed point
+int64_t toFixedGain(double gain)
+{
+    return std::clamp<int64_t>(std::llround(gain * kUnityGain), 0, INT32_MAX);
+}
+
+/// @return the little endian sample with @p Bytes bytes at @p src, sign extended
+template <int Bytes>
+inline int64_t load(const char* src)
+{
+    uint32_t value = 0;
+    for (int n = 0; n < Bytes; ++n)
+        value |= static_cast<uint32_t>(static_cast<uint8_t>(src[n])) << (8 * (n + 4 - Bytes));
+    return static_cast<int32_t>(value) >> (8 * (4 - Bytes));
+}
+
+/// Store the lower @p Bytes bytes of @p sample little endian at @p dst
+template <int Bytes>
+inline void store(char* dst, int64_t sample)
+{
+    for (int n = 0; n < Bytes; ++n)
+        dst[n] = static_cast<char>(sample >> (8 * n));
+}
+
+/// Multiply the samples with @p Bytes bytes by the fixed point gain, ramped from @p from to @p to, saturating
+template <int Bytes>
+void scale(char* buffer, size_t frames, uint16_t channels, int64_t from, int64_t to)
+{
+    constexpr int64_t max = (int64_t{1} << (8 * Bytes - 1)) - 1;
+    constexpr int64_t min = -max - 1;
+    constexpr int64_t round = int64_t{1} << (kGainBits - 1);
+    if (from == to)
+    {
+        size_t samples = frames * channels;
+        for (size_t n = 0; n < samples; ++n, buffer += Bytes)
+            store<Bytes>(buffer, std::clamp((load<Bytes>(buffer) * to + round) >> kGainBits, min, max));
+        return;
+    }
+
+    // the gain is stepped per frame, with 16 more fractional bits.
+    // Multiplied instead of shifted, because the difference is negative for a ramp down
+    constexpr int64_t fraction = 65536;
+    int64_t gain = from * fraction;
+    const int64_t step = (to - from) * fraction / static_cast<int64_t>(frames);
+    for (size_t n = 0; n < frames; ++n)
+    {
+        gain = (n + 1 == frames) ? (to * fraction) : gain + step;
+        const int64_t g = gain >> 16;
+        for (uint16_t channel = 0; channel < channels; ++channel, buffer += Bytes)
+            store<Bytes>(buffer, std::clamp((load<Bytes>(buffer) * g + round) >> kGainBits, min, max));
+    }
+}
+
+/// Multiply S16_LE samples by a constant fixed point gain below unity
+void scale16(char* buffer, size_t samples, int64_t gain)
+{
+    // Q15 gain for a rounding multiply high, that can't overflow for gains below unity
+    const auto gain15 = static_cast<int16_t>(gain >> 1);
+    size_t n = 0;
+#if defined(__SSSE3__)
+    const __m128i g = _mm_set1_epi16(gain15);
+    for (; n + 8 <= samples; n += 8)
+    {
+        auto* v = reinterpret_cast<__m128i*>(buffer + 2 * n);
+        _mm_storeu_si128(v, _mm_mulhrs_epi16(_mm_loadu_si128(v), g));
+    }
+#elif defined(__SSE2__)
+    // baseline x86-64: the rounding multiply high is assembled from the high and low halves of the product,
+    // (product >> 15) + bit 14 of the product, which can't overflow for gains below unity
+    const __m128i g = _mm_set1_epi16(gain15);
+    const __m128i one = _mm_set1_epi16(1);
+    for (; n + 8 <= samples; n += 8)
+    {
+        auto* v = reinterpret_cast<__m128i*>(buffer + 2 * n);
+        __m128i in = _mm_loadu_si128(v);
+        __m128i hi = _mm_mulhi_epi16(in, g);
+        __m128i lo = _mm_mullo_epi16(in, g);
+        __m128i shifted = _mm_or_si128(_mm_slli_epi16(hi, 1), _mm_srli_epi16(lo, 15));
+        _mm_storeu_si128(v, _mm_add_epi16(shifted, _mm_and_si128(_mm_srli_epi16(lo, 14), one)));
+    }
+#elif defined(__ARM_NEON)
+    for (; n + 8 <= samples; n += 8)
+    {
+        auto* v = reinterpret_cast<int16_t*>(buffer + 2 * n);
+        vst1q_s16(v, vqrdmulhq_n_s16(vld1q_s16(v), gain15));
+    }
+#endif
+    // same rounding as the vectorized loops: (sample * gain15 + 2^14) >> 15
+    for (; n < samples; ++n)
+        store<2>(buffer + 2 * n, (load<2>(buffer + 2 * n) * gain15 + (1 << 14)) >> 15);
+}
+
+#if !defined(__SSSE3__) && defined(__SSE2__)
+/// Pack the lower 3 bytes of the 4 samples in @p v into the lower 12 bytes, the upper 4 bytes are 0
+inline __m128i pack24Sse2(__m128i v)
+{
+    // per 64 bit lane: the first sample in bytes 0-2, the second one shifted down from bytes 4-6 to bytes 3-5
+    const __m128i first = _mm_set_epi32(0, 0x00ffffff, 0, 0x00ffffff);
+    const __m128i second = _mm_set_epi32(0xffff, static_cast<int>(0xff000000), 0xffff, static_cast<int>(0xff000000));
+    __m128i lanes = _mm_or_si128(_mm_and_si128(v, first), _mm_and_si128(_mm_srli_epi64(v, 8), second));
+    // move the 6 bytes of the upper lane down to bytes 6-11
+    const __m128i lower = _mm_set_epi32(0, 0, 0xffff, -1);
+    return _mm_or_si128(_mm_and_si128(lanes, lower), _mm_andnot_si128(lower, _mm_srli_si128(lanes, 2)));
+}
+
+/// Unpack the 4 samples in the lower 12 bytes of @p v into the upper 3 bytes of each 32 bit lane, the lowest byte is 0
+inline __m128i unpack24Sse2(__m128i v)
+{
+    // per 64 bit lane: 2 samples in bytes 0-5, i.e. move bytes 6-11 up to the upper lane
+    const __m128i lower = _mm_set_epi32(0, 0, -1, -1);
+    __m128i lanes = _mm_or_si128(_mm_and_si128(v, lower), _mm_andnot_si128(lower, _mm_slli_si128(v, 2)));
+    // the first sample of a lane from bytes 0-2 to bytes 1-3, the second one from bytes 3-5 to bytes 5-7
+    const __m128i first = _mm_set_epi32(0, static_cast<int>(0xffffff00), 0, static_cast<int>(0xffffff00));
+    const __m128i second = _mm_set_epi32(static_cast<int>(0xffffff00), 0, static_cast<int>(0xffffff00), 0);
+    return _mm_or_si128(_mm_and_si128(_mm_slli_epi64(lanes, 8), first), _mm_and_si128(_mm_slli_epi64(lanes, 16), second));
+}
+#endif
+} // namespace
+
+void pack24(const char* src, char* dst, size_t samples)
+{
+    size_t n = 0;
+#if defined(__SSSE3__)
+    // 4 samples per iteration. The store writes 16 bytes, of which 12 are valid,
+    // so stop while there are at least 16 bytes left in dst
+    const __m128i mask = _mm_setr_epi8(0, 1, 2, 4, 5, 6, 8, 9, 10, 12, 13, 14, -1, -1, -1, -1);
+    for (; n + 6 <= samples; n += 4)
+    {
+        __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + 4 * n));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + 3 * n), _mm_shuffle_epi8(v, mask));
+    }
+#elif defined(__SSE2__)
+    // baseline x86-64 has no byte shuffle, the bytes are moved with shifts and masks
+    for (; n + 6 <= samples; n += 4)
+    {
+        __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + 4 * n));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + 3 * n), pack24Sse2(v));
+    }
+#elif defined(__ARM_NEON)
+    // 16 samples per iteration: deinterleave into byte planes and drop the most significant one
+    for (; n + 16 <= samples; n += 16)
+    {
+        uint8x16x4_t in = vld4q_u8(reinterpret_cast<const uint8_t*>(src + 4 * n));
+        uint8x16x3_t out = {{in.val[0], in.val[1], in.val[2]}};
+        vst3q_u8(reinterpret_cast<uint8_t*>(dst + 3 * n), out);
+    }
+#endif
+    for (; n < samples; ++n)
+    {
+        dst[3 * n] = src[4 * n];
+        dst[3 * n + 1] = src[4 * n + 1];
+        dst[3 * n + 2] = src[4 * n + 2];
+    }
+}
+
+
+void unpack24(const char* src, char* dst, size_t samples)
+{
+    size_t n = 0;
+#if defined(__SSSE3__)
+    // 4 samples per iteration. The load reads 16 bytes, of which 12 are used,
+    // so stop while there are at least 16 bytes left in src.
+    // The samples are shuffled into the upper 3 bytes and arithmetically shifted back to sign extend.
+    const __m128i mask = _mm_setr_epi8(-1, 0, 1, 2, -1, 3, 4, 5, -1, 6, 7, 8, -1, 9, 10, 11);
+    for (; n + 6 <= samples; n += 4)
+    {
+        __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + 3 * n));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + 4 * n), _mm_srai_epi32(_mm_shuffle_epi8(v, mask), 8));
+    }
+#elif defined(__SSE2__)
+    for (; n + 6 <= samples; n += 4)
+    {
+        __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + 3 * n));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + 4 * n), _mm_srai_epi32(unpack24Sse2(v), 8));
+    }
+#elif defined(__ARM_NEON)
+    for (; n + 16 <= samples; n += 16)
+    {
+        uint8x16x3_t in = vld3q_u8(reinterpret_cast<const uint8_t*>(src + 3 * n));
+        uint8x16_t sign = vreinterpretq_u8_s8(vshrq_n_s8(vreinterpretq_s8_u8(in.val[2]), 7));
+        uint8x16x4_t out = {{in.val[0], in.val[1], in.val[2], sign}};
+        vst4q_u8(reinterpret_cast<uint8_t*>(dst + 4 * n), out);
+    }
+#endif
+    for (; n < samples; ++n)
+    {
+        dst[4 * n] = src[3 * n];
+        dst[4 * n + 1] = src[3 * n + 1];
+        dst[4 * n + 2] = src[3 * n + 2];
+        dst[4 * n + 3] = static_cast<char>((static_cast<uint8_t>(src[3 * n + 2]) & 0x80) != 0 ? 0xff : 0x00);
+    }
+}
+
+
+void unpack24To32(const char* src, char* dst, size_t samples)
+{
+    size_t n = 0;
+#if defined(__SSSE3__)
+    const __m128i mask = _mm_setr_epi8(-1, 0, 1, 2, -1, 3, 4, 5, -1, 6, 7, 8, -1, 9, 10, 11);
+    for (; n + 6 <= samples; n += 4)
+    {
+        __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + 3 * n));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + 4 * n), _mm_shuffle_epi8(v, mask));
+    }
+#elif defined(__SSE2__)
+    for (; n + 6 <= samples; n += 4)
+    {
+        __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + 3 * n));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + 4 * n), unpack24Sse2(v));
+    }
+#elif defined(__ARM_NEON)
+    for (; n + 16 <= samples; n += 16)
+    {
+        uint8x16x3_t in = vld3q_u8(reinterpret_cast<const uint8_t*>(src + 3 * n));
+        uint8x16x4_t out = {{vdupq_n_u8(0), in.val[0], in.val[1], in.val[2]}};
+        vst4q_u8(reinterpret_cast<uint8_t*>(dst + 4 * n), out);
+    }
+#endif
+    for (; n < samples; ++n)
+    {
+        dst[4 * n] = 0;
+        dst[4 * n + 1] = src[3 * n];
+        dst[4 * n + 2] = src[3 * n + 1];
+        dst[4 * n + 3] = src[3 * n + 2];
+    }
+}
+
+
+void pad24To32(const char* src, char* dst, size_t samples)
+{
+    size_t n = 0;
+#if defined(__SSE2__)
+    for (; n + 4 <= samples; n += 4)
+    {
+        __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + 4 * n));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + 4 * n), _mm_slli_epi32(v, 8));
+    }
+#elif defined(__ARM_NEON)
+    for (; n + 16 <= samples; n += 16)
+    {
+        uint8x16x4_t in = vld4q_u8(reinterpret_cast<const uint8_t*>(src + 4 * n));
+        uint8x16x4_t out = {{vdupq_n_u8(0), in.val[0], in.val[1], in.val[2]}};
+        vst4q_u8(reinterpret_cast<uint8_t*>(dst + 4 * n), out);
+    }
+#endif
+    for (; n < samples; ++n)
+    {
+        dst[4 * n] = 0;
+        dst[4 * n + 1] = src[4 * n];
+        dst[4 * n + 2] = src[4 * n + 1];
+        dst[4 * n + 3] = src[4 * n + 2];
+    }
+}
+
+
+void round32To24(char* buffer, size_t samples)
+{
+    constexpr int32_t max = 0x7fffff;
+    size_t n = 0;
+#if defined(__SSE2__)
+    // (sample >> 8) + bit 7 rounds like (sample + 128) >> 8, without overflowing
+    const __m128i one = _mm_set1_epi32(1);
+    const __m128i max_v = _mm_set1_epi32(max);
+    for (; n + 4 <= samples; n += 4)
+    {
+        auto* p = reinterpret_cast<__m128i*>(buffer + 4 * n);
+        __m128i v = _mm_loadu_si128(p);
+        __m128i r = _mm_add_epi32(_mm_srai_epi32(v, 8), _mm_and_si128(_mm_srli_epi32(v, 7), one));
+        __m128i over = _mm_cmpgt_epi32(r, max_v);
+        _mm_storeu_si128(p, _mm_or_si128(_mm_and_si128(over, max_v), _mm_andnot_si128(over, r)));
+    }
+#elif defined(__ARM_NEON)
+    for (; n + 4 <= samples; n += 4)
+    {
+        auto* p = reinterpret_cast<int32_t*>(buffer + 4 * n);
+        vst1q_s32(p, vminq_s32(vrshrq_n_s32(vld1q_s32(p), 8), vdupq_n_s32(max)));
+    }
+#endif
+    for (; n < samples; ++n)
+        store<4>(buffer + 4 * n, std::min<int64_t>((load<4>(buffer + 4 * n) + 128) >> 8, max));
+}
+
+
+void applyGain(char* buffer, size_t frames, uint16_t channels, uint16_t sample_size, double from, double to)
+{
+    if (frames == 0)
+        return;
+
+    const int64_t from_gain = toFixedGain(from);
+    const int64_t to_gain = toFixedGain(to);
+    if (from_gain == to_gain)
+    {
+        if (to_gain == kUnityGain)
+            return;
+        if ((sample_size == 2) && (to_gain < kUnityGain))
+            return scale16(buffer, frames * channels, to_gain);
+    }
+
+    if (sample_size == 1)
+        scale<1>(buffer, frames, channels, from_gain, to_gain);
+    else if (sample_size == 2)
+        scale<2>(buffer, frames, channels, from_gain, to_gain);
+    else if (sample_size == 3)
+        scale<3>(buffer, frames, channels, from_gain, to_gain);
+    else if (sample_size == 4)
+        scale<4>(buffer, frames, channels, from_gain, to_gain);
+}
+
+
+void mapChannels(const char* src, char* dst, size_t frames, uint16_t channels, uint16_t sample_size, const std::vector<uint16_t>& map)
+{
+    const size_t in_frame_size = static_cast<size_t>(channels) * sample_size;
+    const size_t out_frame_size = map.size() * sample_size;
+    for (size_t n = 0; n < frames; ++n)
+    {
+        const char* in = src + n * in_frame_size;
+        char* out = dst + n * out_frame_size;
+        for (size_t c = 0; c < map.size(); ++c)
+            memcpy(out + c * sample_size, in + map[c] * sample_size, sample_size);
+    }
+}
+
+} // namespace utils::pcm
@@ -0,0 +1,68 @@
+/***
+    This file is part of snapcast
+    Copyright (C) 2014-2025  Johannes Pohl
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+***/
+
+#pragma once
+
+
+// standard headers
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+
+/// Conversion between the 24 bit sample layouts, gain and channel mapping
+/**
+ * Snapcast stores 24 bit samples in 4 byte little endian containers, with the sample in the
+ * lower 3 bytes (S24_LE). On the wire and on some devices the samples are packed into
+ * 3 bytes (S24_3LE). All functions operate on little endian byte streams and are therefore
+ * independent of the host byte order.
+ */
+namespace utils::pcm
+{
+
+/// Pack @p samples S24_LE samples from @p src into S24_3LE samples in @p dst
+/// @p dst must hold at least 3 * @p samples bytes
+void pack24(const char* src, char* dst, size_t samples);
+
+/// Unpack @p samples S24_3LE samples from @p src into sign extended S24_LE samples in @p dst
+/// @p dst must hold at least 4 * @p samples bytes
+void unpack24(const char* src, char* dst, size_t samples);
+
+/// Unpack @p samples S24_3LE samples from @p src into S32_LE samples (i.e. shifted left by 8 bits) in @p dst
+/// @p dst must hold at least 4 * @p samples bytes
+void unpack24To32(const char* src, char* dst, size_t samples);
+
+/// Shift @p samples S24_LE samples from @p src into S32_LE samples in @p dst
+/// @p dst must hold at least 4 * @p samples bytes and may be equal to @p src
+void pad24To32(const char* src, char* dst, size_t samples);
+
+/// Convert @p samples S32_LE samples in @p buffer in place into S24_LE samples, rounded to the nearest and saturated
+void round32To24(char* buffer, size_t samples);
+
+/// Multiply @p frames frames of @p channels samples with @p sample_size bytes (1, 2, 3 for S24_3LE or 4) in @p buffer by a gain,
+/// that is ramped linearly per frame from @p from to @p to and reaches @p to with the last frame.
+/// The gain is applied in fixed point with 16 fractional bits, the samples saturate instead of wrapping around.
+/// Unity gain leaves the buffer untouched.
+void applyGain(char* buffer, size_t frames, uint16_t channels, uint16_t sample_size, double from, double to);
+
+/// Copy @p frames frames of @p channels samples with @p sample_size bytes from @p src to @p dst, where output channel n
+/// is the input channel @p map [n]. All entries of @p map must be less than @p channels.
+/// @p dst must hold at least @p frames * @p map.size() * @p sample_size bytes
+void mapChannels(const char* src, char* dst, size_t frames, uint16_t channels, uint16_t sample_size, const std::vector<uint16_t>& map);
+
+} // namespace utils::pcm
@@ -28,17 +28,32 @@
 // standard headers
 #include <cerrno>
 #include <fcntl.h>
+#include <filesystem>
 #include <fstream>
 #include <sys/stat.h>
 #include <sys/types.h>
+#include <unistd.h>
 
 using namespace std;
 
 
 
+Config::Config() : index_(std::make_shared<Index>())
+{
+    // the metrics registry is created here, before the Config singleton is complete, so it outlives it
+    auto& registry = metrics::Registry::instance();
+    saves_metric_ = registry.counter("snapserver_config_saves_total", "Number of server.json writes");
+    skipped_metric_ = registry.counter("snapserver_config_saves_skipped_total", "Number of unchanged, not written snapshots");
+    duration_metric_ = registry.histogram("snapserver_config_save_duration_seconds", "Time to write server.json");
+}
+
+
 Config::~Config()
 {
-    save();
+    stopWriter();
+    // static destruction: don't rely on the metrics anymore
+    auto [seq, content] = snapshot();
+    write(seq, content, false);
 }
 
 
@@ -94,8 +109,13 @@ void Config::init(const std::string& root_directory, const std::string& user, co
         ifstream ifs(filename_, std::ifstream::in);
         if (ifs.good() && (ifs.peek() != std::ifstream::traits_type::eof()))
         {
-            json j;
-            ifs >> j;
+            std::string content{std::istreambuf_iterator<char>(ifs), std::istreambuf_iterator<char>()};
+            {
+                // don't rewrite an unchanged file
+                std::lock_guard<std::mutex> lock(file_mutex_);
+                written_ = content;
+            }
+            json j = json::parse(content);
             if (j.count("ConfigVersion") != 0u)
             {
                 json jGroups = j["Groups"];
@@ -105,9 +125,11 @@ void Config::init(const std::string& root_directory, const std::string& user, co
                     group->fromJson(jGroup);
                     // if (client->id.empty() || getClientInfo(client->id))
                     //     continue;
-                    groups.push_back(group);
+                    groups_.push_back(group);
                 }
             }
+            std::lock_guard<std::recursive_mutex> lock(mutex_);
+            reindex();
         }
     }
     catch (const std::exception& e)
@@ -117,35 +139,181 @@ void Config::init(const std::string& root_directory, const std::string& user, co
 }
 
 
-void Config::save()
+std::pair<uint64_t, std::string> Config::snapshot()
 {
     std::lock_guard<std::recursive_mutex> lock(mutex_);
     if (filename_.empty())
         init();
-    std::ofstream ofs(filename_.c_str(), std::ofstream::out | std::ofstream::trunc);
     json clients = {{"ConfigVersion", 2}, {"Groups", getGroups()}};
-    // ofs << std::setw(4) << clients;
-    ofs << clients;
-    ofs.close();
+    std::lock_guard<std::mutex> writer_lock(writer_mutex_);
+    return {++snapshot_seq_, clients.dump()};
 }
 
 
-ClientInfoPtr Config::getClientInfo(const std::string& client_id) const
+void Config::save()
 {
-    if (client_id.empty())
-        return nullptr;
+    auto [seq, content] = snapshot();
+    write(seq, content);
+}
 
-    std::lock_guard<std::recursive_mutex> lock(mutex_);
-    for (const auto& group : groups)
+
+void Config::saveAsync()
+{
+    auto snap = snapshot();
+    std::lock_guard<std::mutex> lock(writer_mutex_);
+    // replace an older snapshot that is not yet written
+    pending_ = std::move(snap);
+    if (!writer_.joinable())
+        writer_ = std::thread(&Config::writerLoop, this);
+    writer_cv_.notify_one();
+}
+
+
+void Config::setSaveInterval(const std::chrono::milliseconds& interval)
+{
+    std::lock_guard<std::mutex> lock(writer_mutex_);
+    save_interval_ = interval;
+}
+
+
+void Config::writerLoop()
+{
+    std::unique_lock<std::mutex> lock(writer_mutex_);
+    while (true)
+    {
+        writer_cv_.wait(lock, [this] { return writer_stop_ || pending_.has_value(); });
+        // coalesce all snapshots taken within the save interval
+        if (writer_cv_.wait_until(lock, last_write_ + save_interval_, [this] { return writer_stop_; }))
+            break;
+        auto [seq, content] = std::move(*pending_);
+        pending_.reset();
+        lock.unlock();
+        write(seq, content);
+        lock.lock();
+        last_write_ = std::chrono::steady_clock::now();
+    }
+}
+
+
+void Config::stopWriter()
+{
+    {
+        std::lock_guard<std::mutex> lock(writer_mutex_);
+        writer_stop_ = true;
+        writer_cv_.notify_one();
+    }
+    if (writer_.joinable())
+        writer_.join();
+}
+
+
+void Config::write(uint64_t seq, const std::string& content, bool update_metrics)
+{
+    std::lock_guard<std::mutex> lock(file_mutex_);
+    if (seq <= written_seq_)
+        return;
+    written_seq_ = seq;
+    if (content == written_)
+    {
+        LOG(DEBUG) << "Config unchanged, not saving\n";
+        if (update_metrics)
+            skipped_metric_->inc();
+        return;
+    }
+    auto start = std::chrono::steady_clock::now();
+
+    // Write to a temp file and rename it, so that the file is always complete, even after a crash or power loss
+    LOG(DEBUG) << "Saving config\n";
+    std::string tmp_filename = filename_ + ".tmp";
+    int fd = open(tmp_filename.c_str(), O_WRONLY | O_CREAT | O_TRUNC, S_IRUSR | S_IWUSR | S_IRGRP | S_IROTH);
+    if (fd == -1)
+    {
+        LOG(ERROR) << "Failed to open file \"" << tmp_filename << "\", error " << errno << "\n";
+        return;
+    }
+    size_t offset = 0;
+    while (offset < content.size())
     {
-        for (auto client : group->clients)
+        ssize_t count = ::write(fd, content.data() + offset, content.size() - offset);
+        if (count < 0)
         {
-            if (client->id == client_id)
-                return client;
+            if (errno == EINTR)
+                continue;
+            LOG(ERROR) << "Failed to write file \"" << tmp_filename << "\", error " << errno << "\n";
+            close(fd);
+            return;
         }
+        offset += static_cast<size_t>(count);
+    }
+    // the file replaces the config file: keep its owner and permissions, e.g. after a chown to the snapserver user in init
+    struct stat file_stat;
+    struct stat tmp_stat;
+    if ((stat(filename_.c_str(), &file_stat) == 0) && (fstat(fd, &tmp_stat) == 0))
+    {
+        if (((file_stat.st_uid != tmp_stat.st_uid) || (file_stat.st_gid != tmp_stat.st_gid)) && (fchown(fd, file_stat.st_uid, file_stat.st_gid) != 0))
+            LOG(WARNING) << "Failed to change owner of \"" << tmp_filename << "\", error " << errno << "\n";
+        if (((file_stat.st_mode & 07777) != (tmp_stat.st_mode & 07777)) && (fchmod(fd, file_stat.st_mode & 07777) != 0))
+            LOG(WARNING) << "Failed to change permissions of \"" << tmp_filename << "\", error " << errno << "\n";
+    }
+    // close in any case, a failing fsync must not leak the descriptor
+    int sync_error = (fsync(fd) == 0) ? 0 : errno;
+    int close_error = (close(fd) == 0) ? 0 : errno;
+    if ((sync_error != 0) || (close_error != 0))
+    {
+        LOG(ERROR) << "Failed to sync file \"" << tmp_filename << "\", error " << ((sync_error != 0) ? sync_error : close_error) << "\n";
+        return;
+    }
+    if (rename(tmp_filename.c_str(), filename_.c_str()) != 0)
+    {
+        LOG(ERROR) << "Failed to rename \"" << tmp_filename << "\" to \"" << filename_ << "\", error " << errno << "\n";
+        return;
+    }
+    // persist the rename
+    int dir_fd = open(std::filesystem::path(filename_).parent_path().c_str(), O_RDONLY | O_DIRECTORY);
+    if (dir_fd != -1)
+    {
+        fsync(dir_fd);
+        close(dir_fd);
+    }
+    written_ = content;
+    if (update_metrics)
+    {
+        saves_metric_->inc();
+        duration_metric_->observe(std::chrono::steady_clock::now() - start);
+    }
+}
+
+
+void Config::reindex()
+{
+    auto index = std::make_shared<Index>();
+    for (const auto& group : groups_)
+    {
+        index->groups[group->id] = group;
+        index->streams[group->streamId].push_back(group);
+        for (const auto& client : group->clients)
+            index->clients[client->id] = {client, group};
     }
+    std::atomic_store(&index_, std::shared_ptr<const Index>(std::move(index)));
+}
+
+
+std::shared_ptr<const Config::Index> Config::index() const
+{
+    return std::atomic_load(&index_);
+}
+
+
+ClientInfoPtr Config::getClientInfo(const std::string& client_id) const
+{
+    if (client_id.empty())
+        return nullptr;
 
-    return nullptr;
+    auto index = this->index();
+    auto iter = index->clients.find(client_id);
+    if (iter == index->clients.end())
+        return nullptr;
+    return iter->second.first;
 }
 
 
@@ -157,7 +325,8 @@ GroupPtr Config::addClientInfo(const ClientInfoPtr& client)
     {
         group = std::make_shared<Group>();
         group->addClient(client);
-        groups.push_back(group);
+        groups_.push_back(group);
+        reindex();
     }
     return group;
 }
@@ -175,29 +344,38 @@ GroupPtr Config::addClientInfo(const std::string& client_id)
 
 GroupPtr Config::getGroup(const std::string& group_id) const
 {
-    std::lock_guard<std::recursive_mutex> lock(mutex_);
-    for (const auto& group : groups)
-    {
-        if (group->id == group_id)
-            return group;
-    }
+    auto index = this->index();
+    auto iter = index->groups.find(group_id);
+    if (iter == index->groups.end())
+        return nullptr;
+    return iter->second;
+}
+
 
-    return nullptr;
+std::vector<GroupPtr> Config::getGroupsFromStream(const std::string& stream_id) const
+{
+    auto index = this->index();
+    auto iter = index->streams.find(stream_id);
+    if (iter == index->streams.end())
+        return {};
+    return iter->second;
 }
 
 
-GroupPtr Config::getGroupFromClient(const std::string& client_id)
+std::vector<GroupPtr> Config::getGroupList() const
 {
     std::lock_guard<std::recursive_mutex> lock(mutex_);
-    for (const auto& group : groups)
-    {
-        for (const auto& c : group->clients)
-        {
-            if (c->id == client_id)
-                return group;
-        }
-    }
-    return nullptr;
+    return groups_;
+}
+
+
+GroupPtr Config::getGroupFromClient(const std::string& client_id)
+{
+    auto index = this->index();
+    auto iter = index->clients.find(client_id);
+    if (iter == index->clients.end())
+        return nullptr;
+    return iter->second.second;
 }
 
 
@@ -229,7 +407,7 @@ json Config::getGroups() const
 {
     std::lock_guard<std::recursive_mutex> lock(mutex_);
     json result = json::array();
-    for (const auto& group : groups)
+    for (const auto& group : groups_)
         result.push_back(group->toJson());
     return result;
 }
@@ -244,6 +422,8 @@ void Config::remove(const ClientInfoPtr& client)
     group->removeClient(client);
     if (group->empty())
         remove(group);
+    else
+        reindex();
 }
 
 
@@ -254,7 +434,39 @@ void Config::remove(const GroupPtr& group, bool force)
         return;
 
     if (group->empty() || force)
-        groups.erase(std::remove(groups.begin(), groups.end(), group), groups.end());
+    {
+        groups_.erase(std::remove(groups_.begin(), groups_.end(), group), groups_.end());
+        reindex();
+    }
+}
+
+
+GroupPtr Config::moveClient(const ClientInfoPtr& client, GroupPtr group)
+{
+    std::lock_guard<std::recursive_mutex> lock(mutex_);
+    GroupPtr old_group = getGroupFromClient(client);
+    if (old_group && (old_group == group))
+        return group;
+    if (old_group)
+        old_group->removeClient(client);
+    if (!group)
+    {
+        group = std::make_shared<Group>();
+        groups_.push_back(group);
+    }
+    group->addClient(client);
+    reindex();
+    return group;
+}
+
+
+void Config::setStream(const GroupPtr& group, const std::string& stream_id)
+{
+    std::lock_guard<std::recursive_mutex> lock(mutex_);
+    if (group->streamId == stream_id)
+        return;
+    group->streamId = stream_id;
+    reindex();
 }
 
 
@@ -23,12 +23,20 @@
 #include "common/json.hpp"
 #include "common/utils.hpp"
 #include "common/utils/string_utils.hpp"
+#include "metrics.hpp"
 
 // standard headers
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
 #include <memory>
 #include <mutex>
+#include <optional>
 #include <string>
 #include <sys/time.h>
+#include <thread>
+#include <unordered_map>
+#include <utility>
 #include <vector>
 
 
@@ -335,8 +343,9 @@ struct Group : public JsonConfigItem
         {
             if ((*iter)->id == client_id)
             {
+                ClientInfoPtr client = *iter;
                 clients.erase(iter);
-                return (*iter);
+                return client;
             }
         }
         return nullptr;
@@ -420,6 +429,12 @@ public:
     void remove(const ClientInfoPtr& client);
     /// Remove group @p group, @p force removal of a non-empty group
     void remove(const GroupPtr& group, bool force = false);
+    /// Move @p client from its group into @p group, or into a new group if @p group is nullptr
+    /// The old group is kept, even if it is empty now
+    /// @return the client's new group
+    GroupPtr moveClient(const ClientInfoPtr& client, GroupPtr group = nullptr);
+    /// Assign stream @p stream_id to @p group
+    void setStream(const GroupPtr& group, const std::string& stream_id);
 
     //	GroupPtr removeFromGroup(const std::string& groupId, const std::string& clientId);
     //	GroupPtr setGroupForClient(const std::string& groupId, const std::string& clientId);
@@ -430,31 +445,86 @@ public:
     GroupPtr getGroupFromClient(const ClientInfoPtr& client);
     /// @return group with id @p group_id
     GroupPtr getGroup(const std::string& group_id) const;
+    /// @return groups that are playing stream @p stream_id
+    std::vector<GroupPtr> getGroupsFromStream(const std::string& stream_id) const;
+    /// @return all groups
+    std::vector<GroupPtr> getGroupList() const;
 
     /// @return groups with client as json
     json getGroups() const;
     /// @return complete server status, including @p streams
     json getServerStatus(const json& streams) const;
 
-    /// Save config to file (json format)
+    /// Save config to file (json format), blocks until the file is written
     void save();
+    /// Save config to file in the background
+    /// A snapshot of the config is taken immediately, writes are coalesced to one per save interval
+    void saveAsync();
+    /// Write the file at most once per @p interval in saveAsync
+    void setSaveInterval(const std::chrono::milliseconds& interval);
 
     /// Set directory and user/group of persistent "server.json"
     void init(const std::string& root_directory = "", const std::string& user = "", const std::string& group = "");
 
-    /// List of groups
-    std::vector<GroupPtr> groups;
-
     /// to protect members
     std::mutex& getMutex();
 
 private:
+    /// Lookup tables, rebuilt on every change of the group structure
+    struct Index
+    {
+        /// client id => client and its group
+        std::unordered_map<std::string, std::pair<ClientInfoPtr, GroupPtr>> clients;
+        /// group id => group
+        std::unordered_map<std::string, GroupPtr> groups;
+        /// stream id => groups playing the stream
+        std::unordered_map<std::string, std::vector<GroupPtr>> streams;
+    };
+
     /// c'tor
-    Config() = default;
+    Config();
     /// d'tor
     ~Config();
 
+    /// Publish a new index for the current groups, must be called with mutex_ locked
+    void reindex();
+    /// @return the current index
+    std::shared_ptr<const Index> index() const;
+
+    /// @return a numbered snapshot of the config, serialized as json
+    std::pair<uint64_t, std::string> snapshot();
+    /// Write @p content of snapshot @p seq via temp file, fsync and rename
+    /// Nothing is written if a newer snapshot has been written, or if the content didn't change
+    /// @p update_metrics is false for the final write in the d'tor
+    void write(uint64_t seq, const std::string& content, bool update_metrics = true);
+    /// Background writer thread
+    void writerLoop();
+    /// Stop the background writer
+    void stopWriter();
+
+    /// List of groups
+    std::vector<GroupPtr> groups_;
+    /// Copy-on-write snapshot of the lookup tables: readers don't lock mutex_
+    std::shared_ptr<const Index> index_;
+
     mutable std::recursive_mutex mutex_; ///< to protect members
+
+    std::thread writer_;                                         ///< background writer, started on the first saveAsync
+    std::mutex writer_mutex_;                                    ///< protects the writer state below
+    std::condition_variable writer_cv_;                          ///< wakes up the writer
+    bool writer_stop_{false};                                    ///< stop the writer
+    std::optional<std::pair<uint64_t, std::string>> pending_;    ///< latest snapshot to be written by the writer
+    uint64_t snapshot_seq_{0};                                   ///< number of the last snapshot
+    std::chrono::milliseconds save_interval_{std::chrono::seconds(5)}; ///< min interval between two background writes
+    std::chrono::steady_clock::time_point last_write_;           ///< time of the last background write
+
+    std::shared_ptr<metrics::Counter> saves_metric_;        ///< number of file writes
+    std::shared_ptr<metrics::Counter> skipped_metric_;      ///< number of unchanged, not written snapshots
+    std::shared_ptr<metrics::Histogram> duration_metric_;   ///< time to write the file
+
+    std::mutex file_mutex_;  ///< serializes writes of the file
+    uint64_t written_seq_{0}; ///< number of the last written snapshot
+    std::string written_;     ///< content of the file
     std::mutex client_mutex_;            ///< returned by "getMutex()", TODO: check this
     std::string filename_;               ///< filename to persist the config
 };
@@ -0,0 +1,89 @@
+/***
+    This file is part of snapcast
+    Copyright (C) 2014-2025  Johannes Pohl
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+***/
+
+// prototype/interface header file
+#include "control_dispatch.hpp"
+
+// standard headers
+#include <exception>
+
+
+void dispatchControlMessage(const std::string& message, ControlEncoding encoding, const ControlDispatchHandler& handler,
+                            const std::function<void(std::shared_ptr<const EncodedMessage> response)>& response_handler)
+{
+    jsonrpcpp::entity_ptr entity(nullptr);
+    try
+    {
+        entity = jsonrpcpp::Parser::do_parse_json(decode(message, encoding));
+        if (!entity)
+            return response_handler(nullptr);
+    }
+    catch (const jsonrpcpp::ParseErrorException& e)
+    {
+        return response_handler(std::make_shared<EncodedMessage>(e.to_json()));
+    }
+    catch (const std::exception& e)
+    {
+        return response_handler(std::make_shared<EncodedMessage>(jsonrpcpp::ParseErrorException(e.what()).to_json()));
+    }
+
+    if (entity->is_request())
+    {
+        jsonrpcpp::request_ptr request = std::dynamic_pointer_cast<jsonrpcpp::Request>(entity);
+        handler.process(request, [handler, response_handler](const jsonrpcpp::entity_ptr& response, const jsonrpcpp::notification_ptr& notification)
+        {
+            if (notification)
+                handler.notify(*notification);
+            if (response)
+                return response_handler(std::make_shared<EncodedMessage>(response->to_json()));
+            return response_handler(nullptr);
+        });
+        // the response handler is called by the request processing, possibly asynchronously
+        return;
+    }
+    if (entity->is_batch())
+    {
+        /// Attention: this will only work as long as the response handler in processRequest is called synchronously. One way to do this is to remove the outer
+        /// loop and to call the next processRequest with
+        /// This is true for volume changes, which is the only batch request, but not for Control commands!
+        jsonrpcpp::batch_ptr batch = std::dynamic_pointer_cast<jsonrpcpp::Batch>(entity);
+        jsonrpcpp::Batch responseBatch;
+        jsonrpcpp::Batch notificationBatch;
+        for (const auto& batch_entity : batch->entities)
+        {
+            if (batch_entity->is_request())
+            {
+                jsonrpcpp::request_ptr request = std::dynamic_pointer_cast<jsonrpcpp::Request>(batch_entity);
+                handler.process(request,
+                                [&responseBatch, &notificationBatch](const jsonrpcpp::entity_ptr& response, const jsonrpcpp::notification_ptr& notification)
+                {
+                    if (response != nullptr)
+                        responseBatch.add_ptr(response);
+                    if (notification != nullptr)
+                        notificationBatch.add_ptr(notification);
+                });
+            }
+        }
+        if (!notificationBatch.entities.empty())
+            handler.notify_batch(notificationBatch);
+        if (!responseBatch.entities.empty())
+            return response_handler(std::make_shared<EncodedMessage>(responseBatch.to_json()));
+        return response_handler(nullptr);
+    }
+    return response_handler(nullptr);
+}
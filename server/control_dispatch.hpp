@@ -0,0 +1,55 @@
+/***
+    This file is part of snapcast
+    Copyright (C) 2014-2025  Johannes Pohl
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+***/
+
+#pragma once
+
+
+// local headers
+#include "control_encoding.hpp"
+#include "jsonrpcpp.hpp"
+
+// standard headers
+#include <functional>
+#include <memory>
+#include <string>
+
+
+/// Callbacks for dispatchControlMessage
+struct ControlDispatchHandler
+{
+    /// Called with the response to a request (nullptr if there is nothing to respond) and the notification for the other sessions (nullptr if there is none)
+    using OnResponse = std::function<void(jsonrpcpp::entity_ptr response, jsonrpcpp::notification_ptr notification)>;
+
+    /// Process a request and call the OnResponse callback once, possibly asynchronously
+    std::function<void(const jsonrpcpp::request_ptr& request, const OnResponse& on_response)> process;
+    /// Send the notification, caused by a single request, to the other sessions
+    std::function<void(const jsonrpcpp::Notification& notification)> notify;
+    /// Send the notifications, caused by a batch request, to the other sessions
+    std::function<void(const jsonrpcpp::Batch& notifications)> notify_batch;
+};
+
+
+/// Parse the JSON-RPC @p message, serialized with @p encoding, and pass its requests to @p handler
+/**
+ * @p response_handler is called exactly once: with the response, the parse error, or nullptr if there is
+ * nothing to respond, e.g. for notifications. For a single request it's called asynchronously, if the
+ * request is processed asynchronously.
+ * A batch is answered with one batch response. This requires the requests of a batch to be processed synchronously.
+ */
+void dispatchControlMessage(const std::string& message, ControlEncoding encoding, const ControlDispatchHandler& handler,
+                            const std::function<void(std::shared_ptr<const EncodedMessage> response)>& response_handler);
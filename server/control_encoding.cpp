@@ -0,0 +1,122 @@
+/***
+    This file is part of snapcast
+    Copyright (C) 2014-2025  Johannes Pohl
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+***/
+
+// prototype/interface header file
+#include "control_encoding.hpp"
+
+// local headers
+#include "common/utils/string_utils.hpp"
+
+// standard headers
+#include <utility>
+
+
+std::string to_string(ControlEncoding encoding)
+{
+    switch (encoding)
+    {
+        case ControlEncoding::cbor:
+            return "cbor";
+        case ControlEncoding::msgpack:
+            return "msgpack";
+        case ControlEncoding::json:
+        default:
+            return "json";
+    }
+}
+
+
+std::optional<ControlEncoding> parseControlEncoding(const std::string& name)
+{
+    std::string lower = utils::string::tolower_copy(name);
+    if (lower == "json")
+        return ControlEncoding::json;
+    if (lower == "cbor")
+        return ControlEncoding::cbor;
+    if (lower == "msgpack")
+        return ControlEncoding::msgpack;
+    return std::nullopt;
+}
+
+
+std::string encode(const nlohmann::json& json, ControlEncoding encoding)
+{
+    std::string result;
+    switch (encoding)
+    {
+        case ControlEncoding::cbor:
+            nlohmann::json::to_cbor(json, result);
+            break;
+        case ControlEncoding::msgpack:
+            nlohmann::json::to_msgpack(json, result);
+            break;
+        case ControlEncoding::json:
+        default:
+            result = json.dump();
+    }
+    return result;
+}
+
+
+nlohmann::json decode(const std::string& message, ControlEncoding encoding)
+{
+    switch (encoding)
+    {
+        case ControlEncoding::cbor:
+            return nlohmann::json::from_cbor(message);
+        case ControlEncoding::msgpack:
+            return nlohmann::json::from_msgpack(message);
+        case ControlEncoding::json:
+        default:
+            return nlohmann::json::parse(message);
+    }
+}
+
+
+EncodedMessage::EncodedMessage(nlohmann::json json) : json_(std::move(json))
+{
+}
+
+
+EncodedMessage::EncodedMessage(std::string json_text)
+{
+    encoded_[static_cast<size_t>(ControlEncoding::json)] = std::make_shared<const std::string>(std::move(json_text));
+}
+
+
+std::shared_ptr<const std::string> EncodedMessage::get(ControlEncoding encoding) const
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto& encoded = encoded_[static_cast<size_t>(encoding)];
+    if (!encoded)
+    {
+        if (!json_.has_value())
+            json_ = nlohmann::json::parse(*encoded_[static_cast<size_t>(ControlEncoding::json)]);
+        encoded = std::make_shared<const std::string>(encode(*json_, encoding));
+    }
+    return encoded;
+}
+
+
+const nlohmann::json& EncodedMessage::json() const
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (!json_.has_value())
+        json_ = nlohmann::json::parse(*encoded_[static_cast<size_t>(ControlEncoding::json)]);
+    return *json_;
+}
@@ -0,0 +1,84 @@
+/***
+    This file is part of snapcast
+    Copyright (C) 2014-2025  Johannes Pohl
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+***/
+
+#pragma once
+
+
+// local headers
+#include "common/json.hpp"
+
+// standard headers
+#include <array>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+
+
+/// Encoding of the JSON-RPC messages of a control session
+enum class ControlEncoding : std::uint8_t
+{
+    /// JSON text
+    json = 0,
+    /// CBOR (RFC 8949)
+    cbor = 1,
+    /// MessagePack
+    msgpack = 2
+};
+
+/// @return name of @p encoding, i.e. "json", "cbor" or "msgpack"
+std::string to_string(ControlEncoding encoding);
+
+/// @return encoding with name @p name (case insensitive), nullopt if unknown
+std::optional<ControlEncoding> parseControlEncoding(const std::string& name);
+
+/// @return @p json serialized with @p encoding
+std::string encode(const nlohmann::json& json, ControlEncoding encoding);
+
+/// @return @p message, serialized with @p encoding, parsed into json
+/// @throw nlohmann::json::exception if @p message is malformed
+nlohmann::json decode(const std::string& message, ControlEncoding encoding);
+
+
+/// A JSON-RPC message that is serialized lazily, at most once per encoding
+/**
+ * Notifications are sent to many sessions with different encodings: the serialized
+ * variants are cached and shared by all sessions. Thread safe.
+ */
+class EncodedMessage
+{
+public:
+    /// c'tor for the message @p json
+    explicit EncodedMessage(nlohmann::json json);
+    /// c'tor for the message, already serialized as JSON text @p json_text
+    explicit EncodedMessage(std::string json_text);
+
+    /// @return the message, serialized with @p encoding
+    std::shared_ptr<const std::string> get(ControlEncoding encoding) const;
+
+    /// @return the message as json
+    const nlohmann::json& json() const;
+
+private:
+    /// the message, parsed lazily if only the JSON text is known
+    mutable std::optional<nlohmann::json> json_;
+    /// serialized message per encoding
+    mutable std::array<std::shared_ptr<const std::string>, 3> encoded_;
+    mutable std::mutex mutex_;
+};
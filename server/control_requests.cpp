@@ -22,7 +22,9 @@
 // local headers
 #include "common/aixlog.hpp"
 #include "common/message/server_settings.hpp"
+#include "common/snap_exception.hpp"
 #include "common/utils/file_utils.hpp"
+#include "control_session.hpp"
 #include "jsonrpcpp.hpp"
 #include "server.hpp"
 #include "streamreader/pcm_stream.hpp"
@@ -53,6 +55,9 @@ static void checkParams(const jsonrpcpp::request_ptr& request, const std::vector
 
 Request::Request(const Server& server, std::string method) : server_(server), method_(std::move(method))
 {
+    auto& registry = metrics::Registry::instance();
+    requests_metric_ = registry.counter("snapserver_rpc_requests_total", "Number of handled JSON-RPC requests", {{"method", method_}});
+    duration_metric_ = registry.histogram("snapserver_rpc_duration_seconds", "Time to respond to a JSON-RPC request", {{"method", method_}});
 }
 
 bool Request::hasPermission(const AuthInfo& authinfo) const
@@ -71,8 +76,19 @@ const std::string& Request::method() const
     return method_;
 }
 
+void Request::observe(const std::chrono::steady_clock::duration& duration) const
+{
+    requests_metric_->inc();
+    duration_metric_->observe(duration);
+}
+
+void Request::execute(const jsonrpcpp::request_ptr& request, ControlSession& session, const OnResponse& on_response)
+{
+    execute(request, session.authinfo, on_response);
+}
+
 
-const StreamServer& Request::getStreamServer() const
+StreamServer& Request::getStreamServer() const
 {
     return *server_.streamServer_;
 }
@@ -87,6 +103,16 @@ const ServerSettings& Request::getSettings() const
     return server_.settings_;
 }
 
+StatusCache& Request::getStatusCache() const
+{
+    return server_.status_cache_;
+}
+
+std::pair<std::shared_ptr<const Json>, uint64_t> Request::getServerStatus() const
+{
+    return server_.getServerStatus();
+}
+
 bool Request::requiresAuthentication() const
 {
     return true;
@@ -104,6 +130,7 @@ ControlRequestFactory::ControlRequestFactory(const Server& server)
 
     // Client requests
     add_request(std::make_shared<ClientGetStatusRequest>(server));
+    add_request(std::make_shared<ClientGetStatsRequest>(server));
     add_request(std::make_shared<ClientSetVolumeRequest>(server));
     add_request(std::make_shared<ClientSetLatencyRequest>(server));
     add_request(std::make_shared<ClientSetNameRequest>(server));
@@ -124,8 +151,11 @@ ControlRequestFactory::ControlRequestFactory(const Server& server)
     // Server requests
     add_request(std::make_shared<ServerGetRpcVersionRequest>(server));
     add_request(std::make_shared<ServerGetStatusRequest>(server));
+    add_request(std::make_shared<ServerGetChangesRequest>(server));
     add_request(std::make_shared<ServerDeleteClientRequest>(server));
     add_request(std::make_shared<ServerAuthenticateRequest>(server));
+    add_request(std::make_shared<ServerSubscribeRequest>(server));
+    add_request(std::make_shared<ServerUnsubscribeRequest>(server));
     // add_request(std::make_shared<ServerGetTokenRequest>(server));
 
     // General requests
@@ -177,6 +207,7 @@ void ClientRequest::updateClient(const jsonrpcpp::request_ptr& request)
     {
         auto serverSettings = std::make_shared<msg::ServerSettings>();
         serverSettings->setBufferMs(getSettings().stream.bufferMs);
+        serverSettings->setStatsIntervalMs(static_cast<uint32_t>(getSettings().streamingclient.statsIntervalMs));
         serverSettings->setVolume(clientInfo->config.volume.percent);
         GroupPtr group = Config::instance().getGroupFromClient(clientInfo);
         serverSettings->setMuted(clientInfo->config.volume.muted || group->muted);
@@ -212,6 +243,52 @@ Request::Description ClientGetStatusRequest::description() const
 
 
 
+ClientGetStatsRequest::ClientGetStatsRequest(const Server& server) : ClientRequest(server, "Client.GetStats")
+{
+}
+
+void ClientGetStatsRequest::execute(const jsonrpcpp::request_ptr& request, AuthInfo& authinfo, const OnResponse& on_response)
+{
+    // clang-format off
+    // Request:  {"id":8,"jsonrpc":"2.0","method":"Client.GetStats","params":{"id":"00:21:6a:7d:74:fc"}}
+    // Response: {"id":8,"jsonrpc":"2.0","result":{"stats":{"bufferMs":935,"decodeUs":{"avg":112,"max":480},"deviceLatencyUs":42000,"hardSyncs":0,"intervalMs":10000,"received":{"sec":1488026416,"usec":135973},"rttUs":1250,"syncErrorUs":{"max":310,"p50":24,"p95":120,"p99":205},"underruns":0}}}
+    // clang-format on
+
+    std::ignore = authinfo;
+
+    Json result;
+    result["stats"] = nullptr;
+    session_ptr session = getStreamServer().getStreamSession(getClient(request)->id);
+    std::optional<StreamSession::ClientStats> client_stats = session ? session->getClientStats() : std::nullopt;
+    if (client_stats.has_value())
+    {
+        const auto& stats = client_stats->stats;
+        Json jstats;
+        jstats["received"]["sec"] = client_stats->received.tv_sec;
+        jstats["received"]["usec"] = client_stats->received.tv_usec;
+        jstats["intervalMs"] = stats.interval_ms;
+        jstats["syncErrorUs"] = {{"p50", stats.sync_error_p50_us}, {"p95", stats.sync_error_p95_us}, {"p99", stats.sync_error_p99_us}, {"max", stats.sync_error_max_us}};
+        jstats["hardSyncs"] = stats.hard_syncs;
+        jstats["underruns"] = stats.underruns;
+        jstats["bufferMs"] = stats.buffer_ms;
+        jstats["decodeUs"] = {{"avg", stats.decode_avg_us}, {"max", stats.decode_max_us}};
+        jstats["deviceLatencyUs"] = stats.device_latency_us;
+        jstats["rttUs"] = stats.rtt_us;
+        result["stats"] = jstats;
+    }
+    auto response = std::make_shared<jsonrpcpp::Response>(*request, result);
+    on_response(std::move(response), nullptr);
+}
+
+Request::Description ClientGetStatsRequest::description() const
+{
+    return {"Get the sync stats, periodically reported by the client",
+            {{"id", Description::Type::string, "client id"}},
+            {Description::Type::object, "Sync stats of the last interval, null if the client is not connected or doesn't report stats"}};
+}
+
+
+
 ClientSetVolumeRequest::ClientSetVolumeRequest(const Server& server) : ClientRequest(server, "Client.SetVolume")
 {
 }
@@ -229,6 +306,7 @@ void ClientSetVolumeRequest::execute(const jsonrpcpp::request_ptr& request, Auth
     std::ignore = authinfo;
     auto client_info = getClient(request);
     client_info->config.volume.fromJson(request->params().get("volume"));
+    getStatusCache().invalidate(StatusCache::Object::client, client_info->id);
     Json result;
     result["volume"] = client_info->config.volume.toJson();
 
@@ -268,6 +346,7 @@ void ClientSetLatencyRequest::execute(const jsonrpcpp::request_ptr& request, Aut
         latency = getSettings().stream.bufferMs;
     auto client_info = getClient(request);
     client_info->config.latency = latency; //, -10000, settings_.stream.bufferMs);
+    getStatusCache().invalidate(StatusCache::Object::client, client_info->id);
     Json result;
     result["latency"] = client_info->config.latency;
 
@@ -302,6 +381,7 @@ void ClientSetNameRequest::execute(const jsonrpcpp::request_ptr& request, AuthIn
     std::ignore = authinfo;
     auto client_info = getClient(request);
     client_info->config.name = request->params().get<std::string>("name");
+    getStatusCache().invalidate(StatusCache::Object::client, client_info->id);
     Json result;
     result["name"] = client_info->config.name;
 
@@ -381,6 +461,7 @@ void GroupSetNameRequest::execute(const jsonrpcpp::request_ptr& request, AuthInf
     Json result;
     auto group = getGroup(request);
     group->name = request->params().get<std::string>("name");
+    getStatusCache().invalidate(StatusCache::Object::group, group->id);
     result["name"] = group->name;
 
     auto response = std::make_shared<jsonrpcpp::Response>(*request, result);
@@ -413,6 +494,7 @@ void GroupSetMuteRequest::execute(const jsonrpcpp::request_ptr& request, AuthInf
     bool muted = request->params().get<bool>("mute");
     auto group = getGroup(request);
     group->muted = muted;
+    getStatusCache().invalidate(StatusCache::Object::group, group->id);
 
     // Update clients
     for (const auto& client : group->clients)
@@ -422,6 +504,7 @@ void GroupSetMuteRequest::execute(const jsonrpcpp::request_ptr& request, AuthInf
         {
             auto serverSettings = std::make_shared<msg::ServerSettings>();
             serverSettings->setBufferMs(getSettings().stream.bufferMs);
+            serverSettings->setStatsIntervalMs(static_cast<uint32_t>(getSettings().streamingclient.statsIntervalMs));
             serverSettings->setVolume(client->config.volume.percent);
             GroupPtr group = Config::instance().getGroupFromClient(client);
             serverSettings->setMuted(client->config.volume.muted || group->muted);
@@ -466,7 +549,8 @@ void GroupSetStreamRequest::execute(const jsonrpcpp::request_ptr& request, AuthI
         throw jsonrpcpp::InternalErrorException("Stream not found", request->id());
 
     auto group = getGroup(request);
-    group->streamId = streamId;
+    Config::instance().setStream(group, streamId);
+    getStatusCache().invalidate(StatusCache::Object::group, group->id);
 
     // Update clients
     for (const auto& client : group->clients)
@@ -515,17 +599,14 @@ void GroupSetClientsRequest::execute(const jsonrpcpp::request_ptr& request, Auth
 
     // Remove clients from group
     auto group = getGroup(request);
-    for (auto iter = group->clients.begin(); iter != group->clients.end();)
+    // iterate over a copy, moving a client modifies the group
+    auto group_clients = group->clients;
+    for (const auto& client : group_clients)
     {
-        auto client = *iter;
         if (find(clients.begin(), clients.end(), client->id) != clients.end())
-        {
-            ++iter;
             continue;
-        }
-        iter = group->clients.erase(iter);
-        GroupPtr newGroup = Config::instance().addClientInfo(client);
-        newGroup->streamId = group->streamId;
+        GroupPtr newGroup = Config::instance().moveClient(client);
+        Config::instance().setStream(newGroup, group->streamId);
     }
 
     // Add clients to group
@@ -539,13 +620,9 @@ void GroupSetClientsRequest::execute(const jsonrpcpp::request_ptr& request, Auth
         if (oldGroup && (oldGroup->id == group->id))
             continue;
 
+        Config::instance().moveClient(client, group);
         if (oldGroup)
-        {
-            oldGroup->removeClient(client);
             Config::instance().remove(oldGroup);
-        }
-
-        group->addClient(client);
 
         // assign new stream
         session_ptr session = getStreamServer().getStreamSession(client->id);
@@ -560,13 +637,15 @@ void GroupSetClientsRequest::execute(const jsonrpcpp::request_ptr& request, Auth
     if (group->empty())
         Config::instance().remove(group);
 
-    json server = Config::instance().getServerStatus(getStreamManager().toJson());
+    // groups have been created and removed
+    getStatusCache().invalidateAll();
+    auto server = getServerStatus().first;
     Json result;
-    result["server"] = server;
+    result["server"] = *server;
 
     auto response = std::make_shared<jsonrpcpp::Response>(*request, result);
     // Notify others: since at least two groups are affected, send a complete server update
-    auto notification = std::make_shared<jsonrpcpp::Notification>("Server.OnUpdate", jsonrpcpp::Parameter("server", server));
+    auto notification = std::make_shared<jsonrpcpp::Notification>("Server.OnUpdate", jsonrpcpp::Parameter("server", *server));
     on_response(std::move(response), std::move(notification));
 }
 
@@ -806,6 +885,7 @@ void StreamAddRequest::execute(const jsonrpcpp::request_ptr& request, AuthInfo&
     if (stream == nullptr)
         throw jsonrpcpp::InternalErrorException("Stream not created", request->id());
     stream->start(); // We start the stream, otherwise it would be silent
+    getStatusCache().invalidate(StatusCache::Object::stream, stream->getId());
 
     // Setup response
     Json result;
@@ -840,6 +920,8 @@ void StreamRemoveRequest::execute(const jsonrpcpp::request_ptr& request, AuthInf
     // Find stream
     std::string streamId = getStreamId(request);
     getStreamManager().removeStream(streamId);
+    getStreamServer().removeStream(streamId);
+    getStatusCache().invalidate(StatusCache::Object::stream, streamId);
 
     // Setup response
     Json result;
@@ -875,7 +957,7 @@ void ServerGetRpcVersionRequest::execute(const jsonrpcpp::request_ptr& request,
     // <major>: backwards incompatible change
     result["major"] = 23;
     // <minor>: feature addition to the API
-    result["minor"] = 0;
+    result["minor"] = 2;
     // <patch>: bugfix release
     result["patch"] = 0;
     auto response = std::make_shared<jsonrpcpp::Response>(*request, result);
@@ -897,19 +979,107 @@ void ServerGetStatusRequest::execute(const jsonrpcpp::request_ptr& request, Auth
 {
     // clang-format off
     // Request:      {"id":1,"jsonrpc":"2.0","method":"Server.GetStatus"}
-    // Response:     {"id":1,"jsonrpc":"2.0","result":{"server":{"groups":[{"clients":[{"config":{"instance":2,"latency":6,"name":"123 456","volume":{"muted":false,"percent":48}},"connected":true,"host":{"arch":"x86_64","ip":"127.0.0.1","mac":"00:21:6a:7d:74:fc","name":"T400","os":"Linux Mint 17.3 Rosa"},"id":"00:21:6a:7d:74:fc#2","lastSeen":{"sec":1488025696,"usec":578142},"snapclient":{"name":"Snapclient","protocolVersion":2,"version":"0.10.0"}},{"config":{"instance":1,"latency":0,"name":"","volume":{"muted":false,"percent":81}},"connected":true,"host":{"arch":"x86_64","ip":"192.168.0.54","mac":"00:21:6a:7d:74:fc","name":"T400","os":"Linux Mint 17.3 Rosa"},"id":"00:21:6a:7d:74:fc","lastSeen":{"sec":1488025696,"usec":611255},"snapclient":{"name":"Snapclient","protocolVersion":2,"version":"0.10.0"}}],"id":"4dcc4e3b-c699-a04b-7f0c-8260d23c43e1","muted":false,"name":"","stream_id":"stream 2"}],"server":{"host":{"arch":"x86_64","ip":"","mac":"","name":"T400","os":"Linux Mint 17.3 Rosa"},"snapserver":{"controlProtocolVersion":1,"name":"Snapserver","protocolVersion":1,"version":"0.10.0"}},"streams":[{"id":"stream 1","status":"idle","uri":{"fragment":"","host":"","path":"/tmp/snapfifo","query":{"chunk_ms":"20","codec":"flac","name":"stream 1","sampleformat":"48000:16:2"},"raw":"pipe:///tmp/snapfifo?name=stream 1","scheme":"pipe"}},{"id":"stream 2","status":"idle","uri":{"fragment":"","host":"","path":"/tmp/snapfifo","query":{"chunk_ms":"20","codec":"flac","name":"stream 2","sampleformat":"48000:16:2"},"raw":"pipe:///tmp/snapfifo?name=stream 2","scheme":"pipe"}}]}}}
+    // Response:     {"id":1,"jsonrpc":"2.0","result":{"version":42,"server":{"groups":[{"clients":[{"config":{"instance":2,"latency":6,"name":"123 456","volume":{"muted":false,"percent":48}},"connected":true,"host":{"arch":"x86_64","ip":"127.0.0.1","mac":"00:21:6a:7d:74:fc","name":"T400","os":"Linux Mint 17.3 Rosa"},"id":"00:21:6a:7d:74:fc#2","lastSeen":{"sec":1488025696,"usec":578142},"snapclient":{"name":"Snapclient","protocolVersion":2,"version":"0.10.0"}},{"config":{"instance":1,"latency":0,"name":"","volume":{"muted":false,"percent":81}},"connected":true,"host":{"arch":"x86_64","ip":"192.168.0.54","mac":"00:21:6a:7d:74:fc","name":"T400","os":"Linux Mint 17.3 Rosa"},"id":"00:21:6a:7d:74:fc","lastSeen":{"sec":1488025696,"usec":611255},"snapclient":{"name":"Snapclient","protocolVersion":2,"version":"0.10.0"}}],"id":"4dcc4e3b-c699-a04b-7f0c-8260d23c43e1","muted":false,"name":"","stream_id":"stream 2"}],"server":{"host":{"arch":"x86_64","ip":"","mac":"","name":"T400","os":"Linux Mint 17.3 Rosa"},"snapserver":{"controlProtocolVersion":1,"name":"Snapserver","protocolVersion":1,"version":"0.10.0"}},"streams":[{"id":"stream 1","status":"idle","uri":{"fragment":"","host":"","path":"/tmp/snapfifo","query":{"chunk_ms":"20","codec":"flac","name":"stream 1","sampleformat":"48000:16:2"},"raw":"pipe:///tmp/snapfifo?name=stream 1","scheme":"pipe"}},{"id":"stream 2","status":"idle","uri":{"fragment":"","host":"","path":"/tmp/snapfifo","query":{"chunk_ms":"20","codec":"flac","name":"stream 2","sampleformat":"48000:16:2"},"raw":"pipe:///tmp/snapfifo?name=stream 2","scheme":"pipe"}}]}}}
     // clang-format on
 
     std::ignore = authinfo;
+    auto [server, version] = getServerStatus();
     Json result;
-    result["server"] = Config::instance().getServerStatus(getStreamManager().toJson());
+    result["server"] = *server;
+    result["version"] = version;
     auto response = std::make_shared<jsonrpcpp::Response>(*request, result);
     on_response(std::move(response), nullptr);
 }
 
 Request::Description ServerGetStatusRequest::description() const
 {
-    return {"Get server status"};
+    return {"Get server status", {}, {Description::Type::object, "Server status and its version, to be used with Server.GetChanges"}};
+}
+
+
+
+ServerGetChangesRequest::ServerGetChangesRequest(const Server& server) : Request(server, "Server.GetChanges")
+{
+}
+
+void ServerGetChangesRequest::execute(const jsonrpcpp::request_ptr& request, AuthInfo& authinfo, const OnResponse& on_response)
+{
+    // clang-format off
+    // Request:      {"id":1,"jsonrpc":"2.0","method":"Server.GetChanges","params":{"since":42}}
+    // Response:     {"id":1,"jsonrpc":"2.0","result":{"clients":[{"config":{"instance":1,"latency":0,"name":"","volume":{"muted":false,"percent":74}},"connected":true,"host":{"arch":"x86_64","ip":"127.0.0.1","mac":"00:21:6a:7d:74:fc","name":"T400","os":"Linux Mint 17.3 Rosa"},"id":"00:21:6a:7d:74:fc","lastSeen":{"sec":1488026481,"usec":223747},"snapclient":{"name":"Snapclient","protocolVersion":2,"version":"0.10.0"}}],"full":false,"groups":[],"removed":{"clients":[],"groups":[],"streams":["stream 2"]},"streams":[],"version":44}}
+    // clang-format on
+
+    checkParams(request, {"since"});
+
+    std::ignore = authinfo;
+    auto since = request->params().get<uint64_t>("since");
+    StatusCache::Changes changes = getStatusCache().getChanges(since);
+
+    Json result;
+    result["full"] = changes.full;
+    if (changes.full)
+    {
+        // changes are not tracked that far back, fall back to the complete status
+        auto [server, version] = getServerStatus();
+        result["server"] = *server;
+        result["version"] = version;
+        auto response = std::make_shared<jsonrpcpp::Response>(*request, result);
+        on_response(std::move(response), nullptr);
+        return;
+    }
+
+    Json clients = Json::array();
+    Json streams = Json::array();
+    Json removed = {{"clients", Json::array()}, {"groups", Json::array()}, {"streams", Json::array()}};
+    // a group contains its clients, so a client change is also a group change
+    std::vector<std::string> group_ids = changes.ids[StatusCache::Object::group];
+    for (const auto& id : changes.ids[StatusCache::Object::client])
+    {
+        ClientInfoPtr client = Config::instance().getClientInfo(id);
+        if (client == nullptr)
+        {
+            removed["clients"].push_back(id);
+            continue;
+        }
+        clients.push_back(client->toJson());
+        GroupPtr group = Config::instance().getGroupFromClient(client);
+        if (group && (std::find(group_ids.begin(), group_ids.end(), group->id) == group_ids.end()))
+            group_ids.push_back(group->id);
+    }
+
+    Json groups = Json::array();
+    for (const auto& id : group_ids)
+    {
+        GroupPtr group = Config::instance().getGroup(id);
+        if (group == nullptr)
+            removed["groups"].push_back(id);
+        else
+            groups.push_back(group->toJson());
+    }
+
+    for (const auto& id : changes.ids[StatusCache::Object::stream])
+    {
+        PcmStreamPtr stream = getStreamManager().getStream(id);
+        if (stream == nullptr)
+            removed["streams"].push_back(id);
+        else
+            streams.push_back(stream->toJson());
+    }
+
+    result["version"] = changes.version;
+    result["clients"] = std::move(clients);
+    result["groups"] = std::move(groups);
+    result["streams"] = std::move(streams);
+    result["removed"] = std::move(removed);
+    auto response = std::make_shared<jsonrpcpp::Response>(*request, result);
+    on_response(std::move(response), nullptr);
+}
+
+Request::Description ServerGetChangesRequest::description() const
+{
+    return {"Get the clients, groups and streams that changed since a status version",
+            {{"since", Description::Type::number, "version returned by Server.GetStatus or Server.GetChanges"}},
+            {Description::Type::object, "Changed and removed objects, or the complete status if \"full\" is true"}};
 }
 
 
@@ -935,12 +1105,13 @@ void ServerDeleteClientRequest::execute(const jsonrpcpp::request_ptr& request, A
 
     Config::instance().remove(clientInfo);
 
-    json server = Config::instance().getServerStatus(getStreamManager().toJson());
+    getStatusCache().invalidateAll();
+    auto server = getServerStatus().first;
     Json result;
-    result["server"] = server;
+    result["server"] = *server;
 
     auto response = std::make_shared<jsonrpcpp::Response>(*request, result);
-    auto notification = std::make_shared<jsonrpcpp::Notification>("Server.OnUpdate", jsonrpcpp::Parameter("server", server));
+    auto notification = std::make_shared<jsonrpcpp::Notification>("Server.OnUpdate", jsonrpcpp::Parameter("server", *server));
     on_response(std::move(response), std::move(notification));
 }
 
@@ -996,6 +1167,78 @@ Request::Description ServerAuthenticateRequest::description() const
 
 
 
+SessionRequest::SessionRequest(const Server& server, const std::string& method) : Request(server, method)
+{
+}
+
+void SessionRequest::execute(const jsonrpcpp::request_ptr& request, AuthInfo& authinfo, const OnResponse& on_response)
+{
+    std::ignore = authinfo;
+    std::ignore = on_response;
+    throw jsonrpcpp::InternalErrorException("Request requires a control session", request->id());
+}
+
+
+
+ServerSubscribeRequest::ServerSubscribeRequest(const Server& server) : SessionRequest(server, "Server.Subscribe")
+{
+}
+
+void ServerSubscribeRequest::execute(const jsonrpcpp::request_ptr& request, ControlSession& session, const OnResponse& on_response)
+{
+    // clang-format off
+    // Request:      {"id":8,"jsonrpc":"2.0","method":"Server.Subscribe","params":{"notifications":["Group.*","Client.OnVolumeChanged"],"ids":["4dcc4e3b-c699-a04b-7f0c-8260d23c43e1","00:21:6a:7d:74:fc"]}}
+    // Response:     {"id":8,"jsonrpc":"2.0","result":{"subscriptions":[{"ids":["4dcc4e3b-c699-a04b-7f0c-8260d23c43e1","00:21:6a:7d:74:fc"],"notifications":["Group.*","Client.OnVolumeChanged"]}]}}
+    // clang-format on
+
+    try
+    {
+        session.subscriptions.add(Subscriptions::Subscription::fromJson(request->params().to_json()));
+    }
+    catch (const SnapException& e)
+    {
+        throw jsonrpcpp::InvalidParamsException(e.what(), request->id());
+    }
+
+    Json result;
+    result["subscriptions"] = session.subscriptions.toJson();
+    auto response = std::make_shared<jsonrpcpp::Response>(*request, result);
+    on_response(std::move(response), nullptr);
+}
+
+Request::Description ServerSubscribeRequest::description() const
+{
+    return {"Subscribe to notifications. Without subscriptions, all notifications are received",
+            {{"notifications", Description::Type::array, "Notification methods, '*' wildcards are supported (optional, default: all)"},
+             {"ids", Description::Type::array, "Client, group or stream ids (optional, default: all)"}},
+            {Description::Type::object, "All subscriptions of the session"}};
+}
+
+
+
+ServerUnsubscribeRequest::ServerUnsubscribeRequest(const Server& server) : SessionRequest(server, "Server.Unsubscribe")
+{
+}
+
+void ServerUnsubscribeRequest::execute(const jsonrpcpp::request_ptr& request, ControlSession& session, const OnResponse& on_response)
+{
+    // clang-format off
+    // Request:      {"id":8,"jsonrpc":"2.0","method":"Server.Unsubscribe"}
+    // Response:     {"id":8,"jsonrpc":"2.0","result":"ok"}
+    // clang-format on
+
+    session.subscriptions.clear();
+    auto response = std::make_shared<jsonrpcpp::Response>(*request, "ok");
+    on_response(std::move(response), nullptr);
+}
+
+Request::Description ServerUnsubscribeRequest::description() const
+{
+    return {"Remove all subscriptions, i.e. receive all notifications again"};
+}
+
+
+
 #if 0
 ServerGetTokenRequest::ServerGetTokenRequest(const Server& server) : Request(server, "Server.GetToken")
 {
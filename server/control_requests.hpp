@@ -23,16 +23,23 @@
 #include "authinfo.hpp"
 #include "config.hpp"
 #include "jsonrpcpp.hpp"
+#include "metrics.hpp"
+#include "status_cache.hpp"
 #include "stream_server.hpp"
 #include "streamreader/stream_manager.hpp"
 
 // 3rd party headers
 
 // standard headers
+#include <chrono>
+#include <cstdint>
 #include <functional>
+#include <memory>
 #include <string>
+#include <utility>
 #include <vector>
 
+class ControlSession;
 class Server;
 
 /// Base class of a Snapserver control request
@@ -142,6 +149,8 @@ public:
 
     /// Execute the Request
     virtual void execute(const jsonrpcpp::request_ptr& request, AuthInfo& authinfo, const OnResponse& on_response) = 0;
+    /// Execute the Request for the control @p session, by default with the session's authinfo
+    virtual void execute(const jsonrpcpp::request_ptr& request, ControlSession& session, const OnResponse& on_response);
 
     /// @return description
     virtual Description description() const = 0;
@@ -157,13 +166,20 @@ public:
     /// @return the name of the method
     const std::string& method() const;
 
+    /// Record a handled request, that took @p duration until the response
+    void observe(const std::chrono::steady_clock::duration& duration) const;
+
 protected:
     /// @return the server's stream server
-    const StreamServer& getStreamServer() const;
+    StreamServer& getStreamServer() const;
     /// @return the server's stream manager
     StreamManager& getStreamManager() const;
     /// @return server settings
     const ServerSettings& getSettings() const;
+    /// @return the server's status cache
+    StatusCache& getStatusCache() const;
+    /// @return the (cached) server status and its version
+    std::pair<std::shared_ptr<const Json>, uint64_t> getServerStatus() const;
 
 private:
     /// the server
@@ -172,6 +188,10 @@ private:
     std::string method_;
     /// the ressource
     std::string ressource_;
+    /// number of handled requests
+    std::shared_ptr<metrics::Counter> requests_metric_;
+    /// time until the response
+    std::shared_ptr<metrics::Histogram> duration_metric_;
 };
 
 
@@ -218,6 +238,17 @@ public:
 };
 
 
+/// Base for "Client.GetStats" requests
+class ClientGetStatsRequest : public ClientRequest
+{
+public:
+    /// c'tor
+    explicit ClientGetStatsRequest(const Server& server);
+    void execute(const jsonrpcpp::request_ptr& request, AuthInfo& authinfo, const OnResponse& on_response) override;
+    Description description() const override;
+};
+
+
 /// Base for "Client.SetVolume" requests
 class ClientSetVolumeRequest : public ClientRequest
 {
@@ -403,6 +434,17 @@ public:
 };
 
 
+/// "Server.GetChanges" request
+class ServerGetChangesRequest : public Request
+{
+public:
+    /// c'tor
+    explicit ServerGetChangesRequest(const Server& server);
+    void execute(const jsonrpcpp::request_ptr& request, AuthInfo& authinfo, const OnResponse& on_response) override;
+    Description description() const override;
+};
+
+
 /// "Server.DeleteClient" request
 class ServerDeleteClientRequest : public Request
 {
@@ -435,6 +477,43 @@ public:
 };
 
 
+/// Base for requests that change the state of the requesting control session
+class SessionRequest : public Request
+{
+public:
+    /// c'tor
+    SessionRequest(const Server& server, const std::string& method);
+
+    using Request::execute;
+    /// Session requests can only be executed with a control session
+    void execute(const jsonrpcpp::request_ptr& request, AuthInfo& authinfo, const OnResponse& on_response) override;
+};
+
+
+/// "Server.Subscribe" request
+class ServerSubscribeRequest : public SessionRequest
+{
+public:
+    /// c'tor
+    explicit ServerSubscribeRequest(const Server& server);
+    using SessionRequest::execute;
+    void execute(const jsonrpcpp::request_ptr& request, ControlSession& session, const OnResponse& on_response) override;
+    Description description() const override;
+};
+
+
+/// "Server.Unsubscribe" request
+class ServerUnsubscribeRequest : public SessionRequest
+{
+public:
+    /// c'tor
+    explicit ServerUnsubscribeRequest(const Server& server);
+    using SessionRequest::execute;
+    void execute(const jsonrpcpp::request_ptr& request, ControlSession& session, const OnResponse& on_response) override;
+    Description description() const override;
+};
+
+
 #if 0
 /// "Server.GetToken" request
 class ServerGetTokenRequest : public Request
@@ -32,6 +32,7 @@
 // 3rd party headers
 
 // standard headers
+#include <algorithm>
 #include <iostream>
 
 
@@ -40,14 +41,33 @@ using json = nlohmann::json;
 
 static constexpr auto LOG_TAG = "ControlServer";
 
+namespace
+{
+/// Notifications that carry the complete state of the object with the "id" parameter, i.e. only the latest one is relevant
+const std::vector<std::string> kCoalescedMethods{"Client.OnVolumeChanged", "Client.OnLatencyChanged", "Client.OnNameChanged", "Group.OnMute",
+                                                 "Group.OnStreamChanged",  "Group.OnNameChanged",     "Stream.OnProperties",  "Stream.OnUpdate"};
+
+/// @return the "id" parameter of @p notification, i.e. the client, group or stream id, or an empty string
+std::string notificationId(const jsonrpcpp::Notification& notification)
+{
+    if (!notification.params().has("id"))
+        return "";
+    auto id = notification.params().get("id");
+    return id.is_string() ? id.get<std::string>() : id.dump();
+}
+} // namespace
+
 
 ControlServer::ControlServer(boost::asio::io_context& io_context, const ServerSettings& settings, ControlMessageReceiver* controlMessageReceiver)
-    : io_context_(io_context),
+    : coalesce_timer_(io_context), io_context_(io_context),
 #ifdef HAS_OPENSSL
       ssl_context_(boost::asio::ssl::context::sslv23),
 #endif
       settings_(settings), controlMessageReceiver_(controlMessageReceiver)
 {
+    if (settings_.http.file_cache_size_kb > 0)
+        file_cache_ = std::make_shared<FileCache>(io_context_, settings_.http.file_cache_size_kb * 1024);
+
 #ifdef HAS_OPENSSL
     const ServerSettings::Ssl& ssl = settings.ssl;
     if (settings_.http.ssl_enabled)
@@ -131,16 +151,129 @@ void ControlServer::cleanup()
 }
 
 
+void ControlServer::sendToSessions(const std::shared_ptr<const EncodedMessage>& message, const ControlSession* excludeSession, const std::string& method,
+                                   const std::string& id)
+{
+    // notifications with the same method and id supersede each other, if a session's queue is full
+    const std::string key = method.empty() ? "" : method + "/" + id;
+    for (const auto& s : sessions_)
+    {
+        if (auto session = s.lock())
+        {
+            if ((session.get() != excludeSession) && (method.empty() || session->subscriptions.isSubscribed(method, id)))
+                session->sendAsync(message, key);
+        }
+    }
+}
+
+
+void ControlServer::flushPending()
+{
+    for (const auto& pending : pending_)
+        sendToSessions(pending.message, pending.exclude_session, pending.method, pending.id);
+    pending_.clear();
+}
+
+
+bool ControlServer::isSubscribed(const std::string& method, const std::string& id) const
+{
+    std::lock_guard<std::recursive_mutex> mlock(session_mutex_);
+    return std::any_of(sessions_.begin(), sessions_.end(), [&](const std::weak_ptr<ControlSession>& s)
+    {
+        auto session = s.lock();
+        return session && session->subscriptions.isSubscribed(method, id);
+    });
+}
+
+
 void ControlServer::send(const std::string& message, const ControlSession* excludeSession)
+{
+    // serialized once per encoding, shared by all sessions
+    auto shared_message = std::make_shared<const EncodedMessage>(message);
+    std::lock_guard<std::recursive_mutex> mlock(session_mutex_);
+    // keep the order of notifications
+    flushPending();
+    sendToSessions(shared_message, excludeSession);
+    cleanup();
+}
+
+
+void ControlServer::send(const jsonrpcpp::Notification& notification, const ControlSession* excludeSession)
+{
+    const std::string& method = notification.method();
+    std::string id = notificationId(notification);
+    std::lock_guard<std::recursive_mutex> mlock(session_mutex_);
+    // nobody is interested, don't even serialize it
+    if (!isSubscribed(method, id))
+        return;
+
+    auto message = std::make_shared<const EncodedMessage>(notification.to_json());
+    if ((settings_.server.notification_window_ms == 0) || id.empty() ||
+        (std::find(kCoalescedMethods.begin(), kCoalescedMethods.end(), method) == kCoalescedMethods.end()))
+    {
+        // keep the order of notifications
+        flushPending();
+        sendToSessions(message, excludeSession, method, id);
+        cleanup();
+        return;
+    }
+
+    std::string key = method + "/" + id;
+    auto iter = std::find_if(pending_.begin(), pending_.end(), [&key](const PendingNotification& pending) { return pending.key == key; });
+    if (iter != pending_.end())
+    {
+        LOG(TRACE, LOG_TAG) << "Coalescing notification " << key << "\n";
+        iter->message = std::move(message);
+        iter->exclude_session = excludeSession;
+        return;
+    }
+
+    pending_.push_back({std::move(key), method, std::move(id), std::move(message), excludeSession});
+    if (pending_.size() > 1)
+        return;
+
+    // first pending notification: open the window. This also cancels a wait whose pending notifications have already been flushed.
+    coalesce_timer_.expires_after(std::chrono::milliseconds(settings_.server.notification_window_ms));
+    coalesce_timer_.async_wait([this](const boost::system::error_code& ec)
+    {
+        if (ec)
+            return;
+        std::lock_guard<std::recursive_mutex> mlock(session_mutex_);
+        flushPending();
+        cleanup();
+    });
+}
+
+
+void ControlServer::send(const jsonrpcpp::Batch& batch, const ControlSession* excludeSession)
 {
     std::lock_guard<std::recursive_mutex> mlock(session_mutex_);
+    flushPending();
+    // the complete batch is serialized once per encoding for all sessions without subscriptions
+    std::shared_ptr<const EncodedMessage> message;
     for (const auto& s : sessions_)
     {
-        if (auto session = s.lock())
+        auto session = s.lock();
+        if (!session || (session.get() == excludeSession))
+            continue;
+
+        if (session->subscriptions.empty())
+        {
+            if (!message)
+                message = std::make_shared<const EncodedMessage>(batch.to_json());
+            session->sendAsync(message, "");
+            continue;
+        }
+
+        jsonrpcpp::Batch filtered;
+        for (const auto& entity : batch.entities)
         {
-            if (session.get() != excludeSession)
-                session->sendAsync(message);
+            auto notification = std::dynamic_pointer_cast<jsonrpcpp::Notification>(entity);
+            if (!notification || session->subscriptions.isSubscribed(notification->method(), notificationId(*notification)))
+                filtered.add_ptr(entity);
         }
+        if (!filtered.entities.empty())
+            session->sendAsync(std::make_shared<const EncodedMessage>(filtered.to_json()), "");
     }
     cleanup();
 }
@@ -170,6 +303,14 @@ void ControlServer::onNewSession(std::shared_ptr<StreamSession> session)
 }
 
 
+uint64_t ControlServer::getStatusVersion() const
+{
+    if (controlMessageReceiver_ != nullptr)
+        return controlMessageReceiver_->getStatusVersion();
+    return 0;
+}
+
+
 void ControlServer::startAccept()
 {
     auto accept_handler = [this](error_code ec, tcp::socket socket)
@@ -192,13 +333,13 @@ void ControlServer::startAccept()
             }
             else if (port == settings_.http.port)
             {
-                auto session = make_shared<ControlSessionHttp>(this, std::move(socket), settings_);
+                auto session = make_shared<ControlSessionHttp>(this, std::move(socket), settings_, file_cache_);
                 onNewSession(std::move(session));
             }
 #ifdef HAS_OPENSSL
             else if (port == settings_.http.ssl_port)
             {
-                auto session = make_shared<ControlSessionHttp>(this, ssl_socket(std::move(socket), ssl_context_), settings_);
+                auto session = make_shared<ControlSessionHttp>(this, ssl_socket(std::move(socket), ssl_context_), settings_, file_cache_);
                 onNewSession(std::move(session));
             }
 #endif
@@ -285,6 +426,8 @@ void ControlServer::stop()
     acceptor_.clear();
 
     std::lock_guard<std::recursive_mutex> mlock(session_mutex_);
+    coalesce_timer_.cancel();
+    pending_.clear();
     cleanup();
     for (const auto& s : sessions_)
     {
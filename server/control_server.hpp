@@ -20,11 +20,14 @@
 
 // local headers
 #include "control_session.hpp"
+#include "file_cache.hpp"
+#include "jsonrpcpp.hpp"
 #include "server_settings.hpp"
 
 // 3rd party headers
 #include <boost/asio/io_context.hpp>
 #include <boost/asio/ip/tcp.hpp>
+#include <boost/asio/steady_timer.hpp>
 #ifdef HAS_OPENSSL
 #include <boost/asio/ssl.hpp>
 #endif
@@ -32,6 +35,7 @@
 // standard headers
 #include <memory>
 #include <mutex>
+#include <string>
 #include <vector>
 
 
@@ -55,21 +59,56 @@ public:
     /// Stop accepting connections and stop all running sessions
     void stop();
 
-    /// Send a message to all connected clients
+    /// Send the JSON @p message to all connected clients
     void send(const std::string& message, const ControlSession* excludeSession = nullptr);
+    /// Send a notification to all connected clients that subscribed to it
+    /// Bursts of state notifications with the same method and id are coalesced within the configured window, so that only the latest is sent
+    void send(const jsonrpcpp::Notification& notification, const ControlSession* excludeSession = nullptr);
+    /// Send the notifications of @p batch to all connected clients, filtered by their subscriptions
+    void send(const jsonrpcpp::Batch& batch, const ControlSession* excludeSession = nullptr);
+
+    /// @return if any connected client subscribed to notification @p method for object @p id (empty for notifications without id)
+    bool isSubscribed(const std::string& method, const std::string& id = "") const;
 
 private:
+    /// A coalesced notification, waiting for the window to expire
+    struct PendingNotification
+    {
+        /// method and id of the notification
+        std::string key;
+        /// the notification method
+        std::string method;
+        /// the notification's object id
+        std::string id;
+        /// the notification, serialized lazily per encoding
+        std::shared_ptr<const EncodedMessage> message;
+        /// the session that caused the notification
+        const ControlSession* exclude_session;
+    };
+
     void startAccept();
 
     void cleanup();
 
+    /// Send @p message to all sessions, except @p excludeSession. session_mutex_ must be locked.
+    /// If @p method is not empty, only to sessions that subscribed to notification @p method for object @p id
+    void sendToSessions(const std::shared_ptr<const EncodedMessage>& message, const ControlSession* excludeSession, const std::string& method = "",
+                        const std::string& id = "");
+    /// Send the pending notifications. session_mutex_ must be locked.
+    void flushPending();
+
     /// Implementation of ControlMessageReceiver
     void onMessageReceived(std::shared_ptr<ControlSession> session, const std::string& message, const ResponseHandler& response_handler) override;
     void onNewSession(std::shared_ptr<ControlSession> session) override;
     void onNewSession(std::shared_ptr<StreamSession> session) override;
+    uint64_t getStatusVersion() const override;
 
     mutable std::recursive_mutex session_mutex_;
     std::vector<std::weak_ptr<ControlSession>> sessions_;
+    /// coalesced notifications, in order of their first occurrence
+    std::vector<PendingNotification> pending_;
+    /// fires when the coalescing window is over
+    boost::asio::steady_timer coalesce_timer_;
 
     std::vector<acceptor_ptr> acceptor_;
 
@@ -78,5 +117,7 @@ private:
     boost::asio::ssl::context ssl_context_;
 #endif
     ServerSettings settings_;
+    /// in-memory cache of the HTTP doc root, nullptr if disabled
+    std::shared_ptr<FileCache> file_cache_;
     ControlMessageReceiver* controlMessageReceiver_;
 };
@@ -0,0 +1,69 @@
+/***
+    This file is part of snapcast
+    Copyright (C) 2014-2025  Johannes Pohl
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+***/
+
+// prototype/interface header file
+#include "control_session.hpp"
+
+// local headers
+#include "common/aixlog.hpp"
+
+// standard headers
+#include <algorithm>
+#include <iterator>
+#include <map>
+
+
+static constexpr auto LOG_TAG = "ControlSession";
+
+
+bool ControlSession::enqueue(std::shared_ptr<const std::string> message, ControlEncoding encoding, std::optional<std::string> notification)
+{
+    messages_.push_back({std::move(message), encoding, std::move(notification)});
+    if (messages_.size() == 1)
+        return true;
+
+    if ((max_queue_size_ == 0) || (messages_.size() <= max_queue_size_ + 1))
+        return false;
+
+    // the front message is being written, drop a notification behind it: the oldest one that is superseded by a later one
+    // with the same method and id, or else the oldest one
+    std::map<std::string, size_t> count;
+    for (auto iter = std::next(messages_.begin()); iter != messages_.end(); ++iter)
+    {
+        if (iter->notification.has_value() && !iter->notification->empty())
+            ++count[*iter->notification];
+    }
+    auto superseded = std::find_if(std::next(messages_.begin()), messages_.end(), [&count](const OutboundMessage& message)
+    { return message.notification.has_value() && !message.notification->empty() && (count[*message.notification] > 1); });
+    auto drop = (superseded != messages_.end())
+                    ? superseded
+                    : std::find_if(std::next(messages_.begin()), messages_.end(), [](const OutboundMessage& message) { return message.notification.has_value(); });
+    if (drop == messages_.end())
+    {
+        LOG(ERROR, LOG_TAG) << "Outbound queue full (" << max_queue_size_ << " messages) with responses, closing the session\n";
+        stop();
+        return false;
+    }
+
+    messages_.erase(drop);
+    ++dropped_;
+    // log the first dropped message, and then every 100th
+    if (dropped_ % 100 == 1)
+        LOG(WARNING, LOG_TAG) << "Outbound queue full (" << max_queue_size_ << " messages), dropped " << dropped_ << " notification(s) in total\n";
+    return false;
+}
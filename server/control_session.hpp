@@ -20,13 +20,19 @@
 
 // local headers
 #include "authinfo.hpp"
+#include "control_encoding.hpp"
 #include "server_settings.hpp"
+#include "subscriptions.hpp"
 
 // 3rd party headers
 
 // standard headers
+#include <atomic>
+#include <cstdint>
+#include <deque>
 #include <functional>
 #include <memory>
+#include <optional>
 #include <string>
 
 
@@ -37,15 +43,21 @@ class StreamSession;
 class ControlMessageReceiver
 {
 public:
-    /// Response callback function for requests
-    using ResponseHandler = std::function<void(const std::string& response)>;
+    /// Response callback function for requests, the response is nullptr if there is nothing to respond
+    using ResponseHandler = std::function<void(std::shared_ptr<const EncodedMessage> response)>;
     // TODO: rename, error handling
     /// Called when a comtrol message @p message is received by @p session, response is written to @p response_handler
+    /// @p message is serialized with the session's encoding, see ControlSession::encoding
     virtual void onMessageReceived(std::shared_ptr<ControlSession> session, const std::string& message, const ResponseHandler& response_handler) = 0;
     /// Called when a comtrol session is created
     virtual void onNewSession(std::shared_ptr<ControlSession> session) = 0;
     /// Called when a stream session is created
     virtual void onNewSession(std::shared_ptr<StreamSession> session) = 0;
+    /// @return the version of the server status, used as ETag for "Server.GetStatus" requests, 0 = unknown
+    virtual uint64_t getStatusVersion() const
+    {
+        return 0;
+    }
 };
 
 
@@ -59,7 +71,8 @@ class ControlSession : public std::enable_shared_from_this<ControlSession>
 {
 public:
     /// ctor. Received message from the client are passed to ControlMessageReceiver
-    ControlSession(ControlMessageReceiver* receiver, const ServerSettings& settings) : authinfo(settings.auth), message_receiver_(receiver)
+    ControlSession(ControlMessageReceiver* receiver, const ServerSettings& settings)
+        : authinfo(settings.auth), message_receiver_(receiver), max_queue_size_(settings.server.control_queue_size)
     {
     }
     virtual ~ControlSession() = default;
@@ -68,13 +81,53 @@ public:
     /// Stop the control session
     virtual void stop() = 0;
 
-    /// Sends a message to the client (asynchronous)
-    virtual void sendAsync(const std::string& message) = 0;
+    /// Sends a message to the client (asynchronous), serialized with the session's encoding
+    /// The message is shared with other sessions, so that it's serialized only once per encoding
+    /// @param notification nullopt for responses, which are never dropped. For notifications their "method/id", or empty if
+    ///        there is none: notifications might be dropped if the client doesn't keep up, see enqueue
+    virtual void sendAsync(std::shared_ptr<const EncodedMessage> message, std::optional<std::string> notification) = 0;
+
+    /// @return the encoding of the received requests and of the responses
+    ControlEncoding encoding() const
+    {
+        return encoding_.load();
+    }
 
     /// Authentication info attached to this session
     AuthInfo authinfo;
+    /// Notifications subscribed by this session
+    Subscriptions subscriptions;
 
 protected:
+    /// A serialized outbound message
+    struct OutboundMessage
+    {
+        /// the message, shared with other sessions, must not be modified
+        std::shared_ptr<const std::string> data;
+        /// encoding of the message, defines how it is framed on the wire
+        ControlEncoding encoding;
+        /// "method/id" of a notification, nullopt for anything that must not be dropped
+        std::optional<std::string> notification;
+    };
+
+    /// Append @p message, serialized with @p encoding, to the outbound queue.
+    /// If the queue is full, a notification is dropped: preferably the oldest one that is superseded by a later one with the
+    /// same @p notification key, otherwise the oldest one. Responses are never dropped: if the queue is full of them, the session
+    /// is stopped.
+    /// @param notification see sendAsync
+    /// @return true if the queue was empty, i.e. the caller must start writing
+    bool enqueue(std::shared_ptr<const std::string> message, ControlEncoding encoding, std::optional<std::string> notification = std::nullopt);
+
     /// The control message receiver
     ControlMessageReceiver* message_receiver_;
+    /// Outbound messages, the front message is being written
+    std::deque<OutboundMessage> messages_;
+    /// Encoding of the received requests and of the responses
+    std::atomic<ControlEncoding> encoding_{ControlEncoding::json};
+
+private:
+    /// Max number of queued messages, 0 = unlimited
+    size_t max_queue_size_;
+    /// Number of dropped messages
+    size_t dropped_{0};
 };
@@ -21,9 +21,13 @@
 
 // local headers
 #include "common/aixlog.hpp"
+#include "common/json.hpp"
 #include "common/utils/file_utils.hpp"
+#include "common/utils/string_utils.hpp"
+#include "control_encoding.hpp"
 #include "control_session_ws.hpp"
 #include "image_cache.hpp"
+#include "metrics.hpp"
 #include "stream_session_ws.hpp"
 
 // 3rd party headers
@@ -34,11 +38,16 @@
 #endif
 
 // standard headers
+#include <cstdlib>
 #include <iostream>
 #include <memory>
+#include <optional>
+#include <string_view>
+#include <utility>
 
 
 using namespace std;
+using json = nlohmann::json;
 namespace websocket = beast::websocket; // from <boost/beast/websocket.hpp>
 
 static constexpr auto LOG_TAG = "ControlSessionHTTP";
@@ -80,6 +89,120 @@ static constexpr const char* UNCONFIGURED =
 
 namespace
 {
+/// Response body that serves a shared buffer (e.g. a cached image or file) without copying it
+/// The body keeps a reference to the shared buffer for the lifetime of the response
+struct SharedBufferBody
+{
+    /// the shared buffer
+    using value_type = std::shared_ptr<const std::string>;
+
+    /// @return size of the buffer, used for "Content-Length"
+    static std::uint64_t size(const value_type& body)
+    {
+        return body ? body->size() : 0;
+    }
+
+    /// Serializes the buffer as one chunk
+    class writer
+    {
+    public:
+        /// buffer type
+        using const_buffers_type = boost::asio::const_buffer;
+
+        /// c'tor
+        template <bool isRequest, class Fields>
+        writer(const http::header<isRequest, Fields>& /*header*/, const value_type& body) : body_(body)
+        {
+        }
+
+        /// initialize the writer
+        void init(beast::error_code& ec)
+        {
+            ec = {};
+        }
+
+        /// @return the complete buffer
+        boost::optional<std::pair<const_buffers_type, bool>> get(beast::error_code& ec)
+        {
+            ec = {};
+            if (!body_)
+                return boost::none;
+            return {{boost::asio::buffer(*body_), false}};
+        }
+
+    private:
+        const value_type& body_;
+    };
+};
+
+
+/// @return HTTP content type of JSON-RPC messages with @p encoding
+std::string contentType(ControlEncoding encoding)
+{
+    switch (encoding)
+    {
+        case ControlEncoding::cbor:
+            return "application/cbor";
+        case ControlEncoding::msgpack:
+            return "application/msgpack";
+        case ControlEncoding::json:
+        default:
+            return "application/json";
+    }
+}
+
+
+/// @return encoding of a JSON-RPC request with HTTP content type @p content_type, JSON if unknown
+ControlEncoding contentEncoding(boost::beast::string_view content_type)
+{
+    std::string params;
+    std::string type = utils::string::split_left(std::string(content_type), ';', params);
+    utils::string::trim(utils::string::tolower(type));
+    if (type == "application/cbor")
+        return ControlEncoding::cbor;
+    if ((type == "application/msgpack") || (type == "application/x-msgpack"))
+        return ControlEncoding::msgpack;
+    return ControlEncoding::json;
+}
+
+
+/// @return the first of the websocket subprotocols @p protocols (e.g. "snapcast.cbor, snapcast.json") that names an encoding
+std::optional<std::pair<std::string, ControlEncoding>> negotiateEncoding(boost::beast::string_view protocols)
+{
+    static constexpr std::string_view prefix = "snapcast.";
+    for (auto protocol : utils::string::split(std::string(protocols), ','))
+    {
+        utils::string::trim(protocol);
+        if (protocol.rfind(prefix, 0) != 0)
+            continue;
+        auto encoding = parseControlEncoding(protocol.substr(prefix.size()));
+        if (encoding.has_value())
+            return std::make_pair(protocol, encoding.value());
+    }
+    return std::nullopt;
+}
+
+
+/// @return true if the "Accept-Encoding" header value @p accept_encoding accepts gzip
+bool acceptsGzip(const std::string& accept_encoding)
+{
+    for (const auto& coding : utils::string::split(accept_encoding, ','))
+    {
+        std::string params;
+        std::string name = utils::string::split_left(coding, ';', params);
+        utils::string::trim(name);
+        if ((utils::string::tolower(name) != "gzip") && (name != "*"))
+            continue;
+        // "gzip;q=0" explicitly rejects gzip
+        auto q = utils::string::trim_copy(params);
+        if ((q.rfind("q=", 0) == 0) && (std::strtod(q.c_str() + 2, nullptr) <= 0.))
+            return false;
+        return true;
+    }
+    return false;
+}
+
+
 // Return a reasonable mime type based on the extension of a file.
 boost::beast::string_view mime_type(boost::beast::string_view path)
 {
@@ -152,15 +275,17 @@ std::string path_cat(boost::beast::string_view base, boost::beast::string_view p
 } // namespace
 
 #ifdef HAS_OPENSSL
-ControlSessionHttp::ControlSessionHttp(ControlMessageReceiver* receiver, ssl_socket&& socket, const ServerSettings& settings)
-    : ControlSession(receiver, settings), ssl_socket_(std::move(socket)), settings_(settings), is_ssl_(true)
+ControlSessionHttp::ControlSessionHttp(ControlMessageReceiver* receiver, ssl_socket&& socket, const ServerSettings& settings,
+                                       std::shared_ptr<FileCache> file_cache)
+    : ControlSession(receiver, settings), ssl_socket_(std::move(socket)), settings_(settings), file_cache_(std::move(file_cache)), is_ssl_(true)
 {
     LOG(DEBUG, LOG_TAG) << "ControlSessionHttp, mode: ssl, Local IP: " << ssl_socket_->next_layer().local_endpoint().address().to_string() << "\n";
 }
 #endif
 
-ControlSessionHttp::ControlSessionHttp(ControlMessageReceiver* receiver, tcp_socket&& socket, const ServerSettings& settings)
-    : ControlSession(receiver, settings), tcp_socket_(std::move(socket)), settings_(settings), is_ssl_(false)
+ControlSessionHttp::ControlSessionHttp(ControlMessageReceiver* receiver, tcp_socket&& socket, const ServerSettings& settings,
+                                       std::shared_ptr<FileCache> file_cache)
+    : ControlSession(receiver, settings), tcp_socket_(std::move(socket)), settings_(settings), file_cache_(std::move(file_cache)), is_ssl_(false)
 {
     LOG(DEBUG, LOG_TAG) << "ControlSessionHttp, mode: tcp, Local IP: " << tcp_socket_->local_endpoint().address().to_string() << "\n";
 }
@@ -269,13 +394,49 @@ void ControlSessionHttp::handle_request(http::request<Body, http::basic_fields<A
             return send(bad_request("Illegal request-target"));
 
         std::string request = req.body();
-        return message_receiver_->onMessageReceived(shared_from_this(), request, [req = std::move(req), send = std::move(send)](const std::string& response)
+        // binary encoded requests are answered with the same encoding
+        auto encoding = contentEncoding(req[http::field::content_type]);
+        encoding_ = encoding;
+        // "Server.GetStatus" is versioned: tag the response with the status version, so that polling
+        // clients can send "If-None-Match" and get a "412 Precondition Failed" as long as nothing changed.
+        // "304 Not Modified" is reserved for GET and HEAD (RFC 9110, 13.1.2), this is a POST
+        uint64_t status_version = 0;
+        json jrequest;
+        try
+        {
+            jrequest = decode(request, encoding);
+        }
+        catch (const json::exception&)
+        {
+            // the message receiver responds with a parse error
+        }
+        if (jrequest.is_object() && (jrequest.value("method", "") == "Server.GetStatus"))
+            status_version = message_receiver_->getStatusVersion();
+
+        return message_receiver_->onMessageReceived(
+            shared_from_this(), request,
+            [this, req = std::move(req), send = std::move(send), status_version, encoding](std::shared_ptr<const EncodedMessage> response)
         {
-            http::response<http::string_body> res{http::status::ok, req.version()};
+            bool tagged = (status_version != 0) && response && !response->json().contains("error") && (message_receiver_->getStatusVersion() == status_version);
+            // the version contains the server's epoch, ETags of a previous server instance never match
+            std::string etag = "\"" + std::to_string(status_version) + "\"";
+            if (tagged && (req[http::field::if_none_match] == etag))
+            {
+                http::response<http::empty_body> res{http::status::precondition_failed, req.version()};
+                res.set(http::field::server, HTTP_SERVER_NAME);
+                res.set(http::field::etag, etag);
+                res.keep_alive(req.keep_alive());
+                return send(std::move(res));
+            }
+
+            http::response<SharedBufferBody> res{http::status::ok, req.version()};
             res.set(http::field::server, HTTP_SERVER_NAME);
-            res.set(http::field::content_type, "application/json");
+            res.set(http::field::content_type, contentType(encoding));
+            if (tagged)
+                res.set(http::field::etag, etag);
             res.keep_alive(req.keep_alive());
-            res.body() = response;
+            if (response)
+                res.body() = response->get(encoding);
             res.prepare_payload();
             return send(std::move(res));
         });
@@ -286,6 +447,20 @@ void ControlSessionHttp::handle_request(http::request<Body, http::basic_fields<A
     if (target.empty() || target[0] != '/' || target.find("..") != beast::string_view::npos)
         return send(bad_request("Illegal request-target"));
 
+    if (settings_.http.metrics && (target == "/metrics"))
+    {
+        http::response<http::string_body> res{http::status::ok, req.version()};
+        res.set(http::field::server, HTTP_SERVER_NAME);
+        res.set(http::field::content_type, "text/plain; version=0.0.4; charset=utf-8");
+        res.set(http::field::cache_control, "no-cache");
+        res.keep_alive(req.keep_alive());
+        res.body() = metrics::Registry::instance().serialize();
+        res.prepare_payload();
+        if (req.method() == http::verb::head)
+            res.body().clear();
+        return send(std::move(res));
+    }
+
     static const string image_cache_target = "/__image_cache?name=";
     auto pos = target.find(image_cache_target);
     if (pos != std::string::npos)
@@ -293,18 +468,28 @@ void ControlSessionHttp::handle_request(http::request<Body, http::basic_fields<A
         pos += image_cache_target.size();
         target = target.substr(pos);
         auto image = ImageCache::instance().getImage(std::string(target));
-        LOG(DEBUG, LOG_TAG) << "image cache: " << target << ", found: " << image.has_value() << "\n";
-        if (image.has_value())
+        LOG(DEBUG, LOG_TAG) << "image cache: " << target << ", found: " << (image != nullptr) << "\n";
+        if (image)
         {
-            http::response<http::buffer_body> res{http::status::ok, req.version()};
-            res.body().data = image.value().data();
-            const auto size = image.value().size();
-            res.body().size = size;
-            res.body().more = false;
+            // the url is derived from the image's content, i.e. the image behind a url never changes
+            std::string etag = "\"" + image->etag + "\"";
+            if (req[http::field::if_none_match] == etag)
+            {
+                http::response<http::empty_body> res{http::status::not_modified, req.version()};
+                res.set(http::field::server, HTTP_SERVER_NAME);
+                res.set(http::field::etag, etag);
+                res.keep_alive(req.keep_alive());
+                return send(std::move(res));
+            }
+
+            http::response<SharedBufferBody> res{http::status::ok, req.version()};
             res.set(http::field::server, HTTP_SERVER_NAME);
             res.set(http::field::content_type, mime_type(target));
-            res.content_length(size);
+            res.set(http::field::etag, etag);
+            res.set(http::field::cache_control, "public, max-age=31536000, immutable");
             res.keep_alive(req.keep_alive());
+            res.body() = std::shared_ptr<const std::string>(image, &image->data);
+            res.prepare_payload();
             return send(std::move(res));
         }
         return send(not_found(req.target()));
@@ -325,6 +510,56 @@ void ControlSessionHttp::handle_request(http::request<Body, http::basic_fields<A
     }
 
     LOG(DEBUG, LOG_TAG) << "path: " << path << "\n";
+    // Serve from the in-memory cache, if enabled
+    if (file_cache_)
+    {
+        auto file = file_cache_->get(path);
+        if (!file)
+            return send(not_found(req.target()));
+
+        bool gzip = file->gzip && acceptsGzip(std::string(req[http::field::accept_encoding]));
+        const auto& etag = gzip ? file->gzip_etag : file->etag;
+        const auto& data = gzip ? file->gzip : file->data;
+        auto set_headers = [&](auto& res)
+        {
+            res.set(http::field::server, HTTP_SERVER_NAME);
+            res.set(http::field::etag, etag);
+            // files in the doc root might change: cache, but always revalidate
+            res.set(http::field::cache_control, "no-cache");
+            if (file->gzip)
+                res.set(http::field::vary, "Accept-Encoding");
+            res.keep_alive(req.keep_alive());
+        };
+
+        if (req[http::field::if_none_match] == etag)
+        {
+            http::response<http::empty_body> res{http::status::not_modified, req.version()};
+            set_headers(res);
+            return send(std::move(res));
+        }
+
+        auto set_content_headers = [&](auto& res)
+        {
+            set_headers(res);
+            res.set(http::field::content_type, mime_type(path));
+            if (gzip)
+                res.set(http::field::content_encoding, "gzip");
+            res.content_length(data->size());
+        };
+
+        if (req.method() == http::verb::head)
+        {
+            http::response<http::empty_body> res{http::status::ok, req.version()};
+            set_content_headers(res);
+            return send(std::move(res));
+        }
+
+        http::response<SharedBufferBody> res{http::status::ok, req.version()};
+        set_content_headers(res);
+        res.body() = data;
+        return send(std::move(res));
+    }
+
     // Attempt to open the file
     beast::error_code ec;
     http::file_body::value_type body;
@@ -401,13 +636,24 @@ void ControlSessionHttp::on_read(beast::error_code ec, std::size_t bytes_transfe
         LOG(DEBUG, LOG_TAG) << "websocket upgrade, target: " << req_.target() << "\n";
         if ((req_.target() == "/jsonrpc") || (req_.target() == "/stream"))
         {
+            // control clients negotiate the message encoding as websocket subprotocol
+            std::optional<std::pair<std::string, ControlEncoding>> protocol;
+            if (req_.target() == "/jsonrpc")
+                protocol = negotiateEncoding(req_[http::field::sec_websocket_protocol]);
+            auto encoding = protocol.has_value() ? protocol->second : ControlEncoding::json;
+            auto decorator = websocket::stream_base::decorator([protocol](websocket::response_type& res)
+            {
+                if (protocol.has_value())
+                    res.set(http::field::sec_websocket_protocol, protocol->first);
+            });
 #ifdef HAS_OPENSSL
             if (is_ssl_)
             {
                 // Create a WebSocket session by transferring the socket
                 auto ws = std::make_shared<websocket::stream<ssl_socket>>(std::move(*ssl_socket_));
+                ws->set_option(std::move(decorator));
                 // Accept the websocket handshake
-                ws->async_accept(req_, [this, ws, self = shared_from_this()](beast::error_code ec) mutable
+                ws->async_accept(req_, [this, ws, self = shared_from_this(), encoding](beast::error_code ec) mutable
                 {
                     if (ec)
                     {
@@ -417,7 +663,7 @@ void ControlSessionHttp::on_read(beast::error_code ec, std::size_t bytes_transfe
                     {
                         if (req_.target() == "/jsonrpc")
                         {
-                            auto ws_session = make_shared<ControlSessionWebsocket>(message_receiver_, std::move(*ws), settings_);
+                            auto ws_session = make_shared<ControlSessionWebsocket>(message_receiver_, std::move(*ws), settings_, encoding);
                             message_receiver_->onNewSession(std::move(ws_session));
                         }
                         else // if (req_.target() == "/stream")
@@ -433,8 +679,9 @@ void ControlSessionHttp::on_read(beast::error_code ec, std::size_t bytes_transfe
             {
                 // Create a WebSocket session by transferring the socket
                 auto ws = std::make_shared<websocket::stream<tcp_socket>>(std::move(*tcp_socket_));
+                ws->set_option(std::move(decorator));
                 // Accept the websocket handshake
-                ws->async_accept(req_, [this, ws, self = shared_from_this()](beast::error_code ec) mutable
+                ws->async_accept(req_, [this, ws, self = shared_from_this(), encoding](beast::error_code ec) mutable
                 {
                     if (ec)
                     {
@@ -444,7 +691,7 @@ void ControlSessionHttp::on_read(beast::error_code ec, std::size_t bytes_transfe
                     {
                         if (req_.target() == "/jsonrpc")
                         {
-                            auto ws_session = make_shared<ControlSessionWebsocket>(message_receiver_, std::move(*ws), settings_);
+                            auto ws_session = make_shared<ControlSessionWebsocket>(message_receiver_, std::move(*ws), settings_, encoding);
                             message_receiver_->onNewSession(std::move(ws_session));
                         }
                         else // if (req_.target() == "/stream")
@@ -552,6 +799,6 @@ void ControlSessionHttp::stop()
 }
 
 
-void ControlSessionHttp::sendAsync(const std::string& /*message*/)
+void ControlSessionHttp::sendAsync(std::shared_ptr<const EncodedMessage> /*message*/, std::optional<std::string> /*notification*/)
 {
 }
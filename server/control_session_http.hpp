@@ -21,6 +21,7 @@
 
 // local headers
 #include "control_session.hpp"
+#include "file_cache.hpp"
 #include "server_settings.hpp"
 
 // 3rd party headers
@@ -33,7 +34,7 @@
 #endif
 
 // standard headers
-#include <deque>
+#include <memory>
 #include <optional>
 
 namespace beast = boost::beast; // from <boost/beast.hpp>
@@ -53,16 +54,17 @@ class ControlSessionHttp : public ControlSession
 public:
 #ifdef HAS_OPENSSL
     /// c'tor for ssl sockets. Received message from the client are passed to ControlMessageReceiver
-    ControlSessionHttp(ControlMessageReceiver* receiver, ssl_socket&& socket, const ServerSettings& settings);
+    /// Static files are served from @p file_cache, if not nullptr
+    ControlSessionHttp(ControlMessageReceiver* receiver, ssl_socket&& socket, const ServerSettings& settings, std::shared_ptr<FileCache> file_cache = nullptr);
 #endif
     /// c'tor for tcp sockets
-    ControlSessionHttp(ControlMessageReceiver* receiver, tcp_socket&& socket, const ServerSettings& settings);
+    ControlSessionHttp(ControlMessageReceiver* receiver, tcp_socket&& socket, const ServerSettings& settings, std::shared_ptr<FileCache> file_cache = nullptr);
     ~ControlSessionHttp() override;
     void start() override;
     void stop() override;
 
     /// Sends a message to the client (asynchronous)
-    void sendAsync(const std::string& message) override;
+    void sendAsync(std::shared_ptr<const EncodedMessage> message, std::optional<std::string> notification) override;
 
 private:
     /// HTTP on read callback
@@ -81,6 +83,7 @@ private:
 #endif
     beast::flat_buffer buffer_;
     ServerSettings settings_;
-    std::deque<std::string> messages_;
+    /// in-memory cache of the doc root, nullptr if disabled
+    std::shared_ptr<FileCache> file_cache_;
     bool is_ssl_;
 };
@@ -21,18 +21,31 @@
 #include "control_session_tcp.hpp"
 
 // 3rd party headers
+#include <boost/asio/read.hpp>
 #include <boost/asio/read_until.hpp>
 #include <boost/asio/write.hpp>
 
 // local headers
 #include "common/aixlog.hpp"
+#include "common/utils/string_utils.hpp"
 #include "server_settings.hpp"
 
+// standard headers
+#include <array>
+#include <string_view>
+
 
 using namespace std;
 
 static constexpr auto LOG_TAG = "ControlSessionTCP";
 
+/// Line to request (and acknowledge) a binary encoding, followed by the encoding's name
+static constexpr std::string_view kEncodingHandshake = "Encoding:";
+/// Size of the size prefix of binary messages
+static constexpr size_t kFrameHeaderSize = 4;
+/// Max size of a binary message
+static constexpr size_t kMaxFrameSize = 16 * 1024 * 1024;
+
 // https://stackoverflow.com/questions/7754695/boost-asio-async-write-how-to-not-interleaving-async-write-calls/7756894
 
 
@@ -68,17 +81,82 @@ void ControlSessionTcp::do_read()
             if (line.back() == '\r')
                 line.resize(line.size() - 1);
             // LOG(DEBUG, LOG_TAG) << "received: " << line << "\n";
-            if ((message_receiver_ != nullptr) && !line.empty())
-            {
-                message_receiver_->onMessageReceived(shared_from_this(), line, [this](const std::string& response)
-                {
-                    if (!response.empty())
-                        sendAsync(response);
-                });
-            }
+            if (line.rfind(kEncodingHandshake, 0) == 0)
+                set_encoding(line.substr(kEncodingHandshake.size()));
+            else if (!line.empty())
+                on_message(line);
         }
         streambuf_.consume(bytes_transferred);
-        do_read();
+        if (encoding_ == ControlEncoding::json)
+            do_read();
+        else
+            do_read_frame();
+    });
+}
+
+
+void ControlSessionTcp::do_read_frame()
+{
+    // the stream buffer might already contain complete messages, received together with the handshake
+    size_t needed = kFrameHeaderSize;
+    while (streambuf_.size() >= kFrameHeaderSize)
+    {
+        const auto* data = static_cast<const unsigned char*>(streambuf_.data().data());
+        size_t size = (static_cast<size_t>(data[0]) << 24) | (static_cast<size_t>(data[1]) << 16) | (static_cast<size_t>(data[2]) << 8) | data[3];
+        if (size > kMaxFrameSize)
+        {
+            LOG(ERROR, LOG_TAG) << "Message size " << size << " exceeds the max size of " << kMaxFrameSize << " bytes\n";
+            return;
+        }
+        if (streambuf_.size() < kFrameHeaderSize + size)
+        {
+            needed = kFrameHeaderSize + size;
+            break;
+        }
+        std::string message(reinterpret_cast<const char*>(data) + kFrameHeaderSize, size);
+        streambuf_.consume(kFrameHeaderSize + size);
+        if (!message.empty())
+            on_message(message);
+    }
+
+    boost::asio::async_read(socket_, streambuf_, boost::asio::transfer_exactly(needed - streambuf_.size()),
+                            [this, self = shared_from_this()](const std::error_code& ec, std::size_t /*bytes_transferred*/)
+    {
+        if (ec)
+        {
+            LOG(ERROR, LOG_TAG) << "Error while reading from control socket: " << ec.message() << "\n";
+            return;
+        }
+        do_read_frame();
+    });
+}
+
+
+void ControlSessionTcp::on_message(const std::string& message)
+{
+    if (message_receiver_ == nullptr)
+        return;
+    message_receiver_->onMessageReceived(shared_from_this(), message, [this](std::shared_ptr<const EncodedMessage> response)
+    {
+        if (response)
+            sendAsync(std::move(response), std::nullopt);
+    });
+}
+
+
+void ControlSessionTcp::set_encoding(const std::string& name)
+{
+    auto encoding = parseControlEncoding(utils::string::trim_copy(name)).value_or(ControlEncoding::json);
+    LOG(INFO, LOG_TAG) << "Requested encoding: '" << utils::string::trim_copy(name) << "', using: " << to_string(encoding) << "\n";
+    // requests are decoded with the new encoding from now on
+    encoding_ = encoding;
+    boost::asio::post(strand_, [this, self = shared_from_this(), encoding]()
+    {
+        // everything enqueued before the acknowledgement is written as JSON line, everything after it with the new encoding
+        write_encoding_ = encoding;
+        auto ack = std::make_shared<const std::string>(std::string(kEncodingHandshake) + " " + to_string(encoding));
+        if (enqueue(std::move(ack), ControlEncoding::json))
+            send_next();
     });
 }
 
@@ -103,12 +181,11 @@ void ControlSessionTcp::stop()
 }
 
 
-void ControlSessionTcp::sendAsync(const std::string& message)
+void ControlSessionTcp::sendAsync(std::shared_ptr<const EncodedMessage> message, std::optional<std::string> notification)
 {
-    boost::asio::post(strand_, [this, self = shared_from_this(), message]()
+    boost::asio::post(strand_, [this, self = shared_from_this(), message = std::move(message), notification = std::move(notification)]() mutable
     {
-        messages_.emplace_back(message + "\r\n");
-        if (messages_.size() > 1)
+        if (!enqueue(message->get(write_encoding_), write_encoding_, std::move(notification)))
         {
             LOG(DEBUG, LOG_TAG) << "TCP session outstanding async_writes: " << messages_.size() << "\n";
             return;
@@ -119,7 +196,22 @@ void ControlSessionTcp::sendAsync(const std::string& message)
 
 void ControlSessionTcp::send_next()
 {
-    boost::asio::async_write(socket_, boost::asio::buffer(messages_.front()), [this, self = shared_from_this()](std::error_code ec, std::size_t length)
+    // the message is shared with other sessions: the line delimiter or the size prefix is written as a separate buffer
+    static constexpr std::array<char, 2> delimiter{'\r', '\n'};
+    const auto& message = messages_.front();
+    std::array<boost::asio::const_buffer, 2> buffers;
+    if (message.encoding == ControlEncoding::json)
+    {
+        buffers = {boost::asio::buffer(*message.data), boost::asio::buffer(delimiter)};
+    }
+    else
+    {
+        auto size = message.data->size();
+        frame_header_ = {static_cast<unsigned char>(size >> 24), static_cast<unsigned char>(size >> 16), static_cast<unsigned char>(size >> 8),
+                         static_cast<unsigned char>(size)};
+        buffers = {boost::asio::buffer(frame_header_), boost::asio::buffer(*message.data)};
+    }
+    boost::asio::async_write(socket_, buffers, [this, self = shared_from_this()](std::error_code ec, std::size_t length)
     {
         messages_.pop_front();
         if (ec)
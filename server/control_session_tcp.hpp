@@ -29,7 +29,9 @@
 #include <boost/asio/streambuf.hpp>
 
 // standard headers
-#include <deque>
+#include <array>
+#include <memory>
+#include <string>
 
 using boost::asio::ip::tcp;
 
@@ -38,6 +40,9 @@ using boost::asio::ip::tcp;
  * Endpoint for a connected control client.
  * Messages are sent to the client with the "send" method.
  * Received messages from the client are passed to the ControlMessageReceiver callback
+ * Messages are exchanged as JSON lines, until the client requests a binary encoding with the line
+ * "Encoding: cbor" or "Encoding: msgpack". The server acknowledges with the same line and from then
+ * on, messages in both directions are framed with their size (4 bytes, big endian), followed by the payload.
  */
 class ControlSessionTcp : public ControlSession
 {
@@ -49,14 +54,24 @@ public:
     void stop() override;
 
     /// Sends a message to the client (asynchronous)
-    void sendAsync(const std::string& message) override;
+    void sendAsync(std::shared_ptr<const EncodedMessage> message, std::optional<std::string> notification) override;
 
 private:
+    /// Read the next JSON line
     void do_read();
+    /// Read the next size prefixed binary message
+    void do_read_frame();
+    /// Pass the received @p message to the message receiver
+    void on_message(const std::string& message);
+    /// Switch to the encoding with name @p name and acknowledge it, falls back to JSON if unknown
+    void set_encoding(const std::string& name);
     void send_next();
 
     tcp::socket socket_;
     boost::asio::streambuf streambuf_;
     boost::asio::strand<boost::asio::any_io_executor> strand_;
-    std::deque<std::string> messages_;
+    /// encoding of the messages that are enqueued next, accessed on the strand only
+    ControlEncoding write_encoding_{ControlEncoding::json};
+    /// size prefix of the binary message being written
+    std::array<unsigned char, 4> frame_header_{};
 };
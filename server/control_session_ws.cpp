@@ -33,20 +33,24 @@ static constexpr auto LOG_TAG = "ControlSessionWS";
 
 
 #ifdef HAS_OPENSSL
-ControlSessionWebsocket::ControlSessionWebsocket(ControlMessageReceiver* receiver, ssl_websocket&& ssl_ws, const ServerSettings& settings)
+ControlSessionWebsocket::ControlSessionWebsocket(ControlMessageReceiver* receiver, ssl_websocket&& ssl_ws, const ServerSettings& settings,
+                                                 ControlEncoding encoding)
     : ControlSession(receiver, settings), ssl_ws_(std::move(ssl_ws)), strand_(boost::asio::make_strand(ssl_ws_->get_executor())), is_ssl_(true)
 {
-    LOG(DEBUG, LOG_TAG) << "ControlSessionWebsocket, mode: ssl\n";
+    encoding_ = encoding;
+    LOG(DEBUG, LOG_TAG) << "ControlSessionWebsocket, mode: ssl, encoding: " << to_string(encoding) << "\n";
 }
 #endif
 
-ControlSessionWebsocket::ControlSessionWebsocket(ControlMessageReceiver* receiver, tcp_websocket&& tcp_ws, const ServerSettings& settings)
+ControlSessionWebsocket::ControlSessionWebsocket(ControlMessageReceiver* receiver, tcp_websocket&& tcp_ws, const ServerSettings& settings,
+                                                 ControlEncoding encoding)
     : ControlSession(receiver, settings), tcp_ws_(std::move(tcp_ws)), strand_(boost::asio::make_strand(tcp_ws_->get_executor())), is_ssl_(false)
 {
 #ifndef HAS_OPENSSL
     std::ignore = is_ssl_;
 #endif
-    LOG(DEBUG, LOG_TAG) << "ControlSessionWebsocket, mode: tcp\n";
+    encoding_ = encoding;
+    LOG(DEBUG, LOG_TAG) << "ControlSessionWebsocket, mode: tcp, encoding: " << to_string(encoding) << "\n";
 }
 
 
@@ -66,22 +70,25 @@ void ControlSessionWebsocket::start()
 
 void ControlSessionWebsocket::stop()
 {
-    // if (ws_.is_open())
-    // {
-    //     boost::beast::error_code ec;
-    //     ws_.close(beast::websocket::close_code::normal, ec);
-    //     if (ec)
-    //         LOG(ERROR, LOG_TAG) << "Error in socket close: " << ec.message() << "\n";
-    // }
+    // close the socket: pending reads and writes are aborted, which ends the session
+    boost::beast::error_code ec;
+#ifdef HAS_OPENSSL
+    if (is_ssl_)
+        beast::get_lowest_layer(*ssl_ws_).close(ec);
+    else
+#endif
+        beast::get_lowest_layer(*tcp_ws_).close(ec);
+    if (ec)
+        LOG(ERROR, LOG_TAG) << "Error in socket close: " << ec.message() << "\n";
 }
 
 
-void ControlSessionWebsocket::sendAsync(const std::string& message)
+void ControlSessionWebsocket::sendAsync(std::shared_ptr<const EncodedMessage> message, std::optional<std::string> notification)
 {
-    boost::asio::post(strand_, [this, self = shared_from_this(), msg = message]() mutable
+    boost::asio::post(strand_, [this, self = shared_from_this(), message = std::move(message), notification = std::move(notification)]() mutable
     {
-        messages_.push_back(std::move(msg));
-        if (messages_.size() > 1)
+        auto encoding = encoding_.load();
+        if (!enqueue(message->get(encoding), encoding, std::move(notification)))
         {
             LOG(DEBUG, LOG_TAG) << "HTTP session outstanding async_writes: " << messages_.size() << "\n";
             return;
@@ -93,7 +100,8 @@ void ControlSessionWebsocket::sendAsync(const std::string& message)
 
 void ControlSessionWebsocket::send_next()
 {
-    const std::string& message = messages_.front();
+    const std::string& message = *messages_.front().data;
+    bool binary = (messages_.front().encoding != ControlEncoding::json);
 
     auto write_handler = [this, self = shared_from_this()](std::error_code ec, std::size_t length)
     {
@@ -113,11 +121,13 @@ void ControlSessionWebsocket::send_next()
 #ifdef HAS_OPENSSL
     if (is_ssl_)
     {
+        ssl_ws_->binary(binary);
         ssl_ws_->async_write(boost::asio::buffer(message), [write_handler](std::error_code ec, std::size_t length) { write_handler(ec, length); });
     }
     else
 #endif
     {
+        tcp_ws_->binary(binary);
         tcp_ws_->async_write(boost::asio::buffer(message), [write_handler](std::error_code ec, std::size_t length) { write_handler(ec, length); });
     }
 }
@@ -159,12 +169,10 @@ void ControlSessionWebsocket::on_read_ws(beast::error_code ec, std::size_t bytes
         // LOG(DEBUG, LOG_TAG) << "received: " << line << "\n";
         if (message_receiver_ != nullptr)
         {
-            message_receiver_->onMessageReceived(shared_from_this(), line, [this](const std::string& response)
+            message_receiver_->onMessageReceived(shared_from_this(), line, [this](std::shared_ptr<const EncodedMessage> response)
             {
-                if (!response.empty())
-                {
-                    sendAsync(response);
-                }
+                if (response)
+                    sendAsync(std::move(response), std::nullopt);
             });
         }
     }
@@ -31,8 +31,9 @@
 #endif
 
 // standard headers
-#include <deque>
+#include <memory>
 #include <optional>
+#include <string>
 
 
 namespace beast = boost::beast;         // from <boost/beast.hpp>
@@ -54,16 +55,19 @@ class ControlSessionWebsocket : public ControlSession
 public:
 #ifdef HAS_OPENSSL
     /// c'tor for ssl websockets. Received message from the client are passed to ControlMessageReceiver
-    ControlSessionWebsocket(ControlMessageReceiver* receiver, ssl_websocket&& ssl_ws, const ServerSettings& settings);
+    /// Messages are exchanged with @p encoding, negotiated as websocket subprotocol, binary encodings are sent as binary frames
+    ControlSessionWebsocket(ControlMessageReceiver* receiver, ssl_websocket&& ssl_ws, const ServerSettings& settings,
+                            ControlEncoding encoding = ControlEncoding::json);
 #endif
     /// c'tor for TCP websockets. Received message from the client are passed to ControlMessageReceiver
-    ControlSessionWebsocket(ControlMessageReceiver* receiver, tcp_websocket&& tcp_ws, const ServerSettings& settings);
+    ControlSessionWebsocket(ControlMessageReceiver* receiver, tcp_websocket&& tcp_ws, const ServerSettings& settings,
+                            ControlEncoding encoding = ControlEncoding::json);
     ~ControlSessionWebsocket() override;
     void start() override;
     void stop() override;
 
     /// Sends a message to the client (asynchronous)
-    void sendAsync(const std::string& message) override;
+    void sendAsync(std::shared_ptr<const EncodedMessage> message, std::optional<std::string> notification) override;
 
 private:
     // Websocket methods
@@ -78,6 +82,5 @@ private:
 
     beast::flat_buffer buffer_;
     boost::asio::strand<boost::asio::any_io_executor> strand_;
-    std::deque<std::string> messages_;
     bool is_ssl_;
 };
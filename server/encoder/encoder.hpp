@@ -21,6 +21,7 @@
 // local headers
 #include "common/message/codec_header.hpp"
 #include "common/message/pcm_chunk.hpp"
+#include "common/resampler.hpp"
 #include "common/sample_format.hpp"
 
 // standard headers
@@ -86,6 +87,12 @@ public:
         return headerChunk_;
     }
 
+    /// Set the quality and threads of the resampler, for encoders that resample. Must be called before init.
+    void setResamplerSettings(const Resampler::Settings& settings)
+    {
+        resamplerSettings_ = settings;
+    }
+
 protected:
     /// Initialize the encoder
     virtual void initEncoder() = 0;
@@ -98,6 +105,8 @@ protected:
     std::string codecOptions_;
     /// Callback to return encoded chunks
     OnEncodedCallback encoded_callback_;
+    /// Resampler settings
+    Resampler::Settings resamplerSettings_;
 };
 
 } // namespace encoder
@@ -93,7 +93,7 @@ void OpusEncoder::initEncoder()
     if ((sampleFormat_.rate() != 48000) || (sampleFormat_.bits() != 16))
         LOG(INFO, LOG_TAG) << "Resampling input from " << sampleFormat_.toString() << " to " << out.toString() << " as required by Opus\n";
 
-    resampler_ = make_unique<Resampler>(sampleFormat_, out);
+    resampler_ = make_unique<Resampler>(sampleFormat_, out, resamplerSettings_);
     sampleFormat_ = out;
 
     opus_int32 bitrate = 192000;
@@ -182,13 +182,13 @@ void OpusEncoder::initEncoder()
 // and encode the buffer content in the next iteration
 void OpusEncoder::encode(const msg::PcmChunk& chunk)
 {
-    // chunk =
-    // resampler_->resample(std::make_shared<msg::PcmChunk>(chunk)).get();
-    auto in = std::make_shared<msg::PcmChunk>(chunk);
-    auto out = resampler_->resample(in); //, std::chrono::milliseconds(20));
-    if (out == nullptr)
-        return;
-    // chunk = out.get();
+    const msg::PcmChunk* out = &chunk;
+    if (resampler_->resamplingNeeded())
+    {
+        if (!resampler_->resample(chunk, resampled_))
+            return;
+        out = &resampled_;
+    }
 
     // LOG(TRACE, LOG_TAG) << "encode " << chunk->duration<std::chrono::milliseconds>().count() << "ms\n";
     uint32_t offset = 0;
@@ -56,6 +56,8 @@ private:
     std::unique_ptr<msg::PcmChunk> remainder_;
     size_t remainder_max_size_;
     std::unique_ptr<Resampler> resampler_;
+    /// output of the resampler, reused for every chunk
+    msg::PcmChunk resampled_;
 };
 
 } // namespace encoder
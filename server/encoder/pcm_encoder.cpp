@@ -22,8 +22,13 @@
 // local headers
 #include "common/aixlog.hpp"
 #include "common/endian.hpp"
+#include "common/snap_exception.hpp"
+#include "common/utils/pcm_utils.hpp"
+#include "common/utils/string_utils.hpp"
 
 // standard headers
+#include <array>
+#include <cstring>
 #include <memory>
 
 
@@ -35,6 +40,9 @@ static constexpr auto ID_WAVE = 0x45564157;
 static constexpr auto ID_FMT = 0x20746d66;
 static constexpr auto ID_DATA = 0x61746164;
 
+static constexpr auto WAVE_FORMAT_PCM = 0x0001;
+static constexpr auto WAVE_FORMAT_EXTENSIBLE = 0xFFFE;
+
 static constexpr auto LOG_TAG = "PcmEnc";
 
 namespace
@@ -56,31 +64,77 @@ PcmEncoder::PcmEncoder(std::string codecOptions) : Encoder(std::move(codecOption
 
 void PcmEncoder::encode(const msg::PcmChunk& chunk)
 {
-    // copy the chunk into a shared_ptr
-    auto pcmChunk = std::make_shared<msg::PcmChunk>(chunk);
+    std::shared_ptr<msg::PcmChunk> pcmChunk;
+    if (packed_)
+    {
+        // strip the padding byte of the 24 bit samples
+        pcmChunk = std::make_shared<msg::PcmChunk>(wireFormat_, 0);
+        pcmChunk->timestamp = chunk.timestamp;
+        pcmChunk->setFrameCount(static_cast<int>(chunk.getFrameCount()));
+        utils::pcm::pack24(chunk.payload, pcmChunk->payload, chunk.getSampleCount());
+    }
+    else
+    {
+        // copy the chunk into a shared_ptr
+        pcmChunk = std::make_shared<msg::PcmChunk>(chunk);
+    }
     encoded_callback_(*this, pcmChunk, pcmChunk->durationMs());
 }
 
 
 void PcmEncoder::initEncoder()
 {
-    LOG(INFO, LOG_TAG) << "Init\n";
-    headerChunk_->payloadSize = 44;
+    packed_ = false;
+    for (const auto& option : utils::string::split(codecOptions_, ','))
+    {
+        if (option == "PACKED")
+            packed_ = true;
+        else if (!option.empty())
+            throw SnapException("PCM unknown option: " + option);
+    }
+
+    if (packed_ && ((sampleFormat_.bits() != 24) || sampleFormat_.isPacked24()))
+    {
+        LOG(INFO, LOG_TAG) << "Option PACKED is only used for 24 bit samples in 4 byte containers, sampleformat: " << sampleFormat_.toString() << "\n";
+        packed_ = false;
+    }
+    wireFormat_ = sampleFormat_;
+    if (packed_)
+        wireFormat_.setFormat(sampleFormat_.rate(), sampleFormat_.bits(), sampleFormat_.channels(), 3);
+
+    LOG(INFO, LOG_TAG) << "Init, packed: " << packed_ << "\n";
+
+    // 24 bit samples are sent in 4 byte containers, unless packed.
+    // Packed samples are signaled with a WAVE_FORMAT_EXTENSIBLE fmt chunk with 24 valid bits in a 24 bit container,
+    // the plain fmt chunk keeps the semantics known by older clients.
+    uint32_t fmt_size = packed_ ? 40 : 16;
+    headerChunk_->payloadSize = 28 + fmt_size;
     headerChunk_->payload = static_cast<char*>(realloc(headerChunk_->payload, headerChunk_->payloadSize));
     char* payload = headerChunk_->payload;
     assign(payload, SWAP_32(ID_RIFF));
-    assign(payload + 4, SWAP_32(36));
+    assign(payload + 4, SWAP_32(20 + fmt_size));
     assign(payload + 8, SWAP_32(ID_WAVE));
     assign(payload + 12, SWAP_32(ID_FMT));
-    assign(payload + 16, SWAP_32(16));
-    assign(payload + 20, SWAP_16(1));
+    assign(payload + 16, SWAP_32(fmt_size));
+    assign(payload + 20, SWAP_16(packed_ ? WAVE_FORMAT_EXTENSIBLE : WAVE_FORMAT_PCM));
     assign(payload + 22, SWAP_16(sampleFormat_.channels()));
     assign(payload + 24, SWAP_32(sampleFormat_.rate()));
     assign(payload + 28, SWAP_32(sampleFormat_.rate() * sampleFormat_.bits() * sampleFormat_.channels() / 8));
     assign(payload + 32, SWAP_16(sampleFormat_.channels() * ((sampleFormat_.bits() + 7) / 8)));
     assign(payload + 34, SWAP_16(sampleFormat_.bits()));
-    assign(payload + 36, SWAP_32(ID_DATA));
-    assign(payload + 40, SWAP_32(0));
+    char* data = payload + 36;
+    if (packed_)
+    {
+        // cbSize, valid bits per sample, channel mask, KSDATAFORMAT_SUBTYPE_PCM
+        static constexpr std::array<uint8_t, 16> subtype_pcm{0x01, 0x00, 0x00, 0x00, 0x00, 0x00, 0x10, 0x00, 0x80, 0x00, 0x00, 0xaa, 0x00, 0x38, 0x9b, 0x71};
+        assign(payload + 36, SWAP_16(22));
+        assign(payload + 38, SWAP_16(sampleFormat_.bits()));
+        assign(payload + 40, SWAP_32(0));
+        memcpy(payload + 44, subtype_pcm.data(), subtype_pcm.size());
+        data = payload + 60;
+    }
+    assign(data, SWAP_32(ID_DATA));
+    assign(data + 4, SWAP_32(0));
 }
 
 
@@ -89,4 +143,10 @@ std::string PcmEncoder::name() const
     return "pcm";
 }
 
+
+std::string PcmEncoder::getAvailableOptions() const
+{
+    return "PACKED: send 24 bit samples packed into 3 bytes (S24_3LE), not supported by older clients";
+}
+
 } // namespace encoder
@@ -34,9 +34,15 @@ public:
 
     void encode(const msg::PcmChunk& chunk) override;
     std::string name() const override;
+    std::string getAvailableOptions() const override;
 
 private:
     void initEncoder() override;
+
+    /// send 24 bit samples packed into 3 bytes
+    bool packed_{false};
+    /// format of the encoded chunks
+    SampleFormat wireFormat_;
 };
 
 } // namespace encoder
@@ -0,0 +1,310 @@
+/***
+    This file is part of snapcast
+    Copyright (C) 2014-2025  Johannes Pohl
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+***/
+
+// prototype/interface header file
+#include "file_cache.hpp"
+
+// local headers
+#include "common/aixlog.hpp"
+
+// 3rd party headers
+#include <boost/algorithm/hex.hpp>
+#include <boost/uuid/detail/md5.hpp>
+
+// standard headers
+#include <cerrno>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <string_view>
+#include <sys/stat.h>
+#include <tuple>
+#ifdef __linux__
+#include <sys/inotify.h>
+#endif
+
+
+static constexpr auto LOG_TAG = "FileCache";
+
+namespace
+{
+/// @return content of the regular file @p path
+std::optional<std::string> readFile(const std::string& path)
+{
+    struct stat st;
+    if ((stat(path.c_str(), &st) != 0) || !S_ISREG(st.st_mode))
+        return std::nullopt;
+    std::ifstream ifs(path, std::ios::in | std::ios::binary);
+    if (!ifs.good())
+        return std::nullopt;
+    return std::string{std::istreambuf_iterator<char>(ifs), std::istreambuf_iterator<char>()};
+}
+
+/// @return quoted md5 of @p data, to be used as strong ETag
+std::string etag(const std::string& data)
+{
+    using boost::uuids::detail::md5;
+    md5 hash;
+    md5::digest_type digest;
+    hash.process_bytes(data.data(), data.size());
+    hash.get_digest(digest);
+    std::string result = "\"";
+    const auto* intDigest = reinterpret_cast<const int*>(&digest);
+    boost::algorithm::hex_lower(intDigest, intDigest + (sizeof(md5::digest_type) / sizeof(int)), std::back_inserter(result));
+    return result + "\"";
+}
+
+/// @return modification time of @p path or 0, if it doesn't exist
+std::time_t mtime(const std::string& path)
+{
+    struct stat st;
+    if (stat(path.c_str(), &st) != 0)
+        return 0;
+    return st.st_mtime;
+}
+} // namespace
+
+
+FileCache::FileCache(boost::asio::io_context& io_context, size_t max_size)
+    :
+#ifdef __linux__
+      inotify_(io_context),
+#endif
+      max_size_(max_size)
+{
+#ifdef __linux__
+    int fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (fd < 0)
+    {
+        LOG(ERROR, LOG_TAG) << "Failed to initialize inotify, error: " << errno << "\n";
+        return;
+    }
+    inotify_.assign(fd);
+    readEvents();
+#else
+    std::ignore = io_context;
+#endif
+}
+
+
+FileCache::~FileCache()
+{
+#ifdef __linux__
+    boost::system::error_code ec;
+    inotify_.close(ec);
+#endif
+}
+
+
+FileCache::FilePtr FileCache::get(const std::string& path)
+{
+    // "/x.js", "//x.js" and "/./x.js" are the same file: cache and watch canonical paths only
+    std::error_code ec;
+    std::string key = std::filesystem::weakly_canonical(path, ec).string();
+    if (ec)
+        return nullptr;
+
+#ifdef __linux__
+    uint64_t changes;
+#endif
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        auto iter = files_.find(key);
+        if (iter != files_.end())
+        {
+#ifndef __linux__
+            // without inotify: check if the file changed
+            if ((mtime(key) != iter->second.mtime) || (mtime(key + ".gz") != iter->second.gz_mtime))
+                erase(key);
+            else
+#endif
+            {
+                lru_.splice(lru_.begin(), lru_, iter->second.lru);
+                return iter->second.file;
+            }
+        }
+#ifdef __linux__
+        // watch before reading, so that a change during the read is not missed
+        watch(key);
+        changes = changes_;
+#endif
+    }
+
+    // load without holding the lock
+    std::time_t file_mtime = mtime(key);
+    std::time_t gz_mtime = mtime(key + ".gz");
+    FilePtr file = load(key);
+    if (!file)
+        return nullptr;
+    bool changed = (mtime(key) != file_mtime) || (mtime(key + ".gz") != gz_mtime);
+
+    std::lock_guard<std::mutex> lock(mutex_);
+#ifdef __linux__
+    changed = changed || (changes != changes_);
+#endif
+    if (changed)
+    {
+        // serve what was read, but don't cache a possibly stale content
+        LOG(DEBUG, LOG_TAG) << "Not caching " << key << ", changed while loading\n";
+        return file;
+    }
+    auto file_size = size(*file);
+    if ((max_size_ != 0) && (file_size > max_size_))
+    {
+        LOG(DEBUG, LOG_TAG) << "Not caching " << key << ", size " << file_size << " exceeds cache size\n";
+        return file;
+    }
+    if (files_.find(key) != files_.end())
+        erase(key);
+    lru_.push_front(key);
+    files_[key] = Entry{file, lru_.begin(), file_mtime, gz_mtime};
+    size_ += file_size;
+    LOG(DEBUG, LOG_TAG) << "Cached " << key << " (" << file_size << " bytes), cache size: " << size_ << " bytes\n";
+    evict();
+    return file;
+}
+
+
+size_t FileCache::size() const
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    return size_;
+}
+
+
+FileCache::FilePtr FileCache::load(const std::string& path)
+{
+    auto data = readFile(path);
+    if (!data.has_value())
+        return nullptr;
+    auto file = std::make_shared<File>();
+    file->etag = etag(*data);
+    file->data = std::make_shared<const std::string>(std::move(*data));
+    auto gzip = readFile(path + ".gz");
+    if (gzip.has_value())
+    {
+        file->gzip_etag = etag(*gzip);
+        file->gzip = std::make_shared<const std::string>(std::move(*gzip));
+    }
+    return file;
+}
+
+
+size_t FileCache::size(const File& file)
+{
+    return file.data->size() + (file.gzip ? file.gzip->size() : 0);
+}
+
+
+void FileCache::erase(const std::string& path)
+{
+    auto iter = files_.find(path);
+    if (iter == files_.end())
+        return;
+    size_ -= size(*iter->second.file);
+    lru_.erase(iter->second.lru);
+    files_.erase(iter);
+}
+
+
+void FileCache::evict()
+{
+    while ((max_size_ != 0) && (size_ > max_size_) && !lru_.empty())
+    {
+        LOG(DEBUG, LOG_TAG) << "Evicting " << lru_.back() << "\n";
+        erase(lru_.back());
+    }
+}
+
+
+#ifdef __linux__
+void FileCache::watch(const std::string& path)
+{
+    if (!inotify_.is_open())
+        return;
+    std::string dir = std::filesystem::path(path).parent_path().string();
+    if (watched_dirs_.find(dir) != watched_dirs_.end())
+        return;
+    int wd = inotify_add_watch(inotify_.native_handle(), dir.c_str(), IN_CLOSE_WRITE | IN_MODIFY | IN_ATTRIB | IN_CREATE | IN_DELETE | IN_MOVED_FROM | IN_MOVED_TO);
+    if (wd < 0)
+    {
+        LOG(WARNING, LOG_TAG) << "Failed to watch " << dir << ", error: " << errno << "\n";
+        return;
+    }
+    // the same directory under another name, e.g. via a bind mount: keep the first name
+    if (!watches_.emplace(wd, dir).second)
+    {
+        LOG(WARNING, LOG_TAG) << "Not watching " << dir << ", it's already watched as " << watches_[wd] << "\n";
+        return;
+    }
+    watched_dirs_[dir] = wd;
+}
+
+
+void FileCache::readEvents()
+{
+    inotify_.async_read_some(boost::asio::buffer(event_buffer_), [this](const boost::system::error_code& ec, std::size_t length)
+    {
+        if (ec)
+        {
+            if (ec != boost::asio::error::operation_aborted)
+                LOG(ERROR, LOG_TAG) << "Error reading inotify events: " << ec.message() << "\n";
+            return;
+        }
+
+        std::lock_guard<std::mutex> lock(mutex_);
+        size_t offset = 0;
+        while (offset + sizeof(inotify_event) <= length)
+        {
+            const auto* event = reinterpret_cast<const inotify_event*>(event_buffer_.data() + offset);
+            offset += sizeof(inotify_event) + event->len;
+            if ((event->mask & IN_Q_OVERFLOW) != 0)
+            {
+                // events have been dropped, any cached file might be stale
+                LOG(WARNING, LOG_TAG) << "inotify event queue overflow, clearing the cache\n";
+                ++changes_;
+                files_.clear();
+                lru_.clear();
+                size_ = 0;
+                continue;
+            }
+            auto iter = watches_.find(event->wd);
+            if (iter == watches_.end())
+                continue;
+            if ((event->mask & IN_IGNORED) != 0)
+            {
+                // the directory is gone
+                watched_dirs_.erase(iter->second);
+                watches_.erase(iter);
+                continue;
+            }
+            if (event->len == 0)
+                continue;
+            ++changes_;
+            std::string path = iter->second + "/" + event->name;
+            LOG(DEBUG, LOG_TAG) << "Changed: " << path << "\n";
+            erase(path);
+            // a changed gzip variant invalidates the uncompressed file
+            static constexpr std::string_view gz_ext = ".gz";
+            if ((path.size() > gz_ext.size()) && (path.compare(path.size() - gz_ext.size(), gz_ext.size(), gz_ext) == 0))
+                erase(path.substr(0, path.size() - gz_ext.size()));
+        }
+        readEvents();
+    });
+}
+#endif
@@ -0,0 +1,131 @@
+/***
+    This file is part of snapcast
+    Copyright (C) 2014-2025  Johannes Pohl
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+***/
+
+#pragma once
+
+
+// 3rd party headers
+#include <boost/asio/io_context.hpp>
+#ifdef __linux__
+#include <boost/asio/posix/stream_descriptor.hpp>
+#endif
+
+// standard headers
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <ctime>
+#include <list>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <unordered_map>
+
+
+/// In-memory cache of static files from the HTTP doc root
+/**
+ * Files are loaded on the first request and kept in shared buffers, together with a strong ETag
+ * and the precompressed variant "<file>.gz", if it exists next to the file.
+ * On Linux, cached files are invalidated via inotify when they change on disk, on other
+ * systems the modification time is checked on every request.
+ * Paths are canonicalized, different spellings of a path share one entry.
+ * The total size is bounded, least recently used files are evicted.
+ */
+class FileCache
+{
+public:
+    /// A cached file
+    struct File
+    {
+        /// file content
+        std::shared_ptr<const std::string> data;
+        /// strong ETag of the content
+        std::string etag;
+        /// content of the gzip compressed variant "<file>.gz", if available
+        std::shared_ptr<const std::string> gzip;
+        /// strong ETag of the gzip compressed variant
+        std::string gzip_etag;
+    };
+
+    /// Shared, immutable file
+    using FilePtr = std::shared_ptr<const File>;
+
+    /// c'tor, caching at most @p max_size bytes
+    FileCache(boost::asio::io_context& io_context, size_t max_size);
+    /// d'tor
+    ~FileCache();
+
+    /// @return the file with @p path, loaded from disk if not cached, or nullptr if it's not a readable regular file
+    FilePtr get(const std::string& path);
+
+    /// @return total size of the cached files
+    size_t size() const;
+
+private:
+    /// A cache entry
+    struct Entry
+    {
+        /// the file
+        FilePtr file;
+        /// position in the LRU list
+        std::list<std::string>::iterator lru;
+        /// modification time of the file, to validate the entry without inotify
+        std::time_t mtime{0};
+        /// modification time of the gzip variant, 0 if there is none
+        std::time_t gz_mtime{0};
+    };
+
+    /// @return file with @p path, loaded from disk
+    static FilePtr load(const std::string& path);
+    /// Remove the file with @p path, must be called with mutex_ locked
+    void erase(const std::string& path);
+    /// Evict least recently used files until the cache fits into max_size_, must be called with mutex_ locked
+    void evict();
+    /// @return size of @p file, i.e. content plus gzip variant
+    static size_t size(const File& file);
+
+#ifdef __linux__
+    /// Watch the directory of @p path for changes, must be called with mutex_ locked
+    void watch(const std::string& path);
+    /// Read the next inotify events
+    void readEvents();
+
+    /// the inotify instance
+    boost::asio::posix::stream_descriptor inotify_;
+    /// watch descriptor => directory
+    std::map<int, std::string> watches_;
+    /// directory => watch descriptor
+    std::map<std::string, int> watched_dirs_;
+    /// buffer for inotify events
+    std::array<char, 4096> event_buffer_;
+    /// number of change events, to detect changes while a file is loaded
+    uint64_t changes_{0};
+#endif
+
+    /// path => cached file
+    std::unordered_map<std::string, Entry> files_;
+    /// paths, most recently used first
+    std::list<std::string> lru_;
+    /// total size of the cached files
+    size_t size_{0};
+    /// max total size of the cached files
+    size_t max_size_;
+    mutable std::mutex mutex_;
+};
@@ -0,0 +1,152 @@
+/***
+    This file is part of snapcast
+    Copyright (C) 2014-2025  Johannes Pohl
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+***/
+
+// prototype/interface header file
+#include "image_cache.hpp"
+
+// local headers
+#include "common/aixlog.hpp"
+
+// 3rd party headers
+#include <boost/algorithm/hex.hpp>
+#include <boost/uuid/detail/md5.hpp>
+
+// standard headers
+#include <iterator>
+
+
+static constexpr auto LOG_TAG = "ImageCache";
+
+
+void ImageCache::setMaxSize(size_t bytes)
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    max_size_ = bytes;
+    evict();
+}
+
+
+std::string ImageCache::setImage(const std::string& key, std::string image, const std::string& extension)
+{
+    if (image.empty())
+    {
+        clear(key);
+        return "";
+    }
+
+    using boost::uuids::detail::md5;
+    md5 hash;
+    md5::digest_type digest;
+    hash.process_bytes(key.data(), key.size());
+    hash.process_bytes(image.data(), image.size());
+    hash.get_digest(digest);
+    std::string etag;
+    const auto* intDigest = reinterpret_cast<const int*>(&digest);
+    boost::algorithm::hex_lower(intDigest, intDigest + (sizeof(md5::digest_type) / sizeof(int)), std::back_inserter(etag));
+    auto ext = extension;
+    if (ext.find('.') == 0)
+        ext = ext.substr(1);
+    std::string filename = etag + "." + ext;
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    // the previous image of this key stays cached until it's evicted, clients might still request it
+    auto key_iter = key_to_url_.find(key);
+    if ((key_iter != key_to_url_.end()) && (key_iter->second != filename))
+    {
+        auto old_iter = url_to_image_.find(key_iter->second);
+        if (old_iter != url_to_image_.end())
+            old_iter->second.pinned = false;
+    }
+    key_to_url_[key] = filename;
+
+    auto iter = url_to_image_.find(filename);
+    if (iter != url_to_image_.end())
+    {
+        iter->second.pinned = true;
+        lru_.splice(lru_.begin(), lru_, iter->second.lru);
+    }
+    else
+    {
+        lru_.push_front(filename);
+        size_ += image.size();
+        url_to_image_[filename] = Entry{std::make_shared<Image>(Image{std::move(image), std::move(etag)}), lru_.begin(), true};
+        LOG(DEBUG, LOG_TAG) << "Added image " << filename << ", cache size: " << size_ << " bytes\n";
+    }
+    evict();
+    return filename;
+}
+
+
+void ImageCache::clear(const std::string& key)
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto iter = key_to_url_.find(key);
+    if (iter != key_to_url_.end())
+    {
+        erase(iter->second);
+        key_to_url_.erase(iter);
+    }
+}
+
+
+ImageCache::ImagePtr ImageCache::getImage(const std::string& url)
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto iter = url_to_image_.find(url);
+    if (iter == url_to_image_.end())
+        return nullptr;
+    lru_.splice(lru_.begin(), lru_, iter->second.lru);
+    return iter->second.image;
+}
+
+
+size_t ImageCache::size() const
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    return size_;
+}
+
+
+void ImageCache::erase(const std::string& url)
+{
+    auto iter = url_to_image_.find(url);
+    if (iter == url_to_image_.end())
+        return;
+    size_ -= iter->second.image->data.size();
+    lru_.erase(iter->second.lru);
+    url_to_image_.erase(iter);
+}
+
+
+void ImageCache::evict()
+{
+    if (max_size_ == 0)
+        return;
+    auto iter = lru_.end();
+    while ((size_ > max_size_) && (iter != lru_.begin()))
+    {
+        --iter;
+        const auto& entry = url_to_image_.at(*iter);
+        if (entry.pinned)
+            continue;
+        LOG(DEBUG, LOG_TAG) << "Evicting image " << *iter << ", cache size: " << size_ << " bytes\n";
+        // erase invalidates iter, continue with the next more recently used entry
+        auto url = *iter++;
+        erase(url);
+    }
+}
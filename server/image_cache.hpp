@@ -1,6 +1,6 @@
 /***
     This file is part of snapcast
-    Copyright (C) 2014-2024  Johannes Pohl
+    Copyright (C) 2014-2025  Johannes Pohl
 
     This program is free software: you can redistribute it and/or modify
     it under the terms of the GNU General Public License as published by
@@ -19,21 +19,37 @@
 #pragma once
 
 
-// 3rd party headers
-#include <boost/algorithm/hex.hpp>
-#include <boost/uuid/detail/md5.hpp>
-
 // standard headers
+#include <cstddef>
+#include <list>
 #include <map>
+#include <memory>
 #include <mutex>
-#include <optional>
 #include <string>
+#include <unordered_map>
 
 
 /// Image cache, used to store current album art per stream
+/**
+ * Images are stored decoded and shared, so that they can be served without copying.
+ * The total size is bounded: least recently used images are evicted, but never the
+ * current image of a stream.
+ */
 class ImageCache
 {
 public:
+    /// A cached image
+    struct Image
+    {
+        /// binary image data
+        std::string data;
+        /// entity tag, the md5 of the image
+        std::string etag;
+    };
+
+    /// Shared, immutable image
+    using ImagePtr = std::shared_ptr<const Image>;
+
     /// @return singleton to the image cache
     static ImageCache& instance()
     {
@@ -41,66 +57,51 @@ public:
         return instance_;
     }
 
-    /// Store the base64 encoded @p image for @p key (the session that stores the image) in the cache
+    /// Set the max total size of the cached images to @p bytes, 0 = unlimited
+    void setMaxSize(size_t bytes);
+
+    /// Store the binary @p image for @p key (the session that stores the image) in the cache
     /// @return url of the cached image (md5 of key + image data) appended with @p extension
-    std::string setImage(const std::string& key, std::string image, const std::string& extension)
-    {
-        if (image.empty())
-        {
-            clear(key);
-            return "";
-        }
-
-        using boost::uuids::detail::md5;
-        md5 hash;
-        md5::digest_type digest;
-        hash.process_bytes(key.data(), key.size());
-        hash.process_bytes(image.data(), image.size());
-        hash.get_digest(digest);
-        std::string filename;
-        const auto* intDigest = reinterpret_cast<const int*>(&digest);
-        boost::algorithm::hex_lower(intDigest, intDigest + (sizeof(md5::digest_type) / sizeof(int)), std::back_inserter(filename));
-        auto ext = extension;
-        if (ext.find('.') == 0)
-            ext = ext.substr(1);
-        filename += "." + ext;
-        std::lock_guard<std::mutex> lock(mutex_);
-        key_to_url_[key] = filename;
-        url_to_data_[filename] = std::move(image);
-        return filename;
-    };
+    std::string setImage(const std::string& key, std::string image, const std::string& extension);
 
     /// Clear image for @p key (the stream session's name)
-    void clear(const std::string& key)
-    {
-        std::lock_guard<std::mutex> lock(mutex_);
-        auto iter = key_to_url_.find(key);
-        if (iter != key_to_url_.end())
-        {
-            auto url = *iter;
-            auto url_iter = url_to_data_.find(url.second);
-            if (url_iter != url_to_data_.end())
-                url_to_data_.erase(url_iter);
-            key_to_url_.erase(iter);
-        }
-    }
+    void clear(const std::string& key);
 
-    /// @return base64 encoded image for url (the one returned by "setImage")
-    std::optional<std::string> getImage(const std::string& url)
-    {
-        std::lock_guard<std::mutex> lock(mutex_);
-        auto iter = url_to_data_.find(url);
-        if (iter == url_to_data_.end())
-            return std::nullopt;
-        else
-            return iter->second;
-    }
+    /// @return image for url (the one returned by "setImage") or nullptr, if not found
+    ImagePtr getImage(const std::string& url);
+
+    /// @return total size of the cached images
+    size_t size() const;
 
 private:
     ImageCache() = default;
     ~ImageCache() = default;
 
+    /// A cache entry
+    struct Entry
+    {
+        /// the image
+        ImagePtr image;
+        /// position in the LRU list
+        std::list<std::string>::iterator lru;
+        /// current image of a stream, will not be evicted
+        bool pinned{false};
+    };
+
+    /// Remove the image with @p url, must be called with mutex_ locked
+    void erase(const std::string& url);
+    /// Evict least recently used, unpinned images until the cache fits into max_size_, must be called with mutex_ locked
+    void evict();
+
+    /// key => url of its current image
     std::map<std::string, std::string> key_to_url_;
-    std::map<std::string, std::string> url_to_data_;
-    std::mutex mutex_;
+    /// url => image
+    std::unordered_map<std::string, Entry> url_to_image_;
+    /// urls, most recently used first
+    std::list<std::string> lru_;
+    /// total size of the images
+    size_t size_{0};
+    /// max total size of the images
+    size_t max_size_{10 * 1024 * 1024};
+    mutable std::mutex mutex_;
 };
@@ -0,0 +1,226 @@
+/***
+    This file is part of snapcast
+    Copyright (C) 2014-2025  Johannes Pohl
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+***/
+
+// prototype/interface header file
+#include "metrics.hpp"
+
+// local headers
+#include "common/aixlog.hpp"
+
+// standard headers
+#include <algorithm>
+#include <iomanip>
+#include <limits>
+#include <sstream>
+
+
+static constexpr auto LOG_TAG = "Metrics";
+
+namespace metrics
+{
+
+const std::vector<double> kDurationBuckets{0.00005, 0.0001, 0.00025, 0.0005, 0.001, 0.0025, 0.005, 0.01, 0.025, 0.05, 0.1, 0.25, 0.5, 1., 2.5, 5., 10.};
+
+namespace
+{
+/// @return @p value, escaped as label value
+std::string escape(const std::string& value)
+{
+    std::string result;
+    result.reserve(value.size());
+    for (char c : value)
+    {
+        if (c == '\\')
+            result += "\\\\";
+        else if (c == '"')
+            result += "\\\"";
+        else if (c == '\n')
+            result += "\\n";
+        else
+            result += c;
+    }
+    return result;
+}
+
+/// Write @p labels, plus the optional label @p extra, as "{name="value",...}"
+void writeLabels(std::ostream& os, const Labels& labels, const std::pair<std::string, std::string>& extra = {})
+{
+    if (labels.empty() && extra.first.empty())
+        return;
+    os << "{";
+    bool first = true;
+    for (const auto& [name, value] : labels)
+    {
+        os << (first ? "" : ",") << name << "=\"" << escape(value) << "\"";
+        first = false;
+    }
+    if (!extra.first.empty())
+        os << (first ? "" : ",") << extra.first << "=\"" << escape(extra.second) << "\"";
+    os << "}";
+}
+
+/// @return @p value as string, without trailing zeros
+std::string toString(double value)
+{
+    std::ostringstream oss;
+    oss << std::setprecision(std::numeric_limits<double>::digits10) << value;
+    return oss.str();
+}
+} // namespace
+
+
+Histogram::Histogram(std::vector<double> bounds) : bounds_(std::move(bounds)), counts_(new std::atomic<uint64_t>[bounds_.size() + 1])
+{
+    std::sort(bounds_.begin(), bounds_.end());
+    for (size_t n = 0; n <= bounds_.size(); ++n)
+        counts_[n].store(0, std::memory_order_relaxed);
+}
+
+
+void Histogram::observe(double value) noexcept
+{
+    auto bucket = std::distance(bounds_.begin(), std::lower_bound(bounds_.begin(), bounds_.end(), value));
+    counts_[bucket].fetch_add(1, std::memory_order_relaxed);
+    double sum = sum_.load(std::memory_order_relaxed);
+    while (!sum_.compare_exchange_weak(sum, sum + value, std::memory_order_relaxed))
+        ;
+}
+
+
+std::vector<uint64_t> Histogram::buckets() const
+{
+    std::vector<uint64_t> result(bounds_.size() + 1);
+    uint64_t total = 0;
+    for (size_t n = 0; n < result.size(); ++n)
+    {
+        total += counts_[n].load(std::memory_order_relaxed);
+        result[n] = total;
+    }
+    return result;
+}
+
+
+template <typename T, typename Create>
+std::shared_ptr<T> Registry::get(const std::string& name, const std::string& help, Type type, const Labels& labels, Create&& create)
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto& family = families_[name];
+    if (family.metrics.empty())
+    {
+        family.help = help;
+        family.type = type;
+    }
+    else if (family.type != type)
+    {
+        LOG(ERROR, LOG_TAG) << "Metric " << name << " is already registered with a different type\n";
+        return create();
+    }
+
+    // metrics of destroyed objects are removed
+    family.metrics.erase(std::remove_if(family.metrics.begin(), family.metrics.end(), [](const auto& metric) { return metric.second.expired(); }),
+                         family.metrics.end());
+    for (const auto& [metric_labels, metric] : family.metrics)
+    {
+        if (metric_labels == labels)
+        {
+            if (auto result = metric.lock())
+                return std::static_pointer_cast<T>(result);
+        }
+    }
+    std::shared_ptr<T> result = create();
+    family.metrics.emplace_back(labels, result);
+    return result;
+}
+
+
+std::shared_ptr<Counter> Registry::counter(const std::string& name, const std::string& help, const Labels& labels)
+{
+    return get<Counter>(name, help, Type::counter, labels, [] { return std::make_shared<Counter>(); });
+}
+
+
+std::shared_ptr<Gauge> Registry::gauge(const std::string& name, const std::string& help, const Labels& labels)
+{
+    return get<Gauge>(name, help, Type::gauge, labels, [] { return std::make_shared<Gauge>(); });
+}
+
+
+std::shared_ptr<Histogram> Registry::histogram(const std::string& name, const std::string& help, const Labels& labels, const std::vector<double>& bounds)
+{
+    return get<Histogram>(name, help, Type::histogram, labels, [&bounds] { return std::make_shared<Histogram>(bounds); });
+}
+
+
+std::string Registry::serialize() const
+{
+    std::ostringstream os;
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (const auto& [name, family] : families_)
+    {
+        bool header = false;
+        for (const auto& [labels, weak_metric] : family.metrics)
+        {
+            auto metric = weak_metric.lock();
+            if (!metric)
+                continue;
+            if (!header)
+            {
+                static const std::map<Type, std::string> type_names{{Type::counter, "counter"}, {Type::gauge, "gauge"}, {Type::histogram, "histogram"}};
+                os << "# HELP " << name << " " << family.help << "\n";
+                os << "# TYPE " << name << " " << type_names.at(family.type) << "\n";
+                header = true;
+            }
+
+            switch (family.type)
+            {
+                case Type::counter:
+                    os << name;
+                    writeLabels(os, labels);
+                    os << " " << std::static_pointer_cast<Counter>(metric)->value() << "\n";
+                    break;
+                case Type::gauge:
+                    os << name;
+                    writeLabels(os, labels);
+                    os << " " << toString(std::static_pointer_cast<Gauge>(metric)->value()) << "\n";
+                    break;
+                case Type::histogram:
+                {
+                    auto histogram = std::static_pointer_cast<Histogram>(metric);
+                    auto buckets = histogram->buckets();
+                    const auto& bounds = histogram->bounds();
+                    for (size_t n = 0; n < buckets.size(); ++n)
+                    {
+                        os << name << "_bucket";
+                        writeLabels(os, labels, {"le", (n < bounds.size()) ? toString(bounds[n]) : "+Inf"});
+                        os << " " << buckets[n] << "\n";
+                    }
+                    os << name << "_sum";
+                    writeLabels(os, labels);
+                    os << " " << toString(histogram->sum()) << "\n";
+                    os << name << "_count";
+                    writeLabels(os, labels);
+                    os << " " << buckets.back() << "\n";
+                    break;
+                }
+            }
+        }
+    }
+    return os.str();
+}
+
+} // namespace metrics
@@ -0,0 +1,194 @@
+/***
+    This file is part of snapcast
+    Copyright (C) 2014-2025  Johannes Pohl
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+***/
+
+#pragma once
+
+
+// standard headers
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <utility>
+#include <vector>
+
+
+namespace metrics
+{
+
+/// Labels of a metric, e.g. {{"stream", "default"}}
+using Labels = std::vector<std::pair<std::string, std::string>>;
+
+/// Default histogram buckets for durations [s], 50us to 10s
+extern const std::vector<double> kDurationBuckets;
+
+
+/// Monotonically increasing counter
+class Counter
+{
+public:
+    /// Increment by @p n
+    void inc(uint64_t n = 1) noexcept
+    {
+        value_.fetch_add(n, std::memory_order_relaxed);
+    }
+
+    /// @return current value
+    uint64_t value() const noexcept
+    {
+        return value_.load(std::memory_order_relaxed);
+    }
+
+private:
+    std::atomic<uint64_t> value_{0};
+};
+
+
+/// Value that can go up and down
+class Gauge
+{
+public:
+    /// Set to @p value
+    void set(double value) noexcept
+    {
+        value_.store(value, std::memory_order_relaxed);
+    }
+
+    /// Add @p n (can be negative)
+    void add(double n) noexcept
+    {
+        double value = value_.load(std::memory_order_relaxed);
+        while (!value_.compare_exchange_weak(value, value + n, std::memory_order_relaxed))
+            ;
+    }
+
+    /// @return current value
+    double value() const noexcept
+    {
+        return value_.load(std::memory_order_relaxed);
+    }
+
+private:
+    std::atomic<double> value_{0.};
+};
+
+
+/// Histogram with fixed bucket upper bounds
+class Histogram
+{
+public:
+    /// c'tor with ascending bucket upper bounds @p bounds, the "+Inf" bucket is implicit
+    explicit Histogram(std::vector<double> bounds);
+
+    /// Add an observation of @p value
+    void observe(double value) noexcept;
+
+    /// Add an observation of @p duration, in seconds
+    template <class Rep, class Period>
+    void observe(const std::chrono::duration<Rep, Period>& duration) noexcept
+    {
+        observe(std::chrono::duration<double>(duration).count());
+    }
+
+    /// @return the bucket upper bounds
+    const std::vector<double>& bounds() const
+    {
+        return bounds_;
+    }
+
+    /// @return cumulative count per bucket, the last one being the "+Inf" bucket, i.e. the total count
+    std::vector<uint64_t> buckets() const;
+
+    /// @return sum of all observations
+    double sum() const noexcept
+    {
+        return sum_.load(std::memory_order_relaxed);
+    }
+
+private:
+    std::vector<double> bounds_;
+    /// non cumulative count per bucket, plus the "+Inf" bucket
+    std::unique_ptr<std::atomic<uint64_t>[]> counts_;
+    std::atomic<double> sum_{0.};
+};
+
+
+/// Registry of all metrics, serialized in the Prometheus text exposition format
+/**
+ * Metrics are owned by the instrumented objects (e.g. a stream or a session) and hold only
+ * atomics, so that updating them never locks. The registry keeps weak references: metrics
+ * of destroyed objects disappear from the output. Requesting a metric with the name and labels
+ * of a living one returns the existing metric.
+ */
+class Registry
+{
+public:
+    /// @return the singleton registry
+    static Registry& instance()
+    {
+        static Registry instance_;
+        return instance_;
+    }
+
+    /// @return counter @p name with @p labels, @p help is the description of the metric
+    std::shared_ptr<Counter> counter(const std::string& name, const std::string& help, const Labels& labels = {});
+    /// @return gauge @p name with @p labels, @p help is the description of the metric
+    std::shared_ptr<Gauge> gauge(const std::string& name, const std::string& help, const Labels& labels = {});
+    /// @return histogram @p name with @p labels and bucket upper bounds @p bounds, @p help is the description of the metric
+    std::shared_ptr<Histogram> histogram(const std::string& name, const std::string& help, const Labels& labels = {},
+                                         const std::vector<double>& bounds = kDurationBuckets);
+
+    /// @return all living metrics in the Prometheus text exposition format, version 0.0.4
+    std::string serialize() const;
+
+private:
+    Registry() = default;
+    ~Registry() = default;
+
+    /// Type of a metric
+    enum class Type
+    {
+        counter,
+        gauge,
+        histogram
+    };
+
+    /// All metrics with the same name
+    struct Family
+    {
+        /// description
+        std::string help;
+        /// type of the metrics
+        Type type;
+        /// labels => metric
+        std::vector<std::pair<Labels, std::weak_ptr<void>>> metrics;
+    };
+
+    /// @return metric @p name with @p labels of type @p type, created with @p create if it doesn't exist
+    template <typename T, typename Create>
+    std::shared_ptr<T> get(const std::string& name, const std::string& help, Type type, const Labels& labels, Create&& create);
+
+    /// name => family
+    std::map<std::string, Family> families_;
+    mutable std::mutex mutex_;
+};
+
+} // namespace metrics
@@ -22,11 +22,14 @@
 // local headers
 #include "common/aixlog.hpp"
 #include "common/message/client_info.hpp"
+#include "common/message/client_stats.hpp"
 #include "common/message/error.hpp"
 #include "common/message/hello.hpp"
 #include "common/message/server_settings.hpp"
 #include "common/message/time.hpp"
 #include "config.hpp"
+#include "control_dispatch.hpp"
+#include "image_cache.hpp"
 #include "jsonrpcpp.hpp"
 
 // 3rd party headers
@@ -47,8 +50,12 @@ static constexpr auto LOG_TAG = "Server";
 
 
 Server::Server(boost::asio::io_context& io_context, ServerSettings serverSettings)
-    : io_context_(io_context), config_timer_(io_context), settings_(std::move(serverSettings)), request_factory_(*this)
+    : io_context_(io_context), config_timer_(io_context), probe_timer_(io_context), settings_(std::move(serverSettings)), request_factory_(*this)
 {
+    io_latency_metric_ =
+        metrics::Registry::instance().histogram("snapserver_io_handler_latency_seconds", "Delay between a timer's expiry and the execution of its handler");
+    Config::instance().setSaveInterval(std::chrono::milliseconds(settings_.server.save_interval_ms));
+    ImageCache::instance().setMaxSize(settings_.http.image_cache_size_kb * 1024);
 }
 
 
@@ -63,10 +70,12 @@ void Server::onPropertiesChanged(const PcmStream* pcmStream, const Properties& p
 {
     LOG(DEBUG, LOG_TAG) << "Properties changed, stream: " << pcmStream->getName() << ", properties: " << properties.toJson().dump(3) << "\n";
 
+    status_cache_.invalidate(StatusCache::Object::stream, pcmStream->getId());
     // Send properties to all connected control clients
-    json notification =
-        jsonrpcpp::Notification("Stream.OnProperties", jsonrpcpp::Parameter("id", pcmStream->getId(), "properties", properties.toJson())).to_json();
-    controlServer_->send(notification.dump(), nullptr);
+    if (!controlServer_->isSubscribed("Stream.OnProperties", pcmStream->getId()))
+        return;
+    jsonrpcpp::Notification notification("Stream.OnProperties", jsonrpcpp::Parameter("id", pcmStream->getId(), "properties", properties.toJson()));
+    controlServer_->send(notification, nullptr);
 }
 
 
@@ -77,8 +86,11 @@ void Server::onStateChanged(const PcmStream* pcmStream, ReaderState state)
     // clang-format on
     LOG(INFO, LOG_TAG) << "onStateChanged (" << pcmStream->getName() << "): " << state << "\n";
     //	LOG(INFO, LOG_TAG) << pcmStream->toJson().dump(4);
-    json notification = jsonrpcpp::Notification("Stream.OnUpdate", jsonrpcpp::Parameter("id", pcmStream->getId(), "stream", pcmStream->toJson())).to_json();
-    controlServer_->send(notification.dump(), nullptr);
+    status_cache_.invalidate(StatusCache::Object::stream, pcmStream->getId());
+    if (!controlServer_->isSubscribed("Stream.OnUpdate", pcmStream->getId()))
+        return;
+    jsonrpcpp::Notification notification("Stream.OnUpdate", jsonrpcpp::Parameter("id", pcmStream->getId(), "stream", pcmStream->toJson()));
+    controlServer_->send(notification, nullptr);
     // cout << "Notification: " << notification.dump() << "\n";
 }
 
@@ -111,6 +123,7 @@ void Server::onDisconnect(StreamSession* streamSession)
 
     clientInfo->connected = false;
     chronos::systemtimeofday(&clientInfo->lastSeen);
+    status_cache_.invalidate(StatusCache::Object::client, clientInfo->id);
     saveConfig();
     if (controlServer_ != nullptr)
     {
@@ -123,25 +136,33 @@ void Server::onDisconnect(StreamSession* streamSession)
             // Notification:
             // {"jsonrpc":"2.0","method":"Client.OnDisconnect","params":{"client":{"config":{"instance":1,"latency":0,"name":"","volume":{"muted":false,"percent":81}},"connected":false,"host":{"arch":"x86_64","ip":"192.168.0.54","mac":"00:21:6a:7d:74:fc","name":"T400","os":"Linux Mint 17.3 Rosa"},"id":"00:21:6a:7d:74:fc","lastSeen":{"sec":1488025523,"usec":814067},"snapclient":{"name":"Snapclient","protocolVersion":2,"version":"0.10.0"}},"id":"00:21:6a:7d:74:fc"}}
             // clang-format on
-            json notification =
-                jsonrpcpp::Notification("Client.OnDisconnect", jsonrpcpp::Parameter("id", clientInfo->id, "client", clientInfo->toJson())).to_json();
-            controlServer_->send(notification.dump());
+            jsonrpcpp::Notification notification("Client.OnDisconnect", jsonrpcpp::Parameter("id", clientInfo->id, "client", clientInfo->toJson()));
+            controlServer_->send(notification);
             // cout << "Notification: " << notification.dump() << "\n";
         }
     }
 }
 
 
-void Server::processRequest(const jsonrpcpp::request_ptr& request, AuthInfo& authinfo, const Request::OnResponse& on_response) const
+void Server::processRequest(const jsonrpcpp::request_ptr& request, ControlSession& session, const Request::OnResponse& response_handler) const
 {
+    const AuthInfo& authinfo = session.authinfo;
     auto req = request_factory_.getRequest(request->method());
     if (req)
     {
+        // the response might be sent asynchronously, so the handler is copied
+        auto on_response = [req, response_handler, start = std::chrono::steady_clock::now()](jsonrpcpp::entity_ptr response,
+                                                                                              jsonrpcpp::notification_ptr notification)
+        {
+            req->observe(std::chrono::steady_clock::now() - start);
+            response_handler(std::move(response), std::move(notification));
+        };
+
         try
         {
             if (req->hasPermission(authinfo))
             {
-                req->execute(request, authinfo, on_response);
+                req->execute(request, session, on_response);
             }
             else
             {
@@ -172,7 +193,7 @@ void Server::processRequest(const jsonrpcpp::request_ptr& request, AuthInfo& aut
     {
         LOG(ERROR, LOG_TAG) << "Method not found: " << request->method() << "\n";
         auto response = std::make_shared<jsonrpcpp::MethodNotFoundException>(request->id());
-        on_response(std::move(response), nullptr);
+        response_handler(std::move(response), nullptr);
     }
 }
 
@@ -181,83 +202,20 @@ void Server::onMessageReceived(std::shared_ptr<ControlSession> controlSession, c
 {
     // LOG(DEBUG, LOG_TAG) << "onMessageReceived: " << message << "\n";
     std::lock_guard<std::mutex> lock(Config::instance().getMutex());
-    jsonrpcpp::entity_ptr entity(nullptr);
-    try
-    {
-        entity = jsonrpcpp::Parser::do_parse(message);
-        if (!entity)
-            return response_handler("");
-    }
-    catch (const jsonrpcpp::ParseErrorException& e)
-    {
-        return response_handler(e.to_json().dump());
-    }
-    catch (const std::exception& e)
-    {
-        return response_handler(jsonrpcpp::ParseErrorException(e.what()).to_json().dump());
-    }
-
-    jsonrpcpp::entity_ptr response(nullptr);
-    jsonrpcpp::notification_ptr notification(nullptr);
-    if (entity->is_request())
+    ControlDispatchHandler handler;
+    handler.process = [this, controlSession](const jsonrpcpp::request_ptr& request, const ControlDispatchHandler::OnResponse& on_response)
     {
-        jsonrpcpp::request_ptr request = dynamic_pointer_cast<jsonrpcpp::Request>(entity);
-        processRequest(request, controlSession->authinfo,
-                       [this, controlSession, response_handler](const jsonrpcpp::entity_ptr& response, const jsonrpcpp::notification_ptr& notification)
+        processRequest(request, *controlSession,
+                       [this, on_response](const jsonrpcpp::entity_ptr& response, const jsonrpcpp::notification_ptr& notification)
         {
-            // if (controlSession->authinfo.isAuthenticated())
-            // {
-            //     LOG(INFO, LOG_TAG) << "Request auth info - username: " << controlSession->authinfo->username()
-            //                        << ", valid: " << controlSession->authinfo->valid() << "\n";
-            // }
             saveConfig();
-            ////cout << "Request:      " << request->to_json().dump() << "\n";
-            if (notification)
-            {
-                ////cout << "Notification: " << notification->to_json().dump() << "\n";
-                controlServer_->send(notification->to_json().dump(), controlSession.get());
-            }
-            if (response)
-            {
-                ////cout << "Response:     " << response->to_json().dump() << "\n";
-                return response_handler(response->to_json().dump());
-            }
-            return response_handler("");
+            on_response(response, notification);
         });
-    }
-    else if (entity->is_batch())
-    {
-        /// Attention: this will only work as long as the response handler in processRequest is called synchronously. One way to do this is to remove the outer
-        /// loop and to call the next processRequest with
-        /// This is true for volume changes, which is the only batch request, but not for Control commands!
-        jsonrpcpp::batch_ptr batch = dynamic_pointer_cast<jsonrpcpp::Batch>(entity);
-        ////cout << "Batch: " << batch->to_json().dump() << "\n";
-        jsonrpcpp::Batch responseBatch;
-        jsonrpcpp::Batch notificationBatch;
-        for (const auto& batch_entity : batch->entities)
-        {
-            if (batch_entity->is_request())
-            {
-                jsonrpcpp::request_ptr request = dynamic_pointer_cast<jsonrpcpp::Request>(batch_entity);
-                processRequest(request, controlSession->authinfo,
-                               [controlSession, response_handler, &responseBatch, &notificationBatch](const jsonrpcpp::entity_ptr& response,
-                                                                                                      const jsonrpcpp::notification_ptr& notification)
-                {
-                    if (response != nullptr)
-                        responseBatch.add_ptr(response);
-                    if (notification != nullptr)
-                        notificationBatch.add_ptr(notification);
-                });
-            }
-        }
-        saveConfig();
-        if (!notificationBatch.entities.empty())
-            controlServer_->send(notificationBatch.to_json().dump(), controlSession.get());
-        if (!responseBatch.entities.empty())
-            return response_handler(responseBatch.to_json().dump());
-        return response_handler("");
-    }
-    return response_handler("");
+    };
+    handler.notify = [this, controlSession](const jsonrpcpp::Notification& notification) { controlServer_->send(notification, controlSession.get()); };
+    handler.notify_batch = [this, controlSession](const jsonrpcpp::Batch& notifications) { controlServer_->send(notifications, controlSession.get()); };
+    // the message is serialized with the session's encoding, i.e. JSON, CBOR or MessagePack
+    dispatchControlMessage(message, controlSession->encoding(), handler, response_handler);
 }
 
 
@@ -300,9 +258,19 @@ void Server::onMessageReceived(const std::shared_ptr<StreamSession>& streamSessi
 
         clientInfo->config.volume.percent = infoMsg.getVolume();
         clientInfo->config.volume.muted = infoMsg.isMuted();
+        status_cache_.invalidate(StatusCache::Object::client, clientInfo->id);
         jsonrpcpp::notification_ptr notification = make_shared<jsonrpcpp::Notification>(
             "Client.OnVolumeChanged", jsonrpcpp::Parameter("id", streamSession->clientId, "volume", clientInfo->config.volume.toJson()));
-        controlServer_->send(notification->to_json().dump());
+        controlServer_->send(*notification);
+    }
+    else if (baseMessage.type == message_type::kClientStats)
+    {
+        msg::ClientStats statsMsg;
+        statsMsg.deserialize(baseMessage, buffer);
+        LOG(DEBUG, LOG_TAG) << "Stats from " << streamSession->clientId << ", sync error p50: " << statsMsg.sync_error_p50_us
+                            << " us, p99: " << statsMsg.sync_error_p99_us << " us, hard syncs: " << statsMsg.hard_syncs << ", underruns: " << statsMsg.underruns
+                            << "\n";
+        streamSession->setClientStats(statsMsg);
     }
     else if (baseMessage.type == message_type::kHello)
     {
@@ -370,6 +338,7 @@ void Server::onMessageReceived(const std::shared_ptr<StreamSession>& streamSessi
         serverSettings->setMuted(client->config.volume.muted || group->muted);
         serverSettings->setLatency(client->config.latency);
         serverSettings->setBufferMs(settings_.stream.bufferMs);
+        serverSettings->setStatsIntervalMs(static_cast<uint32_t>(settings_.streamingclient.statsIntervalMs));
         serverSettings->refersTo = helloMsg.id;
         streamSession->send(serverSettings);
 
@@ -390,35 +359,37 @@ void Server::onMessageReceived(const std::shared_ptr<StreamSession>& streamSessi
         if (!stream)
         {
             stream = streamManager_->getDefaultStream();
-            group->streamId = stream->getId();
+            Config::instance().setStream(group, stream->getId());
         }
         LOG(DEBUG, LOG_TAG) << "Group: " << group->id << ", stream: " << group->streamId << "\n";
 
+        if (newGroup)
+            status_cache_.invalidateAll();
+        else
+            status_cache_.invalidate(StatusCache::Object::client, client->id);
         saveConfig();
 
         // LOG(DEBUG, LOG_TAG) << "Sending meta data to " << streamSession->clientId << "\n";
         // streamSession->send(stream->getMeta());
-        streamSession->setPcmStream(stream);
-        auto headerChunk = stream->getHeader();
-        LOG(DEBUG, LOG_TAG) << "Sending codec header to " << streamSession->clientId << "\n";
-        streamSession->send(headerChunk);
+        streamServer_->startStream(streamSession, stream, helloMsg.getResume());
 
         if (newGroup)
         {
             // clang-format off
             // Notification: {"jsonrpc":"2.0","method":"Server.OnUpdate","params":{"server":{"groups":[{"clients":[{"config":{"instance":2,"latency":6,"name":"123 456","volume":{"muted":false,"percent":48}},"connected":true,"host":{"arch":"x86_64","ip":"127.0.0.1","mac":"00:21:6a:7d:74:fc","name":"T400","os":"Linux Mint 17.3 Rosa"},"id":"00:21:6a:7d:74:fc#2","lastSeen":{"sec":1488025796,"usec":714671},"snapclient":{"name":"Snapclient","protocolVersion":2,"version":"0.10.0"}}],"id":"4dcc4e3b-c699-a04b-7f0c-8260d23c43e1","muted":false,"name":"","stream_id":"stream 2"},{"clients":[{"config":{"instance":1,"latency":0,"name":"","volume":{"muted":false,"percent":100}},"connected":true,"host":{"arch":"x86_64","ip":"127.0.0.1","mac":"00:21:6a:7d:74:fc","name":"T400","os":"Linux Mint 17.3 Rosa"},"id":"00:21:6a:7d:74:fc","lastSeen":{"sec":1488025798,"usec":728305},"snapclient":{"name":"Snapclient","protocolVersion":2,"version":"0.10.0"}}],"id":"c5da8f7a-f377-1e51-8266-c5cc61099b71","muted":false,"name":"","stream_id":"stream 1"}],"server":{"host":{"arch":"x86_64","ip":"","mac":"","name":"T400","os":"Linux Mint 17.3 Rosa"},"snapserver":{"controlProtocolVersion":1,"name":"Snapserver","protocolVersion":1,"version":"0.10.0"}},"streams":[{"id":"stream 1","status":"idle","uri":{"fragment":"","host":"","path":"/tmp/snapfifo","query":{"chunk_ms":"20","codec":"flac","name":"stream 1","sampleformat":"48000:16:2"},"raw":"pipe:///tmp/snapfifo?name=stream 1","scheme":"pipe"}},{"id":"stream 2","status":"idle","uri":{"fragment":"","host":"","path":"/tmp/snapfifo","query":{"chunk_ms":"20","codec":"flac","name":"stream 2","sampleformat":"48000:16:2"},"raw":"pipe:///tmp/snapfifo?name=stream 2","scheme":"pipe"}}]}}}
             // clang-format on
-            json server = Config::instance().getServerStatus(streamManager_->toJson());
-            json notification = jsonrpcpp::Notification("Server.OnUpdate", jsonrpcpp::Parameter("server", server)).to_json();
-            controlServer_->send(notification.dump());
+            if (controlServer_->isSubscribed("Server.OnUpdate"))
+            {
+                auto server = getServerStatus();
+                controlServer_->send(jsonrpcpp::Notification("Server.OnUpdate", jsonrpcpp::Parameter("server", *server.first)));
+            }
         }
         else
         {
             // clang-format off
             // Notification: {"jsonrpc":"2.0","method":"Client.OnConnect","params":{"client":{"config":{"instance":1,"latency":0,"name":"","volume":{"muted":false,"percent":81}},"connected":true,"host":{"arch":"x86_64","ip":"192.168.0.54","mac":"00:21:6a:7d:74:fc","name":"T400","os":"Linux Mint 17.3 Rosa"},"id":"00:21:6a:7d:74:fc","lastSeen":{"sec":1488025524,"usec":876332},"snapclient":{"name":"Snapclient","protocolVersion":2,"version":"0.10.0"}},"id":"00:21:6a:7d:74:fc"}}
             // clang-format on
-            json notification = jsonrpcpp::Notification("Client.OnConnect", jsonrpcpp::Parameter("id", client->id, "client", client->toJson())).to_json();
-            controlServer_->send(notification.dump());
+            controlServer_->send(jsonrpcpp::Notification("Client.OnConnect", jsonrpcpp::Parameter("id", client->id, "client", client->toJson())));
             // cout << "Notification: " << notification.dump() << "\n";
         }
         //		cout << Config::instance().getServerStatus(streamManager_->toJson()).dump(4) << "\n";
@@ -427,18 +398,32 @@ void Server::onMessageReceived(const std::shared_ptr<StreamSession>& streamSessi
 }
 
 
+uint64_t Server::getStatusVersion() const
+{
+    return status_cache_.version();
+}
+
+
+std::pair<std::shared_ptr<const json>, uint64_t> Server::getServerStatus() const
+{
+    return status_cache_.getStatus([this]() { return Config::instance().getServerStatus(streamManager_->toJson()); });
+}
+
+
 void Server::saveConfig(const std::chrono::milliseconds& deferred)
 {
     static std::mutex mutex;
     std::lock_guard<std::mutex> lock(mutex);
-    config_timer_.cancel();
+    // already scheduled: the snapshot will include this change
+    if (config_timer_.expiry() > std::chrono::steady_clock::now())
+        return;
     config_timer_.expires_after(deferred);
     config_timer_.async_wait([](const boost::system::error_code& ec)
     {
         if (!ec)
         {
-            LOG(DEBUG, LOG_TAG) << "Saving config\n";
-            Config::instance().save();
+            // the file is written on the config's background writer
+            Config::instance().saveAsync();
         }
     });
 }
@@ -476,6 +461,7 @@ void Server::start()
         streamManager_->start();
         controlServer_->start();
         streamServer_->start();
+        probeIoLatency();
     }
     catch (const std::exception& e)
     {
@@ -486,8 +472,23 @@ void Server::start()
 }
 
 
+void Server::probeIoLatency()
+{
+    probe_timer_.expires_after(std::chrono::milliseconds(250));
+    probe_timer_.async_wait([this](const boost::system::error_code& ec)
+    {
+        if (ec)
+            return;
+        io_latency_metric_->observe(std::chrono::steady_clock::now() - probe_timer_.expiry());
+        probeIoLatency();
+    });
+}
+
+
 void Server::stop()
 {
+    probe_timer_.cancel();
+
     if (streamManager_)
     {
         streamManager_->stop();
@@ -27,6 +27,7 @@
 #include "control_server.hpp"
 #include "jsonrpcpp.hpp"
 #include "server_settings.hpp"
+#include "status_cache.hpp"
 #include "stream_server.hpp"
 #include "stream_session.hpp"
 #include "streamreader/stream_manager.hpp"
@@ -75,6 +76,7 @@ private:
         std::ignore = session;
     };
     void onNewSession(std::shared_ptr<StreamSession> session) override;
+    uint64_t getStatusVersion() const override;
 
     /// Implementation of PcmStream::Listener
     void onPropertiesChanged(const PcmStream* pcmStream, const Properties& properties) override;
@@ -84,13 +86,20 @@ private:
     void onResync(const PcmStream* pcmStream, double ms) override;
 
 private:
-    void processRequest(const jsonrpcpp::request_ptr& request, AuthInfo& authinfo, const Request::OnResponse& on_response) const;
+    void processRequest(const jsonrpcpp::request_ptr& request, ControlSession& session, const Request::OnResponse& response_handler) const;
+    /// @return the complete server status and its version, from the status cache if nothing changed
+    std::pair<std::shared_ptr<const json>, uint64_t> getServerStatus() const;
     /// Save the server state deferred to prevent blocking and lower disk io
     /// @param deferred the delay after the last call to saveConfig
     void saveConfig(const std::chrono::milliseconds& deferred = std::chrono::seconds(2));
+    /// Periodically measure the delay of a timer handler, i.e. how busy the io_context is
+    void probeIoLatency();
 
     boost::asio::io_context& io_context_;
     boost::asio::steady_timer config_timer_;
+    boost::asio::steady_timer probe_timer_;
+    /// delay of the probe timer handler
+    std::shared_ptr<metrics::Histogram> io_latency_metric_;
 
     ServerSettings settings_;
     Queue<std::shared_ptr<msg::BaseMessage>> messages_;
@@ -98,4 +107,6 @@ private:
     std::unique_ptr<StreamServer> streamServer_;
     std::unique_ptr<StreamManager> streamManager_;
     ControlRequestFactory request_factory_;
+    /// cached server status, mutable to be updated by the (const) requests
+    mutable StatusCache status_cache_;
 };
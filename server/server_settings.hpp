@@ -20,6 +20,7 @@
 
 
 // local headers
+#include "common/resampler.hpp"
 #include "common/snap_exception.hpp"
 #include "common/utils/string_utils.hpp"
 
@@ -49,6 +50,12 @@ struct ServerSettings
         std::string data_dir;
         /// Enable mDNS to publish services
         bool mdns_enabled{true};
+        /// Window [ms] to coalesce state notifications to control clients, 0 = disabled
+        size_t notification_window_ms{50};
+        /// Max number of outbound messages queued per control session, 0 = unlimited
+        size_t control_queue_size{256};
+        /// Min interval [ms] between two writes of the persistent settings (server.json)
+        size_t save_interval_ms{5000};
     };
 
     /// SSL settings
@@ -177,6 +184,12 @@ struct ServerSettings
         std::string host{"<hostname>"};
         /// URL prefix when serving album art
         std::string url_prefix;
+        /// Max size [kB] of the cached album art, 0 = unlimited
+        size_t image_cache_size_kb{10240};
+        /// Max size [kB] of the in-memory cache of the doc root, 0 = disabled
+        size_t file_cache_size_kb{0};
+        /// Serve metrics in the Prometheus text format under "/metrics", not protected by the control API authentication
+        bool metrics{false};
         /// Publish HTTP service via mDNS as '_snapcast-http._tcp'
         bool publish_http{true};
         /// Publish HTTPS service via mDNS as '_snapcast-https._tcp'
@@ -228,6 +241,8 @@ struct ServerSettings
         size_t streamChunkMs{20};
         /// Send audio to muted clients?
         bool sendAudioToMutedClients{false};
+        /// Quality and threads of the resampler (meta streams and the opus encoder)
+        Resampler::Settings resampler;
     };
 
     /// Client settings
@@ -235,6 +250,8 @@ struct ServerSettings
     {
         /// Initial volume of new clients
         uint16_t initialVolume{100};
+        /// Interval [ms] of the sync stats reported by the clients, 0 = disabled
+        size_t statsIntervalMs{10000};
     };
 
     /// Logging settings
@@ -84,6 +84,12 @@ int main(int argc, char* argv[])
         conf.add<Implicit<string>>("", "server.group", "the group to run as when daemonized", settings.server.group, &settings.server.group);
         conf.add<Implicit<string>>("", "server.datadir", "directory where persistent data is stored", settings.server.data_dir, &settings.server.data_dir);
         conf.add<Value<bool>>("", "server.mdns_enabled", "enable mDNS to publish services", settings.server.mdns_enabled, &settings.server.mdns_enabled);
+        conf.add<Value<size_t>>("", "server.notification_window", "window [ms] to coalesce state notifications to control clients",
+                                settings.server.notification_window_ms, &settings.server.notification_window_ms);
+        conf.add<Value<size_t>>("", "server.control_queue_size", "max number of outbound messages queued per control client",
+                                settings.server.control_queue_size, &settings.server.control_queue_size);
+        conf.add<Value<size_t>>("", "server.save_interval", "min interval [ms] between two writes of the persistent settings",
+                                settings.server.save_interval_ms, &settings.server.save_interval_ms);
 
         // SSL settings
         conf.add<Value<std::filesystem::path>>("", "ssl.certificate", "certificate file (PEM format)", settings.ssl.certificate, &settings.ssl.certificate);
@@ -112,6 +118,11 @@ int main(int argc, char* argv[])
         conf.add<Implicit<string>>("", "http.doc_root", "serve a website from the doc_root location", settings.http.doc_root, &settings.http.doc_root);
         conf.add<Value<string>>("", "http.host", "Hostname or IP under which clients can reach this host", settings.http.host, &settings.http.host);
         conf.add<Value<string>>("", "http.url_prefix", "URL prefix for generating album art URLs", settings.http.url_prefix, &settings.http.url_prefix);
+        conf.add<Value<size_t>>("", "http.image_cache_size", "max size [kB] of the cached album art", settings.http.image_cache_size_kb,
+                                &settings.http.image_cache_size_kb);
+        conf.add<Value<size_t>>("", "http.file_cache_size", "max size [kB] of the in-memory cache of the doc_root, 0 = disabled",
+                                settings.http.file_cache_size_kb, &settings.http.file_cache_size_kb);
+        conf.add<Value<bool>>("", "http.metrics", "serve metrics in the Prometheus text format under /metrics", settings.http.metrics, &settings.http.metrics);
         conf.add<Value<bool>>("", "http.publish_http", "Publish HTTP service via mDNS", settings.http.publish_http, &settings.http.publish_http);
         conf.add<Value<bool>>("", "http.publish_https", "Publish HTTPS service via mDNS", settings.http.publish_https, &settings.http.publish_https);
 
@@ -166,10 +177,13 @@ int main(int argc, char* argv[])
         conf.add<Value<int>>("", "stream.buffer", "Buffer [ms]", settings.stream.bufferMs, &settings.stream.bufferMs);
         conf.add<Value<bool>>("", "stream.send_to_muted", "Send audio to muted clients", settings.stream.sendAudioToMutedClients,
                               &settings.stream.sendAudioToMutedClients);
+        auto resampler_value = conf.add<Value<string>>("", "stream.resampler", "Resampler quality and number of threads <qq|lq|mq|hq|vhq>[:<threads>]", "hq");
 
         // streaming_client options
         conf.add<Value<uint16_t>>("", "streaming_client.initial_volume", "Volume [percent] assigned to new streaming clients",
                                   settings.streamingclient.initialVolume, &settings.streamingclient.initialVolume);
+        conf.add<Value<size_t>>("", "streaming_client.stats_interval", "Interval [ms] of the sync stats reported by the clients, 0 = disabled",
+                                settings.streamingclient.statsIntervalMs, &settings.streamingclient.statsIntervalMs);
 
         // logging settings
         conf.add<Value<string>>("", "logging.sink", "log sink [null,system,stdout,stderr,file:<filename>]", settings.logging.sink, &settings.logging.sink);
@@ -478,6 +492,7 @@ int main(int argc, char* argv[])
             }
         }
 
+        settings.stream.resampler = Resampler::parseSettings(resampler_value->value());
         if (settings.stream.streamChunkMs < 10)
         {
             LOG(WARNING, LOG_TAG) << "Stream read chunk size is less than 10ms, changing to 10ms\n";
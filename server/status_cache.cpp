@@ -0,0 +1,113 @@
+/***
+    This file is part of snapcast
+    Copyright (C) 2014-2025  Johannes Pohl
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+***/
+
+// prototype/interface header file
+#include "status_cache.hpp"
+
+// local headers
+#include "common/aixlog.hpp"
+
+// standard headers
+#include <random>
+
+
+using json = nlohmann::json;
+
+static constexpr auto LOG_TAG = "StatusCache";
+
+namespace
+{
+/// the version counter lives in the lower bits, the epoch in the upper bits
+constexpr uint64_t counter_bits = 32;
+/// versions are sent as JSON numbers, keep them below 2^53 to survive double precision
+constexpr uint64_t epoch_mask = (1ull << (53 - counter_bits)) - 1;
+} // namespace
+
+
+StatusCache::StatusCache() : epoch_((std::random_device{}() & epoch_mask) << counter_bits), version_(epoch_ + 1), tracked_since_(version_)
+{
+}
+
+
+void StatusCache::invalidate(Object type, const std::string& id)
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    changes_[{type, id}] = ++version_;
+    status_.reset();
+}
+
+
+void StatusCache::invalidateAll()
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    tracked_since_ = ++version_;
+    changes_.clear();
+    status_.reset();
+}
+
+
+uint64_t StatusCache::version() const
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    return version_;
+}
+
+
+std::pair<std::shared_ptr<const json>, uint64_t> StatusCache::getStatus(const StatusBuilder& builder)
+{
+    uint64_t version;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (status_ != nullptr)
+            return {status_, status_version_};
+        version = version_;
+    }
+
+    // build without holding the lock, the builder locks the config and the streams
+    LOG(DEBUG, LOG_TAG) << "Building server status, version: " << version << "\n";
+    auto status = std::make_shared<const json>(builder());
+    std::lock_guard<std::mutex> lock(mutex_);
+    // don't cache, if something changed in the meantime
+    if (version == version_)
+    {
+        status_ = status;
+        status_version_ = version;
+    }
+    return {status, version};
+}
+
+
+StatusCache::Changes StatusCache::getChanges(uint64_t since) const
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    Changes changes;
+    changes.version = version_;
+    // a version from another epoch (i.e. a previous server instance) or from the future can't be related to ours
+    bool other_epoch = ((since >> counter_bits) != (epoch_ >> counter_bits)) || (since > version_);
+    if (other_epoch || (since < tracked_since_))
+    {
+        changes.full = true;
+        return changes;
+    }
+    for (const auto& [object, version] : changes_)
+    {
+        if (version > since)
+            changes.ids[object.first].push_back(object.second);
+    }
+    return changes;
+}
@@ -0,0 +1,100 @@
+/***
+    This file is part of snapcast
+    Copyright (C) 2014-2025  Johannes Pohl
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+***/
+
+#pragma once
+
+// local headers
+#include "common/json.hpp"
+
+// 3rd party headers
+
+// standard headers
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <utility>
+#include <vector>
+
+
+/// Versioned cache of the server status
+/**
+ * Every change of a client, group or stream increments the version and is tracked per object,
+ * so that "Server.GetStatus" can be answered from the cached document as long as nothing changed
+ * and "Server.GetChanges" can return only the objects that changed since a given version.
+ * The upper bits of the version hold a random per process epoch, so that versions handed out by
+ * a previous server instance are not mistaken for own ones.
+ */
+class StatusCache
+{
+public:
+    /// c'tor, draws a new epoch
+    StatusCache();
+
+    /// Type of a status object
+    enum class Object : uint8_t
+    {
+        client,
+        group,
+        stream
+    };
+
+    /// Objects that changed since a version
+    struct Changes
+    {
+        /// the current version
+        uint64_t version{0};
+        /// the changes can't be tracked back to the requested version, the complete status must be reloaded
+        bool full{false};
+        /// ids of changed objects, per type
+        std::map<Object, std::vector<std::string>> ids;
+    };
+
+    /// Builds the complete server status
+    using StatusBuilder = std::function<nlohmann::json()>;
+
+    /// Invalidate the object @p type with @p id
+    void invalidate(Object type, const std::string& id);
+    /// Invalidate everything, e.g. when the group structure changed
+    void invalidateAll();
+
+    /// @return the current version
+    uint64_t version() const;
+    /// @return the cached server status and its version, the status is built with @p builder if it is not cached
+    /// The status is shared with other callers of the same version and must not be modified
+    std::pair<std::shared_ptr<const nlohmann::json>, uint64_t> getStatus(const StatusBuilder& builder);
+    /// @return the objects that changed after version @p since
+    Changes getChanges(uint64_t since) const;
+
+private:
+    mutable std::mutex mutex_;
+    /// epoch of this server instance, in the upper bits
+    uint64_t epoch_;
+    /// current version
+    uint64_t version_;
+    /// changes before this version are not tracked
+    uint64_t tracked_since_;
+    /// version of the last change per object
+    std::map<std::pair<Object, std::string>, uint64_t> changes_;
+    /// the cached status, nullptr if it's not cached
+    std::shared_ptr<const nlohmann::json> status_;
+    /// version of the cached status
+    uint64_t status_version_{0};
+};
@@ -27,6 +27,7 @@
 // 3rd party headers
 
 // standard headers
+#include <algorithm>
 #include <iostream>
 
 using namespace std;
@@ -83,27 +84,31 @@ void StreamServer::onChunkEncoded(const PcmStream* pcmStream, bool isDefaultStre
                 sessions.push_back(s);
     }
 
-    for (const auto& session : sessions)
+    if (!settings_.stream.sendAudioToMutedClients)
     {
-        if (!settings_.stream.sendAudioToMutedClients)
+        std::lock_guard<std::mutex> lock(Config::instance().getMutex());
+        auto muted = [](const std::shared_ptr<StreamSession>& session)
         {
-            std::lock_guard<std::mutex> lock(Config::instance().getMutex());
             GroupPtr group = Config::instance().getGroupFromClient(session->clientId);
-            if (group)
-            {
-                if (group->muted)
-                {
-                    continue;
-                }
-                else
-                {
-                    ClientInfoPtr client = group->getClient(session->clientId);
-                    if (client && client->config.volume.muted)
-                        continue;
-                }
-            }
-        }
+            if (!group)
+                return false;
+            if (group->muted)
+                return true;
+            ClientInfoPtr client = Config::instance().getClientInfo(session->clientId);
+            return (client && client->config.volume.muted);
+        };
+        sessions.erase(std::remove_if(sessions.begin(), sessions.end(), muted), sessions.end());
+    }
+
+    std::lock_guard<std::mutex> lock(historyMutex_);
+    auto& history = history_[pcmStream->getId()];
+    history.push_back(buffer);
+    auto oldest = buffer.message().rec_time - std::chrono::milliseconds(settings_.stream.bufferMs);
+    while (history.front().message().rec_time < oldest)
+        history.pop_front();
 
+    for (const auto& session : sessions)
+    {
         if (!session->pcmStream() && isDefaultStream) //->getName() == "default")
             session->send(buffer);
         else if (session->pcmStream().get() == pcmStream)
@@ -112,6 +117,40 @@ void StreamServer::onChunkEncoded(const PcmStream* pcmStream, bool isDefaultStre
 }
 
 
+void StreamServer::startStream(const session_ptr& session, const PcmStreamPtr& pcmStream, const std::optional<tv>& resume)
+{
+    std::lock_guard<std::mutex> lock(historyMutex_);
+    session->setPcmStream(pcmStream);
+    LOG(DEBUG, LOG_TAG) << "Sending codec header to " << session->clientId << "\n";
+    session->send(pcmStream->getHeader());
+    if (!resume.has_value())
+        return;
+
+    auto history = history_.find(pcmStream->getId());
+    if (history == history_.end())
+        return;
+
+    auto last = chronos::time_point_clk(chronos::sec(resume->sec) + chronos::usec(resume->usec));
+    size_t count = 0;
+    for (const auto& buffer : history->second)
+    {
+        if (buffer.message().rec_time > last)
+        {
+            session->send(buffer);
+            ++count;
+        }
+    }
+    LOG(INFO, LOG_TAG) << "Resuming stream for " << session->clientId << ", resending " << count << " chunks\n";
+}
+
+
+void StreamServer::removeStream(const std::string& streamId)
+{
+    std::lock_guard<std::mutex> lock(historyMutex_);
+    history_.erase(streamId);
+}
+
+
 void StreamServer::onMessageReceived(const std::shared_ptr<StreamSession>& streamSession, const msg::BaseMessage& baseMessage, char* buffer)
 {
     try
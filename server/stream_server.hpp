@@ -31,8 +31,12 @@
 #include <boost/asio/steady_timer.hpp>
 
 // standard headers
+#include <deque>
+#include <map>
 #include <memory>
 #include <mutex>
+#include <optional>
+#include <string>
 #include <vector>
 
 
@@ -71,6 +75,13 @@ public:
     /// Callback for chunks that are ready to be sent
     void onChunkEncoded(const PcmStream* pcmStream, bool isDefaultStream, const std::shared_ptr<msg::PcmChunk>& chunk, double duration);
 
+    /// Stream @p pcmStream to @p session, starting with the codec header
+    /// @param resume timestamp of the last chunk the client holds after a reconnect. The buffered chunks after it are sent
+    ///        right after the header, so that the client can continue the playback without a gap
+    void startStream(const session_ptr& session, const PcmStreamPtr& pcmStream, const std::optional<tv>& resume);
+    /// Forget the buffered chunks of the removed stream @p streamId
+    void removeStream(const std::string& streamId);
+
     /// @return stream session for @p clientId
     session_ptr getStreamSession(const std::string& clientId) const;
     /// @return stream session for @p session
@@ -93,5 +104,9 @@ private:
 
     ServerSettings settings_;
     Queue<std::shared_ptr<msg::BaseMessage>> messages_;
+    /// stream id => chunks of the last buffer duration, to resume sessions
+    std::map<std::string, std::deque<shared_const_buffer>> history_;
+    /// chunks are added to the history and sent under this lock, so that a resumed session gets every chunk once
+    std::mutex historyMutex_;
     StreamMessageReceiver* messageReceiver_;
 };
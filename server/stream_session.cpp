@@ -21,10 +21,12 @@
 
 // local headers
 #include "common/aixlog.hpp"
+#include "common/time_defs.hpp"
 
 // 3rd party headers
 
 // standard headers
+#include <chrono>
 #include <iostream>
 
 
@@ -62,13 +64,17 @@ void StreamSession::sendNext()
     buffer.on_air = true;
     boost::asio::post(strand_, [this, self = shared_from_this(), buffer]()
     {
-        sendAsync(buffer, [this, buffer](boost::system::error_code ec, std::size_t length)
+        auto start = std::chrono::steady_clock::now();
+        sendAsync(buffer, [this, buffer, start](boost::system::error_code ec, std::size_t length)
         {
             auto write_handler = buffer.getWriteHandler();
             if (write_handler)
                 write_handler(ec, length);
 
+            metrics_->write_duration->observe(std::chrono::steady_clock::now() - start);
+            metrics_->bytes_sent->inc(length);
             messages_.pop_front();
+            metrics_->queue_depth->set(static_cast<double>(messages_.size()));
             if (ec)
             {
                 LOG(ERROR, LOG_TAG) << "StreamSession write error (msg length: " << length << "): " << ec.message() << "\n";
@@ -86,7 +92,21 @@ void StreamSession::send(shared_const_buffer const_buf, WriteHandler&& handler)
 {
     boost::asio::post(strand_, [this, self = shared_from_this(), const_buf = std::move(const_buf), handler = std::move(handler)]() mutable
     {
+        if (!metrics_)
+        {
+            // created with the first message, the client id is known after the "Hello" message
+            auto& registry = metrics::Registry::instance();
+            metrics::Labels labels{{"client", clientId.empty() ? getIP() : clientId}};
+            metrics_ = std::make_unique<Metrics>();
+            metrics_->queue_depth = registry.gauge("snapserver_session_queue_depth", "Number of messages queued for the client", labels);
+            metrics_->dropped_chunks =
+                registry.counter("snapserver_session_dropped_chunks_total", "Number of PCM chunks dropped, because they were too old", labels);
+            metrics_->bytes_sent = registry.counter("snapserver_session_sent_bytes_total", "Number of bytes sent to the client", labels);
+            metrics_->write_duration = registry.histogram("snapserver_session_write_duration_seconds", "Time to write a message to the client", labels);
+        }
+
         // delete PCM chunks that are older than the overall buffer duration
+        auto size = messages_.size();
         messages_.erase(std::remove_if(messages_.begin(), messages_.end(),
                                        [this](const shared_const_buffer& buffer)
         {
@@ -98,8 +118,11 @@ void StreamSession::send(shared_const_buffer const_buf, WriteHandler&& handler)
         }),
                         messages_.end());
 
+        metrics_->dropped_chunks->inc(size - messages_.size());
+
         const_buf.setWriteHandler(std::move(handler));
         messages_.push_back(std::move(const_buf));
+        metrics_->queue_depth->set(static_cast<double>(messages_.size()));
 
         if (messages_.size() > 1)
         {
@@ -125,3 +148,51 @@ void StreamSession::setBufferMs(size_t bufferMs)
 {
     bufferMs_ = bufferMs;
 }
+
+
+void StreamSession::setClientStats(const msg::ClientStats& stats)
+{
+    std::lock_guard<std::mutex> lock(client_stats_mutex_);
+    client_stats_ = ClientStats{stats, {}};
+    chronos::systemtimeofday(&client_stats_->received);
+
+    if (!client_metrics_)
+    {
+        auto& registry = metrics::Registry::instance();
+        metrics::Labels labels{{"client", clientId}};
+        client_metrics_ = std::make_unique<ClientMetrics>();
+        // "quantile" is reserved for summaries, the client reports precomputed percentiles as gauges
+        std::array<std::string, 4> percentiles{"50", "95", "99", "100"};
+        for (size_t n = 0; n < percentiles.size(); ++n)
+        {
+            client_metrics_->sync_error[n] = registry.gauge("snapserver_client_sync_error_seconds", "Absolute sync error of the client's playback",
+                                                            {{"client", clientId}, {"percentile", percentiles[n]}});
+        }
+        client_metrics_->hard_syncs = registry.counter("snapserver_client_hard_syncs_total", "Number of hard syncs of the client's playback", labels);
+        client_metrics_->underruns = registry.counter("snapserver_client_underruns_total", "Number of buffer underruns of the client's playback", labels);
+        client_metrics_->buffer = registry.gauge("snapserver_client_buffer_seconds", "Queued audio of the client, not yet played", labels);
+        client_metrics_->decode_mean = registry.gauge("snapserver_client_decode_mean_seconds", "Mean time of the client to decode a chunk", labels);
+        client_metrics_->decode_max = registry.gauge("snapserver_client_decode_max_seconds", "Max time of the client to decode a chunk", labels);
+        client_metrics_->device_latency = registry.gauge("snapserver_client_device_latency_seconds", "Latency of the client's audio device", labels);
+        client_metrics_->rtt = registry.gauge("snapserver_client_time_sync_rtt_seconds", "Round trip time of the client's time sync", labels);
+    }
+
+    client_metrics_->sync_error[0]->set(stats.sync_error_p50_us / 1000000.);
+    client_metrics_->sync_error[1]->set(stats.sync_error_p95_us / 1000000.);
+    client_metrics_->sync_error[2]->set(stats.sync_error_p99_us / 1000000.);
+    client_metrics_->sync_error[3]->set(stats.sync_error_max_us / 1000000.);
+    client_metrics_->hard_syncs->inc(stats.hard_syncs);
+    client_metrics_->underruns->inc(stats.underruns);
+    client_metrics_->buffer->set(stats.buffer_ms / 1000.);
+    client_metrics_->decode_mean->set(stats.decode_avg_us / 1000000.);
+    client_metrics_->decode_max->set(stats.decode_max_us / 1000000.);
+    client_metrics_->device_latency->set(stats.device_latency_us / 1000000.);
+    client_metrics_->rtt->set(stats.rtt_us / 1000000.);
+}
+
+
+std::optional<StreamSession::ClientStats> StreamSession::getClientStats() const
+{
+    std::lock_guard<std::mutex> lock(client_stats_mutex_);
+    return client_stats_;
+}
@@ -21,7 +21,9 @@
 
 // local headers
 #include "authinfo.hpp"
+#include "common/message/client_stats.hpp"
 #include "common/message/message.hpp"
+#include "metrics.hpp"
 #include "streamreader/stream_manager.hpp"
 
 // 3rd party headers
@@ -30,9 +32,11 @@
 #include <boost/asio/strand.hpp>
 
 // standard headers
+#include <array>
 #include <deque>
 #include <memory>
 #include <mutex>
+#include <optional>
 #include <sstream>
 #include <string>
 #include <vector>
@@ -185,10 +189,58 @@ public:
     /// Authentication info attached to this session
     AuthInfo authinfo;
 
+    /// Sync stats, reported by the client
+    struct ClientStats
+    {
+        /// the reported stats
+        msg::ClientStats stats;
+        /// time of reception
+        timeval received;
+    };
+
+    /// Set the sync stats @p stats, reported by the client
+    void setClientStats(const msg::ClientStats& stats);
+    /// @return the last sync stats reported by the client, nullopt if the client didn't report any
+    std::optional<ClientStats> getClientStats() const;
+
 protected:
     /// Send next message from "messages_"
     void sendNext();
 
+    /// Metrics of a session
+    struct Metrics
+    {
+        /// number of queued messages
+        std::shared_ptr<metrics::Gauge> queue_depth;
+        /// number of PCM chunks dropped, because they were too old
+        std::shared_ptr<metrics::Counter> dropped_chunks;
+        /// number of bytes sent
+        std::shared_ptr<metrics::Counter> bytes_sent;
+        /// time to write a message
+        std::shared_ptr<metrics::Histogram> write_duration;
+    };
+
+    /// Metrics of the sync stats, reported by the client
+    struct ClientMetrics
+    {
+        /// absolute sync error percentiles 50, 95, 99 and 100
+        std::array<std::shared_ptr<metrics::Gauge>, 4> sync_error;
+        /// number of hard syncs
+        std::shared_ptr<metrics::Counter> hard_syncs;
+        /// number of underruns
+        std::shared_ptr<metrics::Counter> underruns;
+        /// queued audio
+        std::shared_ptr<metrics::Gauge> buffer;
+        /// mean time to decode a chunk
+        std::shared_ptr<metrics::Gauge> decode_mean;
+        /// max time to decode a chunk
+        std::shared_ptr<metrics::Gauge> decode_max;
+        /// latency of the audio device
+        std::shared_ptr<metrics::Gauge> device_latency;
+        /// round trip time of the time sync
+        std::shared_ptr<metrics::Gauge> rtt;
+    };
+
     msg::BaseMessage baseMessage_;                             ///< base message buffer
     std::vector<char> buffer_;                                 ///< buffer
     size_t base_msg_size_;                                     ///< size of a base message
@@ -197,5 +249,9 @@ protected:
     streamreader::PcmStreamPtr pcm_stream_;                    ///< the sessions PCM stream
     boost::asio::strand<boost::asio::any_io_executor> strand_; ///< strand to sync IO on
     std::deque<shared_const_buffer> messages_;                 ///< messages to be sent
+    std::unique_ptr<Metrics> metrics_;                         ///< session metrics, created on the strand with the first message
     mutable std::mutex mutex_;                                 ///< protect pcm_stream_
+    std::optional<ClientStats> client_stats_;                  ///< last sync stats, reported by the client
+    std::unique_ptr<ClientMetrics> client_metrics_;            ///< metrics of the sync stats, created with the first stats
+    mutable std::mutex client_stats_mutex_;                    ///< protect client_stats_ and client_metrics_
 };
@@ -63,7 +63,7 @@ MetaStream::MetaStream(PcmStream::Listener* pcmListener, const std::vector<std::
         throw SnapException("Meta stream '" + getName() + "' must contain at least one stream");
 
     active_stream_ = streams_.front();
-    resampler_ = make_unique<Resampler>(active_stream_->getSampleFormat(), sampleFormat_);
+    resampler_ = make_unique<Resampler>(active_stream_->getSampleFormat(), sampleFormat_, server_settings_.stream.resampler);
 }
 
 
@@ -113,7 +113,7 @@ void MetaStream::onStateChanged(const PcmStream* pcmStream, ReaderState state)
                            << new_stream->getName() << "\n";
         active_stream_ = new_stream;
         setProperties(active_stream_->getProperties());
-        resampler_ = make_unique<Resampler>(active_stream_->getSampleFormat(), sampleFormat_);
+        resampler_ = make_unique<Resampler>(active_stream_->getSampleFormat(), sampleFormat_, server_settings_.stream.resampler);
     };
 
     for (const auto& stream : streams_)
@@ -178,9 +178,8 @@ void MetaStream::onChunkRead(const PcmStream* pcmStream, const msg::PcmChunk& ch
 
     if (resampler_ && resampler_->resamplingNeeded())
     {
-        auto resampled_chunk = resampler_->resample(chunk);
-        if (resampled_chunk)
-            chunkRead(*resampled_chunk);
+        if (resampler_->resample(chunk, resampled_))
+            chunkRead(resampled_);
     }
     else
         chunkRead(chunk);
@@ -80,6 +80,8 @@ private:
     std::recursive_mutex active_mutex_;
     std::shared_ptr<PcmStream> active_stream_;
     std::unique_ptr<Resampler> resampler_;
+    /// output of the resampler, reused for every chunk
+    msg::PcmChunk resampled_;
     bool first_read_;
     std::chrono::time_point<std::chrono::steady_clock> next_tick_;
 };
@@ -35,6 +35,7 @@
 #include <boost/asio/ip/host_name.hpp>
 
 // standard headers
+#include <chrono>
 #include <memory>
 
 
@@ -56,6 +57,7 @@ PcmStream::PcmStream(PcmStream::Listener* pcmListener, boost::asio::io_context&
     if (uri_.query.find(kUriCodec) == uri_.query.end())
         throw SnapException("Stream URI must have a codec");
     encoder_ = encoderFactory.createEncoder(uri_.query[kUriCodec]);
+    encoder_->setResamplerSettings(server_settings_.stream.resampler);
 
     if (uri_.query.find(kUriName) == uri_.query.end())
         throw SnapException("Stream URI must have a name");
@@ -92,6 +94,19 @@ PcmStream::PcmStream(PcmStream::Listener* pcmListener, boost::asio::io_context&
     int32_t max_amplitude = std::pow(2, sampleFormat_.bits() - 1) - 1;
     silence_threshold_ = max_amplitude * (silence_threshold_percent / 100.);
     LOG(DEBUG, LOG_TAG) << "Silence threshold percent: " << silence_threshold_percent << ", silence threshold amplitude: " << silence_threshold_ << "\n";
+
+    auto& registry = metrics::Registry::instance();
+    metrics::Labels labels{{"stream", name_}};
+    metrics_.chunks_read = registry.counter("snapserver_stream_chunks_read_total", "Number of PCM chunks read from the stream", labels);
+    metrics_.encode_duration = registry.histogram("snapserver_stream_encode_duration_seconds", "Time to encode a PCM chunk", labels);
+    metrics_.resyncs = registry.counter("snapserver_stream_resyncs_total", "Number of resyncs, i.e. gaps in the stream", labels);
+    metrics_.resync_duration = registry.histogram("snapserver_stream_resync_duration_seconds", "Duration of the gaps in the stream", labels,
+                                                  {0.001, 0.005, 0.01, 0.05, 0.1, 0.5, 1., 5., 10., 60.});
+    for (auto state : {ReaderState::kIdle, ReaderState::kPlaying, ReaderState::kDisabled})
+    {
+        metrics_.state_changes[state] = registry.counter("snapserver_stream_state_changes_total", "Number of state changes per new state",
+                                                         {{"stream", name_}, {"state", to_string(state)}});
+    }
 }
 
 
@@ -99,6 +114,7 @@ PcmStream::~PcmStream()
 {
     stop(); // NOLINT
     property_timer_.cancel();
+    ImageCache::instance().clear(getName());
 }
 
 
@@ -300,6 +316,9 @@ void PcmStream::setState(ReaderState newState)
     {
         LOG(INFO, LOG_TAG) << "State changed: " << name_ << ", state: " << state_ << " => " << newState << "\n";
         state_ = newState;
+        auto iter = metrics_.state_changes.find(newState);
+        if (iter != metrics_.state_changes.end())
+            iter->second->inc();
         for (auto* listener : pcmListeners_)
         {
             if (listener != nullptr)
@@ -339,12 +358,17 @@ void PcmStream::chunkRead(const msg::PcmChunk& chunk)
         if (listener != nullptr)
             listener->onChunkRead(this, chunk);
     }
+    metrics_.chunks_read->inc();
+    auto start = std::chrono::steady_clock::now();
     encoder_->encode(chunk);
+    metrics_.encode_duration->observe(std::chrono::steady_clock::now() - start);
 }
 
 
 void PcmStream::resync(const std::chrono::nanoseconds& duration)
 {
+    metrics_.resyncs->inc();
+    metrics_.resync_duration->observe(duration);
     for (auto* listener : pcmListeners_)
     {
         if (listener != nullptr)
@@ -534,7 +558,13 @@ void PcmStream::setProperties(const Properties& properties)
         props.metadata = properties_.metadata;
 
     // If the cover image is availbale as raw data, cache it on the HTTP Server to make it also available via HTTP
-    if (props.metadata.has_value() && props.metadata->art_data.has_value() && !props.metadata->art_url.has_value())
+    if (props.metadata.has_value() && props.metadata->art_data.has_value() && !props.metadata->art_url.has_value() && properties_.metadata.has_value() &&
+        (properties_.metadata->art_data == props.metadata->art_data) && properties_.metadata->art_url.has_value())
+    {
+        // The cover didn't change: don't decode and hash it again
+        props.metadata->art_url = properties_.metadata->art_url;
+    }
+    else if (props.metadata.has_value() && props.metadata->art_data.has_value() && !props.metadata->art_url.has_value())
     {
         auto data = base64_decode(props.metadata->art_data->data);
         auto md5 = ImageCache::instance().setImage(getName(), std::move(data), props.metadata->art_data->extension);
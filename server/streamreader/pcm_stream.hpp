@@ -27,6 +27,7 @@
 #include "common/stream_uri.hpp"
 #include "encoder/encoder.hpp"
 #include "jsonrpcpp.hpp"
+#include "metrics.hpp"
 #include "properties.hpp"
 #include "server_settings.hpp"
 #include "stream_control.hpp"
@@ -39,6 +40,8 @@
 
 // standard headers
 #include <atomic>
+#include <map>
+#include <memory>
 #include <mutex>
 #include <string>
 #include <vector>
@@ -264,6 +267,23 @@ protected:
     std::unique_ptr<msg::PcmChunk> chunk_;
     /// Silent chunk (all 0), for fast silence detection (memcmp)
     std::vector<char> silent_chunk_;
+
+    /// Metrics of this stream
+    struct Metrics
+    {
+        /// number of read chunks
+        std::shared_ptr<metrics::Counter> chunks_read;
+        /// time to encode a chunk
+        std::shared_ptr<metrics::Histogram> encode_duration;
+        /// number of resyncs
+        std::shared_ptr<metrics::Counter> resyncs;
+        /// duration of the resyncs, i.e. of the gaps in the stream
+        std::shared_ptr<metrics::Histogram> resync_duration;
+        /// number of state changes per new state
+        std::map<ReaderState, std::shared_ptr<metrics::Counter>> state_changes;
+    };
+    /// Metrics of this stream
+    Metrics metrics_;
 };
 
 } // namespace streamreader
@@ -0,0 +1,118 @@
+/***
+    This file is part of snapcast
+    Copyright (C) 2014-2025  Johannes Pohl
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+***/
+
+// prototype/interface header file
+#include "subscriptions.hpp"
+
+// local headers
+#include "common/snap_exception.hpp"
+#include "common/utils/string_utils.hpp"
+
+// standard headers
+#include <algorithm>
+
+
+using json = nlohmann::json;
+
+
+namespace
+{
+/// @return the string array @p key of @p json, or @p fallback if missing
+std::vector<std::string> getStrings(const json& json, const std::string& key, std::vector<std::string> fallback)
+{
+    if (!json.contains(key))
+        return fallback;
+    const auto& value = json[key];
+    if (!value.is_array() || !std::all_of(value.begin(), value.end(), [](const auto& item) { return item.is_string(); }))
+        throw SnapException("'" + key + "' must be an array of strings");
+    return value.get<std::vector<std::string>>();
+}
+} // namespace
+
+
+Subscriptions::Subscription Subscriptions::Subscription::fromJson(const json& json)
+{
+    if (!json.is_null() && !json.is_object())
+        throw SnapException("Subscription must be an object");
+    Subscription subscription;
+    if (json.is_object())
+    {
+        subscription.notifications = getStrings(json, "notifications", subscription.notifications);
+        subscription.ids = getStrings(json, "ids", subscription.ids);
+    }
+    return subscription;
+}
+
+
+json Subscriptions::Subscription::toJson() const
+{
+    json j;
+    j["notifications"] = notifications;
+    j["ids"] = ids;
+    return j;
+}
+
+
+bool Subscriptions::Subscription::matches(const std::string& method, const std::string& id) const
+{
+    if (!id.empty() && !ids.empty() && (std::find(ids.begin(), ids.end(), id) == ids.end()))
+        return false;
+    return std::any_of(notifications.begin(), notifications.end(),
+                       [&method](const std::string& pattern) { return utils::string::wildcardMatch(pattern, method); });
+}
+
+
+void Subscriptions::add(Subscription subscription)
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    subscriptions_.push_back(std::move(subscription));
+}
+
+
+void Subscriptions::clear()
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    subscriptions_.clear();
+}
+
+
+bool Subscriptions::empty() const
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    return subscriptions_.empty();
+}
+
+
+bool Subscriptions::isSubscribed(const std::string& method, const std::string& id) const
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (subscriptions_.empty())
+        return true;
+    return std::any_of(subscriptions_.begin(), subscriptions_.end(),
+                       [&](const Subscription& subscription) { return subscription.matches(method, id); });
+}
+
+
+json Subscriptions::toJson() const
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    json result = json::array();
+    for (const auto& subscription : subscriptions_)
+        result.push_back(subscription.toJson());
+    return result;
+}
@@ -0,0 +1,70 @@
+/***
+    This file is part of snapcast
+    Copyright (C) 2014-2025  Johannes Pohl
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+***/
+
+#pragma once
+
+// local headers
+#include "common/json.hpp"
+
+// 3rd party headers
+
+// standard headers
+#include <mutex>
+#include <string>
+#include <vector>
+
+
+/// Notification subscriptions of a control session
+/**
+ * A session without subscriptions receives all notifications.
+ * Once subscribed, a session receives only notifications that match at least one subscription.
+ */
+class Subscriptions
+{
+public:
+    /// A subscription to notifications
+    struct Subscription
+    {
+        /// Notification methods, with '*' wildcards, e.g. "Client.OnVolumeChanged" or "Group.*"
+        std::vector<std::string> notifications{"*"};
+        /// Ids of clients, groups or streams. Empty = any. Notifications without an "id" parameter are not filtered by id
+        std::vector<std::string> ids;
+
+        /// @return the subscription parsed from @p json: {"notifications": [...], "ids": [...]}, both optional
+        static Subscription fromJson(const nlohmann::json& json);
+        /// @return subscription as json
+        nlohmann::json toJson() const;
+        /// @return if notification @p method for object @p id matches
+        bool matches(const std::string& method, const std::string& id) const;
+    };
+
+    /// Add @p subscription
+    void add(Subscription subscription);
+    /// Remove all subscriptions, i.e. receive all notifications
+    void clear();
+    /// @return true if there are no subscriptions, i.e. all notifications are received
+    bool empty() const;
+    /// @return if notification @p method for object @p id (empty, if the notification has no id) is received
+    bool isSubscribed(const std::string& method, const std::string& id) const;
+    /// @return all subscriptions as json array
+    nlohmann::json toJson() const;
+
+private:
+    mutable std::mutex mutex_;
+    std::vector<Subscription> subscriptions_;
+};
@@ -0,0 +1,262 @@
+/***
+    This file is part of snapcast
+    Copyright (C) 2014-2025  Johannes Pohl
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+***/
+
+// prototype/interface header file
+#include "sync_simulation.hpp"
+
+// local headers
+#include "client/time_provider.hpp"
+#include "common/message/pcm_chunk.hpp"
+
+// standard headers
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <memory>
+#include <random>
+#include <vector>
+
+
+namespace
+{
+/// number of quick time syncs after connecting, as sent by the Controller
+constexpr uint32_t kQuickSyncs = 50;
+/// frame indices are encoded as low part in the left channel and high part in the right channel
+constexpr int64_t kLowFrames = 4096;
+/// the low part is scaled, for sub frame resolution after resampling
+constexpr int32_t kLowScale = 256;
+/// frames close to a wrap of the low part are not decoded, the resampler smears the step
+constexpr double kWrapMargin = 64.;
+
+/// current time of the virtual local clock
+chronos::time_point_clk virtual_now;
+
+/// @return the current time of the virtual local clock
+chronos::time_point_clk virtualNow()
+{
+    return virtual_now;
+}
+
+/// Replaces the local clock of the TimeProvider by the virtual clock for its lifetime
+struct VirtualClock
+{
+    VirtualClock()
+    {
+        TimeProvider::setClock(&virtualNow);
+        TimeProvider::getInstance().reset();
+    }
+
+    ~VirtualClock()
+    {
+        TimeProvider::setClock(nullptr);
+        TimeProvider::getInstance().reset();
+    }
+};
+
+/// @return @p us microseconds as tv, with a non negative usec part
+tv toTv(int64_t us)
+{
+    int64_t sec = us / 1000000;
+    int64_t usec = us % 1000000;
+    if (usec < 0)
+    {
+        usec += 1000000;
+        --sec;
+    }
+    return {static_cast<int32_t>(sec), static_cast<int32_t>(usec)};
+}
+} // namespace
+
+
+SyncSimulation::SyncSimulation(const Settings& settings) : settings_(settings)
+{
+}
+
+
+SyncSimulation::Result SyncSimulation::run()
+{
+    const Settings& s = settings_;
+    const auto wall_start = std::chrono::steady_clock::now();
+    VirtualClock clock;
+
+    // all times in ns, local times are on the virtual clock
+    const int64_t start = 1000000000000;
+    const int64_t end = start + std::chrono::duration_cast<std::chrono::nanoseconds>(s.duration).count();
+    const int64_t settled = start + std::chrono::duration_cast<std::chrono::nanoseconds>(s.settle_time).count();
+    const double skew = s.server.skew / 1000000.;
+    auto server_time = [&](double local) { return local + static_cast<double>(s.server.offset) * 1000. + skew * (local - static_cast<double>(start)); };
+    const auto server_start = static_cast<int64_t>(server_time(static_cast<double>(start)));
+    auto local_time = [&](int64_t server)
+    { return static_cast<int64_t>(static_cast<double>(start) + static_cast<double>(server - server_start) / (1. + skew)); };
+
+    std::mt19937 random(s.seed);
+    std::exponential_distribution<double> excess(1. / std::max<double>(s.network.mean_excess, 1.));
+    std::uniform_real_distribution<double> uniform(0., 1.);
+    auto network_delay = [&]()
+    {
+        double delay = s.network.min_delay + excess(random);
+        if (uniform(random) < s.network.spike_probability)
+            delay += uniform(random) * s.network.max_spike;
+        return static_cast<int64_t>(delay * 1000.);
+    };
+
+    SampleFormat format(s.rate, 32, 2);
+    Stream stream(format, SampleFormat());
+    stream.setBufferLen(s.buffer_ms);
+    stream.setDriftCorrection(s.drift_correction);
+
+    // server: chunk n is sent as soon as it's complete, TCP keeps the order
+    const int64_t chunk_frames = static_cast<int64_t>(s.rate) * s.chunk_ms / 1000;
+    const int64_t chunk_duration = static_cast<int64_t>(s.chunk_ms) * 1000000;
+    int64_t chunk_index = 0;
+    auto chunk_arrival = [&](int64_t previous) { return std::max(previous, local_time(server_start + (chunk_index + 1) * chunk_duration) + network_delay()); };
+    int64_t next_chunk = chunk_arrival(start);
+
+    // time sync: the server answers immediately
+    uint32_t syncs = 0;
+    int64_t sync_sent = 0;
+    int64_t sync_server = 0;
+    int64_t next_sync = 0;
+    auto send_sync = [&](int64_t now)
+    {
+        sync_sent = now;
+        int64_t request = network_delay();
+        sync_server = static_cast<int64_t>(server_time(static_cast<double>(now + request)));
+        next_sync = now + request + network_delay();
+    };
+    send_sync(start);
+
+    // DAC: consumes frames at its own rate and wakes up when a period is free
+    const double dac_rate = s.rate * (1. + s.dac.drift / 1000000.);
+    const auto dac_buffer = static_cast<int64_t>(s.dac.callback_frames) * s.dac.periods;
+    double dac_start = static_cast<double>(start);
+    int64_t written = 0;
+    int64_t next_callback = start;
+    std::vector<int32_t> buffer(s.dac.callback_frames * format.channels());
+
+    Result result;
+    std::vector<int64_t> errors;
+    double error_sum = 0;
+
+    while (true)
+    {
+        int64_t now = std::min({next_sync, next_chunk, next_callback});
+        if (now >= end)
+            break;
+        virtual_now = chronos::time_point_clk(chronos::nsec(now));
+
+        if (now == next_sync)
+        {
+            TimeProvider::getInstance().setDiff(toTv((sync_server - sync_sent) / 1000), toTv((now - sync_server) / 1000));
+            ++syncs;
+            int64_t interval = (syncs < kQuickSyncs) ? 100000 : (TimeProvider::getInstance().converged() ? 5000000000 : 1000000000);
+            send_sync(now + interval);
+        }
+        else if (now == next_chunk)
+        {
+            auto chunk = std::make_unique<msg::PcmChunk>(format, s.chunk_ms);
+            auto timestamp = (server_start + chunk_index * chunk_duration) / 1000;
+            chunk->timestamp = toTv(timestamp);
+            auto* samples = reinterpret_cast<int32_t*>(chunk->payload);
+            for (int64_t n = 0; n < chunk_frames; ++n)
+            {
+                int64_t frame = chunk_index * chunk_frames + n;
+                samples[2 * n] = static_cast<int32_t>((frame % kLowFrames) * kLowScale);
+                samples[2 * n + 1] = static_cast<int32_t>(frame / kLowFrames);
+            }
+            stream.addChunk(std::move(chunk));
+            ++chunk_index;
+            next_chunk = chunk_arrival(now);
+        }
+        else
+        {
+            double level = static_cast<double>(written) - (static_cast<double>(now) - dac_start) * dac_rate / 1000000000.;
+            if (level < 0)
+            {
+                // underrun: the DAC restarts with the next write
+                if (written > 0)
+                    ++result.underruns;
+                dac_start = static_cast<double>(now) - static_cast<double>(written) * 1000000000. / dac_rate;
+                level = 0;
+            }
+            // the player reports the DAC delay based on the nominal rate
+            auto dac_time = chronos::usec(static_cast<chronos::usec::rep>(level * 1000000. / s.rate));
+            bool played = stream.getPlayerChunkOrSilence(buffer.data(), dac_time, s.dac.callback_frames);
+            ++result.callbacks;
+
+            if (now >= settled)
+            {
+                // the first frames must form a ramp, i.e. be neither silence nor smeared by a wrap
+                auto low = [&](size_t frame) { return static_cast<double>(buffer[frame * 2]) / kLowScale; };
+                bool ramp = (buffer[1] == buffer[3]) && (buffer[3] == buffer[5]) && (std::abs(low(1) - low(0) - 1.) < 0.01) &&
+                            (std::abs(low(2) - low(1) - 1.) < 0.01) && (low(0) >= kWrapMargin) && (low(0) <= kLowFrames - kWrapMargin);
+                if (!played)
+                {
+                    ++result.silent_callbacks;
+                }
+                else if (ramp)
+                {
+                    // the first frame of the callback is audible after the frames in the DAC have been played out
+                    double frame = static_cast<double>(buffer[1]) * kLowFrames + low(0);
+                    double audible = server_time(static_cast<double>(now) + level * 1000000000. / dac_rate);
+                    double expected = static_cast<double>(server_start) + frame * 1000000000. / s.rate + s.buffer_ms * 1000000.;
+                    double error = (audible - expected) / 1000.;
+                    errors.push_back(std::llround(error));
+                    error_sum += error;
+                    double fraction = low(0) - std::floor(low(0));
+                    if ((fraction > 0.01) && (fraction < 0.99))
+                        ++result.interpolated;
+                }
+            }
+
+            written += s.dac.callback_frames;
+            double wakeup = dac_start + static_cast<double>(written - dac_buffer + s.dac.callback_frames) * 1000000000. / dac_rate;
+            next_callback = std::max(now, static_cast<int64_t>(wakeup + uniform(random) * s.dac.jitter * 1000.));
+        }
+    }
+
+    result.statistics = stream.getStatistics();
+    result.samples = errors.size();
+    if (!errors.empty())
+    {
+        result.mean = error_sum / static_cast<double>(errors.size());
+        for (auto& error : errors)
+            error = std::abs(error);
+        std::sort(errors.begin(), errors.end());
+        auto percentile = [&](size_t percent) { return errors[(errors.size() - 1) * percent / 100]; };
+        result.p50 = percentile(50);
+        result.p95 = percentile(95);
+        result.p99 = percentile(99);
+        result.max = errors.back();
+    }
+    std::chrono::duration<double> wall_time = std::chrono::steady_clock::now() - wall_start;
+    result.realtime_factor = std::chrono::duration<double>(s.duration).count() / std::max(wall_time.count(), 1e-9);
+    return result;
+}
+
+
+std::ostream& operator<<(std::ostream& os, const SyncSimulation::Result& result)
+{
+    os << "sync error [us] p50: " << result.p50 << ", p95: " << result.p95 << ", p99: " << result.p99 << ", max: " << result.max
+       << ", mean: " << result.mean << " (" << result.samples << " samples)\n"
+       << "hard syncs: " << result.statistics.hard_syncs << ", frames inserted: " << result.statistics.frames_inserted
+       << ", dropped: " << result.statistics.frames_dropped << ", interpolated: " << result.interpolated << "\n"
+       << "callbacks: " << result.callbacks << ", silent: " << result.silent_callbacks << ", DAC underruns: " << result.underruns
+       << ", realtime factor: " << result.realtime_factor << "\n";
+    return os;
+}
@@ -0,0 +1,146 @@
+/***
+    This file is part of snapcast
+    Copyright (C) 2014-2025  Johannes Pohl
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+***/
+
+#pragma once
+
+
+// local headers
+#include "client/stream.hpp"
+#include "client/variable_resampler.hpp"
+
+// standard headers
+#include <chrono>
+#include <cstdint>
+#include <optional>
+#include <ostream>
+
+
+/// Deterministic simulation of the client sync engine on a virtual clock
+/**
+ * Drives a Stream with chunks from a simulated server, over a simulated network, into a
+ * simulated DAC, without any threads or sleeps: the local clock of the TimeProvider is replaced
+ * by a virtual clock, that jumps from event to event. Hours of playback run in seconds.
+ *
+ * The server clock runs with an offset and a skew relative to the local clock, the DAC consumes
+ * frames with a drift relative to the local clock and wakes up with a jitter. Time syncs and
+ * chunks are delayed by the network: a minimum delay plus an exponentially distributed excess,
+ * plus occasional spikes.
+ *
+ * Every PCM frame carries its own index, so that the true playout time of the first frame of
+ * each DAC callback can be compared to the time it is supposed to be played, in server time.
+ */
+class SyncSimulation
+{
+public:
+    /// Simulation settings
+    struct Settings
+    {
+        /// Network delay of a single message
+        struct Network
+        {
+            /// minimum one way delay [us]
+            uint32_t min_delay{500};
+            /// mean of the exponentially distributed excess delay [us]
+            uint32_t mean_excess{1000};
+            /// probability of a delay spike per message
+            double spike_probability{0.001};
+            /// max additional delay of a spike, uniformly distributed [us]
+            uint32_t max_spike{100000};
+        };
+
+        /// Server clock, relative to the local clock
+        struct Server
+        {
+            /// server time - local time at the start [us]
+            int64_t offset{3600000000};
+            /// skew [ppm], > 0 if the server clock runs faster
+            double skew{-30.};
+        };
+
+        /// Sound card
+        struct Dac
+        {
+            /// drift [ppm], > 0 if the DAC plays faster than the local clock
+            double drift{50.};
+            /// frames per callback
+            uint32_t callback_frames{480};
+            /// number of callback sized periods in the DAC buffer
+            uint32_t periods{4};
+            /// max wakeup delay of a callback, uniformly distributed [us]
+            uint32_t jitter{1000};
+        };
+
+        /// simulated playback duration
+        std::chrono::seconds duration{600};
+        /// sync errors are collected after this time
+        std::chrono::seconds settle_time{60};
+        /// sample rate [Hz]
+        uint32_t rate{48000};
+        /// duration of a server chunk [ms]
+        uint32_t chunk_ms{20};
+        /// end to end latency, i.e. the server buffer [ms]
+        uint32_t buffer_ms{1000};
+        /// drift correction by variable rate resampling, frames are dropped or inserted if not set
+        std::optional<VariableResampler::Quality> drift_correction;
+        /// seed for the network delays and the DAC jitter
+        uint32_t seed{1};
+        Network network;
+        Server server;
+        Dac dac;
+    };
+
+    /// Simulation result
+    struct Result
+    {
+        /// percentiles of the absolute sync error, i.e. true playout time - expected playout time [us]
+        int64_t p50{0};
+        int64_t p95{0};
+        int64_t p99{0};
+        int64_t max{0};
+        /// mean sync error [us], > 0 if playing late
+        double mean{0};
+        /// number of sync error samples
+        uint64_t samples{0};
+        /// number of DAC callbacks
+        uint64_t callbacks{0};
+        /// number of DAC callbacks after the settle time that got no chunk
+        uint64_t silent_callbacks{0};
+        /// number of DAC underruns
+        uint64_t underruns{0};
+        /// number of sync error samples that start between two stream frames, i.e. that were interpolated by the drift resampler
+        uint64_t interpolated{0};
+        /// hard syncs, inserted and dropped frames of the stream
+        Stream::Statistics statistics;
+        /// simulated time / wall clock time
+        double realtime_factor{0};
+    };
+
+    /// c'tor
+    explicit SyncSimulation(const Settings& settings);
+
+    /// Run the simulation
+    /// @return the sync statistics
+    Result run();
+
+private:
+    Settings settings_;
+};
+
+
+/// Print the @p result of a simulation
+std::ostream& operator<<(std::ostream& os, const SyncSimulation::Result& result);
@@ -19,26 +19,57 @@
 // prototype/interface header file
 
 // local headers
+#include "client/clock_recovery.hpp"
+#include "client/double_buffer.hpp"
+#include "client/median_buffer.hpp"
+#include "client/stream.hpp"
+#include "client/time_provider.hpp"
+#include "client/variable_resampler.hpp"
+#include "client/zone_router.hpp"
 #include "common/base64.h"
 #include "common/error_code.hpp"
+#include "common/message/factory.hpp"
+#include "common/message/pcm_chunk.hpp"
+#include "common/resampler.hpp"
+#include "common/sample_format.hpp"
+#include "common/spsc_ring.hpp"
 #include "common/stream_uri.hpp"
 #include "common/utils/file_utils.hpp"
+#include "common/utils/pcm_utils.hpp"
 #include "common/utils/string_utils.hpp"
 // #include "server/jwt.hpp"
 #include "server/authinfo.hpp"
+#include "server/config.hpp"
+#include "server/control_dispatch.hpp"
+#include "server/control_encoding.hpp"
+#include "server/control_session.hpp"
+#include "server/file_cache.hpp"
+#include "server/image_cache.hpp"
+#include "server/metrics.hpp"
 #include "server/server_settings.hpp"
+#include "server/status_cache.hpp"
 #include "server/streamreader/control_error.hpp"
 #include "server/streamreader/properties.hpp"
+#include "server/subscriptions.hpp"
+#include "sync_simulation.hpp"
 
 // 3rd party headers
 #include <catch2/catch_test_macros.hpp>
 
 // standard headers
+#include <algorithm>
+#include <cmath>
 #include <cstddef>
+#include <filesystem>
+#include <fstream>
 #include <iostream>
+#include <memory>
 #include <optional>
+#include <random>
 #include <regex>
+#include <set>
 #include <system_error>
+#include <thread>
 #include <vector>
 
 
@@ -840,3 +871,1231 @@ TEST_CASE("Auth")
         REQUIRE(!auth.hasPermission("Server.GetStatus"));
     }
 }
+
+
+TEST_CASE("Subscriptions")
+{
+    Subscriptions subscriptions;
+    // no subscriptions: receive everything
+    REQUIRE(subscriptions.empty());
+    REQUIRE(subscriptions.isSubscribed("Stream.OnProperties", "stream 1"));
+    REQUIRE(subscriptions.isSubscribed("Server.OnUpdate", ""));
+
+    // a wall tablet for one group and its client
+    subscriptions.add(Subscriptions::Subscription::fromJson(json::parse(R"({"notifications": ["Group.*", "Client.*"], "ids": ["group 1", "client 1"]})")));
+    REQUIRE(!subscriptions.empty());
+    REQUIRE(subscriptions.isSubscribed("Group.OnMute", "group 1"));
+    REQUIRE(subscriptions.isSubscribed("Client.OnVolumeChanged", "client 1"));
+    REQUIRE(!subscriptions.isSubscribed("Group.OnMute", "group 2"));
+    REQUIRE(!subscriptions.isSubscribed("Client.OnVolumeChanged", "client 2"));
+    REQUIRE(!subscriptions.isSubscribed("Stream.OnProperties", "stream 1"));
+    REQUIRE(!subscriptions.isSubscribed("Server.OnUpdate", ""));
+
+    // plus all volume changes, and notifications without id are not filtered by id
+    subscriptions.add(Subscriptions::Subscription::fromJson(json::parse(R"({"notifications": ["Client.OnVolumeChanged", "Server.OnUpdate"]})")));
+    REQUIRE(subscriptions.isSubscribed("Client.OnVolumeChanged", "client 2"));
+    REQUIRE(!subscriptions.isSubscribed("Client.OnNameChanged", "client 2"));
+    REQUIRE(subscriptions.isSubscribed("Server.OnUpdate", ""));
+    REQUIRE(subscriptions.toJson().size() == 2);
+
+    REQUIRE_THROWS_AS(Subscriptions::Subscription::fromJson(json::parse(R"({"ids": "client 1"})")), SnapException);
+    REQUIRE_THROWS_AS(Subscriptions::Subscription::fromJson(json::parse(R"(["Client.*"])")), SnapException);
+
+    subscriptions.clear();
+    REQUIRE(subscriptions.isSubscribed("Stream.OnProperties", "stream 1"));
+}
+
+
+TEST_CASE("ControlEncoding")
+{
+    REQUIRE(parseControlEncoding("CBOR") == ControlEncoding::cbor);
+    REQUIRE(parseControlEncoding("msgpack") == ControlEncoding::msgpack);
+    REQUIRE(parseControlEncoding("json") == ControlEncoding::json);
+    REQUIRE(!parseControlEncoding("bson").has_value());
+    REQUIRE(to_string(ControlEncoding::msgpack) == "msgpack");
+
+    json notification = {
+        {"jsonrpc", "2.0"}, {"method", "Client.OnVolumeChanged"}, {"params", {{"id", "client"}, {"volume", {{"muted", false}, {"percent", 42}}}}}};
+    for (auto encoding : {ControlEncoding::json, ControlEncoding::cbor, ControlEncoding::msgpack})
+        REQUIRE(decode(encode(notification, encoding), encoding) == notification);
+    REQUIRE_THROWS(decode("{\"jsonrpc\": ", ControlEncoding::json));
+    REQUIRE_THROWS(decode("\xff\xff", ControlEncoding::cbor));
+
+    // serialized once per encoding and shared
+    EncodedMessage message(notification);
+    auto cbor = message.get(ControlEncoding::cbor);
+    REQUIRE(cbor == message.get(ControlEncoding::cbor));
+    REQUIRE(*cbor == encode(notification, ControlEncoding::cbor));
+    REQUIRE(cbor->size() < message.get(ControlEncoding::json)->size());
+
+    // created from JSON text, parsed on demand
+    EncodedMessage text(notification.dump());
+    REQUIRE(*text.get(ControlEncoding::json) == notification.dump());
+    REQUIRE(*text.get(ControlEncoding::msgpack) == encode(notification, ControlEncoding::msgpack));
+    REQUIRE(text.json() == notification);
+}
+
+
+namespace
+{
+/// Control session that never writes, to inspect its outbound queue
+class QueueingSession : public ControlSession
+{
+public:
+    explicit QueueingSession(const ServerSettings& settings) : ControlSession(nullptr, settings)
+    {
+    }
+
+    void start() override
+    {
+    }
+
+    void stop() override
+    {
+        stopped = true;
+    }
+
+    void sendAsync(std::shared_ptr<const EncodedMessage> message, std::optional<std::string> notification) override
+    {
+        enqueue(message->get(ControlEncoding::json), ControlEncoding::json, std::move(notification));
+    }
+
+    /// @return the queued messages
+    std::vector<std::string> queued() const
+    {
+        std::vector<std::string> result;
+        for (const auto& message : messages_)
+            result.push_back(*message.data);
+        return result;
+    }
+
+    bool stopped{false};
+};
+} // namespace
+
+
+TEST_CASE("ControlDispatch")
+{
+    std::vector<std::shared_ptr<const EncodedMessage>> responses;
+    auto response_handler = [&responses](std::shared_ptr<const EncodedMessage> response) { responses.push_back(std::move(response)); };
+    size_t notifications = 0;
+    // requests are answered with their method, a notification is sent for every request
+    std::vector<ControlDispatchHandler::OnResponse> pending;
+    bool async = false;
+    ControlDispatchHandler handler;
+    handler.process = [&](const jsonrpcpp::request_ptr& request, const ControlDispatchHandler::OnResponse& on_response)
+    {
+        auto response = std::make_shared<jsonrpcpp::Response>(*request, request->method());
+        auto notification = std::make_shared<jsonrpcpp::Notification>("Test.OnRequest", jsonrpcpp::Parameter("method", request->method()));
+        if (async)
+            pending.emplace_back([on_response, response, notification](const jsonrpcpp::entity_ptr&, const jsonrpcpp::notification_ptr&)
+            { on_response(response, notification); });
+        else
+            on_response(response, notification);
+    };
+    handler.notify = [&notifications](const jsonrpcpp::Notification&) { ++notifications; };
+    handler.notify_batch = [&notifications](const jsonrpcpp::Batch& batch) { notifications += batch.entities.size(); };
+
+    // a single request is answered exactly once
+    dispatchControlMessage(R"({"id":1,"jsonrpc":"2.0","method":"Server.GetRPCVersion"})", ControlEncoding::json, handler, response_handler);
+    REQUIRE(responses.size() == 1);
+    REQUIRE(responses[0] != nullptr);
+    REQUIRE(responses[0]->json()["result"] == "Server.GetRPCVersion");
+    REQUIRE(notifications == 1);
+
+    // also if the request is processed asynchronously
+    async = true;
+    dispatchControlMessage(R"({"id":2,"jsonrpc":"2.0","method":"Stream.Control"})", ControlEncoding::json, handler, response_handler);
+    REQUIRE(responses.size() == 1);
+    REQUIRE(pending.size() == 1);
+    pending.front()(nullptr, nullptr);
+    REQUIRE(responses.size() == 2);
+    REQUIRE(responses[1]->json()["id"] == 2);
+    async = false;
+
+    // a batch gets one batch response
+    dispatchControlMessage(R"([{"id":3,"jsonrpc":"2.0","method":"A"},{"id":4,"jsonrpc":"2.0","method":"B"}])", ControlEncoding::json, handler,
+                           response_handler);
+    REQUIRE(responses.size() == 3);
+    REQUIRE(responses[2]->json().is_array());
+    REQUIRE(responses[2]->json().size() == 2);
+    REQUIRE(notifications == 4);
+
+    // notifications from the client are not answered, parse errors are
+    dispatchControlMessage(R"({"jsonrpc":"2.0","method":"Client.OnSomething"})", ControlEncoding::json, handler, response_handler);
+    REQUIRE(responses.size() == 4);
+    REQUIRE(responses[3] == nullptr);
+    dispatchControlMessage("{no json", ControlEncoding::json, handler, response_handler);
+    REQUIRE(responses.size() == 5);
+    REQUIRE(responses[4]->json()["error"]["code"] == -32700);
+
+    // the request is decoded with the session's encoding
+    std::string cbor = encode(json{{"id", 5}, {"jsonrpc", "2.0"}, {"method", "C"}}, ControlEncoding::cbor);
+    dispatchControlMessage(cbor, ControlEncoding::cbor, handler, response_handler);
+    REQUIRE(responses.size() == 6);
+    REQUIRE(responses[5]->json()["result"] == "C");
+}
+
+
+TEST_CASE("ControlSession queue")
+{
+    ServerSettings settings;
+    settings.server.control_queue_size = 3;
+    QueueingSession session(settings);
+    auto send = [&session](const std::string& text, std::optional<std::string> notification)
+    { session.sendAsync(std::make_shared<const EncodedMessage>(text), std::move(notification)); };
+
+    // the first response is being written, the queue holds 3 more messages
+    send("r1", std::nullopt);
+    send("a1", "Client.OnVolumeChanged/a");
+    send("r2", std::nullopt);
+    send("b1", "Client.OnVolumeChanged/b");
+    REQUIRE(session.queued() == std::vector<std::string>{"r1", "a1", "r2", "b1"});
+
+    // full: the notification superseded by a later one with the same method and id is dropped
+    send("a2", "Client.OnVolumeChanged/a");
+    REQUIRE(session.queued() == std::vector<std::string>{"r1", "r2", "b1", "a2"});
+    // otherwise the oldest notification, never a response
+    send("r3", std::nullopt);
+    REQUIRE(session.queued() == std::vector<std::string>{"r1", "r2", "a2", "r3"});
+    send("r4", std::nullopt);
+    REQUIRE(session.queued() == std::vector<std::string>{"r1", "r2", "r3", "r4"});
+    REQUIRE(!session.stopped);
+
+    // full of responses: the session is closed instead of dropping one
+    send("r5", std::nullopt);
+    REQUIRE(session.stopped);
+    REQUIRE(session.queued().back() == "r5");
+}
+
+
+TEST_CASE("Metrics")
+{
+    auto& registry = metrics::Registry::instance();
+    auto counter = registry.counter("test_requests_total", "Number of requests", {{"method", "Server.GetStatus"}});
+    counter->inc();
+    counter->inc(2);
+    REQUIRE(counter->value() == 3);
+    // same name and labels => same metric
+    REQUIRE(registry.counter("test_requests_total", "Number of requests", {{"method", "Server.GetStatus"}}) == counter);
+    auto other = registry.counter("test_requests_total", "Number of requests", {{"method", "Client.SetVolume"}});
+    REQUIRE(other != counter);
+
+    auto gauge = registry.gauge("test_queue_depth", "Queue depth");
+    gauge->set(5);
+    gauge->add(-2);
+    REQUIRE(gauge->value() == 3);
+
+    auto histogram = registry.histogram("test_duration_seconds", "Duration", {{"stream", "a \"b\""}}, {0.1, 1.});
+    histogram->observe(0.05);
+    histogram->observe(std::chrono::milliseconds(100));
+    histogram->observe(2.);
+    REQUIRE(histogram->buckets() == std::vector<uint64_t>{2, 2, 3});
+    REQUIRE(std::abs(histogram->sum() - 2.15) < 1e-9);
+
+    std::string text = registry.serialize();
+    REQUIRE(text.find("# HELP test_requests_total Number of requests\n# TYPE test_requests_total counter\n") != std::string::npos);
+    REQUIRE(text.find("test_requests_total{method=\"Server.GetStatus\"} 3\n") != std::string::npos);
+    REQUIRE(text.find("test_requests_total{method=\"Client.SetVolume\"} 0\n") != std::string::npos);
+    REQUIRE(text.find("test_queue_depth 3\n") != std::string::npos);
+    REQUIRE(text.find("test_duration_seconds_bucket{stream=\"a \\\"b\\\"\",le=\"0.1\"} 2\n") != std::string::npos);
+    REQUIRE(text.find("test_duration_seconds_bucket{stream=\"a \\\"b\\\"\",le=\"+Inf\"} 3\n") != std::string::npos);
+    REQUIRE(text.find("test_duration_seconds_count{stream=\"a \\\"b\\\"\"} 3\n") != std::string::npos);
+
+    // metrics of destroyed objects are removed
+    other.reset();
+    gauge.reset();
+    text = registry.serialize();
+    REQUIRE(text.find("Client.SetVolume") == std::string::npos);
+    REQUIRE(text.find("test_queue_depth") == std::string::npos);
+    REQUIRE(text.find("Server.GetStatus") != std::string::npos);
+}
+
+
+TEST_CASE("StatusCache")
+{
+    StatusCache cache;
+    size_t builds = 0;
+    auto builder = [&builds]()
+    {
+        ++builds;
+        return json{{"builds", builds}};
+    };
+
+    // the status is built once and served from the cache until something changes
+    auto [status, version] = cache.getStatus(builder);
+    REQUIRE(builds == 1);
+    REQUIRE(version == cache.version());
+    // cached responses share the status instead of copying it
+    REQUIRE(cache.getStatus(builder).first == status);
+    REQUIRE(builds == 1);
+    REQUIRE(cache.getChanges(version).ids.empty());
+    REQUIRE(!cache.getChanges(version).full);
+
+    cache.invalidate(StatusCache::Object::client, "client 1");
+    cache.invalidate(StatusCache::Object::stream, "stream 1");
+    cache.invalidate(StatusCache::Object::client, "client 1");
+    auto [status2, version2] = cache.getStatus(builder);
+    REQUIRE(builds == 2);
+    REQUIRE(version2 == version + 3);
+    REQUIRE(*status2 != *status);
+
+    auto changes = cache.getChanges(version);
+    REQUIRE(!changes.full);
+    REQUIRE(changes.version == version2);
+    REQUIRE(changes.ids[StatusCache::Object::client] == std::vector<std::string>{"client 1"});
+    REQUIRE(changes.ids[StatusCache::Object::stream] == std::vector<std::string>{"stream 1"});
+    REQUIRE(changes.ids[StatusCache::Object::group].empty());
+    // only the second client change is newer than version + 2
+    changes = cache.getChanges(version + 2);
+    REQUIRE(changes.ids.size() == 1);
+    REQUIRE(changes.ids[StatusCache::Object::client].size() == 1);
+
+    // structural changes can't be expressed as delta
+    cache.invalidateAll();
+    REQUIRE(cache.getChanges(version2).full);
+    REQUIRE(!cache.getChanges(cache.version()).full);
+    REQUIRE(cache.getStatus(builder).second == cache.version());
+    REQUIRE(builds == 3);
+
+    // versions of another server instance (epoch) or from the future require a full reload
+    REQUIRE(cache.getChanges(cache.version() + 1).full);
+    REQUIRE(cache.getChanges(cache.version() ^ (1ull << 40)).full);
+    REQUIRE(cache.getChanges(0).full);
+    REQUIRE(cache.version() < (1ull << 53));
+}
+
+
+TEST_CASE("Config index")
+{
+    namespace fs = std::filesystem;
+    auto& config = Config::instance();
+    for (const auto& group : config.getGroupList())
+        config.remove(group, true);
+
+    // the lookups must agree with the group list after every change
+    auto checkIndex = [&config]()
+    {
+        size_t stream_groups = 0;
+        std::set<std::string> streams;
+        for (const auto& group : config.getGroupList())
+        {
+            REQUIRE(config.getGroup(group->id) == group);
+            auto groups = config.getGroupsFromStream(group->streamId);
+            REQUIRE(std::count(groups.begin(), groups.end(), group) == 1);
+            if (streams.insert(group->streamId).second)
+                stream_groups += groups.size();
+            for (const auto& client : group->clients)
+            {
+                REQUIRE(config.getClientInfo(client->id) == client);
+                REQUIRE(config.getGroupFromClient(client->id) == group);
+            }
+        }
+        REQUIRE(stream_groups == config.getGroupList().size());
+    };
+
+    // the persistent file is also written by the Config d'tor, so the directory is not removed
+    auto dir = fs::temp_directory_path() / "snapcast_test_config";
+    fs::create_directories(dir);
+    {
+        json groups = json::array();
+        for (size_t n = 0; n < 3; ++n)
+        {
+            Group group;
+            group.id = "group " + std::to_string(n);
+            group.streamId = (n == 0) ? "stream 1" : "stream 2";
+            group.addClient(std::make_shared<ClientInfo>("client " + std::to_string(n)));
+            groups.push_back(group.toJson());
+        }
+        std::ofstream ofs(dir / "server.json", std::ios::trunc);
+        ofs << json{{"ConfigVersion", 2}, {"Groups", groups}}.dump();
+    }
+    config.init(dir.string());
+    REQUIRE(config.getGroupList().size() == 3);
+    REQUIRE(config.getGroupsFromStream("stream 2").size() == 2);
+    REQUIRE(config.getGroupFromClient("client 1") == config.getGroup("group 1"));
+    checkIndex();
+
+    // into an existing group, and into a new group
+    auto client0 = config.getClientInfo("client 0");
+    auto group1 = config.getGroup("group 1");
+    REQUIRE(config.moveClient(client0, group1) == group1);
+    REQUIRE(config.getGroupFromClient("client 0") == group1);
+    REQUIRE(config.getGroup("group 0")->empty());
+    checkIndex();
+    auto group = config.moveClient(client0);
+    REQUIRE(group != group1);
+    REQUIRE(config.getGroup(group->id) == group);
+    REQUIRE(config.getGroupFromClient(client0) == group);
+    REQUIRE(group1->clients.size() == 1);
+    checkIndex();
+
+    config.setStream(group1, "stream 1");
+    REQUIRE(config.getGroupsFromStream("stream 1").size() == 2);
+    REQUIRE(config.getGroupsFromStream("stream 2").size() == 1);
+    checkIndex();
+
+    // removing the last client removes its group
+    config.remove(client0);
+    REQUIRE(config.getClientInfo("client 0") == nullptr);
+    REQUIRE(config.getGroup(group->id) == nullptr);
+    checkIndex();
+
+    // non-empty groups are only removed by force
+    auto client2 = config.getClientInfo("client 2");
+    config.remove(config.getGroup("group 2"));
+    REQUIRE(config.getGroup("group 2") != nullptr);
+    config.remove(config.getGroup("group 2"), true);
+    REQUIRE(config.getGroup("group 2") == nullptr);
+    REQUIRE(config.getClientInfo("client 2") == nullptr);
+    REQUIRE(config.getGroupFromClient(client2) == nullptr);
+    REQUIRE(config.getGroupsFromStream("stream 2").empty());
+    checkIndex();
+
+    for (const auto& group : config.getGroupList())
+        config.remove(group, true);
+    REQUIRE(config.getClientInfo("client 1") == nullptr);
+}
+
+
+TEST_CASE("Config persistence")
+{
+    namespace fs = std::filesystem;
+    auto& config = Config::instance();
+    for (const auto& group : config.getGroupList())
+        config.remove(group, true);
+    auto& registry = metrics::Registry::instance();
+    auto saves = registry.counter("snapserver_config_saves_total", "");
+    auto skipped = registry.counter("snapserver_config_saves_skipped_total", "");
+
+    // the persistent file is also written by the Config d'tor, so the directory is not removed
+    auto dir = fs::temp_directory_path() / "snapcast_test_config_save";
+    fs::create_directories(dir);
+    auto file = dir / "server.json";
+    auto read = [&file]()
+    {
+        std::ifstream ifs(file);
+        return json::parse(ifs);
+    };
+    std::ofstream(file, std::ios::trunc) << json{{"ConfigVersion", 2}, {"Groups", json::array()}}.dump();
+    fs::permissions(file, fs::perms::owner_read | fs::perms::owner_write | fs::perms::group_read);
+    config.init(dir.string());
+
+    // a crash during a write leaves a partial temp file behind, the config file stays complete
+    std::ofstream(dir / "server.json.tmp", std::ios::trunc) << "{\"ConfigVers";
+    REQUIRE(read()["Groups"].empty());
+    config.addClientInfo("client 1");
+    auto saved = saves->value();
+    config.save();
+    REQUIRE(saves->value() == saved + 1);
+    REQUIRE(read()["Groups"].size() == 1);
+    REQUIRE(!fs::exists(dir / "server.json.tmp"));
+    // the permissions of the replaced file are kept
+    REQUIRE(fs::status(file).permissions() == (fs::perms::owner_read | fs::perms::owner_write | fs::perms::group_read));
+
+    // unchanged snapshots are not written
+    auto skips = skipped->value();
+    config.save();
+    REQUIRE(saves->value() == saved + 1);
+    REQUIRE(skipped->value() == skips + 1);
+
+    // snapshots within the save interval are coalesced into one write of the latest one
+    config.setSaveInterval(std::chrono::milliseconds(200));
+    config.addClientInfo("client 2");
+    config.saveAsync();
+    for (size_t n = 0; (n < 200) && (saves->value() != saved + 2); ++n)
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    REQUIRE(saves->value() == saved + 2);
+    for (size_t n = 3; n < 6; ++n)
+    {
+        config.addClientInfo("client " + std::to_string(n));
+        config.saveAsync();
+    }
+    for (size_t n = 0; (n < 200) && (saves->value() != saved + 3); ++n)
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    std::this_thread::sleep_for(std::chrono::milliseconds(400));
+    REQUIRE(saves->value() == saved + 3);
+    REQUIRE(read()["Groups"].size() == 5);
+    config.setSaveInterval(std::chrono::seconds(5));
+
+    for (const auto& group : config.getGroupList())
+        config.remove(group, true);
+}
+
+
+TEST_CASE("Base64")
+{
+    std::string binary;
+    for (size_t n = 0; n < 300; ++n)
+        binary.push_back(static_cast<char>(n * 7));
+    for (size_t len = 0; len < binary.size(); ++len)
+    {
+        std::string data = binary.substr(0, len);
+        REQUIRE(base64_decode(base64_encode(data)) == data);
+    }
+    REQUIRE(base64_decode("U25hcGNhc3Q=") == "Snapcast");
+    REQUIRE(base64_decode("U25hcGNhc3Q") == "Snapcast");
+    // decoding stops at the first invalid character
+    REQUIRE(base64_decode("U25h\ncGNhc3Q=") == "Sna");
+    REQUIRE(base64url_decode(base64url_encode(binary)) == binary);
+}
+
+
+TEST_CASE("ImageCache")
+{
+    auto& cache = ImageCache::instance();
+    cache.setMaxSize(3500);
+    std::string url1 = cache.setImage("stream 1", std::string(1000, 'a'), "jpg");
+    REQUIRE(url1.size() == 32 + 4);
+    REQUIRE(url1.substr(32) == ".jpg");
+    auto image1 = cache.getImage(url1);
+    REQUIRE(image1 != nullptr);
+    REQUIRE(image1->data == std::string(1000, 'a'));
+    REQUIRE(image1->etag == url1.substr(0, 32));
+    REQUIRE(cache.size() == 1000);
+
+    // the previous cover of a stream stays cached until it's evicted
+    std::string url2 = cache.setImage("stream 1", std::string(1000, 'b'), ".png");
+    REQUIRE(url2 != url1);
+    REQUIRE(cache.getImage(url1) != nullptr);
+    std::string url3 = cache.setImage("stream 2", std::string(1000, 'c'), "jpg");
+    REQUIRE(cache.size() == 3000);
+    REQUIRE(cache.getImage(url1) == image1);
+
+    // url1 is the only unpinned image
+    std::string url4 = cache.setImage("stream 3", std::string(1000, 'd'), "jpg");
+    REQUIRE(cache.getImage(url1) == nullptr);
+    REQUIRE(cache.size() == 3000);
+    // handed out images stay valid
+    REQUIRE(image1->data == std::string(1000, 'a'));
+
+    // current images are never evicted
+    cache.setMaxSize(100);
+    REQUIRE(cache.getImage(url2) != nullptr);
+    REQUIRE(cache.getImage(url3) != nullptr);
+    REQUIRE(cache.getImage(url4) != nullptr);
+
+    cache.clear("stream 1");
+    cache.clear("stream 2");
+    cache.clear("stream 3");
+    REQUIRE(cache.getImage(url2) == nullptr);
+    REQUIRE(cache.size() == 0);
+    cache.setMaxSize(0);
+}
+
+
+TEST_CASE("FileCache")
+{
+    namespace fs = std::filesystem;
+    auto dir = fs::temp_directory_path() / ("snapcast_file_cache_" + std::to_string(std::random_device{}()));
+    fs::create_directories(dir);
+    auto write = [&dir](const std::string& name, const std::string& content)
+    {
+        std::ofstream ofs(dir / name, std::ios::binary | std::ios::trunc);
+        ofs << content;
+    };
+    write("index.html", std::string(1000, 'a'));
+    write("index.html.gz", std::string(100, 'z'));
+    write("app.js", std::string(1000, 'b'));
+
+    boost::asio::io_context io_context;
+    FileCache cache(io_context, 2000);
+    REQUIRE(cache.get((dir / "missing.html").string()) == nullptr);
+    REQUIRE(cache.get(dir.string()) == nullptr);
+
+    auto index = cache.get((dir / "index.html").string());
+    REQUIRE(index != nullptr);
+    REQUIRE(*index->data == std::string(1000, 'a'));
+    REQUIRE(index->gzip != nullptr);
+    REQUIRE(*index->gzip == std::string(100, 'z'));
+    REQUIRE(index->etag.size() == 34);
+    REQUIRE(index->etag != index->gzip_etag);
+    REQUIRE(cache.size() == 1100);
+    // served from the cache
+    REQUIRE(cache.get((dir / "index.html").string()) == index);
+    // other spellings of the path share the entry
+    REQUIRE(cache.get(dir.string() + "//index.html") == index);
+    REQUIRE(cache.get((dir / "." / "index.html").string()) == index);
+    REQUIRE(cache.size() == 1100);
+
+    // least recently used files are evicted
+    auto app = cache.get((dir / "app.js").string());
+    REQUIRE(app != nullptr);
+    REQUIRE(app->gzip == nullptr);
+    REQUIRE(cache.size() == 1000);
+    REQUIRE(cache.get((dir / "index.html").string()) != index);
+    // handed out files stay valid
+    REQUIRE(*index->data == std::string(1000, 'a'));
+
+    // changed files are reloaded
+    app = cache.get((dir / "app.js").string());
+    write("app.js", std::string(500, 'c'));
+    for (size_t n = 0; (n < 100) && (*app->data != std::string(500, 'c')); ++n)
+    {
+        io_context.run_for(std::chrono::milliseconds(10));
+        app = cache.get((dir / "app.js").string());
+    }
+    REQUIRE(*app->data == std::string(500, 'c'));
+
+#ifdef __linux__
+    // changes that are lost in an inotify queue overflow are not missed
+    size_t max_queued_events = 16384;
+    std::ifstream("/proc/sys/fs/inotify/max_queued_events") >> max_queued_events;
+    write("a", "a");
+    write("b", "b");
+    // alternate the files, identical consecutive events are merged
+    for (size_t n = 0; n <= max_queued_events; ++n)
+        fs::permissions(dir / ((n % 2 == 0) ? "a" : "b"), fs::perms::owner_read | fs::perms::owner_write);
+    write("app.js", std::string(500, 'd'));
+    for (size_t n = 0; (n < 100) && (*app->data != std::string(500, 'd')); ++n)
+    {
+        io_context.run_for(std::chrono::milliseconds(10));
+        app = cache.get((dir / "app.js").string());
+    }
+    REQUIRE(*app->data == std::string(500, 'd'));
+#endif
+
+    fs::remove_all(dir);
+}
+
+
+TEST_CASE("Pack24")
+{
+    using namespace utils::pcm;
+    // odd number of samples to exercise the vectorized loops and the scalar tail
+    std::vector<int32_t> samples;
+    for (int32_t n = 0; n < 37; ++n)
+        samples.push_back(((n % 2 == 0) ? 1 : -1) * n * 226099);
+    samples.push_back(8388607);
+    samples.push_back(-8388608);
+
+    std::vector<char> packed(samples.size() * 3);
+    pack24(reinterpret_cast<const char*>(samples.data()), packed.data(), samples.size());
+    for (size_t n = 0; n < samples.size(); ++n)
+    {
+        int32_t sample = static_cast<int32_t>(static_cast<uint32_t>(static_cast<uint8_t>(packed[3 * n])) << 8 |
+                                              static_cast<uint32_t>(static_cast<uint8_t>(packed[3 * n + 1])) << 16 |
+                                              static_cast<uint32_t>(static_cast<uint8_t>(packed[3 * n + 2])) << 24) >>
+                         8;
+        REQUIRE(sample == samples[n]);
+    }
+
+    std::vector<int32_t> unpacked(samples.size());
+    unpack24(packed.data(), reinterpret_cast<char*>(unpacked.data()), samples.size());
+    REQUIRE(unpacked == samples);
+
+    unpack24To32(packed.data(), reinterpret_cast<char*>(unpacked.data()), samples.size());
+    for (size_t n = 0; n < samples.size(); ++n)
+        REQUIRE(unpacked[n] == static_cast<int32_t>(static_cast<uint32_t>(samples[n]) << 8));
+
+    std::vector<int32_t> padded(samples.size());
+    pad24To32(reinterpret_cast<const char*>(samples.data()), reinterpret_cast<char*>(padded.data()), samples.size());
+    REQUIRE(padded == unpacked);
+    round32To24(reinterpret_cast<char*>(padded.data()), padded.size());
+    REQUIRE(padded == samples);
+    // rounded to the nearest and saturated
+    std::vector<int32_t> wide{127, 128, -128, -129, INT32_MAX, INT32_MIN, 0x7fffff7f, 0x7fffff80};
+    round32To24(reinterpret_cast<char*>(wide.data()), wide.size());
+    REQUIRE(wide == std::vector<int32_t>{0, 1, 0, -1, 8388607, -8388608, 8388607, 8388607});
+
+    SampleFormat format(48000, 24, 2, 3);
+    REQUIRE(format.isPacked24());
+    REQUIRE(format.sampleSize() == 3);
+    REQUIRE(format.frameSize() == 6);
+    format.setFormat(48000, 24, 2);
+    REQUIRE(!format.isPacked24());
+    REQUIRE(format.sampleSize() == 4);
+    format.setFormat(48000, 16, 2, 3);
+    REQUIRE(!format.isPacked24());
+    REQUIRE(format.sampleSize() == 2);
+}
+
+
+TEST_CASE("Resampler")
+{
+    SampleFormat padded(48000, 24, 2);
+    SampleFormat packed(48000, 24, 2, 3);
+    REQUIRE(Resampler::parseSettings("vhq:0").quality == Resampler::Quality::very_high);
+    REQUIRE(Resampler::parseSettings("vhq:0").threads == 0);
+    REQUIRE(Resampler::parseSettings("qq").threads == 1);
+    REQUIRE_THROWS_AS(Resampler::parseSettings("best"), SnapException);
+    REQUIRE_THROWS_AS(Resampler::parseSettings("hq:x"), SnapException);
+
+    Resampler resampler(padded, packed);
+    REQUIRE(resampler.resamplingNeeded());
+    msg::PcmChunk in(padded, 10);
+    in.timestamp = {12, 345678};
+    auto* samples = reinterpret_cast<int32_t*>(in.payload);
+    for (size_t n = 0; n < in.getSampleCount(); ++n)
+        samples[n] = static_cast<int32_t>(n) * 1000 - 400000;
+    const std::vector<char> original(in.payload, in.payload + in.payloadSize);
+
+    // the output chunk is reused, also after it has been read
+    msg::PcmChunk out;
+    for (size_t n = 0; n < 2; ++n)
+    {
+        REQUIRE(resampler.resample(in, out));
+        REQUIRE(out.format.isPacked24());
+        REQUIRE(out.getFrameCount() == in.getFrameCount());
+        REQUIRE(out.timestamp.sec == 12);
+        REQUIRE(out.timestamp.usec == 345678);
+        REQUIRE(out.start() == in.start());
+        out.seek(100);
+    }
+    REQUIRE(std::equal(original.begin(), original.end(), in.payload));
+    std::vector<int32_t> unpacked(out.getSampleCount());
+    utils::pcm::unpack24(out.payload, reinterpret_cast<char*>(unpacked.data()), unpacked.size());
+    REQUIRE(std::equal(unpacked.begin(), unpacked.end(), samples));
+}
+
+
+TEST_CASE("Gain")
+{
+    using namespace utils::pcm;
+    // odd number of frames to exercise the vectorized loops and the scalar tail
+    std::vector<int16_t> samples;
+    for (int32_t n = 0; n < 37; ++n)
+        samples.push_back(static_cast<int16_t>(((n % 2 == 0) ? 1 : -1) * n * 881));
+    samples.push_back(32767);
+    samples.push_back(-32768);
+    samples.push_back(12345);
+
+    // unity gain doesn't touch the samples
+    auto buffer = samples;
+    applyGain(reinterpret_cast<char*>(buffer.data()), buffer.size() / 2, 2, 2, 1., 1.);
+    REQUIRE(buffer == samples);
+
+    // constant gain, rounded
+    applyGain(reinterpret_cast<char*>(buffer.data()), buffer.size() / 2, 2, 2, 0.5, 0.5);
+    for (size_t n = 0; n < samples.size(); ++n)
+        REQUIRE(std::abs(buffer[n] - samples[n] / 2.) <= 0.5);
+
+    // saturation instead of wraparound
+    buffer = samples;
+    applyGain(reinterpret_cast<char*>(buffer.data()), buffer.size() / 2, 2, 2, 4., 4.);
+    for (size_t n = 0; n < samples.size(); ++n)
+        REQUIRE(buffer[n] == std::clamp(samples[n] * 4, -32768, 32767));
+
+    // linear ramp per frame, both channels get the same gain and the last frame gets the target gain
+    std::vector<int16_t> constant(2 * 100, 10000);
+    applyGain(reinterpret_cast<char*>(constant.data()), 100, 2, 2, 0., 1.);
+    for (size_t n = 0; n < 100; ++n)
+    {
+        REQUIRE(constant[2 * n] == constant[2 * n + 1]);
+        REQUIRE(std::abs(constant[2 * n] - 10000. * (n + 1) / 100.) <= 2.);
+    }
+    REQUIRE(constant.back() == 10000);
+
+    // ramp down
+    constant.assign(2 * 100, 10000);
+    applyGain(reinterpret_cast<char*>(constant.data()), 100, 2, 2, 1., 0.25);
+    for (size_t n = 0; n < 100; ++n)
+        REQUIRE(std::abs(constant[2 * n] - 10000. * (1. - 0.75 * (n + 1) / 100.)) <= 2.);
+    REQUIRE(constant.back() == 2500);
+
+    // the vectorized constant gain rounds exactly like the scalar code, for all 16 bit samples
+    std::vector<int16_t> all(65536 + 3);
+    for (size_t n = 0; n < all.size(); ++n)
+        all[n] = static_cast<int16_t>(static_cast<int32_t>(n % 65536) - 32768);
+    buffer = all;
+    applyGain(reinterpret_cast<char*>(buffer.data()), buffer.size(), 1, 2, 0.3, 0.3);
+    const int32_t gain15 = static_cast<int32_t>(std::llround(0.3 * 65536)) >> 1;
+    for (size_t n = 0; n < all.size(); ++n)
+        REQUIRE(buffer[n] == ((all[n] * gain15 + (1 << 14)) >> 15));
+
+    // packed 24 and 32 bit samples
+    std::vector<char> packed = {0x00, 0x00, 0x40, static_cast<char>(0xff), static_cast<char>(0xff), static_cast<char>(0xbf)};
+    applyGain(packed.data(), 1, 2, 3, 4., 4.);
+    REQUIRE(packed == std::vector<char>{static_cast<char>(0xff), static_cast<char>(0xff), 0x7f, 0x00, 0x00, static_cast<char>(0x80)});
+    std::vector<int32_t> wide = {8388607, -8388608};
+    applyGain(reinterpret_cast<char*>(wide.data()), 1, 2, 4, 256., 256.);
+    REQUIRE(wide == std::vector<int32_t>{2147483392, -2147483647 - 1});
+}
+
+
+TEST_CASE("SpscRing")
+{
+    SpscRing<std::unique_ptr<int>> ring(3);
+    REQUIRE(ring.capacity() == 3);
+    REQUIRE(ring.empty());
+    REQUIRE(ring.front() == nullptr);
+
+    for (int n = 0; n < 3; ++n)
+        REQUIRE(ring.try_push(std::make_unique<int>(n)));
+    REQUIRE(ring.size() == 3);
+    // a failed push leaves the item untouched
+    auto item = std::make_unique<int>(3);
+    REQUIRE(!ring.try_push(std::move(item)));
+    REQUIRE(item);
+
+    std::unique_ptr<int> value;
+    REQUIRE(**ring.front() == 0);
+    REQUIRE(ring.try_pop(value));
+    REQUIRE(*value == 0);
+    REQUIRE(ring.try_push(std::move(item)));
+    for (int n = 1; n < 4; ++n)
+    {
+        REQUIRE(ring.try_pop(value));
+        REQUIRE(*value == n);
+    }
+    REQUIRE(!ring.try_pop(value));
+    REQUIRE(ring.empty());
+
+    // elements arrive in order across threads
+    SpscRing<size_t> numbers(16);
+    static constexpr size_t count = 100000;
+    auto produce = [&numbers]()
+    {
+        for (size_t n = 0; n < count;)
+        {
+            if (numbers.try_push(size_t(n)))
+                ++n;
+        }
+    };
+    std::thread producer(produce);
+    size_t expected = 0;
+    size_t number;
+    while (expected < count)
+    {
+        if (numbers.try_pop(number))
+        {
+            REQUIRE(number == expected);
+            ++expected;
+        }
+    }
+    producer.join();
+    REQUIRE(numbers.empty());
+}
+
+
+TEST_CASE("MedianBuffer")
+{
+    MedianBuffer<int64_t> empty(5);
+    REQUIRE(empty.median() == 0);
+    REQUIRE(empty.percentile(50) == 0);
+
+    // compare against the sorting DoubleBuffer, with many duplicates
+    std::mt19937 rng(1704);
+    for (size_t size : {1, 2, 7, 100})
+    {
+        MedianBuffer<int64_t> buffer(size);
+        DoubleBuffer<int64_t> reference(size);
+        for (size_t n = 0; n < 3 * size + 50; ++n)
+        {
+            auto value = static_cast<int64_t>(rng() % 50) - 25;
+            buffer.add(value);
+            reference.add(value);
+            REQUIRE(buffer.size() == reference.size());
+            REQUIRE(buffer.full() == reference.full());
+            REQUIRE(buffer.median() == reference.median());
+            REQUIRE(buffer.median(3) == reference.median(3));
+            REQUIRE(buffer.percentile(95) == reference.percentile(95));
+            REQUIRE(buffer.percentiles(std::array<uint8_t, 5>{100, 99, 95, 50, 5}) == reference.percentiles(std::array<uint8_t, 5>{100, 99, 95, 50, 5}));
+            REQUIRE(std::abs(buffer.mean() - reference.mean()) < 0.001);
+        }
+        buffer.clear();
+        REQUIRE(buffer.empty());
+        REQUIRE(buffer.median() == 0);
+        buffer.add(42);
+        REQUIRE(buffer.median() == 42);
+    }
+}
+
+
+TEST_CASE("ClockRecovery")
+{
+    using namespace std::chrono_literals;
+    // server clock: 1s ahead, running 50ppm faster. One way delays of 0.5ms + up to 3ms random queuing
+    std::mt19937 rng(1704);
+    std::uniform_int_distribution<int> queuing(0, 3000);
+    const double skew = 50.;
+    auto true_offset = [skew](double t) { return 1000000. + skew * t; };
+
+    ClockEstimator estimator;
+    REQUIRE(!estimator.converged());
+    chronos::time_point_clk start(10s);
+    auto sync = [&](double t)
+    {
+        int c2s = 500 + ((rng() % 4 == 0) ? queuing(rng) : 0);
+        int s2c = 500 + ((rng() % 4 == 0) ? queuing(rng) : 0);
+        auto local = start + chronos::usec(static_cast<chronos::usec::rep>(t * 1000000.));
+        estimator.update(local, chronos::usec(static_cast<chronos::usec::rep>(true_offset(t) + (c2s - s2c) / 2.)), chronos::usec(c2s + s2c));
+    };
+
+    // 50 quick syncs, then one per second
+    for (int n = 0; n < 50; ++n)
+        sync(n * 0.001);
+    REQUIRE(std::abs(estimator.offset(start).count() - true_offset(0)) < 1000);
+    for (int n = 1; n <= 300; ++n)
+        sync(n);
+    REQUIRE(estimator.converged());
+    REQUIRE(std::abs(estimator.skew() - skew) < 2.);
+    // the estimation is extrapolated between the syncs
+    double t = 305.;
+    REQUIRE(std::abs(static_cast<double>(estimator.offset(start + 305s).count()) - true_offset(t)) < 100.);
+
+    // a clock step restarts the estimation
+    estimator.update(start + 306s, chronos::usec(5000000), chronos::usec(1000));
+    REQUIRE(estimator.offset(start + 306s).count() == 5000000);
+    REQUIRE(!estimator.converged());
+
+    // the PI loop compensates a constant drift of the playback clock against the server: 30ppm too slow
+    RateController controller(0.2, 0.01, 500.);
+    double error = 2000.;
+    for (int n = 0; n < 120 * 100; ++n)
+    {
+        double ratio = controller.update(error, 0.01);
+        // playing with ratio < 1 is faster, reducing the error
+        error += (30. - (1. - ratio) * 1000000.) * 0.01;
+    }
+    REQUIRE(std::abs(error) < 25.);
+    REQUIRE(std::abs((1. - controller.ratio()) * 1000000. - 30.) < 1.);
+
+    // the output is clamped
+    controller.reset();
+    REQUIRE(controller.update(1000000., 0.01) == 1. - 500. / 1000000.);
+}
+
+
+TEST_CASE("VariableResampler")
+{
+    // 1kHz sine, the output must follow the sine at the positions given by the frame accounting
+    SampleFormat format(48000, 16, 2);
+    auto sine = [](double position) { return 10000. * std::sin(2. * 3.14159265358979323846 * 1000. * position / 48000.); };
+
+    for (auto quality : {VariableResampler::Quality::low, VariableResampler::Quality::medium, VariableResampler::Quality::high})
+    {
+        for (double ratio : {1., 0.9995, 1.0005})
+        {
+            VariableResampler resampler(format, quality, 1000);
+            uint64_t read = 0;
+            std::vector<int16_t> input(2 * 1000);
+            std::vector<int16_t> output(2 * 480);
+            for (size_t n = 0; n < 100; ++n)
+            {
+                uint32_t frames = 480 - n % 3;
+                uint32_t in_frames = resampler.inputFrames(frames, ratio);
+                REQUIRE(in_frames <= 1000);
+                for (uint32_t i = 0; i < in_frames; ++i)
+                {
+                    input[2 * i] = static_cast<int16_t>(std::lround(sine(static_cast<double>(read + i))));
+                    input[2 * i + 1] = -input[2 * i];
+                }
+                // position of the first output frame in the input
+                double start = static_cast<double>(read) - resampler.latency();
+                resampler.process(input.data(), in_frames, output.data(), frames, ratio);
+                read += in_frames;
+                if (n == 0)
+                    continue;
+
+                for (uint32_t i = 0; i < frames; ++i)
+                {
+                    double expected = sine(start + i / ratio);
+                    REQUIRE(std::abs(output[2 * i] - expected) < 50.);
+                    REQUIRE(output[2 * i + 1] == -output[2 * i]);
+                }
+            }
+            // the consumed input matches the ratio, up to the lookahead
+            REQUIRE(std::abs(static_cast<double>(read) - resampler.latency() - 100 * 479 / ratio) < 2.);
+        }
+    }
+
+    // packed 24 bit round trip at ratio 1 is lossless with the sinc kernel
+    SampleFormat packed(48000, 24, 1, 3);
+    VariableResampler resampler(packed, VariableResampler::Quality::medium, 100);
+    std::vector<char> input(3 * 100);
+    for (size_t i = 0; i < input.size(); ++i)
+        input[i] = static_cast<char>(i * 37);
+    uint32_t in_frames = resampler.inputFrames(50, 1.);
+    std::vector<char> output(3 * 50);
+    resampler.process(input.data(), in_frames, output.data(), 50, 1.);
+    REQUIRE(resampler.latency() == in_frames - 50);
+    uint32_t more = resampler.inputFrames(50, 1.);
+    REQUIRE(more == 50);
+    resampler.process(input.data() + 3 * in_frames, more, output.data(), 50, 1.);
+    REQUIRE(std::equal(output.begin(), output.end(), input.begin() + 3 * 50));
+}
+
+
+TEST_CASE("Stream drift correction")
+{
+    using namespace std::chrono_literals;
+    // 26 chunks of 1ms, each frame holds its index. The first callback plays 5ms of silence, then the
+    // stream. At ratio 1 both modes play the same frames, but the resampler reads a lookahead of half its
+    // taps, so that the stream runs out of frames one callback earlier.
+    SampleFormat format(8000, 16, 2);
+    const uint32_t frames = 80;
+    // add @p count chunks of @p ms, the first one starts 5ms after the current playback position
+    auto addChunks = [&format](Stream& stream, uint32_t count, uint32_t ms)
+    {
+        const auto chunk_frames = static_cast<uint32_t>(ms * format.msRate());
+        auto first = TimeProvider::serverNow() - 500ms + 5ms;
+        for (uint32_t n = 0; n < count; ++n)
+        {
+            auto chunk = std::make_unique<msg::PcmChunk>(format, ms);
+            auto timestamp = std::chrono::duration_cast<chronos::usec>((first + chronos::msec(n * ms)).time_since_epoch()).count();
+            chunk->timestamp = tv(static_cast<int32_t>(timestamp / 1000000), static_cast<int32_t>(timestamp % 1000000));
+            auto* samples = reinterpret_cast<int16_t*>(chunk->payload);
+            for (uint32_t i = 0; i < chunk_frames; ++i)
+            {
+                samples[2 * i] = static_cast<int16_t>(n * chunk_frames + i);
+                samples[2 * i + 1] = static_cast<int16_t>(-samples[2 * i]);
+            }
+            stream.addChunk(std::move(chunk));
+        }
+    };
+    // @return number of silent frames before frame 1, with frame 0 (which is also silent) included
+    auto silence = [](const std::vector<int16_t>& output)
+    {
+        auto one = std::find(output.begin(), output.end(), 1);
+        REQUIRE(one != output.end());
+        return static_cast<uint32_t>(std::distance(output.begin(), one) / 2 - 1);
+    };
+
+    for (auto drift_correction : {std::optional<VariableResampler::Quality>{}, std::optional<VariableResampler::Quality>{VariableResampler::Quality::high}})
+    {
+        Stream stream(format, SampleFormat());
+        stream.setBufferLen(500);
+        stream.setDriftCorrection(drift_correction);
+        addChunks(stream, 26, 1);
+
+        std::vector<int16_t> output(2 * frames);
+        REQUIRE(stream.getPlayerChunk(output.data(), 0us, frames));
+        // silence up to frame 0
+        auto silent = silence(output);
+        REQUIRE(silent > 24);
+        REQUIRE(silent < 56);
+        for (uint32_t i = silent; i < frames; ++i)
+        {
+            REQUIRE(output[2 * i] == static_cast<int16_t>(i - silent));
+            REQUIRE(output[2 * i + 1] == -output[2 * i]);
+        }
+
+        // soft sync, the frames continue seamlessly
+        REQUIRE(stream.getPlayerChunk(output.data(), 0us, frames));
+        for (uint32_t i = 0; i < frames; ++i)
+            REQUIRE(output[2 * i] == static_cast<int16_t>(frames - silent + i));
+
+        // 208 frames: enough for a third callback, unless 16 more frames are held as lookahead
+        REQUIRE(stream.getPlayerChunk(output.data(), 0us, frames) == !drift_correction.has_value());
+    }
+
+    // periods beyond the preallocated read buffer of 1s are resampled in slices, the frames held by the resampler are not lost
+    Stream stream(format, SampleFormat());
+    stream.setBufferLen(500);
+    stream.setDriftCorrection(VariableResampler::Quality::high);
+    addChunks(stream, 2, 1000);
+    const uint32_t long_frames = 12000;
+    std::vector<int16_t> output(2 * long_frames);
+    REQUIRE(stream.getPlayerChunk(output.data(), 0us, frames));
+    auto silent = silence(output);
+    // the first soft synced callback fills the resampler's lookahead
+    REQUIRE(stream.getPlayerChunk(output.data(), 0us, frames));
+    REQUIRE(stream.getPlayerChunk(output.data(), 0us, long_frames));
+    for (uint32_t i = 0; i < long_frames; ++i)
+        REQUIRE(output[2 * i] == static_cast<int16_t>(2 * frames - silent + i));
+}
+
+
+TEST_CASE("ClientStats")
+{
+    msg::ClientStats stats;
+    stats.interval_ms = 10000;
+    stats.sync_error_p50_us = 25;
+    stats.sync_error_p99_us = 480;
+    stats.hard_syncs = 2;
+    stats.underruns = 1;
+    stats.buffer_ms = 950;
+    stats.rtt_us = 1200;
+    std::ostringstream oss;
+    stats.serialize(oss);
+    std::string data = oss.str();
+
+    msg::BaseMessage base;
+    base.deserialize(data.data());
+    REQUIRE(base.type == message_type::kClientStats);
+    REQUIRE(data.size() == base.getSize() + base.size);
+    auto received = msg::message_cast<msg::ClientStats>(msg::factory::createMessage(base, data.data() + base.getSize()));
+    REQUIRE(received != nullptr);
+    REQUIRE(received->interval_ms == 10000);
+    REQUIRE(received->sync_error_p50_us == 25);
+    REQUIRE(received->sync_error_p95_us == 0);
+    REQUIRE(received->sync_error_p99_us == 480);
+    REQUIRE(received->hard_syncs == 2);
+    REQUIRE(received->underruns == 1);
+    REQUIRE(received->buffer_ms == 950);
+    REQUIRE(received->rtt_us == 1200);
+}
+
+
+TEST_CASE("Stream switch")
+{
+    // 200ms of a constant signal, followed by 300ms of the inverted signal from a new input stream
+    AixLog::Log::init<AixLog::SinkCout>(AixLog::Severity::warning);
+    static chronos::time_point_clk now(std::chrono::seconds(1000));
+    TimeProvider::setClock([]() { return now; });
+    TimeProvider::getInstance().reset();
+
+    SampleFormat format(48000, 16, 2);
+    Stream stream(format, SampleFormat());
+    stream.setBufferLen(100);
+    auto add_chunks = [&](size_t count, int16_t value, chronos::time_point_clk start)
+    {
+        for (size_t n = 0; n < count; ++n)
+        {
+            auto chunk = std::make_unique<msg::PcmChunk>(format, 10);
+            auto timestamp = std::chrono::duration_cast<chronos::usec>((start + n * 10ms).time_since_epoch()).count();
+            chunk->timestamp = {static_cast<int32_t>(timestamp / 1000000), static_cast<int32_t>(timestamp % 1000000)};
+            std::fill_n(reinterpret_cast<int16_t*>(chunk->payload), chunk->getSampleCount(), value);
+            stream.addChunk(std::move(chunk));
+        }
+    };
+    add_chunks(20, 8000, now - 100ms);
+    // the output format would change
+    REQUIRE(!stream.switchInput(SampleFormat(44100, 16, 2), SampleFormat()));
+    REQUIRE(stream.switchInput(format, SampleFormat()));
+    add_chunks(30, -8000, now + 100ms);
+
+    std::vector<int16_t> played;
+    std::vector<int16_t> buffer(2 * 480);
+    for (size_t n = 0; n < 45; ++n)
+    {
+        stream.getPlayerChunkOrSilence(buffer.data(), 0us, 480);
+        for (size_t i = 0; i < 480; ++i)
+            played.push_back(buffer[2 * i]);
+        now += 10ms;
+    }
+    TimeProvider::setClock(nullptr);
+    TimeProvider::getInstance().reset();
+
+    // both streams are played, without a step between them
+    REQUIRE(std::count(played.begin(), played.end(), 8000) > 9000);
+    REQUIRE(std::count(played.begin(), played.end(), -8000) > 9000);
+    for (size_t n = 1; n < played.size(); ++n)
+        REQUIRE(std::abs(played[n] - played[n - 1]) < 100);
+    REQUIRE(stream.getStatistics().hard_syncs == 0);
+}
+
+
+TEST_CASE("Zones")
+{
+    // 3 channels, 16 bit: select the third and the first channel
+    std::vector<int16_t> in{1, 2, 3, 4, 5, 6};
+    std::vector<int16_t> out(4);
+    utils::pcm::mapChannels(reinterpret_cast<const char*>(in.data()), reinterpret_cast<char*>(out.data()), 2, 3, 2, {2, 0});
+    REQUIRE(out == std::vector<int16_t>{3, 1, 6, 4});
+
+    AixLog::Log::init<AixLog::SinkCout>(AixLog::Severity::warning);
+    SampleFormat format(48000, 16, 2);
+    msg::CodecHeader header("pcm", 4);
+    std::fill_n(header.payload, 4, 'x');
+    size_t decoded = 0;
+    auto decode = [&decoded](msg::PcmChunk& chunk)
+    {
+        ++decoded;
+        std::fill_n(reinterpret_cast<int16_t*>(chunk.payload), chunk.getSampleCount(), 1000);
+        return true;
+    };
+    auto encoded = [&format](int32_t sec, char value)
+    {
+        auto chunk = std::make_unique<msg::PcmChunk>(format, 10);
+        chunk->timestamp = {sec, 0};
+        std::fill_n(chunk->payload, chunk->payloadSize, value);
+        return chunk;
+    };
+
+    ZoneRouter router(128, 20ms);
+    auto zone1 = router.join(header);
+    auto zone2 = router.join(header);
+    REQUIRE(router.sources() == 1);
+    REQUIRE(zone1->isLeader());
+    REQUIRE(!zone2->isLeader());
+
+    // the leader decodes, the other zone gets a copy
+    auto chunk1 = zone1->decode(encoded(1, 0), decode);
+    auto chunk2 = zone2->decode(encoded(1, 0), decode);
+    REQUIRE(decoded == 1);
+    REQUIRE(chunk1 != nullptr);
+    REQUIRE(chunk2 != nullptr);
+    REQUIRE(chunk2->payloadSize == chunk1->payloadSize);
+    REQUIRE(reinterpret_cast<int16_t*>(chunk2->payload)[0] == 1000);
+
+    // the leader doesn't deliver: take over
+    chunk2 = zone2->decode(encoded(2, 0), decode);
+    REQUIRE(decoded == 2);
+    REQUIRE(zone2->isLeader());
+    REQUIRE(!zone1->isLeader());
+
+    // same timestamp, different content: another stream with the same header
+    zone1->decode(encoded(3, 0), decode);
+    chunk2 = zone2->decode(encoded(3, 1), decode);
+    REQUIRE(router.sources() == 2);
+    REQUIRE(zone1->isLeader());
+    REQUIRE(zone2->isLeader());
+
+    // the leader leaves, the next member takes over
+    auto zone3 = router.join(header);
+    REQUIRE(!zone3->isLeader());
+    zone2.reset();
+    zone1.reset();
+    REQUIRE(zone3->isLeader());
+    REQUIRE(router.sources() == 1);
+
+    // the first zone that claims the time sync owns it, until it releases it
+    int controller1 = 0;
+    int controller2 = 0;
+    REQUIRE(router.claimTimeSync(&controller2));
+    REQUIRE(!router.claimTimeSync(&controller1));
+    REQUIRE(router.claimTimeSync(&controller2));
+    router.releaseTimeSync(&controller1);
+    REQUIRE(!router.claimTimeSync(&controller1));
+    router.releaseTimeSync(&controller2);
+    REQUIRE(router.claimTimeSync(&controller1));
+    REQUIRE(!router.claimTimeSync(&controller2));
+}
+
+
+TEST_CASE("SyncSimulation")
+{
+    // 10 minutes of playback with server skew, DAC drift, network and wakeup jitter
+    for (auto drift_correction : {std::optional<VariableResampler::Quality>{}, std::optional<VariableResampler::Quality>{VariableResampler::Quality::medium}})
+    {
+        SyncSimulation::Settings settings;
+        settings.drift_correction = drift_correction;
+        auto result = SyncSimulation(settings).run();
+        INFO(result);
+        REQUIRE(result.samples > 20000);
+        REQUIRE(result.statistics.hard_syncs == 0);
+        REQUIRE(result.silent_callbacks == 0);
+        REQUIRE(result.underruns == 0);
+        REQUIRE(result.p99 < 1000);
+        // the drift resampler interpolates between frames, the frame based correction never does
+        if (drift_correction.has_value())
+            REQUIRE(result.interpolated > result.samples / 2);
+        else
+            REQUIRE(result.interpolated == 0);
+        // the stream's own estimation of the sync error
+        REQUIRE(result.statistics.underruns == 0);
+        REQUIRE(result.statistics.sync_error[0] <= result.statistics.sync_error[2]);
+        REQUIRE(result.statistics.sync_error[2] <= result.statistics.sync_error[3]);
+        REQUIRE(result.statistics.sync_error[2] < 1ms);
+        REQUIRE(result.statistics.buffer > 0us);
+    }
+}
+
+
+TEST_CASE("SyncSimulation long", "[.][simulation]")
+{
+    // hours of playback, run explicitly with: snapcast_test "[simulation]" -s
+    SyncSimulation::Settings settings;
+    settings.duration = std::chrono::hours(4);
+    settings.network.mean_excess = 5000;
+    settings.dac.jitter = 3000;
+    for (auto drift_correction : {std::optional<VariableResampler::Quality>{}, std::optional<VariableResampler::Quality>{VariableResampler::Quality::medium}})
+    {
+        settings.drift_correction = drift_correction;
+        auto result = SyncSimulation(settings).run();
+        INFO(result);
+        REQUIRE(result.statistics.hard_syncs == 0);
+    }
+}